@@ -25,12 +25,12 @@
 #include "I2Cdev.h"
 #include "RTIMUSettings.h"
 #include "RTIMU.h"
-#include "RTFusionRTQF.h" 
+#include "RTFusion.h"
 #include "CalLib.h"
 #include <EEPROM.h>
 
 RTIMU *imu;                                           // the IMU object
-RTFusionRTQF fusion;                                  // the fusion object
+RTFusion *fusion;                                     // the fusion object
 RTIMUSettings settings;                               // the settings object
 
 //  DISPLAY_INTERVAL sets the rate at which results are displayed
@@ -53,6 +53,7 @@ void setup()
   Serial.begin(SERIAL_PORT_SPEED);
   Wire.begin();
   imu = RTIMU::createIMU(&settings);                        // create the imu object
+  fusion = RTFusion::createFusion();                        // create the fusion object
   
   Serial.print("ArduinoIMU starting using device "); Serial.println(imu->IMUName());
   if ((errcode = imu->IMUInit()) < 0) {
@@ -87,17 +88,17 @@ void loop()
     // this flushes remaining data in case we are falling behind
     if (++loopCount >= 10)
       continue;
-    fusion.newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
+    fusion->newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
     
     //  do gravity rotation and subtraction
     
     // create the conjugate of the pose
     
-    fusedConjugate = fusion.getFusionQPose().conjugate();
+    fusedConjugate = fusion->getFusionQPose().conjugate();
     
     // now do the rotation - takes two steps with qTemp as the intermediate variable
     
-    qTemp = gravity * fusion.getFusionQPose();
+    qTemp = gravity * fusion->getFusionQPose();
     rotatedGravity = fusedConjugate * qTemp;
     
     // now adjust the measured accel and change the signs to make sense
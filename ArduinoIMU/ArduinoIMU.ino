@@ -25,12 +25,12 @@
 #include "I2Cdev.h"
 #include "RTIMUSettings.h"
 #include "RTIMU.h"
-#include "RTFusionRTQF.h" 
+#include "RTFusion.h"
 #include "CalLib.h"
 #include <EEPROM.h>
 
 RTIMU *imu;                                           // the IMU object
-RTFusionRTQF fusion;                                  // the fusion object
+RTFusion *fusion;                                     // the fusion object
 RTIMUSettings settings;                               // the settings object
 
 //  DISPLAY_INTERVAL sets the rate at which results are displayed
@@ -52,8 +52,12 @@ void setup()
     Serial.begin(SERIAL_PORT_SPEED);
     Wire.begin();
     imu = RTIMU::createIMU(&settings);                        // create the imu object
+    fusion = RTFusion::createFusion();                        // create the fusion object
   
     Serial.print("ArduinoIMU starting using device "); Serial.println(imu->IMUName());
+#ifdef I2CDEV_TRACE
+    Serial.print("I2CTRACE,"); Serial.println(imu->IMUName());
+#endif
     if ((errcode = imu->IMUInit()) < 0) {
         Serial.print("Failed to init IMU: "); Serial.println(errcode);
     }
@@ -66,19 +70,49 @@ void setup()
     lastDisplay = lastRate = millis();
     sampleCount = 0;
 
-    // Slerp power controls the fusion and can be between 0 and 1
-    // 0 means that only gyros are used, 1 means that only accels/compass are used
-    // In-between gives the fusion mix.
-    
-    fusion.setSlerpPower(0.02);
+    // the fusion engine is selected in RTIMULibDefs.h. Its own parameters (such as
+    // the RTFusionRTQF slerp power) default to values that suit most IMUs.
     
     // use of sensors in the fusion algorithm can be controlled here
     // change any of these to false to disable that sensor
     
-    fusion.setGyroEnable(true);
-    fusion.setAccelEnable(true);
-    fusion.setCompassEnable(true);
+    fusion->setGyroEnable(true);
+    fusion->setAccelEnable(true);
+    fusion->setCompassEnable(true);
+
+    // with RTFusionRTQF (include RTFusionRTQF.h) at high sample rates the accel/compass
+    // correction and the Euler angle output can be run less often than the gyro
+    // integration (intervals in uS, 0 = every sample)
+
+    // ((RTFusionRTQF *)fusion)->setCorrectionInterval(10000);
+    // ((RTFusionRTQF *)fusion)->setOutputInterval(100000);
+}
+
+#ifdef I2CDEV_TRACE
+//  dumpTrace sends the I2C bus trace collected since the last call as text
+//  lines for the I2CTrace host tool
+
+void dumpTrace()
+{
+    I2CDEV_TRACE_ENTRY entries[8];
+    uint8_t count;
+    uint16_t lost;
+
+    while ((count = I2Cdev::traceRead(entries, 8)) > 0) {
+        for (uint8_t i = 0; i < count; i++) {
+            Serial.print("I2CT,"); Serial.print(entries[i].start);
+            Serial.print(","); Serial.print(entries[i].duration);
+            Serial.print(","); Serial.print(entries[i].devAddr);
+            Serial.print(","); Serial.print(entries[i].regAddr);
+            Serial.print(","); Serial.print(entries[i].length);
+            Serial.print(","); Serial.println(entries[i].flags);
+        }
+    }
+    if ((lost = I2Cdev::traceLost()) > 0) {
+        Serial.print("I2CLOST,"); Serial.println(lost);
+    }
 }
+#endif
 
 void loop()
 {  
@@ -90,8 +124,11 @@ void loop()
         // this flushes remaining data in case we are falling behind
         if (++loopCount >= 10)
             continue;
-        fusion.newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
+        fusion->newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
         sampleCount++;
+#ifdef I2CDEV_TRACE
+        I2Cdev::traceMark(0);
+#endif
         if ((delta = now - lastRate) >= 1000) {
             Serial.print("Sample rate: "); Serial.print(sampleCount);
             if (imu->IMUGyroBiasValid())
@@ -107,9 +144,12 @@ void loop()
 //          RTMath::display("Gyro:", (RTVector3&)imu->getGyro());                // gyro data
 //          RTMath::display("Accel:", (RTVector3&)imu->getAccel());              // accel data
 //          RTMath::display("Mag:", (RTVector3&)imu->getCompass());              // compass data
-            RTMath::displayRollPitchYaw("Pose:", (RTVector3&)fusion.getFusionPose()); // fused output
+            RTMath::displayRollPitchYaw("Pose:", (RTVector3&)fusion->getFusionPose()); // fused output
            Serial.println();
         }
     }
+#ifdef I2CDEV_TRACE
+    dumpTrace();
+#endif
 }
 
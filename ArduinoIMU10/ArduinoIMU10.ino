@@ -25,14 +25,18 @@
 #include "I2Cdev.h"
 #include "RTIMUSettings.h"
 #include "RTIMU.h"
-#include "RTFusionRTQF.h" 
+#include "RTFusion.h"
 #include "RTPressure.h"
+#include "RTSensorScheduler.h"
+#include "RTAltitudeFusion.h"
 #include "CalLib.h"
 #include <EEPROM.h>
 
+RTSensorScheduler *scheduler;                         // the scheduler - it owns the IMU and pressure objects
 RTIMU *imu;                                           // the IMU object
 RTPressure *pressure;                                 // the pressure object
-RTFusionRTQF fusion;                                  // the fusion object
+RTFusion *fusion;                                     // the fusion object
+RTAltitudeFusion altitude;                            // the altitude fusion object
 RTIMUSettings settings;                               // the settings object
 
 //  DISPLAY_INTERVAL sets the rate at which results are displayed
@@ -46,6 +50,8 @@ RTIMUSettings settings;                               // the settings object
 unsigned long lastDisplay;
 unsigned long lastRate;
 int sampleCount;
+float latestPressure;
+float latestTemperature;
 
 void setup()
 {
@@ -53,8 +59,10 @@ void setup()
   
     Serial.begin(SERIAL_PORT_SPEED);
     Wire.begin();
-    imu = RTIMU::createIMU(&settings);                        // create the imu object
-    pressure = RTPressure::createPressure(&settings);         // create the pressure sensor
+    scheduler = new RTSensorScheduler(&settings);             // create the imu and pressure objects
+    imu = scheduler->getIMU();
+    pressure = scheduler->getPressureSensor();
+    fusion = RTFusion::createFusion();                        // create the fusion object
     
     if (pressure == 0) {
         Serial.println("No pressure sensor has been configured - terminating"); 
@@ -63,12 +71,8 @@ void setup()
     
     Serial.print("ArduinoIMU10 starting using IMU "); Serial.print(imu->IMUName());
     Serial.print(", pressure sensor "); Serial.println(pressure->pressureName());
-    if ((errcode = imu->IMUInit()) < 0) {
-        Serial.print("Failed to init IMU: "); Serial.println(errcode);
-    }
-  
-    if ((errcode = pressure->pressureInit()) < 0) {
-        Serial.print("Failed to init pressure sensor: "); Serial.println(errcode);
+    if ((errcode = scheduler->schedulerInit()) < 0) {
+        Serial.print("Failed to init sensors: "); Serial.println(errcode);
     }
   
     if (imu->getCalibrationValid())
@@ -78,38 +82,43 @@ void setup()
 
     lastDisplay = lastRate = millis();
     sampleCount = 0;
+    latestPressure = 0;
    
-    // Slerp power controls the fusion and can be between 0 and 1
-    // 0 means that only gyros are used, 1 means that only accels/compass are used
-    // In-between gives the fusion mix.
-    
-    fusion.setSlerpPower(0.02);
+    // the fusion engine is selected in RTIMULibDefs.h. Its own parameters (such as
+    // the RTFusionRTQF slerp power) default to values that suit most IMUs.
  
     // use of sensors in the fusion algorithm can be controlled here
     // change any of these to false to disable that sensor
     
-    fusion.setGyroEnable(true);
-    fusion.setAccelEnable(true);
-    fusion.setCompassEnable(true);
+    fusion->setGyroEnable(true);
+    fusion->setAccelEnable(true);
+    fusion->setCompassEnable(true);
 }
 
 void loop()
 {  
     unsigned long now = millis();
     unsigned long delta;
-    float latestPressure;
-    float latestTemperature;
-    int loopCount = 1;
-  
-    while (imu->IMURead()) {                                // get the latest data if ready yet
-        // this flushes remaining data in case we are falling behind
-        if (++loopCount >= 10)
+    int result;
+
+    //  the scheduler reads the IMU when a sample is due and fits the pressure sensor
+    //  accesses in between
+
+    while ((result = scheduler->poll()) != 0) {
+        if (result & RTSCHEDULER_PRESSURE) {
+            latestPressure = scheduler->getPressure();
+            latestTemperature = scheduler->getTemperature();
+            altitude.newPressureData(latestPressure);
+        }
+        if (!(result & RTSCHEDULER_IMU))
             continue;
 
-        fusion.newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
+        fusion->newIMUData(imu->getGyro(), imu->getAccel(), imu->getCompass(), imu->getTimestamp());
+        altitude.newIMUData(fusion->getFusionQPose(), imu->getAccel(), imu->getTimestamp());
         sampleCount++;
         if ((delta = now - lastRate) >= 1000) {
             Serial.print("Sample rate: "); Serial.print(sampleCount);
+            Serial.print(", pressure rate: "); Serial.print(pressure->pressureGetRate());
             if (imu->IMUGyroBiasValid())
                 Serial.println(", gyro bias valid");
             else
@@ -123,14 +132,15 @@ void loop()
 //          RTMath::display("Gyro:", (RTVector3&)imu->getGyro());                // gyro data
 //          RTMath::display("Accel:", (RTVector3&)imu->getAccel());              // accel data
 //          RTMath::display("Mag:", (RTVector3&)imu->getCompass());              // compass data
-            RTMath::displayRollPitchYaw("Pose:", (RTVector3&)fusion.getFusionPose()); // fused output
+            RTMath::displayRollPitchYaw("Pose:", (RTVector3&)fusion->getFusionPose()); // fused output
             
-            if (pressure->pressureRead(latestPressure, latestTemperature)) {
+            if (altitude.getAltitudeValid()) {
                 Serial.print(", pressure: "); Serial.print(latestPressure);
                 Serial.print(", temperature: "); Serial.print(latestTemperature);
+                Serial.print(", altitude: "); Serial.print(altitude.getAltitude());
+                Serial.print(", climb rate: "); Serial.print(altitude.getClimbRate());
             }
             Serial.println();
         }
     }
 }
-
@@ -0,0 +1,354 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  FusionBench runs each of the fusion engines over the same IMU data and reports the
+//  time per update and the pose error. Usage:
+//
+//      FusionBench [-r rate] [-t seconds] [-n passes] [-w file] [file]
+//
+//  With a file it replays the samples in it. Each line is
+//
+//      <timestamp uS>,<gyro x,y,z rad/s>,<accel x,y,z g>,<compass x,y,z>[,<true pose qs,qx,qy,qz>]
+//
+//  and lines that don't parse are ignored. If the lines have the true pose the error is
+//  measured against that, otherwise against RTFusionRTQF. Without a file it generates
+//  rate samples per second (default 100) for the given time (default 120) from a
+//  simulated IMU with gyro bias and noise, accel and compass noise and some periods of
+//  linear acceleration. -w writes the generated data to a file for replay elsewhere.
+//  The timing is the fastest of passes runs (default 20) over the data, in CPU cycles
+//  where they can be read and in nS. The first 10 seconds are left out of the errors
+//  while the engines settle.
+
+#include "RTFusion.h"
+#include "RTFusionRTQF.h"
+#include "RTFusionMEKF.h"
+#include "RTFusionMadgwick.h"
+#include "RTFusionMahony.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define FUSIONBENCH_CYCLES
+#endif
+
+//  The time in seconds at the start that isn't included in the errors
+
+#define FUSIONBENCH_SETTLE          10
+
+//  The simulated IMU - gyro bias in radians/s and noise standard deviations in
+//  radians/s, g and field units. The field has a 60 degree dip.
+
+#define FUSIONBENCH_GYRO_BIAS_X     (RTFLOAT)0.02
+#define FUSIONBENCH_GYRO_BIAS_Y     (RTFLOAT)-0.01
+#define FUSIONBENCH_GYRO_BIAS_Z     (RTFLOAT)0.015
+#define FUSIONBENCH_GYRO_NOISE      0.005
+#define FUSIONBENCH_ACCEL_NOISE     0.01
+#define FUSIONBENCH_COMPASS_NOISE   0.01
+#define FUSIONBENCH_FIELD_X         (RTFLOAT)0.5
+#define FUSIONBENCH_FIELD_Z         (RTFLOAT)-0.866
+
+typedef struct
+{
+    unsigned long timestamp;                                // sample time in uS
+    RTVector3 gyro;                                         // gyro in radians/s
+    RTVector3 accel;                                        // accel in g
+    RTVector3 compass;                                      // compass in any units
+    RTQuaternion truth;                                     // the true pose if known
+} FUSIONBENCH_SAMPLE;
+
+typedef struct
+{
+    const char *name;                                       // engine name
+    RTFusion *fusion;                                       // the engine
+    double cycles;                                          // fastest pass cycles per update
+    double nS;                                              // fastest pass nS per update
+    double rmsError;                                        // rms pose error in degrees
+    double maxError;                                        // max pose error in degrees
+} FUSIONBENCH_ENGINE;
+
+static RTVector3 rotate(const RTQuaternion& q, const RTVector3& v)
+{
+    RTQuaternion p(0, v.x(), v.y(), v.z());
+
+    p = q * p * q.conjugate();
+    return RTVector3(p.x(), p.y(), p.z());
+}
+
+static double poseError(const RTQuaternion& a, const RTQuaternion& b)
+{
+    RTQuaternion e = a.conjugate() * b;
+    double v = sqrt((double)e.x() * e.x() + (double)e.y() * e.y() + (double)e.z() * e.z());
+
+    //  atan2 rather than acos of the scalar as that has no resolution for small angles
+
+    return 2.0 * atan2(v, fabs((double)e.scalar())) * 180.0 / M_PI;
+}
+
+//  The simulated motion is a mix of slow rotations about all three axes
+
+static RTVector3 simRate(double t)
+{
+    return RTVector3(0.8 * sin(0.7 * t), 0.8 * cos(1.3 * t), 0.4 * sin(0.4 * t + 1.0));
+}
+
+static void generate(std::vector<FUSIONBENCH_SAMPLE>& samples, int rate, int seconds)
+{
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0, 1);
+    RTVector3 bias(FUSIONBENCH_GYRO_BIAS_X, FUSIONBENCH_GYRO_BIAS_Y, FUSIONBENCH_GYRO_BIAS_Z);
+    RTVector3 field(FUSIONBENCH_FIELD_X, 0, FUSIONBENCH_FIELD_Z);
+    RTVector3 axis(0, 0, 1);
+    RTQuaternion pose;
+    RTQuaternion step;
+    unsigned long interval = 1000000 / rate;
+    double dt = (double)interval / 1000000.0;
+    FUSIONBENCH_SAMPLE sample;
+
+    pose.fromAngleVector(0.3, axis);
+
+    for (long i = 0; i < (long)rate * seconds; i++) {
+        double t = i * dt;
+        RTVector3 w = simRate(t);
+        RTVector3 up = rotate(pose.conjugate(), RTVector3(0, 0, 1));
+        RTVector3 mag = rotate(pose.conjugate(), field);
+
+        //  two seconds of linear acceleration (in the earth frame) in every ten
+
+        if (fmod(t, 10.0) < 2.0) {
+            RTVector3 linear = rotate(pose.conjugate(), RTVector3(0.3 * sin(5.0 * t), 0.08 * cos(3.0 * t), 0));
+            up += linear;
+        }
+
+        sample.timestamp = i * interval;
+        sample.gyro = RTVector3(w.x() + bias.x() + FUSIONBENCH_GYRO_NOISE * noise(gen),
+                w.y() + bias.y() + FUSIONBENCH_GYRO_NOISE * noise(gen),
+                w.z() + bias.z() + FUSIONBENCH_GYRO_NOISE * noise(gen));
+        sample.accel = RTVector3(up.x() + FUSIONBENCH_ACCEL_NOISE * noise(gen),
+                up.y() + FUSIONBENCH_ACCEL_NOISE * noise(gen),
+                up.z() + FUSIONBENCH_ACCEL_NOISE * noise(gen));
+        sample.compass = RTVector3(mag.x() + FUSIONBENCH_COMPASS_NOISE * noise(gen),
+                mag.y() + FUSIONBENCH_COMPASS_NOISE * noise(gen),
+                mag.z() + FUSIONBENCH_COMPASS_NOISE * noise(gen));
+        sample.truth = pose;
+        samples.push_back(sample);
+
+        //  move the true pose on by the rate at the middle of the interval
+
+        w = simRate(t + dt / 2.0);
+        RTFLOAT angle = w.length();
+        if (angle > 0) {
+            w.normalize();
+            step.fromAngleVector(angle * dt, w);
+            pose *= step;
+            pose.normalize();
+        }
+    }
+}
+
+static bool load(std::vector<FUSIONBENCH_SAMPLE>& samples, const char *fileName, bool& haveTruth)
+{
+    FILE *file = fopen(fileName, "r");
+    char line[512];
+    FUSIONBENCH_SAMPLE sample;
+    double v[14];
+    unsigned long timestamp;
+
+    if (file == NULL) {
+        perror(fileName);
+        return false;
+    }
+
+    haveTruth = true;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int count = sscanf(line, "%lu,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", &timestamp,
+                v, v + 1, v + 2, v + 3, v + 4, v + 5, v + 6, v + 7, v + 8, v + 9, v + 10, v + 11, v + 12);
+
+        if (count < 10)
+            continue;
+        sample.timestamp = timestamp;
+        sample.gyro = RTVector3(v[0], v[1], v[2]);
+        sample.accel = RTVector3(v[3], v[4], v[5]);
+        sample.compass = RTVector3(v[6], v[7], v[8]);
+        if (count == 14)
+            sample.truth = RTQuaternion(v[9], v[10], v[11], v[12]);
+        else
+            haveTruth = false;
+        samples.push_back(sample);
+    }
+    fclose(file);
+    return true;
+}
+
+static bool save(const std::vector<FUSIONBENCH_SAMPLE>& samples, const char *fileName)
+{
+    FILE *file = fopen(fileName, "w");
+
+    if (file == NULL) {
+        perror(fileName);
+        return false;
+    }
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        const FUSIONBENCH_SAMPLE& s = samples[i];
+        fprintf(file, "%lu,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", s.timestamp,
+                s.gyro.x(), s.gyro.y(), s.gyro.z(), s.accel.x(), s.accel.y(), s.accel.z(),
+                s.compass.x(), s.compass.y(), s.compass.z(),
+                s.truth.scalar(), s.truth.x(), s.truth.y(), s.truth.z());
+    }
+    fclose(file);
+    return true;
+}
+
+//  run() puts the data through one engine, recording the pose for every sample
+
+static void run(RTFusion *fusion, const std::vector<FUSIONBENCH_SAMPLE>& samples, std::vector<RTQuaternion>& poses)
+{
+    fusion->reset();
+    for (size_t i = 0; i < samples.size(); i++) {
+        const FUSIONBENCH_SAMPLE& s = samples[i];
+        fusion->newIMUData(s.gyro, s.accel, s.compass, s.timestamp);
+        poses[i] = fusion->getFusionQPose();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<FUSIONBENCH_SAMPLE> samples;
+    std::vector<RTQuaternion> poses;
+    std::vector<RTQuaternion> reference;
+    const char *inFile = NULL;
+    const char *outFile = NULL;
+    int rate = 100;
+    int seconds = 120;
+    int passes = 20;
+    bool haveTruth = true;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+            rate = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            seconds = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            passes = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc))
+            outFile = argv[++i];
+        else if (argv[i][0] != '-')
+            inFile = argv[i];
+        else {
+            fprintf(stderr, "Usage: FusionBench [-r rate] [-t seconds] [-n passes] [-w file] [file]\n");
+            return 1;
+        }
+    }
+
+    if ((rate <= 0) || (seconds <= 0) || (passes <= 0)) {
+        fprintf(stderr, "Rate, time and passes must be positive\n");
+        return 1;
+    }
+
+    if (inFile != NULL) {
+        if (!load(samples, inFile, haveTruth))
+            return 1;
+    } else {
+        generate(samples, rate, seconds);
+        if ((outFile != NULL) && !save(samples, outFile))
+            return 1;
+    }
+
+    if (samples.size() < 2) {
+        fprintf(stderr, "No samples\n");
+        return 1;
+    }
+
+    FUSIONBENCH_ENGINE engines[] = {
+        {"RTQF", new RTFusionRTQF(), 0, 0, 0, 0},
+        {"MEKF", new RTFusionMEKF(), 0, 0, 0, 0},
+        {"Madgwick", new RTFusionMadgwick(), 0, 0, 0, 0},
+        {"Mahony", new RTFusionMahony(), 0, 0, 0, 0},
+    };
+    int engineCount = sizeof(engines) / sizeof(engines[0]);
+
+    poses.resize(samples.size());
+
+    if (!haveTruth) {
+        reference.resize(samples.size());
+        run(engines[0].fusion, samples, reference);
+    }
+
+    for (int e = 0; e < engineCount; e++) {
+        FUSIONBENCH_ENGINE& engine = engines[e];
+        double errorSum = 0;
+        long errorCount = 0;
+
+        for (int pass = 0; pass < passes; pass++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#ifdef FUSIONBENCH_CYCLES
+            unsigned long long startCycles = __rdtsc();
+#endif
+            run(engine.fusion, samples, poses);
+#ifdef FUSIONBENCH_CYCLES
+            double cycles = (double)(__rdtsc() - startCycles) / samples.size();
+            if ((pass == 0) || (cycles < engine.cycles))
+                engine.cycles = cycles;
+#endif
+            double nS = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count() / samples.size();
+            if ((pass == 0) || (nS < engine.nS))
+                engine.nS = nS;
+        }
+
+        for (size_t i = 0; i < samples.size(); i++) {
+            if ((samples[i].timestamp - samples[0].timestamp) < FUSIONBENCH_SETTLE * 1000000UL)
+                continue;
+            double error = poseError(haveTruth ? samples[i].truth : reference[i], poses[i]);
+            errorSum += error * error;
+            errorCount++;
+            if (error > engine.maxError)
+                engine.maxError = error;
+        }
+        if (errorCount > 0)
+            engine.rmsError = sqrt(errorSum / errorCount);
+    }
+
+    printf("%lu samples over %.1f seconds, errors against %s\n\n", (unsigned long)samples.size(),
+            (double)(samples.back().timestamp - samples[0].timestamp) / 1000000.0,
+            haveTruth ? "the true pose" : "RTQF");
+    printf("%-10s %12s %12s %12s %12s\n", "Engine", "cycles/upd", "nS/upd", "rms deg", "max deg");
+
+    for (int e = 0; e < engineCount; e++) {
+        FUSIONBENCH_ENGINE& engine = engines[e];
+#ifdef FUSIONBENCH_CYCLES
+        printf("%-10s %12.0f %12.1f %12.3f %12.3f\n", engine.name, engine.cycles, engine.nS, engine.rmsError, engine.maxError);
+#else
+        printf("%-10s %12s %12.1f %12.3f %12.3f\n", engine.name, "-", engine.nS, engine.rmsError, engine.maxError);
+#endif
+        delete engine.fusion;
+    }
+    return 0;
+}
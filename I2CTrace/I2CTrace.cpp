@@ -0,0 +1,271 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  I2CTrace analyses the I2C bus trace produced when I2CDEV_TRACE is enabled in I2Cdev.h.
+//  It reads the text dump sent by ArduinoIMU (or written by a host build using
+//  I2Cdev::traceRead()) and reports bus utilisation, transactions per sample and a
+//  latency histogram for each device, plus the registers that take the most bus time.
+//  Usage:
+//
+//      I2CTrace [file]                 read the dump from a file (default stdin)
+//
+//  Lines that are not trace lines are ignored so a capture of the whole serial output
+//  can be used directly. The trace lines are:
+//
+//      I2CTRACE,<IMU name>
+//      I2CT,<start uS>,<duration uS>,<device>,<register>,<length>,<flags>
+//      I2CLOST,<entries dropped>
+
+#include <stdint.h>
+#include "I2Cdev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//  Latency histogram buckets are powers of two from I2CTRACE_HIST_FIRST uS
+
+#define I2CTRACE_HIST_FIRST     32
+#define I2CTRACE_HIST_BUCKETS   10
+
+//  The number of registers listed in the top register table
+
+#define I2CTRACE_TOP_REGISTERS  10
+
+typedef struct
+{
+    uint64_t count;                                         // number of transactions
+    uint64_t bytes;                                         // bytes transferred
+    uint64_t busy;                                          // total bus time in uS
+    uint64_t errors;                                        // transactions with I2CDEV_TRACE_ERROR
+    uint32_t maxDuration;                                   // longest transaction in uS
+    uint64_t hist[I2CTRACE_HIST_BUCKETS];                   // duration histogram
+} I2CTRACE_STATS;
+
+static void addStats(I2CTRACE_STATS& stats, const I2CDEV_TRACE_ENTRY& entry)
+{
+    uint32_t limit = I2CTRACE_HIST_FIRST;
+    int bucket = 0;
+
+    stats.count++;
+    stats.bytes += entry.length;
+    stats.busy += entry.duration;
+    if (entry.flags & I2CDEV_TRACE_ERROR)
+        stats.errors++;
+    if (entry.duration > stats.maxDuration)
+        stats.maxDuration = entry.duration;
+
+    while ((bucket < I2CTRACE_HIST_BUCKETS - 1) && (entry.duration >= limit)) {
+        bucket++;
+        limit <<= 1;
+    }
+    stats.hist[bucket]++;
+}
+
+//  deviceName gives the likely part for the addresses used by the RTIMULib drivers
+
+static const char *deviceName(uint8_t devAddr)
+{
+    switch (devAddr) {
+    case 0x0c: return "AK8975/AK8963";
+    case 0x1c: return "LSM303D";
+    case 0x1d: return "LSM303D/LSM9DS0 AM";
+    case 0x19: return "LSM303DLHC accel";
+    case 0x1e: return "HMC5883/LSM303DLHC mag/LSM9DS0 AM";
+    case 0x28: return "BNO055";
+    case 0x29: return "BNO055";
+    case 0x5c: return "LPS25H";
+    case 0x5d: return "LPS25H";
+    case 0x68: return "MPU-9150/9250";
+    case 0x69: return "MPU-9150/9250";
+    case 0x6a: return "L3GD20/LSM9DS0 gyro";
+    case 0x6b: return "L3GD20/LSM9DS0 gyro";
+    case 0x76: return "MS5611";
+    case 0x77: return "BMP180/MS5611";
+    default:   return "";
+    }
+}
+
+static void printHistogram(const I2CTRACE_STATS& stats)
+{
+    uint64_t maxCount = 0;
+    uint32_t limit = I2CTRACE_HIST_FIRST;
+
+    for (int i = 0; i < I2CTRACE_HIST_BUCKETS; i++)
+        maxCount = std::max(maxCount, stats.hist[i]);
+
+    for (int i = 0; i < I2CTRACE_HIST_BUCKETS; i++, limit <<= 1) {
+        if (i < I2CTRACE_HIST_BUCKETS - 1)
+            printf("        < %6uuS %8llu ", limit, (unsigned long long)stats.hist[i]);
+        else
+            printf("       >= %6uuS %8llu ", limit >> 1, (unsigned long long)stats.hist[i]);
+        int bar = maxCount ? (int)((stats.hist[i] * 40 + maxCount - 1) / maxCount) : 0;
+        for (int j = 0; j < bar; j++)
+            putchar('#');
+        putchar('\n');
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *input = stdin;
+    char line[256];
+    std::string imuName;
+    std::map<uint8_t, I2CTRACE_STATS> devices;
+    std::map<uint32_t, I2CTRACE_STATS> registers;           // key is (device << 16) | (register << 8) | write
+    I2CTRACE_STATS total;
+    I2CDEV_TRACE_ENTRY entry;
+    unsigned long start, duration, devAddr, regAddr, length, flags;
+    uint64_t lost = 0;
+    uint64_t samples = 0;
+    uint64_t elapsed = 0;                                   // uS from the first to the last entry
+    uint32_t lastStart = 0;
+    bool haveFirst = false;
+
+    if (argc > 1) {
+        if ((input = fopen(argv[1], "r")) == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    memset(&total, 0, sizeof(total));
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        if (strncmp(line, "I2CTRACE,", 9) == 0) {
+            imuName = std::string(line + 9, strcspn(line + 9, "\r\n"));
+            continue;
+        }
+        if (strncmp(line, "I2CLOST,", 8) == 0) {
+            lost += strtoul(line + 8, NULL, 10);
+            continue;
+        }
+        if (sscanf(line, "I2CT,%lu,%lu,%lu,%lu,%lu,%lu", &start, &duration, &devAddr, &regAddr, &length, &flags) != 6)
+            continue;
+
+        entry.start = start;
+        entry.duration = duration;
+        entry.devAddr = devAddr;
+        entry.regAddr = regAddr;
+        entry.length = length;
+        entry.flags = flags;
+
+        //  micros() wraps every 71 minutes - unsigned differences take care of that
+
+        if (haveFirst)
+            elapsed += (uint32_t)(entry.start - lastStart);
+        lastStart = entry.start;
+        haveFirst = true;
+
+        if (entry.flags & I2CDEV_TRACE_MARK) {
+            samples++;
+            continue;
+        }
+
+        std::map<uint8_t, I2CTRACE_STATS>::iterator dev = devices.find(entry.devAddr);
+        if (dev == devices.end()) {
+            I2CTRACE_STATS empty;
+            memset(&empty, 0, sizeof(empty));
+            dev = devices.insert(std::make_pair(entry.devAddr, empty)).first;
+        }
+        addStats(dev->second, entry);
+
+        uint32_t key = ((uint32_t)entry.devAddr << 16) | ((uint32_t)entry.regAddr << 8) | (entry.flags & I2CDEV_TRACE_WRITE);
+        std::map<uint32_t, I2CTRACE_STATS>::iterator reg = registers.find(key);
+        if (reg == registers.end()) {
+            I2CTRACE_STATS empty;
+            memset(&empty, 0, sizeof(empty));
+            reg = registers.insert(std::make_pair(key, empty)).first;
+        }
+        addStats(reg->second, entry);
+        addStats(total, entry);
+    }
+
+    if (input != stdin)
+        fclose(input);
+
+    if (total.count == 0) {
+        printf("No trace entries found\n");
+        return 1;
+    }
+
+    if (elapsed == 0)
+        elapsed = 1;
+
+    //  summary
+
+    printf("IMU: %s\n", imuName.empty() ? "(unknown)" : imuName.c_str());
+    printf("Trace span %.3fs, %llu transactions, %llu bytes, %llu errors, %llu entries lost\n",
+           (double)elapsed / 1000000.0, (unsigned long long)total.count, (unsigned long long)total.bytes,
+           (unsigned long long)total.errors, (unsigned long long)lost);
+    printf("Bus utilisation %.1f%%, mean transaction %.0fuS\n",
+           100.0 * (double)total.busy / (double)elapsed, (double)total.busy / (double)total.count);
+    if (samples > 0)
+        printf("Samples %llu (%.1f/s): %.2f transactions, %.0f bytes and %.0fuS of bus time per sample\n",
+               (unsigned long long)samples, (double)samples * 1000000.0 / (double)elapsed,
+               (double)total.count / samples, (double)total.bytes / samples, (double)total.busy / samples);
+    else
+        printf("No sample markers - call I2Cdev::traceMark() once per sample to get per sample figures\n");
+
+    //  per device
+
+    for (std::map<uint8_t, I2CTRACE_STATS>::iterator dev = devices.begin(); dev != devices.end(); ++dev) {
+        const I2CTRACE_STATS& stats = dev->second;
+
+        printf("\nDevice 0x%02x %s\n", dev->first, deviceName(dev->first));
+        printf("    %llu transactions, %llu bytes, %llu errors, utilisation %.1f%%, mean %.0fuS, max %uuS\n",
+               (unsigned long long)stats.count, (unsigned long long)stats.bytes, (unsigned long long)stats.errors,
+               100.0 * (double)stats.busy / (double)elapsed, (double)stats.busy / (double)stats.count, stats.maxDuration);
+        if (samples > 0)
+            printf("    %.2f transactions and %.0fuS per sample\n",
+                   (double)stats.count / samples, (double)stats.busy / samples);
+        printf("    latency:\n");
+        printHistogram(stats);
+    }
+
+    //  registers ranked by bus time
+
+    std::vector<std::pair<uint64_t, uint32_t> > ranked;
+
+    for (std::map<uint32_t, I2CTRACE_STATS>::iterator reg = registers.begin(); reg != registers.end(); ++reg)
+        ranked.push_back(std::make_pair(reg->second.busy, reg->first));
+    std::sort(ranked.rbegin(), ranked.rend());
+
+    printf("\nTop registers by bus time\n");
+    printf("    dev  reg  dir      count      bytes  mean uS   max uS   share\n");
+    for (size_t i = 0; (i < ranked.size()) && (i < I2CTRACE_TOP_REGISTERS); i++) {
+        const I2CTRACE_STATS& stats = registers[ranked[i].second];
+        uint32_t key = ranked[i].second;
+
+        printf("    0x%02x 0x%02x %-5s %9llu %10llu %8.0f %8u %6.1f%%\n",
+               (key >> 16) & 0xff, (key >> 8) & 0xff, (key & I2CDEV_TRACE_WRITE) ? "write" : "read",
+               (unsigned long long)stats.count, (unsigned long long)stats.bytes,
+               (double)stats.busy / (double)stats.count, stats.maxDuration,
+               100.0 * (double)stats.busy / (double)total.busy);
+    }
+    return 0;
+}
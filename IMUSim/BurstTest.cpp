@@ -0,0 +1,348 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  BurstTest drives I2Cdev's double-buffered bursts (initDoubleBuffer(), submitBurst(),
+//  takeBurst() and releaseBurst()) through the buffer handoff cases and checks the
+//  buffer contents, fill index and overrun count after each one. The slave numbers its
+//  transfers and fills each burst with a pattern from that number, so the contents
+//  show which burst a buffer holds. It has two builds:
+//
+//  -   on the simulated bus (I2CDEV_SIMULATOR), where every burst completes inside
+//      submitBurst();
+//  -   on the SAM3X PDC backend (__SAM3X8E__ and I2CDEV_SAM3X_PDC) against the TWI and
+//      PDC model in host/Wire.h, where bursts complete in the background. This build
+//      also checks the PDC tail states (the last two bytes and the STOP) with fast and
+//      slow polling, NACKs, timeouts and the blocking calls waiting for a PDC transfer.
+//
+//  Each check prints ok or FAILED and the exit code is 1 if any failed.
+
+#include "I2Cdev.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(I2CDEV_SIMULATOR)
+#include "I2CdevSim.h"
+typedef I2CdevSimDevice BurstTestDeviceBase;
+#elif defined(I2CDEV_SAM3X_PDC)
+#include <Wire.h>
+typedef HostWireDevice BurstTestDeviceBase;
+#else
+#error "BurstTest must be built with I2CDEV_SIMULATOR, or with __SAM3X8E__ and I2CDEV_SAM3X_PDC"
+#endif
+
+#define BURSTTEST_ADDRESS           0x50                    // the slave
+#define BURSTTEST_REGISTER          0x10                    // where the bursts are read from
+#define BURSTTEST_LENGTH            8                       // bytes per burst
+#define BURSTTEST_POLL              20                      // uS between polls while a burst runs
+
+//  The slave - byte i of transfer n is n * BURSTTEST_LENGTH + i
+
+class BurstTestDevice : public BurstTestDeviceBase
+{
+public:
+    BurstTestDevice() : BurstTestDeviceBase(BURSTTEST_ADDRESS) { transfers = 0; index = 0; nack = false; }
+
+    virtual bool present() { return !nack; }
+    virtual void start(uint8_t regAddr) { transfers++; index = 0; }
+    virtual uint8_t read() { return (uint8_t)(transfers * BURSTTEST_LENGTH + index++); }
+
+    unsigned int transfers;                                 // transfers started
+    uint8_t index;                                          // byte within the transfer
+    bool nack;                                              // true to NACK the address
+};
+
+static BurstTestDevice device;
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s %s\n", ok ? "ok    " : "FAILED", what);
+    if (!ok)
+        failures++;
+}
+
+//  true if buffer holds transfer n
+
+static bool holds(const uint8_t *buffer, unsigned int transfer, uint8_t length)
+{
+    if (buffer == NULL)
+        return false;
+    for (uint8_t i = 0; i < length; i++) {
+        if (buffer[i] != (uint8_t)(transfer * BURSTTEST_LENGTH + i))
+            return false;
+    }
+    return true;
+}
+
+//  polls a submitted burst until it's off the bus
+
+static uint8_t waitBurst(I2CDEV_DOUBLE_BUFFER *burst, unsigned long pollMicros)
+{
+    while (I2Cdev::pending(&burst->transaction)) {
+        hostAdvance(pollMicros);
+        I2Cdev::poll();
+    }
+    return burst->transaction.status;
+}
+
+//  submits a burst and waits for it - returns the transfer number or 0 if it failed
+
+static unsigned int runBurst(I2CDEV_DOUBLE_BUFFER *burst, unsigned long pollMicros)
+{
+    if (!I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER))
+        return 0;
+    if (waitBurst(burst, pollMicros) != I2CDEV_STATUS_DONE)
+        return 0;
+    return device.transfers;
+}
+
+static void testHandoff(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    unsigned int transfer;
+    uint8_t *data;
+
+    printf("Handoff\n");
+    transfer = runBurst(burst, BURSTTEST_POLL);
+    check(transfer != 0, "burst completes");
+    check(burst->ready && (burst->fill == 1), "completed burst is ready and the bus moves to buffer 1");
+    data = I2Cdev::takeBurst(burst);
+    check((data == burst->buffer[0]) && holds(data, transfer, burst->length), "takeBurst returns buffer 0 with the burst");
+    check(I2Cdev::takeBurst(burst) == 0, "nothing more to take");
+    check(burst->overruns == 0, "no overruns");
+    I2Cdev::releaseBurst(burst);
+
+    for (int i = 0; i < 4; i++) {
+        uint8_t expected = burst->fill;
+
+        transfer = runBurst(burst, BURSTTEST_POLL);
+        data = I2Cdev::takeBurst(burst);
+        check((data == burst->buffer[expected]) && holds(data, transfer, burst->length) &&
+                (burst->fill == (expected ^ 1)), "fill alternates and each burst is taken from the buffer it went to");
+        I2Cdev::releaseBurst(burst);
+    }
+    check(burst->overruns == 0, "no overruns");
+}
+
+static void testReadyOverrun(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    unsigned int first;
+    unsigned int second;
+    uint16_t overruns = burst->overruns;
+    uint8_t *data;
+
+    printf("Burst never taken\n");
+    first = runBurst(burst, BURSTTEST_POLL);
+    second = runBurst(burst, BURSTTEST_POLL);
+    check((first != 0) && (second != 0), "bursts complete");
+    check(burst->overruns == overruns + 1, "the untaken burst counts as an overrun");
+    data = I2Cdev::takeBurst(burst);
+    check(holds(data, second, burst->length), "takeBurst returns the newer burst");
+    check(!holds(burst->buffer[burst->fill], second, burst->length), "the bus fills the other buffer next");
+    I2Cdev::releaseBurst(burst);
+}
+
+static void testHeldOverrun(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    unsigned int held;
+    unsigned int dropped;
+    unsigned int next;
+    uint16_t overruns = burst->overruns;
+    uint8_t fill;
+    uint8_t *data;
+
+    printf("Burst completes while the caller holds the other buffer\n");
+    held = runBurst(burst, BURSTTEST_POLL);
+    data = I2Cdev::takeBurst(burst);
+    fill = burst->fill;
+    dropped = runBurst(burst, BURSTTEST_POLL);
+    check(dropped != 0, "burst completes");
+    check(burst->overruns == overruns + 1, "it counts as an overrun");
+    check(!burst->ready && (burst->fill == fill), "it isn't made ready and the fill buffer doesn't change");
+    check(holds(data, held, burst->length), "the held buffer is untouched");
+    check(I2Cdev::takeBurst(burst) == 0, "nothing to take");
+    I2Cdev::releaseBurst(burst);
+
+    next = runBurst(burst, BURSTTEST_POLL);
+    data = I2Cdev::takeBurst(burst);
+    check((data == burst->buffer[fill]) && holds(data, next, burst->length), "the next burst after the release is delivered");
+    I2Cdev::releaseBurst(burst);
+}
+
+static void testFailedBurst(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    uint16_t overruns = burst->overruns;
+    uint8_t fill = burst->fill;
+    uint8_t status;
+
+    printf("Failed burst\n");
+    device.nack = true;
+    I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER);
+    status = waitBurst(burst, BURSTTEST_POLL);
+    device.nack = false;
+    check((status == I2CDEV_STATUS_ERROR) && (burst->transaction.error == I2CDEV_ERROR_NACK), "NACKed burst fails");
+    check(!burst->ready && (burst->fill == fill) && (burst->overruns == overruns), "and doesn't change the handoff");
+    check(runBurst(burst, BURSTTEST_POLL) != 0, "the next burst completes");
+    I2Cdev::takeBurst(burst);
+    I2Cdev::releaseBurst(burst);
+}
+
+#ifdef I2CDEV_SAM3X_PDC
+
+static void testHeldInFlight(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    unsigned int held;
+    uint16_t overruns = burst->overruns;
+    uint8_t *data;
+    uint8_t status;
+
+    printf("Burst in flight when the caller takes the previous one\n");
+    held = runBurst(burst, BURSTTEST_POLL);
+    check(I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER), "next burst starts");
+    check(I2Cdev::pending(&burst->transaction), "and is still on the bus");
+    check(!I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER), "submitBurst refuses while it's pending");
+    data = I2Cdev::takeBurst(burst);
+    check(holds(data, held, burst->length), "takeBurst returns the previous burst");
+    status = waitBurst(burst, BURSTTEST_POLL);
+    check((status == I2CDEV_STATUS_DONE) && (burst->overruns == overruns + 1), "the burst completes while held and is dropped");
+    check(holds(data, held, burst->length), "the PDC didn't write the held buffer");
+    I2Cdev::releaseBurst(burst);
+}
+
+static void testTail(I2CDEV_DOUBLE_BUFFER *burst, unsigned long pollMicros, const char *title)
+{
+    unsigned long received = hostTwi.bytesReceived;
+    unsigned long pdc = hostTwi.pdcBytes;
+    unsigned long cpu = hostTwi.cpuBytes;
+    unsigned int transfer;
+    uint8_t *data;
+
+    printf("%s\n", title);
+    transfer = runBurst(burst, pollMicros);
+    check(transfer != 0, "burst completes");
+    check(hostTwi.bytesReceived - received == burst->length, "STOP is placed after the last byte");
+    check((hostTwi.pdcBytes - pdc == (unsigned long)(burst->length - 2)) && (hostTwi.cpuBytes - cpu == 2),
+            "the PDC moves all but the last two bytes");
+    data = I2Cdev::takeBurst(burst);
+    check(holds(data, transfer, burst->length), "buffer holds the burst");
+    I2Cdev::releaseBurst(burst);
+}
+
+static void testBlocking(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    unsigned long collisions = hostTwi.collisions;
+    unsigned int transfer;
+    uint8_t data[2];
+    uint8_t *taken;
+
+    printf("Blocking read while a PDC burst is on the bus\n");
+    transfer = device.transfers + 1;
+    I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER);
+    check(I2Cdev::readBytes(BURSTTEST_ADDRESS, BURSTTEST_REGISTER, 2, data) == 2, "readBytes succeeds");
+    check(hostTwi.collisions == collisions, "it waited for the PDC transfer");
+    check(holds(data, transfer + 1, 2), "readBytes data is right");
+    taken = I2Cdev::takeBurst(burst);
+    check(holds(taken, transfer, burst->length), "the burst is right");
+    I2Cdev::releaseBurst(burst);
+}
+
+static void testErrors(I2CDEV_DOUBLE_BUFFER *burst)
+{
+    I2CDEV_ERRORS errors;
+    uint8_t status;
+
+    printf("Errors\n");
+    I2Cdev::clearDeviceErrors();
+    device.stretch = true;
+    I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER);
+    status = waitBurst(burst, BURSTTEST_POLL);
+    device.stretch = false;
+    I2Cdev::getDeviceErrors(BURSTTEST_ADDRESS, &errors);
+    check((status == I2CDEV_STATUS_ERROR) && (burst->transaction.error == I2CDEV_ERROR_TIMEOUT), "stuck transfer times out");
+    check((errors.timeout == 1) && (errors.recovered == 1) && !hostTwi.busy(), "and the bus is recovered");
+    check(runBurst(burst, BURSTTEST_POLL) != 0, "the next burst completes");
+    I2Cdev::takeBurst(burst);
+    I2Cdev::releaseBurst(burst);
+
+    device.nack = true;
+    I2Cdev::submitBurst(burst, BURSTTEST_ADDRESS, BURSTTEST_REGISTER);
+    status = waitBurst(burst, BURSTTEST_POLL);
+    device.nack = false;
+    I2Cdev::getDeviceErrors(BURSTTEST_ADDRESS, &errors);
+    check((status == I2CDEV_STATUS_ERROR) && (errors.nack == 1) && (errors.recovered == 1), "NACK fails without a recovery");
+}
+
+static void testShortRead()
+{
+    I2CDEV_TRANSACTION transaction;
+    unsigned long transfers = hostTwi.transfers;
+    uint8_t data[2];
+
+    printf("Short read\n");
+    transaction.callback = 0;
+    I2Cdev::submitRead(&transaction, BURSTTEST_ADDRESS, BURSTTEST_REGISTER, 2, data);
+    I2Cdev::flush();
+    check((transaction.status == I2CDEV_STATUS_DONE) && (hostTwi.transfers == transfers), "2 byte reads go through Wire");
+}
+
+#endif
+
+int main()
+{
+    I2CDEV_DOUBLE_BUFFER burst;
+    uint8_t *buffers;
+
+    hostSetMicros(1000);
+#ifdef I2CDEV_SIMULATOR
+    I2CdevSim::advance = hostAdvance;
+    I2CdevSim::attach(&device);
+    buffers = (uint8_t *)malloc(2 * BURSTTEST_LENGTH);
+#else
+    Wire.begin();
+    hostWireAttach(&device);
+    buffers = hostLowAlloc(2 * BURSTTEST_LENGTH);
+#endif
+
+    I2Cdev::initDoubleBuffer(&burst, buffers, buffers + BURSTTEST_LENGTH, BURSTTEST_LENGTH);
+    testHandoff(&burst);
+    testReadyOverrun(&burst);
+    testHeldOverrun(&burst);
+    testFailedBurst(&burst);
+
+#ifdef I2CDEV_SAM3X_PDC
+    testHeldInFlight(&burst);
+    testTail(&burst, 5, "PDC tail with fast polling");
+    testTail(&burst, 400, "PDC tail with slow polling");
+    testTail(&burst, 3000, "PDC tail with polling slower than the transaction budget");
+    I2Cdev::initDoubleBuffer(&burst, buffers, buffers + BURSTTEST_LENGTH, 3);
+    testTail(&burst, 5, "PDC tail on a 3 byte burst (one byte through the PDC)");
+    I2Cdev::initDoubleBuffer(&burst, buffers, buffers + BURSTTEST_LENGTH, BURSTTEST_LENGTH);
+    testBlocking(&burst);
+    testErrors(&burst);
+    testShortRead();
+#endif
+
+    printf("%d failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
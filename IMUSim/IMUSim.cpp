@@ -0,0 +1,480 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  IMUSim runs the IMU and pressure drivers on the simulated I2C bus (I2CDEV_SIMULATOR)
+//  against the register-level models in RTIMUSim.h and reports what they cost and how
+//  well they track the simulated motion. Usage:
+//
+//      IMUSim [-t seconds] [-l loop uS | -r] [-s] [-x] [-w rad/s] [-c ppm] [-i rate]
+//
+//  The drivers are polled every -l microseconds (default 500) of simulated time, or at
+//  random intervals of 50uS to 3.05mS with -r. -s polls through RTSensorScheduler instead
+//  of calling IMURead() and pressureRead() on every loop. -x reconfigures the IMU half
+//  way through the run with its set functions. -w sets the rotation rate of the simulated
+//  motion (default 0.5 radians/s), -c gives every model a sample clock error in ppm and
+//  -i sets the sample rate of an MPU9150/9250. The run lasts -t seconds (default 10).
+//
+//  The IMU and pressure sensor are the ones selected in RTIMULibDefs.h, or on the
+//  compiler command line with RTIMULIB_SENSORS_EXTERNAL defined.
+//
+//  It prints:
+//
+//  -   the time and bus transactions taken by IMUInit() and pressureInit();
+//  -   the largest gyro, accel and compass errors against the simulated motion;
+//  -   the timestamp error - how far each sample's timestamp is from the time the model
+//      took it, to the nearest sample period;
+//  -   the pressure reading rate and largest error;
+//  -   the bus transactions and bus time;
+//  -   for each model, the samples taken and read, overruns and the latency from a
+//      sample being taken to it being read;
+//  -   the RTSensorScheduler statistics with -s.
+//
+//  The first IMUSIM_SETTLE seconds are left out of the errors, as are the IMUSIM_SETTLE
+//  seconds after a -x reconfiguration. The timestamp error leaves out the first
+//  IMUSIM_LOCK seconds while an MPU9150/9250 locks on to the chip's sample clock.
+
+#include "RTIMU.h"
+#include "RTPressure.h"
+#include "RTIMUSettings.h"
+#include "RTSensorScheduler.h"
+#include "RTIMUSim.h"
+#include "RTIMUMPU9150.h"
+#include "RTIMUMPU9250.h"
+
+#if defined(LSM9DS0_6a) || defined(LSM9DS0_6b)
+#include "RTIMULSM9DS0.h"
+#endif
+
+#if defined(GD20HM303D_6a) || defined(GD20HM303D_6b)
+#include "RTIMUGD20HM303D.h"
+#endif
+
+#if defined(GD20M303DLHC_6a) || defined(GD20M303DLHC_6b)
+#include "RTIMUGD20M303DLHC.h"
+#endif
+
+#if defined(GD20HM303DLHC_6a) || defined(GD20HM303DLHC_6b)
+#include "RTIMUGD20HM303DLHC.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef I2CDEV_SIMULATOR
+#error "IMUSim must be built with I2CDEV_SIMULATOR defined"
+#endif
+
+//  The time in seconds at the start (and after a reconfiguration) that isn't included in the errors
+
+#define IMUSIM_SETTLE               1
+
+//  The time in seconds at the start that isn't included in the timestamp error
+
+#define IMUSIM_LOCK                 5
+
+//  The time the simulated clock starts at, in uS
+
+#define IMUSIM_START                1000
+
+//  The simulated motion - a fixed starting pose turning at the -w rate, and a slow
+//  altitude change for the pressure sensor
+
+#define IMUSIM_ALTITUDE             100                     // meters
+#define IMUSIM_ALTITUDE_AMPLITUDE   10                      // meters
+#define IMUSIM_ALTITUDE_PERIOD      4000000                 // uS
+#define IMUSIM_TEMPERATURE          23.4                    // degrees C
+
+typedef struct
+{
+    double gyro;                                            // largest errors
+    double accel;
+    double compass;
+    double timestampMax;                                    // timestamp errors in uS
+    double timestampTotal;
+    unsigned long timestampCount;
+} IMUSIM_ERRORS;
+
+//  The largest component of the difference between two vectors
+
+static double vectorError(const RTVector3& a, const RTVector3& b)
+{
+    double error = 0;
+
+    for (int i = 0; i < 3; i++)
+        error = fmax(error, fabs(a.data(i) - b.data(i)));
+    return error;
+}
+
+//  The model that holds the IMU's gyro (the one at the IMU's address)
+
+static RTIMUSimSensor *findGyroModel(RTIMUSettings *settings)
+{
+    for (int i = 0; i < RTIMUSim::m_sensorCount; i++) {
+        if (RTIMUSim::m_sensors[i]->devAddr == settings->m_I2CSlaveAddress)
+            return RTIMUSim::m_sensors[i];
+    }
+    return NULL;
+}
+
+//  Sets the MPU9150/9250 sample rate before IMUInit()
+
+static bool setSampleRate(RTIMUSettings *settings, int rate)
+{
+    switch (settings->m_imuType) {
+#if defined(MPU9150_68) || defined(MPU9150_69)
+    case RTIMU_TYPE_MPU9150:
+        settings->m_MPU9150GyroAccelSampleRate = rate;
+        return true;
+#endif
+
+#if defined(MPU9250_68) || defined(MPU9250_69)
+    case RTIMU_TYPE_MPU9250:
+        settings->m_MPU9250GyroAccelSampleRate = rate;
+        return true;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+//  Switches a running IMU to 200Hz and its widest gyro and accel ranges. Returns 1 if ok,
+//  0 if a set function failed and -1 if the driver has no runtime set functions.
+
+static int reconfigure(RTIMU *imu)
+{
+    switch (imu->IMUType()) {
+#if defined(MPU9150_68) || defined(MPU9150_69)
+    case RTIMU_TYPE_MPU9150: {
+        RTIMUMPU9150 *mpu = (RTIMUMPU9150 *)imu;
+
+        return mpu->setSampleRate(200) && mpu->setGyroFsr(MPU9150_GYROFSR_2000) &&
+                mpu->setAccelFsr(MPU9150_ACCELFSR_16) ? 1 : 0;
+    }
+#endif
+
+#if defined(MPU9250_68) || defined(MPU9250_69)
+    case RTIMU_TYPE_MPU9250: {
+        RTIMUMPU9250 *mpu = (RTIMUMPU9250 *)imu;
+
+        return mpu->setSampleRate(200) && mpu->setGyroFsr(MPU9250_GYROFSR_2000) &&
+                mpu->setAccelFsr(MPU9250_ACCELFSR_16) ? 1 : 0;
+    }
+#endif
+
+#if defined(LSM9DS0_6a) || defined(LSM9DS0_6b)
+    case RTIMU_TYPE_LSM9DS0: {
+        RTIMULSM9DS0 *st = (RTIMULSM9DS0 *)imu;
+
+        return st->setGyroSampleRate(LSM9DS0_GYRO_SAMPLERATE_190) && st->setGyroFsr(LSM9DS0_GYRO_FSR_2000) &&
+                st->setAccelFsr(LSM9DS0_ACCEL_FSR_16) ? 1 : 0;
+    }
+#endif
+
+#if defined(GD20HM303D_6a) || defined(GD20HM303D_6b)
+    case RTIMU_TYPE_GD20HM303D: {
+        RTIMUGD20HM303D *st = (RTIMUGD20HM303D *)imu;
+
+        return st->setGyroSampleRate(L3GD20H_SAMPLERATE_100) && st->setGyroFsr(L3GD20H_FSR_2000) &&
+                st->setAccelFsr(LSM303D_ACCEL_FSR_16) ? 1 : 0;
+    }
+#endif
+
+#if defined(GD20M303DLHC_6a) || defined(GD20M303DLHC_6b)
+    case RTIMU_TYPE_GD20M303DLHC: {
+        RTIMUGD20M303DLHC *st = (RTIMUGD20M303DLHC *)imu;
+
+        return st->setGyroSampleRate(L3GD20_SAMPLERATE_190) && st->setGyroFsr(L3GD20_FSR_2000) &&
+                st->setAccelFsr(LSM303DLHC_ACCEL_FSR_16) ? 1 : 0;
+    }
+#endif
+
+#if defined(GD20HM303DLHC_6a) || defined(GD20HM303DLHC_6b)
+    case RTIMU_TYPE_GD20HM303DLHC: {
+        RTIMUGD20HM303DLHC *st = (RTIMUGD20HM303DLHC *)imu;
+
+        return st->setGyroSampleRate(L3GD20H_SAMPLERATE_100) && st->setGyroFsr(L3GD20H_FSR_2000) &&
+                st->setAccelFsr(LSM303DLHC_ACCEL_FSR_16) ? 1 : 0;
+    }
+#endif
+
+    default:
+        return -1;
+    }
+}
+
+static void imuSample(RTIMU *imu, RTIMUSimMotion *motion, RTIMUSimSensor *gyroModel,
+        bool settled, bool locked, IMUSIM_ERRORS *errors)
+{
+    RTIMUSIM_STATE state;
+    long period;
+    long error;
+
+    if (!settled)
+        return;
+
+    motion->getState(imu->getTimestamp(), &state);
+    errors->gyro = fmax(errors->gyro, vectorError(imu->getGyro(), state.gyro));
+    errors->accel = fmax(errors->accel, vectorError(imu->getAccel(), state.accel));
+    errors->compass = fmax(errors->compass, vectorError(imu->getCompass(), state.compass));
+
+    if (!locked || (gyroModel == NULL) || (imu->IMUGetSampleRate() <= 0))
+        return;
+
+    //  the error to the nearest sample period, as a sample can be matched with the one either side
+
+    period = 1000000 / imu->IMUGetSampleRate();
+    period += (long)((long long)period * gyroModel->m_clockError / 1000000);
+    error = (long)(imu->getTimestamp() - gyroModel->m_lastSampleTime);
+    while (error > period / 2)
+        error -= period;
+    while (error < -period / 2)
+        error += period;
+    errors->timestampMax = fmax(errors->timestampMax, fabs((double)error));
+    errors->timestampTotal += fabs((double)error);
+    errors->timestampCount++;
+}
+
+int main(int argc, char **argv)
+{
+    RTIMUSettings settings;
+    RTIMUSimSyntheticMotion motion;
+    IMUSIM_ERRORS errors;
+    RTIMUSIM_STATE state;
+    RTIMU *imu;
+    RTPressure *pressure;
+    RTSensorScheduler *scheduler = NULL;
+    RTIMUSimSensor *gyroModel;
+    int seconds = 10;
+    long loopMicros = 500;
+    bool randomLoop = false;
+    bool useScheduler = false;
+    bool doReconfigure = false;
+    double rate = 0.5;
+    long ppm = 0;
+    int sampleRate = 0;
+    unsigned long start;
+    unsigned long settleTime;
+    unsigned long lockTime;
+    unsigned long imuSamples = 0;
+    unsigned long readingCount = 0;
+    double pressureError = 0;
+    float latestPressure;
+    float latestTemperature;
+    int imuResult;
+    bool pressureResult = false;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc))
+            seconds = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+            loopMicros = atol(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0)
+            randomLoop = true;
+        else if (strcmp(argv[i], "-s") == 0)
+            useScheduler = true;
+        else if (strcmp(argv[i], "-x") == 0)
+            doReconfigure = true;
+        else if ((strcmp(argv[i], "-w") == 0) && (i + 1 < argc))
+            rate = atof(argv[++i]);
+        else if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc))
+            ppm = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc))
+            sampleRate = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: IMUSim [-t seconds] [-l loop uS | -r] [-s] [-x] [-w rad/s] [-c ppm] [-i rate]\n");
+            return 1;
+        }
+    }
+
+    if ((seconds <= IMUSIM_SETTLE) || (loopMicros <= 0)) {
+        fprintf(stderr, "The run must be longer than %d seconds and the loop time positive\n", IMUSIM_SETTLE);
+        return 1;
+    }
+
+    if ((sampleRate > 0) && !setSampleRate(&settings, sampleRate)) {
+        fprintf(stderr, "-i is only supported for the MPU9150 and MPU9250\n");
+        return 1;
+    }
+
+    hostSetMicros(IMUSIM_START);
+    I2CdevSim::advance = hostAdvance;
+    srand(1);
+
+    motion.setPose(RTVector3(0.3, -0.2, 1.0));
+    motion.setRate(RTVector3(rate, -rate / 2, rate / 3));
+    motion.setAltitude(IMUSIM_ALTITUDE, IMUSIM_ALTITUDE_AMPLITUDE, IMUSIM_ALTITUDE_PERIOD);
+    motion.setTemperature(IMUSIM_TEMPERATURE);
+
+    if (!RTIMUSim::attach(&settings, &motion)) {
+        fprintf(stderr, "Failed to attach the sensor models\n");
+        return 1;
+    }
+    for (int i = 0; i < RTIMUSim::m_sensorCount; i++)
+        RTIMUSim::m_sensors[i]->m_clockError = ppm;
+    gyroModel = findGyroModel(&settings);
+
+    //  initialization
+
+    if (useScheduler) {
+        scheduler = new RTSensorScheduler(&settings);
+        imu = scheduler->getIMU();
+        pressure = scheduler->getPressureSensor();
+    } else {
+        imu = RTIMU::createIMU(&settings);
+        pressure = RTPressure::createPressure(&settings);
+    }
+
+    if (imu == NULL) {
+        fprintf(stderr, "No IMU selected\n");
+        return 1;
+    }
+
+    start = micros();
+    I2CdevSim::clearCounters();
+    imuResult = imu->IMUInit();
+    printf("%s init %s: %luuS, %lu transactions\n", imu->IMUName(), imuResult < 0 ? "failed" : "ok",
+            micros() - start, (unsigned long)I2CdevSim::transactions);
+
+    if (pressure != NULL) {
+        start = micros();
+        I2CdevSim::clearCounters();
+        pressureResult = pressure->pressureInit();
+        printf("%s init %s: %luuS, %lu transactions\n", pressure->pressureName(), pressureResult ? "ok" : "failed",
+                micros() - start, (unsigned long)I2CdevSim::transactions);
+    }
+
+    if ((imuResult < 0) || ((pressure != NULL) && !pressureResult))
+        return 1;
+
+    if (scheduler != NULL)
+        scheduler->schedulerInit();
+
+    //  the run
+
+    memset(&errors, 0, sizeof(errors));
+    for (int i = 0; i < RTIMUSim::m_sensorCount; i++)
+        RTIMUSim::m_sensors[i]->clearCounters();
+    I2CdevSim::clearCounters();
+    if (scheduler != NULL)
+        scheduler->clearStats();
+    if (pressure != NULL)
+        readingCount = pressure->pressureGetReadingCount();
+
+    start = micros();
+    settleTime = start + IMUSIM_SETTLE * 1000000UL;
+    lockTime = start + IMUSIM_LOCK * 1000000UL;
+
+    while ((micros() - start) < (unsigned long)seconds * 1000000UL) {
+        hostAdvance(randomLoop ? 50 + rand() % 3000 : loopMicros);
+
+        if (doReconfigure && ((micros() - start) >= (unsigned long)seconds * 500000UL)) {
+            unsigned long reconfigureStart = micros();
+            uint32_t transactions = I2CdevSim::transactions;
+            bool biasValid = imu->IMUGyroBiasValid();
+            int result;
+
+            doReconfigure = false;
+            result = reconfigure(imu);
+            if (result < 0)
+                printf("Reconfigure: the %s driver has no runtime set functions\n", imu->IMUName());
+            else
+                printf("Reconfigure %s: %luuS, %lu transactions, gyro bias valid %s -> %s\n", result ? "ok" : "failed",
+                        micros() - reconfigureStart, (unsigned long)(I2CdevSim::transactions - transactions),
+                        biasValid ? "yes" : "no", imu->IMUGyroBiasValid() ? "yes" : "no");
+            settleTime = micros() + IMUSIM_SETTLE * 1000000UL;
+        }
+
+        if (scheduler != NULL) {
+            int result;
+
+            while ((result = scheduler->poll()) != 0) {
+                if (result & RTSCHEDULER_IMU) {
+                    imuSamples++;
+                    imuSample(imu, &motion, gyroModel, micros() >= settleTime, micros() >= lockTime, &errors);
+                }
+                if (result & RTSCHEDULER_PRESSURE) {
+                    pressure->pressureRead(latestPressure, latestTemperature);
+                    motion.getState(micros(), &state);
+                    pressureError = fmax(pressureError, fabs(latestPressure - state.pressure));
+                }
+            }
+        } else {
+            while (imu->IMURead()) {
+                imuSamples++;
+                imuSample(imu, &motion, gyroModel, micros() >= settleTime, micros() >= lockTime, &errors);
+            }
+            if (pressure != NULL) {
+                unsigned long count = pressure->pressureGetReadingCount();
+
+                pressure->pressureRead(latestPressure, latestTemperature);
+                if (pressure->pressureGetReadingCount() != count) {
+                    motion.getState(micros(), &state);
+                    pressureError = fmax(pressureError, fabs(latestPressure - state.pressure));
+                }
+            }
+        }
+    }
+
+    //  the results
+
+    printf("\nIMU: %lu samples at %dHz, %lu lost\n", imuSamples, imu->IMUGetSampleRate(), imu->IMUGetLostSamples());
+    printf("  max error: gyro %.4f radians/s, accel %.4f g, compass %.3f uT\n", errors.gyro, errors.accel, errors.compass);
+    if (errors.timestampCount > 0)
+        printf("  timestamp error: max %.0fuS, average %.1fuS\n", errors.timestampMax,
+                errors.timestampTotal / errors.timestampCount);
+
+    if (pressure != NULL)
+        printf("Pressure: %lu readings, %.2f per second, max error %.3f hPa\n",
+                pressure->pressureGetReadingCount() - readingCount, pressure->pressureGetRate(), pressureError);
+
+    printf("Bus: %lu transactions, %lu bytes, busy %luuS (%.1f%%)\n", (unsigned long)I2CdevSim::transactions,
+            (unsigned long)I2CdevSim::bytes, (unsigned long)I2CdevSim::busMicros,
+            100.0 * I2CdevSim::busMicros / (micros() - start));
+
+    printf("Models:\n");
+    for (int i = 0; i < RTIMUSim::m_sensorCount; i++) {
+        RTIMUSimSensor *model = RTIMUSim::m_sensors[i];
+
+        printf("  0x%02x: %lu samples, %lu read, %lu overruns, latency average %luuS max %luuS, %lu transactions\n",
+                model->devAddr, model->m_samples, model->m_samplesRead, model->m_overruns,
+                model->m_samplesRead > 0 ? model->m_latencyTotal / model->m_samplesRead : 0,
+                model->m_latencyMax, (unsigned long)model->transactions);
+    }
+
+    if (scheduler != NULL) {
+        const RTSCHEDULER_STATS& stats = scheduler->getStats();
+
+        printf("Scheduler:\n");
+        printf("  IMU: %lu samples, %lu empty reads, late max %luuS average %luuS, longest access %luuS\n",
+                stats.imuSamples, stats.imuEmptyReads, stats.imuLateMax,
+                stats.imuSamples > 0 ? stats.imuLateTotal / stats.imuSamples : 0, stats.imuAccessMax);
+        printf("  pressure: %lu readings, %lu calls, %lu deferred, longest wait %luuS, longest access %luuS\n",
+                stats.pressureReadings, stats.pressureCalls, stats.pressureDeferred, stats.pressureWaitMax,
+                stats.pressureAccessMax);
+        printf("  busy %luuS (%.1f%%)\n", stats.busyMicros, 100.0 * stats.busyMicros / (micros() - start));
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  The parts of the Arduino core that the libraries use, for host builds on the
+//  simulated bus. Time is simulated - it only moves when the program calls
+//  hostAdvance(), when the libraries call delay() or delayMicroseconds() and when
+//  I2CdevSim charges a transaction its bus time (set I2CdevSim::advance to hostAdvance).
+//  Serial output goes to stdout.
+
+#ifndef _ARDUINO_HOST_H
+#define _ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define DEC 10
+#define HEX 16
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void hostAdvance(uint32_t us);                              // move the simulated time on
+void hostSetMicros(unsigned long us);                       // set the simulated time
+
+class Print
+{
+public:
+    void print(const char *str);
+    void print(char c);
+    void print(int val, int base = DEC);
+    void print(unsigned int val, int base = DEC);
+    void print(long val, int base = DEC);
+    void print(unsigned long val, int base = DEC);
+    void print(double val, int digits = 2);
+    void println();
+    void println(const char *str);
+    void println(char c);
+    void println(int val, int base = DEC);
+    void println(unsigned int val, int base = DEC);
+    void println(long val, int base = DEC);
+    void println(unsigned long val, int base = DEC);
+    void println(double val, int digits = 2);
+};
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // _ARDUINO_HOST_H
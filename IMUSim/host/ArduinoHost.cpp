@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+static unsigned long hostMicros = 0;
+
+unsigned long micros()
+{
+    return hostMicros;
+}
+
+unsigned long millis()
+{
+    return hostMicros / 1000;
+}
+
+void delay(unsigned long ms)
+{
+    hostMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    hostMicros += us;
+}
+
+void hostAdvance(uint32_t us)
+{
+    hostMicros += us;
+}
+
+void hostSetMicros(unsigned long us)
+{
+    hostMicros = us;
+}
+
+static void printNumber(unsigned long val, bool negative, int base)
+{
+    if (negative)
+        putchar('-');
+    printf(base == HEX ? "%lx" : "%lu", val);
+}
+
+void Print::print(const char *str) { fputs(str, stdout); }
+void Print::print(char c) { putchar(c); }
+void Print::print(int val, int base) { print((long)val, base); }
+void Print::print(unsigned int val, int base) { print((unsigned long)val, base); }
+void Print::print(long val, int base) { printNumber(val < 0 ? -(unsigned long)val : val, val < 0, base); }
+void Print::print(unsigned long val, int base) { printNumber(val, false, base); }
+void Print::print(double val, int digits) { printf("%.*f", digits, val); }
+void Print::println() { putchar('\n'); }
+void Print::println(const char *str) { print(str); println(); }
+void Print::println(char c) { print(c); println(); }
+void Print::println(int val, int base) { print(val, base); println(); }
+void Print::println(unsigned int val, int base) { print(val, base); println(); }
+void Print::println(long val, int base) { print(val, base); println(); }
+void Print::println(unsigned long val, int base) { print(val, base); println(); }
+void Print::println(double val, int digits) { print(val, digits); println(); }
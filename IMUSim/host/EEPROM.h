@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  RAM backed EEPROM for host builds. It starts erased so CalLib finds no calibration.
+
+#ifndef _EEPROM_HOST_H
+#define _EEPROM_HOST_H
+
+#include "Arduino.h"
+
+#define EEPROM_HOST_SIZE    1024
+
+class EEPROMClass
+{
+public:
+    EEPROMClass() { memset(m_data, 0xff, sizeof(m_data)); }
+    uint8_t read(int address) { return m_data[address % EEPROM_HOST_SIZE]; }
+    void write(int address, uint8_t value) { m_data[address % EEPROM_HOST_SIZE] = value; }
+
+private:
+    uint8_t m_data[EEPROM_HOST_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // _EEPROM_HOST_H
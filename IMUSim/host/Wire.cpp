@@ -0,0 +1,362 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "Wire.h"
+#include <stdio.h>
+#include <sys/mman.h>
+
+Twi hostTwi;
+TwoWire Wire;
+
+static HostWireDevice *hostWireDevices = NULL;
+
+void hostWireAttach(HostWireDevice *device)
+{
+    device->next = hostWireDevices;
+    hostWireDevices = device;
+}
+
+static HostWireDevice *hostWireFind(uint8_t devAddr)
+{
+    for (HostWireDevice *device = hostWireDevices; device != NULL; device = device->next) {
+        if ((device->devAddr == devAddr) && device->present())
+            return device;
+    }
+    return NULL;
+}
+
+uint8_t *hostLowAlloc(size_t size)
+{
+    void *memory = MAP_FAILED;
+
+#ifdef MAP_32BIT
+    memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+#endif
+    if ((memory == MAP_FAILED) || ((uintptr_t)memory + size > 0x100000000ULL)) {
+        fprintf(stderr, "Can't allocate memory below 4GB for the PDC\n");
+        exit(1);
+    }
+    return (uint8_t *)memory;
+}
+
+//----------------------------------------------------------
+//
+//  TwiRegister
+
+TwiRegister::operator uint32_t()
+{
+    return m_twi->readRegister(m_index);
+}
+
+TwiRegister& TwiRegister::operator=(uint32_t value)
+{
+    m_twi->writeRegister(m_index, value);
+    return *this;
+}
+
+//----------------------------------------------------------
+//
+//  Twi
+
+Twi::Twi() :
+    TWI_CR(this, TWI_REG_CR), TWI_MMR(this, TWI_REG_MMR), TWI_IADR(this, TWI_REG_IADR),
+    TWI_SR(this, TWI_REG_SR), TWI_RHR(this, TWI_REG_RHR), TWI_RPR(this, TWI_REG_RPR),
+    TWI_RCR(this, TWI_REG_RCR), TWI_PTCR(this, TWI_REG_PTCR)
+{
+    transfers = 0;
+    bytesReceived = 0;
+    pdcBytes = 0;
+    cpuBytes = 0;
+    heldMicros = 0;
+    collisions = 0;
+    m_mmr = 0;
+    m_iadr = 0;
+    m_rpr = 0;
+    m_rcr = 0;
+    m_pdcEnabled = false;
+    setClock(100000);
+    reset();
+}
+
+void Twi::reset()
+{
+    m_device = NULL;
+    m_rhr = 0;
+    m_rxrdy = false;
+    m_nack = false;
+    m_txcomp = true;
+    m_stopRequested = false;
+    m_lastByte = false;
+    m_phase = TWI_PHASE_IDLE;
+    m_eventTime = 0;
+}
+
+void Twi::setClock(uint32_t clock)
+{
+    m_byteMicros = 9000000UL / clock;
+}
+
+uint32_t Twi::readRegister(int index)
+{
+    uint32_t value = 0;
+
+    update();
+    switch (index) {
+    case TWI_REG_SR:
+        value = (m_txcomp ? TWI_SR_TXCOMP : 0) | (m_rxrdy ? TWI_SR_RXRDY : 0) |
+                (m_nack ? TWI_SR_NACK : 0) | (m_rcr == 0 ? TWI_SR_ENDRX : 0);
+        m_nack = false;
+        hostAdvance(1);
+        break;
+
+    case TWI_REG_RHR:
+        value = m_rhr;
+        if (m_rxrdy) {
+            m_rxrdy = false;
+            cpuBytes++;
+            if (m_phase == TWI_PHASE_HELD) {
+                heldMicros += micros() - m_eventTime;
+                startByte(micros());
+            }
+        }
+        break;
+
+    case TWI_REG_MMR:
+        value = m_mmr;
+        break;
+
+    case TWI_REG_IADR:
+        value = m_iadr;
+        break;
+
+    case TWI_REG_RPR:
+        value = m_rpr;
+        break;
+
+    case TWI_REG_RCR:
+        value = m_rcr;
+        break;
+    }
+    return value;
+}
+
+void Twi::writeRegister(int index, uint32_t value)
+{
+    update();
+    switch (index) {
+    case TWI_REG_CR:
+        if (value & TWI_CR_START) {
+            transfers++;
+            m_device = hostWireFind((m_mmr >> 16) & 0x7f);
+            m_nack = false;
+            m_txcomp = false;
+            m_rxrdy = false;
+            m_stopRequested = (value & TWI_CR_STOP) != 0;
+            m_phase = TWI_PHASE_ADDRESS;
+            m_eventTime = micros() + 3 * m_byteMicros;
+        } else if (value & TWI_CR_STOP) {
+            m_stopRequested = true;
+            if (m_phase == TWI_PHASE_BYTE)
+                m_lastByte = true;
+        }
+        break;
+
+    case TWI_REG_MMR:
+        m_mmr = value;
+        break;
+
+    case TWI_REG_IADR:
+        m_iadr = value;
+        break;
+
+    case TWI_REG_RPR:
+        m_rpr = value;
+        break;
+
+    case TWI_REG_RCR:
+        m_rcr = value;
+        break;
+
+    case TWI_REG_PTCR:
+        if (value & TWI_PTCR_RXTDIS)
+            m_pdcEnabled = false;
+        else if (value & TWI_PTCR_RXTEN)
+            m_pdcEnabled = true;
+        pdcTake();
+        break;
+    }
+}
+
+//  moves the transfer on to micros()
+
+void Twi::update()
+{
+    unsigned long now = micros();
+
+    while ((m_phase != TWI_PHASE_IDLE) && (m_phase != TWI_PHASE_HELD) &&
+            (m_phase != TWI_PHASE_STRETCH) && ((long)(now - m_eventTime) >= 0)) {
+        switch (m_phase) {
+        case TWI_PHASE_ADDRESS:
+            if (m_device == NULL) {
+                m_nack = true;                              // the TWI sends the STOP itself
+                m_txcomp = true;
+                m_phase = TWI_PHASE_IDLE;
+                break;
+            }
+            m_device->start(m_iadr);
+            startByte(m_eventTime);
+            break;
+
+        case TWI_PHASE_BYTE:
+            m_rhr = m_device->read();
+            m_rxrdy = true;
+            bytesReceived++;
+            if (m_lastByte) {
+                m_phase = TWI_PHASE_STOP;
+                m_eventTime += m_byteMicros / 9;            // one bit time for the STOP
+            } else {
+                m_phase = TWI_PHASE_HELD;
+                pdcTake();
+            }
+            break;
+
+        case TWI_PHASE_STOP:
+            m_device->stop();
+            m_txcomp = true;
+            m_phase = TWI_PHASE_IDLE;
+            pdcTake();
+            break;
+        }
+    }
+}
+
+//  starts receiving a byte at time - it's the last if a STOP is waiting
+
+void Twi::startByte(unsigned long time)
+{
+    if (m_device->stretch) {
+        m_phase = TWI_PHASE_STRETCH;
+        return;
+    }
+    m_lastByte = m_stopRequested;
+    m_phase = TWI_PHASE_BYTE;
+    m_eventTime = time + m_byteMicros;
+}
+
+//  the PDC takes a waiting byte if it has any count left
+
+void Twi::pdcTake()
+{
+    if (!m_rxrdy || !m_pdcEnabled || (m_rcr == 0))
+        return;
+    *(uint8_t *)(uintptr_t)m_rpr = m_rhr;
+    m_rpr++;
+    m_rcr--;
+    m_rxrdy = false;
+    pdcBytes++;
+    if (m_phase == TWI_PHASE_HELD)
+        startByte(m_eventTime);
+}
+
+//----------------------------------------------------------
+//
+//  TwoWire
+
+void TwoWire::begin()
+{
+    hostTwi.reset();
+    m_device = NULL;
+    m_txLength = 0;
+    m_rxLength = 0;
+    m_rxIndex = 0;
+    m_started = false;
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+    hostTwi.setClock(clock);
+}
+
+void TwoWire::beginTransmission(uint8_t devAddr)
+{
+    if (hostTwi.busy())
+        hostTwi.collisions++;
+    m_device = hostWireFind(devAddr);
+    m_txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (m_txLength >= BUFFER_LENGTH)
+        return 0;
+    m_txBuffer[m_txLength++] = data;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool stop)
+{
+    uint8_t i;
+
+    delayMicroseconds((m_txLength + 1) * 90);
+    if (m_device == NULL)
+        return 2;
+    if (m_txLength > 0)
+        m_device->start(m_txBuffer[0]);
+    for (i = 1; i < m_txLength; i++)
+        m_device->write(m_txBuffer[i]);
+    if (stop)
+        m_device->stop();
+    m_started = !stop;
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t devAddr, uint8_t length, uint8_t stop)
+{
+    HostWireDevice *device = hostWireFind(devAddr);
+
+    if (hostTwi.busy())
+        hostTwi.collisions++;
+    m_rxLength = 0;
+    m_rxIndex = 0;
+    if ((device == NULL) || (length > BUFFER_LENGTH))
+        return 0;
+    if (!m_started)
+        device->start(0);
+    for (m_rxLength = 0; m_rxLength < length; m_rxLength++)
+        m_rxBuffer[m_rxLength] = device->read();
+    if (stop)
+        device->stop();
+    m_started = !stop;
+    delayMicroseconds((length + 1) * 90);
+    return length;
+}
+
+int TwoWire::available()
+{
+    return m_rxLength - m_rxIndex;
+}
+
+int TwoWire::read()
+{
+    return m_rxIndex < m_rxLength ? m_rxBuffer[m_rxIndex++] : -1;
+}
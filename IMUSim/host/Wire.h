@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+//  Wire and the SAM3X TWI for host builds of the I2Cdev SAM3X PDC backend (built with
+//  __SAM3X8E__ and I2CDEV_SAM3X_PDC defined and without I2CDEV_SIMULATOR).
+//
+//  Twi models the registers the backend uses: a master read in internal address mode,
+//  the PDC receive channel and the TWI_SR flags. Bytes take 9 bit times at the clock
+//  set with Wire.setClock(). A received byte stays in RHR with SCL held low until the
+//  PDC or the CPU takes it. A STOP requested while the TWI is waiting makes the next
+//  byte the last, and one requested during a byte makes that byte the last. The PDC
+//  writes to the 32 bit address in RPR, so the buffers must be in the low 4GB (see
+//  hostLowAlloc()). Reading TWI_SR costs a microsecond of simulated time so that busy
+//  waits move on, and clears NACK. The read-to-clear in "(void)twi->TWI_SR" is not
+//  modelled as a cast to void doesn't read a C++ object - START clears NACK instead.
+//
+//  The slaves are HostWireDevices attached with hostWireAttach(). Both the TWI model
+//  and the blocking TwoWire calls talk to them.
+
+#ifndef _WIRE_HOST_H
+#define _WIRE_HOST_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH               32
+
+//  The TWI register bits used by I2Cdev
+
+#define TWI_CR_START                (1u << 0)
+#define TWI_CR_STOP                 (1u << 1)
+#define TWI_MMR_IADRSZ_1_BYTE       (1u << 8)
+#define TWI_MMR_MREAD               (1u << 12)
+#define TWI_MMR_DADR(addr)          (((uint32_t)(addr) & 0x7f) << 16)
+#define TWI_SR_TXCOMP               (1u << 0)
+#define TWI_SR_RXRDY                (1u << 1)
+#define TWI_SR_NACK                 (1u << 8)
+#define TWI_SR_ENDRX                (1u << 12)
+#define TWI_PTCR_RXTEN              (1u << 0)
+#define TWI_PTCR_RXTDIS             (1u << 1)
+#define TWI_PTCR_TXTEN              (1u << 8)
+#define TWI_PTCR_TXTDIS             (1u << 9)
+
+//  A slave device. start() gets the register address, read() is called for each byte
+//  sent to the master. While stretch is true the slave holds SCL low and no more
+//  bytes are received (to make a transfer time out).
+
+class HostWireDevice
+{
+public:
+    HostWireDevice(uint8_t devAddr) { this->devAddr = devAddr; stretch = false; next = NULL; }
+    virtual ~HostWireDevice() {}
+
+    virtual bool present() { return true; }                 // false to NACK the address
+    virtual void start(uint8_t regAddr) {}                  // register address byte
+    virtual uint8_t read() = 0;                             // next byte to the master
+    virtual void write(uint8_t data) {}                     // next byte from the master
+    virtual void stop() {}                                  // end of the transaction
+
+    uint8_t devAddr;                                        // I2C slave device address
+    bool stretch;                                           // holding SCL low
+    HostWireDevice *next;
+};
+
+void hostWireAttach(HostWireDevice *device);
+uint8_t *hostLowAlloc(size_t size);                         // memory the PDC can address
+
+class Twi;
+
+//  One TWI register - reads and writes go to the model
+
+class TwiRegister
+{
+public:
+    TwiRegister(Twi *twi, int index) { m_twi = twi; m_index = index; }
+    operator uint32_t();
+    TwiRegister& operator=(uint32_t value);
+
+private:
+    Twi *m_twi;
+    int m_index;
+};
+
+#define TWI_REG_CR                  0
+#define TWI_REG_MMR                 1
+#define TWI_REG_IADR                2
+#define TWI_REG_SR                  3
+#define TWI_REG_RHR                 4
+#define TWI_REG_RPR                 5
+#define TWI_REG_RCR                 6
+#define TWI_REG_PTCR                7
+
+#define TWI_PHASE_IDLE              0                       // STOP done (TXCOMP set)
+#define TWI_PHASE_ADDRESS           1                       // address, register and repeated start address
+#define TWI_PHASE_BYTE              2                       // receiving a byte
+#define TWI_PHASE_HELD              3                       // byte in RHR, SCL held low
+#define TWI_PHASE_STRETCH           4                       // the slave is holding SCL low
+#define TWI_PHASE_STOP              5                       // sending the STOP
+
+class Twi
+{
+public:
+    Twi();
+
+    TwiRegister TWI_CR;
+    TwiRegister TWI_MMR;
+    TwiRegister TWI_IADR;
+    TwiRegister TWI_SR;
+    TwiRegister TWI_RHR;
+    TwiRegister TWI_RPR;
+    TwiRegister TWI_RCR;
+    TwiRegister TWI_PTCR;
+
+    uint32_t readRegister(int index);
+    void writeRegister(int index, uint32_t value);
+
+    void reset();                                           // Wire.begin()
+    void setClock(uint32_t clock);
+    bool busy() { return m_phase != TWI_PHASE_IDLE; }
+
+    //  counters for the tests
+
+    unsigned long transfers;                                // STARTs
+    unsigned long bytesReceived;                            // bytes clocked in from the slave
+    unsigned long pdcBytes;                                 // bytes moved by the PDC
+    unsigned long cpuBytes;                                 // bytes read from RHR by the CPU
+    unsigned long heldMicros;                               // time SCL was held waiting for RHR to be read
+    unsigned long collisions;                               // blocking Wire calls made while a transfer was running
+
+private:
+    void update();
+    void startByte(unsigned long time);
+    void pdcTake();
+
+    HostWireDevice *m_device;
+    uint32_t m_mmr;
+    uint32_t m_iadr;
+    uint32_t m_rpr;
+    uint32_t m_rcr;
+    bool m_pdcEnabled;
+    uint8_t m_rhr;
+    bool m_rxrdy;
+    bool m_nack;
+    bool m_txcomp;
+    bool m_stopRequested;
+    bool m_lastByte;
+    int m_phase;
+    unsigned long m_eventTime;                              // when the current phase ends
+    unsigned long m_byteMicros;
+};
+
+extern Twi hostTwi;
+
+#define WIRE_INTERFACE              (&hostTwi)
+
+//  The blocking Wire calls I2Cdev makes. They go straight to the slaves.
+
+class TwoWire
+{
+public:
+    void begin();
+    void setClock(uint32_t clock);
+    void beginTransmission(uint8_t devAddr);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool stop = true);
+    uint8_t requestFrom(uint8_t devAddr, uint8_t length, uint8_t stop = true);
+    int available();
+    int read();
+
+private:
+    HostWireDevice *m_device;
+    uint8_t m_txBuffer[BUFFER_LENGTH];
+    uint8_t m_txLength;
+    uint8_t m_rxBuffer[BUFFER_LENGTH];
+    uint8_t m_rxLength;
+    uint8_t m_rxIndex;
+    bool m_started;                                         // register address sent, repeated start pending
+};
+
+extern TwoWire Wire;
+
+#endif // _WIRE_HOST_H
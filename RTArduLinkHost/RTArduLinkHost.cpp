@@ -0,0 +1,615 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#include "RTArduLinkHost.h"
+#include "RTArduLinkUtils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//  RECEIVE_POLL_INTERVAL is the time in mS that the receive thread waits for data before
+//  checking whether it has been asked to stop
+
+#define RECEIVE_POLL_INTERVAL   100
+
+RTArduLinkHost::RTArduLinkHost()
+{
+    m_fd = -1;
+    m_isSocket = false;
+    m_deviceName[0] = 0;
+    m_run = false;
+    m_frameCount = 0;
+    m_errorCount = 0;
+    m_timeSyncInterval = RTARDULINKHOST_TIMESYNC_INTERVAL;
+    m_flowControlWindow = RTARDULINKHOST_FLOWCONTROL_WINDOW;
+    RTArduLinkRXFrameInit(&m_RXFrame, &m_RXFrameBuffer);
+}
+
+uint64_t RTArduLinkHost::currentMicros()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+RTArduLinkHost::~RTArduLinkHost()
+{
+    close();
+}
+
+bool RTArduLinkHost::openSerial(const char *device, unsigned long speed)
+{
+    int fd;
+
+    close();
+
+    if ((fd = ::open(device, O_RDWR | O_NOCTTY)) < 0) {
+        fprintf(stderr, "Failed to open %s: %s\n", device, strerror(errno));
+        return false;
+    }
+    if (!setRaw(fd, speed)) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_isSocket = false;
+    return true;
+}
+
+bool RTArduLinkHost::openPseudoTerminal()
+{
+    int fd;
+
+    close();
+
+    if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0) {
+        fprintf(stderr, "Failed to create pty: %s\n", strerror(errno));
+        return false;
+    }
+    if ((grantpt(fd) < 0) || (unlockpt(fd) < 0) ||
+            (ptsname_r(fd, m_deviceName, RTARDULINKHOST_DEVICE_NAME_LEN) != 0)) {
+        fprintf(stderr, "Failed to set up pty: %s\n", strerror(errno));
+        ::close(fd);
+        m_deviceName[0] = 0;
+        return false;
+    }
+
+    //  the line discipline is shared by both sides so this makes the slave raw too
+
+    if (!setRaw(fd, 0)) {
+        ::close(fd);
+        m_deviceName[0] = 0;
+        return false;
+    }
+    m_fd = fd;
+    m_isSocket = false;
+    return true;
+}
+
+bool RTArduLinkHost::openSocket(const char *path)
+{
+    int fd;
+    struct sockaddr_un addr;
+
+    close();
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return false;
+    }
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to connect to %s: %s\n", path, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_isSocket = true;
+    return true;
+}
+
+void RTArduLinkHost::close()
+{
+    end();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_deviceName[0] = 0;
+}
+
+bool RTArduLinkHost::begin()
+{
+    if (m_fd < 0)
+        return false;
+    if (m_run)
+        return true;
+
+    RTArduLinkRXFrameInit(&m_RXFrame, &m_RXFrameBuffer);
+
+    m_nodeLock.lock();
+    m_nodes.clear();
+    m_nodes[RTARDULINK_MY_ADDRESS].sequence = 0;            // always sync with the directly connected subsystem
+    m_nodeLock.unlock();
+    m_lastTimeSync = 0;
+    m_timeSyncCount = 0;
+
+    m_run = true;
+    m_thread = std::thread(&RTArduLinkHost::receiveThread, this);
+    return true;
+}
+
+void RTArduLinkHost::end()
+{
+    m_run = false;
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool RTArduLinkHost::sendMessage(unsigned int address, unsigned char messageType, unsigned char messageParam,
+        const unsigned char *data, int length)
+{
+    RTARDULINK_FRAME frame;
+    unsigned char *ptr;
+    int bytesLeft;
+    int count;
+
+    if (m_fd < 0)
+        return false;
+
+    if (length > RTARDULINK_DATA_MAX_LEN)
+        length = RTARDULINK_DATA_MAX_LEN;
+
+    frame.sync0 = RTARDULINK_MESSAGE_SYNC0;
+    frame.sync1 = RTARDULINK_MESSAGE_SYNC1;
+    frame.messageLength = RTARDULINK_MESSAGE_HEADER_LEN + length;
+    RTArduLinkConvertIntToUC2(address, frame.message.messageAddress);
+    frame.message.messageType = messageType;
+    frame.message.messageParam = messageParam;
+    if (length > 0)
+        memcpy(frame.message.data, data, length);
+    RTArduLinkSetChecksum(&frame);
+
+    std::lock_guard<std::mutex> lock(m_sendLock);
+
+    ptr = (unsigned char *)&frame;
+    bytesLeft = frame.messageLength + RTARDULINK_FRAME_HEADER_LEN;
+    while (bytesLeft > 0) {
+        if (m_isSocket)
+            count = send(m_fd, ptr, bytesLeft, MSG_NOSIGNAL);
+        else
+            count = ::write(m_fd, ptr, bytesLeft);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += count;
+        bytesLeft -= count;
+    }
+    return true;
+}
+
+void RTArduLinkHost::processMessage(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength)
+{
+    switch (message->messageType) {
+        case RTARDULINK_MESSAGE_IDENTITY:
+            printf("Subsystem %u identity: %.*s\n", address, dataLength, (char *)message->data);
+            break;
+
+        case RTARDULINK_MESSAGE_DEBUG:
+            printf("Subsystem %u debug: %.*s\n", address, dataLength, (char *)message->data);
+            break;
+
+        case RTARDULINK_MESSAGE_INFO:
+            printf("Subsystem %u info: %.*s\n", address, dataLength, (char *)message->data);
+            break;
+
+        case RTARDULINK_MESSAGE_ERROR:
+            printf("Subsystem %u error: code %d type %d\n", address, message->data[0], message->data[1]);
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool RTArduLinkHost::setRaw(int fd, unsigned long speed)
+{
+    struct termios options;
+    speed_t code;
+
+    switch (speed) {
+        case 0:         code = B0;          break;          // don't change the speed
+        case 9600:      code = B9600;       break;
+        case 19200:     code = B19200;      break;
+        case 38400:     code = B38400;      break;
+        case 57600:     code = B57600;      break;
+        case 115200:    code = B115200;     break;
+        case 230400:    code = B230400;     break;
+        case 460800:    code = B460800;     break;
+        case 921600:    code = B921600;     break;
+
+        default:
+            fprintf(stderr, "Unsupported serial speed %lu\n", speed);
+            return false;
+    }
+
+    if (tcgetattr(fd, &options) < 0) {
+        fprintf(stderr, "Failed to get serial attributes: %s\n", strerror(errno));
+        return false;
+    }
+    cfmakeraw(&options);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VTIME] = 0;
+    if (code != B0) {
+        cfsetispeed(&options, code);
+        cfsetospeed(&options, code);
+    }
+    if (tcsetattr(fd, TCSANOW, &options) < 0) {
+        fprintf(stderr, "Failed to set serial attributes: %s\n", strerror(errno));
+        return false;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return true;
+}
+
+void RTArduLinkHost::receiveThread()
+{
+    struct pollfd pfd;
+    unsigned char buffer[256];
+    int count;
+
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+
+    while (m_run) {
+        sendTimeSyncs();
+        sendFlowControls();
+
+        if (poll(&pfd, 1, RECEIVE_POLL_INTERVAL) <= 0)
+            continue;
+
+        if ((count = ::read(m_fd, buffer, sizeof(buffer))) <= 0) {
+            if ((count < 0) && (errno == EINTR))
+                continue;
+            if ((count < 0) && (errno == EIO) && !m_isSocket) {
+                usleep(RECEIVE_POLL_INTERVAL * 1000);       // pty slave isn't open yet
+                continue;
+            }
+            break;                                          // the other end has gone away
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (!RTArduLinkReassemble(&m_RXFrame, buffer[i])) {
+                m_errorCount++;
+            } else if (m_RXFrame.complete) {
+                m_frameCount++;
+                processReceivedFrame();
+                RTArduLinkRXFrameInit(&m_RXFrame, &m_RXFrameBuffer);
+            }
+        }
+    }
+    m_run = false;
+}
+
+void RTArduLinkHost::processReceivedFrame()
+{
+    RTARDULINK_MESSAGE *message;
+    RTARDULINKIMU_MESSAGE IMUMessage;
+    RTARDULINKIMU_SUMMARY IMUSummary;
+    RTARDULINKHOST_IMUDATA IMUData;
+    unsigned int address;
+    int dataLength;
+    bool isIMUData = false;
+
+    message = &(m_RXFrameBuffer.message);
+    dataLength = m_RXFrameBuffer.messageLength - RTARDULINK_MESSAGE_HEADER_LEN;
+    if (dataLength < 0) {
+        m_errorCount++;
+        return;
+    }
+
+    address = RTArduLinkConvertUC2ToUInt(message->messageAddress);
+
+    switch (message->messageType) {
+        case RTARDULINK_MESSAGE_TIMESYNC:
+            processTimeSync(address, message, dataLength);
+            return;
+
+        case RTARDULINK_MESSAGE_FLOWCONTROL:
+            processFlowControl(address, message, dataLength);
+            return;
+
+        case RTARDULINK_MESSAGE_ERROR:
+            if ((dataLength >= 2) && (message->data[0] == RTARDULINK_RESPONSE_ILLEGAL_COMMAND) &&
+                    ((message->data[1] == RTARDULINK_MESSAGE_TIMESYNC) || (message->data[1] == RTARDULINK_MESSAGE_FLOWCONTROL))) {
+                //  older subsystem code - just stop asking
+
+                std::lock_guard<std::mutex> lock(m_nodeLock);
+                RTARDULINKHOST_NODE& node = m_nodes[address];
+                if (message->data[1] == RTARDULINK_MESSAGE_TIMESYNC)
+                    node.noTimeSync = true;
+                else
+                    node.noFlowControl = true;
+                return;
+            }
+            break;
+
+        case RTARDULINK_MESSAGE_IMU:
+        case RTARDULINK_MESSAGE_IMU_MICROS:
+            if (dataLength < (int)sizeof(RTARDULINKIMU_MESSAGE))
+                break;
+            memcpy(&IMUMessage, message->data, sizeof(RTARDULINKIMU_MESSAGE));    // data field is not aligned
+            IMUData.timestamp = (unsigned long)RTArduLinkConvertUC4ToLong(IMUMessage.timestamp) & 0xffffffff;
+            if (message->messageType == RTARDULINK_MESSAGE_IMU)
+                IMUData.timestamp = (IMUData.timestamp * 1000) & 0xffffffff;    // older mS format
+            IMUData.sampleCount = 1;
+            IMUData.gyro = RTVector3(IMUMessage.gyro[0], IMUMessage.gyro[1], IMUMessage.gyro[2]);
+            IMUData.accel = RTVector3(IMUMessage.accel[0], IMUMessage.accel[1], IMUMessage.accel[2]);
+            IMUData.mag = RTVector3(IMUMessage.mag[0], IMUMessage.mag[1], IMUMessage.mag[2]);
+            isIMUData = true;
+            break;
+
+        case RTARDULINK_MESSAGE_IMU_SUMMARY:
+            if (dataLength < (int)sizeof(RTARDULINKIMU_SUMMARY))
+                break;
+            memcpy(&IMUSummary, message->data, sizeof(RTARDULINKIMU_SUMMARY));
+            IMUData.timestamp = (unsigned long)RTArduLinkConvertUC4ToLong(IMUSummary.timestamp) & 0xffffffff;
+            IMUData.sampleCount = (unsigned long)RTArduLinkConvertUC4ToLong(IMUSummary.sampleCount) & 0xffffffff;
+            IMUData.gyro = RTVector3(IMUSummary.gyro[0], IMUSummary.gyro[1], IMUSummary.gyro[2]);
+            IMUData.accel = RTVector3(IMUSummary.accel[0], IMUSummary.accel[1], IMUSummary.accel[2]);
+            IMUData.mag = RTVector3(IMUSummary.mag[0], IMUSummary.mag[1], IMUSummary.mag[2]);
+            isIMUData = true;
+            break;
+
+        default:
+            break;
+    }
+
+    if ((message->messageType >= RTARDULINK_MESSAGE_CUSTOM) || isIMUData) {
+        //  this is a data message that uses flow control credit
+
+        std::lock_guard<std::mutex> lock(m_nodeLock);
+        RTARDULINKHOST_NODE& node = m_nodes[address];       // adds the subsystem if it's new
+
+        node.received++;
+        if (isIMUData) {
+            IMUData.address = address;
+            IMUData.state = message->messageParam;
+            if (node.timeSync.isValid())
+                IMUData.hostTimestamp = node.timeSync.toHostTime(node.timeSync.unwrapMicros(IMUData.timestamp));
+            else
+                IMUData.hostTimestamp = 0;
+            m_IMUQueue.push(IMUData);
+        }
+        updateFlowControl(address, node, false);
+    }
+
+    if (!isIMUData) {
+        if ((message->messageType == RTARDULINK_MESSAGE_IMU) || (message->messageType == RTARDULINK_MESSAGE_IMU_MICROS) ||
+                (message->messageType == RTARDULINK_MESSAGE_IMU_SUMMARY))
+            m_errorCount++;                                 // too short
+        else
+            processMessage(address, message, dataLength);
+    }
+}
+
+void RTArduLinkHost::sendFlowControls()
+{
+    std::lock_guard<std::mutex> lock(m_nodeLock);
+
+    for (auto& entry : m_nodes)
+        updateFlowControl(entry.first, entry.second, true);
+}
+
+void RTArduLinkHost::updateFlowControl(unsigned int address, RTARDULINKHOST_NODE& node, bool refresh)
+{
+    RTARDULINK_FLOWCONTROL flowControl;
+    uint32_t window;
+    uint32_t limit;
+    uint64_t now;
+
+    if (node.noFlowControl)
+        return;
+
+    now = currentMicros();
+    if (refresh && ((now - node.grantTime) < (RTARDULINKHOST_FLOWCONTROL_REFRESH * 1000)))
+        return;
+
+    if (m_flowControlWindow <= 0) {
+        if (node.flowControlOn) {
+            RTArduLinkConvertLongToUC4(0, flowControl.count);
+            sendMessage(address, RTARDULINK_MESSAGE_FLOWCONTROL, RTARDULINK_FLOWCONTROL_OFF,
+                    (unsigned char *)&flowControl, sizeof(RTARDULINK_FLOWCONTROL));
+            node.flowControlOn = false;
+            node.countValid = false;
+        }
+        return;
+    }
+    window = m_flowControlWindow;
+
+    if (!node.countValid) {
+        //  the subsystem's count isn't known yet so give it a window from wherever it is now
+
+        if (!refresh && node.flowControlOn)
+            return;                                         // already asked - wait for the answer or a refresh
+        node.relativeGrant = window;
+        RTArduLinkConvertLongToUC4(window, flowControl.count);
+        sendMessage(address, RTARDULINK_MESSAGE_FLOWCONTROL, RTARDULINK_FLOWCONTROL_RELATIVE,
+                (unsigned char *)&flowControl, sizeof(RTARDULINK_FLOWCONTROL));
+        node.flowControlOn = true;
+        node.grantTime = now;
+        return;
+    }
+
+    //  stop giving credit if the application isn't keeping up
+
+    if (m_IMUQueue.count() >= (RTARDULINKHOST_IMUQUEUE_LEN / 2))
+        window = 0;
+
+    limit = node.reportedCount + (node.received - node.receivedAtReport) + window;
+    if ((int32_t)(limit - node.creditLimit) < 0)
+        limit = node.creditLimit;                           // can't take credit back
+
+    //  only send when half the window has been used up unless it's a refresh
+
+    if (!refresh && ((int32_t)(limit - node.creditLimit) < (int32_t)((window + 1) / 2)))
+        return;
+
+    RTArduLinkConvertLongToUC4(limit, flowControl.count);
+    sendMessage(address, RTARDULINK_MESSAGE_FLOWCONTROL, RTARDULINK_FLOWCONTROL_LIMIT,
+            (unsigned char *)&flowControl, sizeof(RTARDULINK_FLOWCONTROL));
+    node.creditLimit = limit;
+    node.grantTime = now;
+}
+
+void RTArduLinkHost::processFlowControl(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength)
+{
+    RTARDULINK_FLOWCONTROL *flowControl;
+    uint32_t count;
+
+    if (dataLength < (int)sizeof(RTARDULINK_FLOWCONTROL)) {
+        m_errorCount++;
+        return;
+    }
+    flowControl = (RTARDULINK_FLOWCONTROL *)(message->data);
+    count = (uint32_t)RTArduLinkConvertUC4ToLong(flowControl->count);
+
+    std::lock_guard<std::mutex> lock(m_nodeLock);
+
+    auto entry = m_nodes.find(address);
+    if ((entry == m_nodes.end()) || !entry->second.flowControlOn)
+        return;
+    RTARDULINKHOST_NODE& node = entry->second;
+
+    if (message->messageParam == RTARDULINK_FLOWCONTROL_RELATIVE) {
+        if (node.countValid)
+            return;                                         // an old response
+        node.creditLimit = count + node.relativeGrant;
+    } else if (!node.countValid ||
+            ((int32_t)(count - (node.reportedCount + (node.received - node.receivedAtReport))) < 0)) {
+        //  count has gone backwards so the subsystem must have been reset
+
+        node.creditLimit = count;
+    }
+
+    //  everything the subsystem had sent before the response has arrived (or been lost) by now
+
+    node.reportedCount = count;
+    node.receivedAtReport = node.received;
+    node.countValid = true;
+}
+
+void RTArduLinkHost::sendTimeSyncs()
+{
+    uint64_t now;
+    uint64_t interval;
+
+    if (m_timeSyncInterval <= 0)
+        return;
+
+    //  do the first few quickly to get a usable estimate
+
+    interval = (uint64_t)m_timeSyncInterval * 1000;
+    if (m_timeSyncCount < RTARDULINKHOST_TIMESYNC_FAST_COUNT)
+        interval /= 10;
+
+    now = currentMicros();
+    if ((now - m_lastTimeSync) < interval)
+        return;
+    m_lastTimeSync = now;
+    m_timeSyncCount++;
+
+    std::lock_guard<std::mutex> lock(m_nodeLock);
+
+    for (auto& entry : m_nodes) {
+        if (entry.second.noTimeSync)
+            continue;
+        entry.second.sequence++;
+        entry.second.sendTime = currentMicros();
+        sendMessage(entry.first, RTARDULINK_MESSAGE_TIMESYNC, entry.second.sequence, NULL, 0);
+    }
+}
+
+void RTArduLinkHost::processTimeSync(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength)
+{
+    RTARDULINK_TIMESYNC *timeSync;
+    uint64_t now;
+
+    now = currentMicros();
+
+    if (dataLength < (int)sizeof(RTARDULINK_TIMESYNC)) {
+        m_errorCount++;
+        return;
+    }
+    timeSync = (RTARDULINK_TIMESYNC *)(message->data);
+
+    std::lock_guard<std::mutex> lock(m_nodeLock);
+
+    auto entry = m_nodes.find(address);
+    if ((entry == m_nodes.end()) || (entry->second.sequence != message->messageParam))
+        return;                                             // not the latest request - can't tell when it was sent
+
+    entry->second.timeSync.newExchange(entry->second.sendTime, now,
+            (uint32_t)RTArduLinkConvertUC4ToLong(timeSync->receiveTime),
+            (uint32_t)RTArduLinkConvertUC4ToLong(timeSync->sendTime),
+            (uint32_t)RTArduLinkConvertUC4ToLong(timeSync->sendTimeMillis));
+}
+
+bool RTArduLinkHost::getTimeSync(unsigned int address, double& offset, double& drift, uint32_t& roundTrip)
+{
+    std::lock_guard<std::mutex> lock(m_nodeLock);
+
+    auto entry = m_nodes.find(address);
+    if ((entry == m_nodes.end()) || !entry->second.timeSync.isValid())
+        return false;
+    offset = entry->second.timeSync.getOffset();
+    drift = entry->second.timeSync.getDrift();
+    roundTrip = entry->second.timeSync.getRoundTrip();
+    return true;
+}
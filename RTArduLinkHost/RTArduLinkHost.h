@@ -0,0 +1,182 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTARDULINKHOST_H
+#define _RTARDULINKHOST_H
+
+//  RTArduLinkHost is the host side of an RTArduLink connection. It runs on Linux and talks to
+//  a subsystem (normally an Arduino running RTArduLinkIMU) over a serial device, a pseudo-terminal
+//  or a Unix domain socket. A receive thread reassembles frames and decodes the IMU messages
+//  into a lock-free queue so that the application thread can run the fusion on the host. The
+//  older RTARDULINK_MESSAGE_IMU with mS timestamps is accepted as well as RTARDULINK_MESSAGE_IMU_MICROS.
+//
+//  The IMU message carries floats in the subsystem's native format. AVR and ARM Arduinos both use
+//  little endian IEEE 754 which matches x86 and ARM Linux hosts so the values are copied directly.
+//
+//  The receive thread also runs RTARDULINK_MESSAGE_TIMESYNC exchanges with every subsystem that
+//  has sent IMU data so that IMU timestamps can be translated into host time. Host time is
+//  CLOCK_MONOTONIC in uS as returned by currentMicros().
+//
+//  Subsystems are also given RTARDULINK_MESSAGE_FLOWCONTROL credits for their data messages so
+//  that they never send more than the link and the host can take. A subsystem that runs out of
+//  credit (or local buffer space) summarises its samples into RTARDULINK_MESSAGE_IMU_SUMMARY
+//  messages instead. If the application stops calling getIMUData(), credit stops too.
+
+#include "RTArduLinkDefs.h"
+#include "RTArduLinkIMUDefs.h"
+#include "RTArduLinkHostQueue.h"
+#include "RTArduLinkHostTimeSync.h"
+#include "RTMath.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+//  RTARDULINKHOST_IMUDATA is the decoded form of an IMU or IMU summary message
+
+typedef struct
+{
+    unsigned int address;                                   // address of the subsystem that sent the data
+    unsigned long timestamp;                                // subsystem sample time in uS (32 bits, wraps)
+    uint64_t hostTimestamp;                                 // sample time in host uS or 0 if not synchronised yet
+    unsigned char state;                                    // RTARDULINKIMU_STATE_ flags
+    unsigned long sampleCount;                              // number of samples averaged into this one (1 if not a summary)
+    RTVector3 gyro;                                         // de-biased gyro data in rads/sec
+    RTVector3 accel;                                        // accel data in gs
+    RTVector3 mag;                                          // magnetometer data in uT
+} RTARDULINKHOST_IMUDATA;
+
+#define RTARDULINKHOST_IMUQUEUE_LEN     256                 // IMU samples that can be waiting (must be a power of 2)
+#define RTARDULINKHOST_DEVICE_NAME_LEN  64                  // max length of a pty slave name
+#define RTARDULINKHOST_TIMESYNC_INTERVAL    1000            // default mS between time sync exchanges
+#define RTARDULINKHOST_TIMESYNC_FAST_COUNT  10              // exchanges done at a tenth of the interval at the start
+#define RTARDULINKHOST_FLOWCONTROL_WINDOW   16              // default number of data messages each subsystem may have outstanding
+#define RTARDULINKHOST_FLOWCONTROL_REFRESH  100             // mS between credit refreshes if nothing else has been sent
+
+class RTArduLinkHost
+{
+public:
+    RTArduLinkHost();
+    virtual ~RTArduLinkHost();
+
+    //  Endpoint selection - call one of these and then begin(). Only one endpoint can be open at a time.
+
+    bool openSerial(const char *device, unsigned long speed); // opens a serial device (or pty slave) in raw mode
+    bool openPseudoTerminal();                              // creates a pty. The subsystem side should open getDeviceName()
+    bool openSocket(const char *path);                      // connects to a listening Unix domain stream socket
+    const char *getDeviceName() { return m_deviceName; }    // the pty slave device name after openPseudoTerminal()
+    void close();                                           // stops the receive thread and closes the endpoint
+
+    bool begin();                                           // starts the receive thread
+    void end();                                             // stops the receive thread
+
+    bool sendMessage(unsigned int address, unsigned char messageType, unsigned char messageParam,
+        const unsigned char *data, int length);             // sends a message to a subsystem. Can be called from any thread
+
+    //  getIMUData() returns the next IMU sample in arrival order, false if there isn't one.
+    //  It must only be called from one thread.
+
+    bool getIMUData(RTARDULINKHOST_IMUDATA& data) { return m_IMUQueue.pop(data); }
+
+    unsigned long getFrameCount() { return m_frameCount; }  // number of valid frames received
+    unsigned long getErrorCount() { return m_errorCount; }  // number of reassembly and checksum errors
+    unsigned int getIMUDropCount() { return m_IMUQueue.getDropCount(); } // IMU samples lost because the queue was full
+
+    //  Time synchronisation
+
+    static uint64_t currentMicros();                        // the host clock in uS
+    void setTimeSyncInterval(int interval) { m_timeSyncInterval = interval; } // mS between exchanges, 0 to disable
+    bool getTimeSync(unsigned int address, double& offset, double& drift, uint32_t& roundTrip); // current estimate for a subsystem
+
+    //  Flow control
+
+    void setFlowControlWindow(int window) { m_flowControlWindow = window; } // data messages outstanding per subsystem, 0 to disable
+
+protected:
+    //  processMessage() is called on the receive thread for every message other than IMU data.
+    //  The default version prints identity, debug, info and error messages.
+
+    virtual void processMessage(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength);
+
+private:
+    bool setRaw(int fd, unsigned long speed);               // puts a tty into raw mode at the specified speed
+    void receiveThread();                                   // the receive thread
+    void processReceivedFrame();                            // handles a complete frame
+    void sendTimeSyncs();                                   // starts an exchange with each known subsystem
+    void processTimeSync(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength); // handles a response
+
+    typedef struct
+    {
+        RTArduLinkHostTimeSync timeSync;                    // the clock estimator for this subsystem
+        unsigned char sequence;                             // sequence number of the last request
+        uint64_t sendTime;                                  // host time the last request was sent
+
+        bool flowControlOn;                                 // true if flow control has been turned on
+        bool countValid;                                    // true once the subsystem has reported its count
+        uint32_t relativeGrant;                             // credit given by the last relative grant
+        uint32_t reportedCount;                             // the subsystem's last reported count of data messages sent
+        uint32_t receivedAtReport;                          // value of received when that report arrived
+        uint32_t received;                                  // data messages received from the subsystem
+        uint32_t creditLimit;                               // the last credit limit granted
+        uint64_t grantTime;                                 // host time of the last grant
+
+        bool noTimeSync;                                    // true if the subsystem doesn't support time sync
+        bool noFlowControl;                                 // true if the subsystem doesn't support flow control
+    } RTARDULINKHOST_NODE;
+
+    void updateFlowControl(unsigned int address, RTARDULINKHOST_NODE& node, bool refresh); // grants credit if needed
+    void sendFlowControls();                                // refreshes credit for each known subsystem
+    void processFlowControl(unsigned int address, RTARDULINK_MESSAGE *message, int dataLength); // handles a response
+
+    int m_fd;                                               // the endpoint file descriptor or -1 if not open
+    bool m_isSocket;                                        // true if the endpoint is a socket
+    char m_deviceName[RTARDULINKHOST_DEVICE_NAME_LEN];      // pty slave name
+
+    std::thread m_thread;                                   // the receive thread
+    std::atomic<bool> m_run;                                // cleared to stop the receive thread
+    std::mutex m_sendLock;                                  // serializes writes to the endpoint
+
+    RTARDULINK_RXFRAME m_RXFrame;                           // structure to maintain receive frame state
+    RTARDULINK_FRAME m_RXFrameBuffer;                       // used to assemble received frames
+    RTArduLinkHostQueue<RTARDULINKHOST_IMUDATA, RTARDULINKHOST_IMUQUEUE_LEN> m_IMUQueue; // decoded IMU samples
+
+    std::map<unsigned int, RTARDULINKHOST_NODE> m_nodes;    // subsystems known about, by address
+    std::mutex m_nodeLock;                                  // protects m_nodes
+    std::atomic<int> m_timeSyncInterval;                    // mS between exchanges
+    uint64_t m_lastTimeSync;                                // host time of the last exchange
+    int m_timeSyncCount;                                    // number of rounds of exchanges so far
+    std::atomic<int> m_flowControlWindow;                   // data messages outstanding per subsystem
+
+    std::atomic<unsigned long> m_frameCount;                // valid frames received
+    std::atomic<unsigned long> m_errorCount;                // frame errors
+};
+
+#endif // _RTARDULINKHOST_H
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+//  RTArduLinkHostIMU receives IMU data from an RTArduLinkIMU subsystem and runs RTFusionRTQF
+//  on the host. Usage:
+//
+//      RTArduLinkHostIMU                       use the built in loopback stand-in over a pty
+//      RTArduLinkHostIMU -s <device> [speed]   use a serial device (default speed 115200)
+//      RTArduLinkHostIMU -p                    create a pty and wait for a subsystem to attach
+//      RTArduLinkHostIMU -u <path>             connect to a Unix socket
+//      RTArduLinkHostIMU -l <path>             use the loopback stand-in over a Unix socket
+
+#include "RTArduLinkHost.h"
+#include "RTArduLinkHostLoopback.h"
+#include "RTFusionRTQF.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+//  DISPLAY_INTERVAL sets the rate at which results are displayed
+
+#define DISPLAY_INTERVAL  300                               // interval in milliseconds
+
+//  The loopback stand-in's clock runs fast by LOOPBACK_DRIFT ppm and starts just before micros() wraps
+
+#define LOOPBACK_DRIFT    100.0
+#define LOOPBACK_UPTIME   4280000000ULL
+
+static unsigned long hostMillis()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main(int argc, char *argv[])
+{
+    RTArduLinkHost host;
+    RTArduLinkHostLoopback loopback;
+    RTFusionRTQF fusion;
+    RTARDULINKHOST_IMUDATA data;
+    RTVector3 pose;
+    unsigned long lastDisplay;
+    unsigned long sampleCount;
+    int64_t latency;
+    double offset;
+    double drift;
+    uint32_t roundTrip;
+    bool opened;
+
+    loopback.setClock(LOOPBACK_DRIFT, LOOPBACK_UPTIME);
+
+    if (argc == 1) {
+        opened = loopback.beginPseudoTerminal() && host.openSerial(loopback.getDeviceName(), 0);
+    } else if ((argc >= 3) && (strcmp(argv[1], "-s") == 0)) {
+        opened = host.openSerial(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 10) : 115200);
+    } else if ((argc == 2) && (strcmp(argv[1], "-p") == 0)) {
+        if ((opened = host.openPseudoTerminal()))
+            printf("Attach the subsystem to %s\n", host.getDeviceName());
+    } else if ((argc == 3) && (strcmp(argv[1], "-u") == 0)) {
+        opened = host.openSocket(argv[2]);
+    } else if ((argc == 3) && (strcmp(argv[1], "-l") == 0)) {
+        opened = loopback.beginSocket(argv[2]) && host.openSocket(argv[2]);
+    } else {
+        fprintf(stderr, "Usage: %s [-s <device> [speed] | -p | -u <socket> | -l <socket>]\n", argv[0]);
+        return 1;
+    }
+
+    if (!opened || !host.begin())
+        return 1;
+
+    //  this is how RTIMU sets up the fusion
+
+    fusion.setSlerpPower(0.02);
+    fusion.setGyroEnable(true);
+    fusion.setAccelEnable(true);
+    fusion.setCompassEnable(true);
+
+    host.sendMessage(RTARDULINK_MY_ADDRESS, RTARDULINK_MESSAGE_IDENTITY, 0, NULL, 0);
+
+    lastDisplay = hostMillis();
+    sampleCount = 0;
+    latency = 0;
+
+    while (1) {
+        while (host.getIMUData(data)) {
+            fusion.newIMUData(data.gyro, data.accel, data.mag, data.timestamp);
+            if (data.hostTimestamp != 0)
+                latency = (int64_t)(RTArduLinkHost::currentMicros() - data.hostTimestamp);
+            sampleCount += data.sampleCount;
+        }
+
+        if ((hostMillis() - lastDisplay) >= DISPLAY_INTERVAL) {
+            lastDisplay = hostMillis();
+            pose = fusion.getFusionPose();
+            printf("Samples %lu frames %lu errors %lu dropped %u ", sampleCount,
+                    host.getFrameCount(), host.getErrorCount(), host.getIMUDropCount());
+            RTMath::displayRollPitchYaw("Pose:", pose);     // fused output
+            if (host.getTimeSync(RTARDULINK_MY_ADDRESS, offset, drift, roundTrip))
+                printf(" drift:%.1fppm rtt:%uuS latency:%lduS", drift, roundTrip, (long)latency);
+            printf("\n");
+            fflush(stdout);
+        }
+        usleep(1000);
+    }
+}
@@ -0,0 +1,399 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#include "RTArduLinkHostLoopback.h"
+#include "RTArduLinkUtils.h"
+#include "RTArduLinkIMUDefs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//  The simulated earth field in uT - horizontal component points north, vertical points down
+
+#define LOOPBACK_MAG_HORIZONTAL     20.0f
+#define LOOPBACK_MAG_VERTICAL       40.0f
+
+#define LOOPBACK_IDENTITY           "RTArduLink loopback:RTArduLinkIMU"
+
+static uint64_t hostMicros()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned long loopbackMillis()
+{
+    return hostMicros() / 1000;
+}
+
+RTArduLinkHostLoopback::RTArduLinkHostLoopback()
+{
+    m_fd = -1;
+    m_listenFd = -1;
+    m_deviceName[0] = 0;
+    m_socketPath[0] = 0;
+    m_sampleRate = 50;
+    m_rotationRate = 0.5f;
+    m_clockDrift = 0;
+    m_clockUptime = 0;
+    m_clockStart = hostMicros();
+    m_flowControl = false;
+    m_TXCount = 0;
+    m_TXCreditLimit = 0;
+    m_summaryCount = 0;
+    m_run = false;
+}
+
+RTArduLinkHostLoopback::~RTArduLinkHostLoopback()
+{
+    end();
+}
+
+bool RTArduLinkHostLoopback::beginPseudoTerminal()
+{
+    int fd;
+    int slaveFd;
+    struct termios options;
+
+    end();
+
+    if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0) {
+        fprintf(stderr, "Loopback failed to create pty: %s\n", strerror(errno));
+        return false;
+    }
+    if ((grantpt(fd) < 0) || (unlockpt(fd) < 0) ||
+            (ptsname_r(fd, m_deviceName, RTARDULINKHOSTLOOPBACK_DEVICE_NAME_LEN) != 0)) {
+        fprintf(stderr, "Loopback failed to set up pty: %s\n", strerror(errno));
+        ::close(fd);
+        m_deviceName[0] = 0;
+        return false;
+    }
+
+    //  make the line raw straight away so nothing sent before the host opens the slave gets mangled
+
+    if ((slaveFd = ::open(m_deviceName, O_RDWR | O_NOCTTY)) >= 0) {
+        if (tcgetattr(slaveFd, &options) == 0) {
+            cfmakeraw(&options);
+            tcsetattr(slaveFd, TCSANOW, &options);
+        }
+        ::close(slaveFd);
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);   // never block if the host isn't reading
+    m_fd = fd;
+    m_run = true;
+    m_thread = std::thread(&RTArduLinkHostLoopback::run, this);
+    return true;
+}
+
+bool RTArduLinkHostLoopback::beginSocket(const char *path)
+{
+    struct sockaddr_un addr;
+
+    end();
+
+    if ((strlen(path) >= sizeof(addr.sun_path)) || (strlen(path) >= sizeof(m_socketPath))) {
+        fprintf(stderr, "Loopback socket path %s is too long\n", path);
+        return false;
+    }
+    if ((m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+        fprintf(stderr, "Loopback failed to create socket: %s\n", strerror(errno));
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if ((bind(m_listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(m_listenFd, 1) < 0)) {
+        fprintf(stderr, "Loopback failed to listen on %s: %s\n", path, strerror(errno));
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    strcpy(m_socketPath, path);
+    m_run = true;
+    m_thread = std::thread(&RTArduLinkHostLoopback::run, this);
+    return true;
+}
+
+void RTArduLinkHostLoopback::end()
+{
+    m_run = false;
+    if (m_thread.joinable())
+        m_thread.join();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+    }
+    if (m_socketPath[0] != 0) {
+        unlink(m_socketPath);
+        m_socketPath[0] = 0;
+    }
+    m_deviceName[0] = 0;
+}
+
+void RTArduLinkHostLoopback::run()
+{
+    struct pollfd pfd;
+    RTARDULINK_RXFRAME RXFrame;
+    RTARDULINK_FRAME RXFrameBuffer;
+    unsigned char buffer[256];
+    unsigned long nextSample;
+    unsigned long now;
+    int timeout;
+    int count;
+
+    //  wait for the host to connect if using a socket
+
+    while (m_run && (m_fd < 0)) {
+        pfd.fd = m_listenFd;
+        pfd.events = POLLIN;
+        if ((poll(&pfd, 1, 100) > 0) && ((m_fd = accept(m_listenFd, NULL, NULL)) >= 0))
+            fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    RTArduLinkRXFrameInit(&RXFrame, &RXFrameBuffer);
+    m_clockStart = hostMicros();
+    nextSample = loopbackMillis();
+
+    while (m_run) {
+        now = loopbackMillis();
+        if ((long)(now - nextSample) >= 0) {
+            sendIMU(subsystemMicros());
+            nextSample += 1000 / m_sampleRate;
+            if ((long)(now - nextSample) > 1000)
+                nextSample = now;                           // fell a long way behind - don't try to catch up
+        }
+
+        timeout = (int)(nextSample - now);
+        if (timeout < 0)
+            timeout = 0;
+
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout) <= 0)
+            continue;
+
+        if ((count = ::read(m_fd, buffer, sizeof(buffer))) <= 0) {
+            if ((count < 0) && (errno == EINTR))
+                continue;
+            usleep(10000);                                  // host isn't connected - keep the simulated clock running
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            if (RTArduLinkReassemble(&RXFrame, buffer[i]) && RXFrame.complete) {
+                processFrame(&RXFrameBuffer);
+                RTArduLinkRXFrameInit(&RXFrame, &RXFrameBuffer);
+            }
+        }
+    }
+}
+
+uint64_t RTArduLinkHostLoopback::subsystemMicros()
+{
+    return m_clockUptime + (uint64_t)((double)(hostMicros() - m_clockStart) * (1.0 + m_clockDrift / 1000000.0));
+}
+
+void RTArduLinkHostLoopback::sendIMU(uint64_t timestamp)
+{
+    RTARDULINK_FRAME frame;
+    RTARDULINKIMU_MESSAGE IMUMessage;
+    RTFLOAT yaw;
+
+    yaw = m_rotationRate * (RTFLOAT)(timestamp - m_clockUptime) / 1000000.0f;
+
+    RTArduLinkConvertLongToUC4((long)timestamp, IMUMessage.timestamp);
+    IMUMessage.gyro[0] = 0;
+    IMUMessage.gyro[1] = 0;
+    IMUMessage.gyro[2] = m_rotationRate;
+    IMUMessage.accel[0] = 0;
+    IMUMessage.accel[1] = 0;
+    IMUMessage.accel[2] = 1;
+    IMUMessage.mag[0] = LOOPBACK_MAG_HORIZONTAL * cos(yaw);
+    IMUMessage.mag[1] = -LOOPBACK_MAG_HORIZONTAL * sin(yaw);
+    IMUMessage.mag[2] = LOOPBACK_MAG_VERTICAL;
+
+    if ((m_summaryCount > 0) || (m_flowControl && ((int32_t)(m_TXCreditLimit - m_TXCount) <= 0))) {
+        sendSummary(&IMUMessage);
+        return;
+    }
+
+    RTArduLinkConvertIntToUC2(RTARDULINK_MY_ADDRESS, frame.message.messageAddress);
+    frame.message.messageType = RTARDULINK_MESSAGE_IMU_MICROS;
+    frame.message.messageParam = RTARDULINKIMU_STATE_GYRO_BIAS_VALID | RTARDULINKIMU_STATE_MAG_CAL_VALID;
+    memcpy(frame.message.data, &IMUMessage, sizeof(RTARDULINKIMU_MESSAGE));
+    sendFrame(&frame, RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINKIMU_MESSAGE));
+    m_TXCount++;
+}
+
+void RTArduLinkHostLoopback::sendSummary(RTARDULINKIMU_MESSAGE *IMUMessage)
+{
+    RTARDULINK_FRAME frame;
+
+    if (m_summaryCount == 0)
+        memset(&m_summary, 0, sizeof(RTARDULINKIMU_SUMMARY));
+    for (int i = 0; i < 3; i++) {
+        m_summary.gyro[i] += IMUMessage->gyro[i];
+        m_summary.accel[i] += IMUMessage->accel[i];
+        m_summary.mag[i] += IMUMessage->mag[i];
+    }
+    m_summaryCount++;
+
+    if (m_flowControl && ((int32_t)(m_TXCreditLimit - m_TXCount) <= 0))
+        return;                                             // keep accumulating
+
+    for (int i = 0; i < 3; i++) {
+        m_summary.gyro[i] /= m_summaryCount;
+        m_summary.accel[i] /= m_summaryCount;
+        m_summary.mag[i] /= m_summaryCount;
+    }
+    memcpy(m_summary.timestamp, IMUMessage->timestamp, sizeof(RTARDULINK_UC4));
+    RTArduLinkConvertLongToUC4(m_summaryCount, m_summary.sampleCount);
+
+    RTArduLinkConvertIntToUC2(RTARDULINK_MY_ADDRESS, frame.message.messageAddress);
+    frame.message.messageType = RTARDULINK_MESSAGE_IMU_SUMMARY;
+    frame.message.messageParam = RTARDULINKIMU_STATE_GYRO_BIAS_VALID | RTARDULINKIMU_STATE_MAG_CAL_VALID;
+    memcpy(frame.message.data, &m_summary, sizeof(RTARDULINKIMU_SUMMARY));
+    sendFrame(&frame, RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINKIMU_SUMMARY));
+    m_TXCount++;
+    m_summaryCount = 0;
+}
+
+void RTArduLinkHostLoopback::processFrame(RTARDULINK_FRAME *frame)
+{
+    RTARDULINK_MESSAGE *message = &(frame->message);
+    RTARDULINK_TIMESYNC *timeSync;
+    RTARDULINK_FLOWCONTROL *flowControl;
+    uint64_t receiveTime;
+    unsigned int address;
+    int identityLength;
+
+    receiveTime = subsystemMicros();
+
+    address = RTArduLinkConvertUC2ToUInt(message->messageAddress);
+    if ((address != RTARDULINK_MY_ADDRESS) && (address != RTARDULINK_BROADCAST_ADDRESS))
+        return;                                             // nothing is daisy chained to the stand-in
+
+    RTArduLinkConvertIntToUC2(RTARDULINK_MY_ADDRESS, message->messageAddress);
+
+    switch (message->messageType) {
+        case RTARDULINK_MESSAGE_POLL:
+        case RTARDULINK_MESSAGE_ECHO:
+            sendFrame(frame, frame->messageLength);
+            break;
+
+        case RTARDULINK_MESSAGE_TIMESYNC:
+            timeSync = (RTARDULINK_TIMESYNC *)(message->data);
+            RTArduLinkConvertLongToUC4((long)receiveTime, timeSync->receiveTime);
+            RTArduLinkConvertLongToUC4((long)(subsystemMicros() / 1000), timeSync->sendTimeMillis);
+            RTArduLinkConvertLongToUC4((long)subsystemMicros(), timeSync->sendTime);
+            sendFrame(frame, RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINK_TIMESYNC));
+            break;
+
+        case RTARDULINK_MESSAGE_FLOWCONTROL:
+            flowControl = (RTARDULINK_FLOWCONTROL *)(message->data);
+            switch (message->messageParam) {
+                case RTARDULINK_FLOWCONTROL_LIMIT:
+                    m_flowControl = true;
+                    m_TXCreditLimit = (uint32_t)RTArduLinkConvertUC4ToLong(flowControl->count);
+                    break;
+
+                case RTARDULINK_FLOWCONTROL_RELATIVE:
+                    m_flowControl = true;
+                    m_TXCreditLimit = m_TXCount + (uint32_t)RTArduLinkConvertUC4ToLong(flowControl->count);
+                    break;
+
+                default:
+                    m_flowControl = false;
+                    break;
+            }
+            RTArduLinkConvertLongToUC4(m_TXCount, flowControl->count);
+            sendFrame(frame, RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINK_FLOWCONTROL));
+            break;
+
+        case RTARDULINK_MESSAGE_IDENTITY:
+            identityLength = strlen(LOOPBACK_IDENTITY);
+            memcpy(message->data, LOOPBACK_IDENTITY, identityLength + 1);
+            sendFrame(frame, RTARDULINK_MESSAGE_HEADER_LEN + identityLength + 1);
+            break;
+
+        default:
+            if (message->messageType < RTARDULINK_MESSAGE_CUSTOM) {
+                message->data[0] = RTARDULINK_RESPONSE_ILLEGAL_COMMAND;
+                message->data[1] = message->messageType;
+                message->messageType = RTARDULINK_MESSAGE_ERROR;
+                sendFrame(frame, RTARDULINK_MESSAGE_HEADER_LEN + 2);
+            }
+            break;
+    }
+}
+
+void RTArduLinkHostLoopback::sendFrame(RTARDULINK_FRAME *frame, int length)
+{
+    unsigned char *ptr;
+    int bytesLeft;
+    int count;
+
+    frame->sync0 = RTARDULINK_MESSAGE_SYNC0;
+    frame->sync1 = RTARDULINK_MESSAGE_SYNC1;
+    frame->messageLength = length;
+    RTArduLinkSetChecksum(frame);
+
+    ptr = (unsigned char *)frame;
+    bytesLeft = length + RTARDULINK_FRAME_HEADER_LEN;
+    while (bytesLeft > 0) {
+        if (m_listenFd >= 0)
+            count = send(m_fd, ptr, bytesLeft, MSG_NOSIGNAL);
+        else
+            count = ::write(m_fd, ptr, bytesLeft);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return;                                         // like a real serial port, data is just lost if nobody is listening
+        }
+        ptr += count;
+        bytesLeft -= count;
+    }
+}
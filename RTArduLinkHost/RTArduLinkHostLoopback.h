@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTARDULINKHOSTLOOPBACK_H
+#define _RTARDULINKHOSTLOOPBACK_H
+
+//  RTArduLinkHostLoopback is a stand-in for an Arduino running RTArduLinkIMU. It creates the far
+//  end of a pseudo-terminal or a listening Unix domain socket and then behaves like the sketch:
+//  it streams RTARDULINK_MESSAGE_IMU_MICROS messages and answers poll, echo and identity messages. This
+//  allows RTArduLinkHost and the host fusion to be tested end to end without any hardware.
+//
+//  The simulated IMU sits level and rotates about its z axis at a constant rate so the fused
+//  yaw should track the rotation while roll and pitch stay at zero.
+//
+//  The stand-in's clock can be given a drift relative to the host and a starting uptime so that
+//  time synchronisation, including the wrap of micros() and millis(), can be exercised. It also
+//  follows RTARDULINK_MESSAGE_FLOWCONTROL credits and sends summaries when it runs out, as the sketch does.
+
+#include "RTArduLinkDefs.h"
+#include "RTArduLinkIMUDefs.h"
+#include "RTMath.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#define RTARDULINKHOSTLOOPBACK_DEVICE_NAME_LEN  64          // max length of a pty slave name
+
+class RTArduLinkHostLoopback
+{
+public:
+    RTArduLinkHostLoopback();
+    ~RTArduLinkHostLoopback();
+
+    bool beginPseudoTerminal();                             // creates a pty. The host should openSerial(getDeviceName(), 0)
+    bool beginSocket(const char *path);                     // listens on a Unix socket. The host should openSocket(path)
+    const char *getDeviceName() { return m_deviceName; }    // the pty slave device name
+    void end();                                             // stops the stand-in and closes everything
+
+    void setSampleRate(int rate) { m_sampleRate = rate; }   // IMU messages per second (default 50)
+    void setRotationRate(RTFLOAT rate) { m_rotationRate = rate; } // simulated yaw rate in rads/sec
+    void setClock(double drift, uint64_t uptime) { m_clockDrift = drift; m_clockUptime = uptime; } // drift in ppm, uptime in uS at start
+
+private:
+    void run();                                             // the stand-in thread
+    uint64_t subsystemMicros();                             // the simulated subsystem clock
+    void sendIMU(uint64_t timestamp);                       // sends one simulated IMU sample (subsystem uS)
+    void sendSummary(RTARDULINKIMU_MESSAGE *IMUMessage);    // adds a sample to the summary and sends it if there's credit
+    void processFrame(RTARDULINK_FRAME *frame);             // answers a message received from the host
+    void sendFrame(RTARDULINK_FRAME *frame, int length);    // writes a frame. length is length of message field
+
+    int m_fd;                                               // the stand-in side of the link or -1
+    int m_listenFd;                                         // the listening socket or -1
+    char m_deviceName[RTARDULINKHOSTLOOPBACK_DEVICE_NAME_LEN]; // pty slave name
+    char m_socketPath[RTARDULINKHOSTLOOPBACK_DEVICE_NAME_LEN * 2]; // socket path to unlink at the end
+
+    int m_sampleRate;                                       // IMU messages per second
+    RTFLOAT m_rotationRate;                                 // yaw rate in rads/sec
+    double m_clockDrift;                                    // how much faster the subsystem clock runs in ppm
+    uint64_t m_clockUptime;                                 // subsystem uptime in uS when started
+    uint64_t m_clockStart;                                  // host time in uS when started
+
+    bool m_flowControl;                                     // true if the host has turned on flow control
+    uint32_t m_TXCount;                                     // number of data messages sent
+    uint32_t m_TXCreditLimit;                               // the value m_TXCount may reach
+    RTARDULINKIMU_SUMMARY m_summary;                        // accumulates samples when out of credit
+    unsigned long m_summaryCount;                           // number of samples in m_summary
+
+    std::thread m_thread;                                   // the stand-in thread
+    std::atomic<bool> m_run;                                // cleared to stop the thread
+};
+
+#endif // _RTARDULINKHOSTLOOPBACK_H
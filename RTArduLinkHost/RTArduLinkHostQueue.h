@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTARDULINKHOSTQUEUE_H
+#define _RTARDULINKHOSTQUEUE_H
+
+#include <atomic>
+
+//  RTArduLinkHostQueue is a lock-free single producer, single consumer queue. Exactly one thread
+//  may call push() and exactly one other thread may call pop(). SIZE must be a power of 2.
+//
+//  If the queue is full, push() fails and the item is counted as dropped. This keeps the
+//  receive thread running at line rate even if the consumer stalls.
+
+template <typename T, unsigned int SIZE>
+class RTArduLinkHostQueue
+{
+    static_assert((SIZE != 0) && ((SIZE & (SIZE - 1)) == 0), "RTArduLinkHostQueue SIZE must be a power of 2");
+
+public:
+    RTArduLinkHostQueue() : m_head(0), m_tail(0), m_dropCount(0) {}
+
+    //  push() is called by the producer. Returns false if the queue is full.
+
+    bool push(const T& item)
+    {
+        unsigned int tail = m_tail.load(std::memory_order_relaxed);
+
+        if ((tail - m_head.load(std::memory_order_acquire)) == SIZE) {
+            m_dropCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_items[tail & (SIZE - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);  // publish the item
+        return true;
+    }
+
+    //  pop() is called by the consumer. Returns false if the queue is empty.
+
+    bool pop(T& item)
+    {
+        unsigned int head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = m_items[head & (SIZE - 1)];
+        m_head.store(head + 1, std::memory_order_release);  // give the slot back to the producer
+        return true;
+    }
+
+    unsigned int count() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    unsigned int getDropCount() const { return m_dropCount.load(std::memory_order_relaxed); }
+
+private:
+    T m_items[SIZE];                                        // the item storage
+    alignas(64) std::atomic<unsigned int> m_head;           // free running index of next item to pop - written by consumer
+    alignas(64) std::atomic<unsigned int> m_tail;           // free running index of next slot to fill - written by producer
+    std::atomic<unsigned int> m_dropCount;                  // number of items discarded because the queue was full
+};
+
+#endif // _RTARDULINKHOSTQUEUE_H
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#include "RTArduLinkHostTimeSync.h"
+
+#include <math.h>
+
+RTArduLinkHostTimeSync::RTArduLinkHostTimeSync()
+{
+    reset();
+}
+
+void RTArduLinkHostTimeSync::reset()
+{
+    m_sampleCount = 0;
+    m_nextSample = 0;
+    m_microsValid = false;
+    m_millisValid = false;
+    m_valid = false;
+    m_slope = 1.0;
+    m_bestRoundTrip = 0;
+}
+
+uint64_t RTArduLinkHostTimeSync::unwrapMillis(uint32_t millis)
+{
+    if (!m_millisValid) {
+        m_lastMillisUnwrapped = millis;
+        m_millisValid = true;
+    } else {
+        m_lastMillisUnwrapped += (int32_t)(millis - m_lastMillis);   // works across a wrap in either direction
+    }
+    m_lastMillis = millis;
+    return m_lastMillisUnwrapped * 1000;
+}
+
+//  After the first exchange micros() values are unwrapped relative to the last one seen, so
+//  anything within 35 minutes of it either way is placed correctly. Before that there's no
+//  way to tell how many times it has wrapped.
+
+uint64_t RTArduLinkHostTimeSync::unwrapMicros(uint32_t micros)
+{
+    if (!m_microsValid)
+        return micros;
+    m_lastMicrosUnwrapped += (int32_t)(micros - m_lastMicros);
+    m_lastMicros = micros;
+    return m_lastMicrosUnwrapped;
+}
+
+void RTArduLinkHostTimeSync::newExchange(uint64_t hostSend, uint64_t hostReceive, uint32_t subsystemReceive,
+        uint32_t subsystemSend, uint32_t subsystemSendMillis)
+{
+    RTARDULINKHOST_TIMESYNC_SAMPLE *sample;
+    uint64_t millisTime;
+    uint64_t sendTime;
+    uint32_t processing;
+    uint64_t hostRoundTrip;
+
+    //  micros() wraps every 71 minutes so use millis() to work out how many times it has wrapped
+
+    millisTime = unwrapMillis(subsystemSendMillis);
+    if (!m_microsValid) {
+        m_lastMicrosUnwrapped = subsystemSend +
+            ((uint64_t)llround(((double)millisTime - (double)subsystemSend) / 4294967296.0) << 32);
+        m_lastMicros = subsystemSend;
+        m_microsValid = true;
+    }
+    sendTime = unwrapMicros(subsystemSend);
+
+    processing = subsystemSend - subsystemReceive;
+    hostRoundTrip = hostReceive - hostSend;
+    if ((hostReceive < hostSend) || (processing > hostRoundTrip))
+        return;                                             // nonsense
+
+    sample = m_samples + m_nextSample;
+    sample->roundTrip = (uint32_t)(hostRoundTrip - processing);
+    sample->hostTime = hostSend + hostRoundTrip / 2;
+    sample->subsystemTime = sendTime - processing / 2;
+
+    m_nextSample = (m_nextSample + 1) % RTARDULINKHOST_TIMESYNC_WINDOW;
+    if (m_sampleCount < RTARDULINKHOST_TIMESYNC_WINDOW)
+        m_sampleCount++;
+
+    fit();
+}
+
+void RTArduLinkHostTimeSync::fit()
+{
+    RTARDULINKHOST_TIMESYNC_SAMPLE *sample;
+    RTARDULINKHOST_TIMESYNC_SAMPLE *first;
+    double dx, dy;
+    double sumX, sumY, sumXX, sumXY;
+    double meanX, meanY;
+    double minX, maxX;
+    int count;
+
+    m_bestRoundTrip = 0xffffffff;
+    for (int i = 0; i < m_sampleCount; i++) {
+        if (m_samples[i].roundTrip < m_bestRoundTrip)
+            m_bestRoundTrip = m_samples[i].roundTrip;
+    }
+
+    //  work relative to the first good sample to keep the precision in the doubles
+
+    first = NULL;
+    count = 0;
+    sumX = sumY = sumXX = sumXY = 0;
+    minX = maxX = 0;
+
+    for (int i = 0; i < m_sampleCount; i++) {
+        sample = m_samples + i;
+        if (sample->roundTrip > (m_bestRoundTrip + RTARDULINKHOST_TIMESYNC_RTT_MARGIN))
+            continue;
+        if (first == NULL)
+            first = sample;
+        dx = (double)(int64_t)(sample->subsystemTime - first->subsystemTime);
+        dy = (double)(int64_t)(sample->hostTime - first->hostTime);
+        sumX += dx;
+        sumY += dy;
+        sumXX += dx * dx;
+        sumXY += dx * dy;
+        if (dx < minX)
+            minX = dx;
+        if (dx > maxX)
+            maxX = dx;
+        count++;
+    }
+
+    meanX = sumX / count;
+    meanY = sumY / count;
+
+    //  only estimate drift once the samples cover a long enough time for it to mean something
+
+    if ((count >= 2) && ((maxX - minX) >= RTARDULINKHOST_TIMESYNC_MIN_SPAN))
+        m_slope = (sumXY - count * meanX * meanY) / (sumXX - count * meanX * meanX);
+
+    m_subsystemRef = first->subsystemTime + (int64_t)llround(meanX);
+    m_hostRef = first->hostTime + (int64_t)llround(meanY);
+    m_valid = true;
+}
+
+uint64_t RTArduLinkHostTimeSync::toHostTime(uint64_t subsystemTime)
+{
+    return m_hostRef + (int64_t)llround(m_slope * (double)(int64_t)(subsystemTime - m_subsystemRef));
+}
+
+double RTArduLinkHostTimeSync::getOffset()
+{
+    return (double)(int64_t)(m_hostRef - m_subsystemRef);
+}
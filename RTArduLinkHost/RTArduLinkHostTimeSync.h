@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////
+//
+//  This file is part of RTArduLink
+//
+//  Copyright (c) 2014-2015 richards-tech
+//
+//  Permission is hereby granted, free of charge,
+//  to any person obtaining a copy of
+//  this software and associated documentation files
+//  (the "Software"), to deal in the Software without
+//  restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute,
+//  sublicense, and/or sell copies of the Software, and
+//  to permit persons to whom the Software is furnished
+//  to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice
+//  shall be included in all copies or substantial portions
+//  of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF
+//  ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+//  TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+//  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+//  IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTARDULINKHOSTTIMESYNC_H
+#define _RTARDULINKHOSTTIMESYNC_H
+
+//  RTArduLinkHostTimeSync estimates the relationship between a subsystem's clock and the host's
+//  clock from the results of RTARDULINK_MESSAGE_TIMESYNC exchanges. There should be one of these
+//  for each subsystem address.
+//
+//  Each exchange gives a round trip time and an estimate of the offset at the midpoint of the
+//  exchange. Exchanges that are delayed (by the subsystem's loop, a busy link or the host's
+//  scheduler) have a longer round trip and are less accurate, so only those within
+//  RTARDULINKHOST_TIMESYNC_RTT_MARGIN of the best round trip in the window are used. A straight
+//  line fit through these gives the offset and the drift between the two crystals.
+//
+//  All times are 64 bit microsecond counts. Subsystem times are counted from the subsystem's
+//  reset - the 32 bit millis() and micros() values are unwrapped here.
+
+#include <stdint.h>
+
+#define RTARDULINKHOST_TIMESYNC_WINDOW      32              // number of exchanges kept
+#define RTARDULINKHOST_TIMESYNC_RTT_MARGIN  1000            // uS above the best round trip that is acceptable
+#define RTARDULINKHOST_TIMESYNC_MIN_SPAN    2000000         // uS of samples needed before drift is estimated
+
+class RTArduLinkHostTimeSync
+{
+public:
+    RTArduLinkHostTimeSync();
+
+    void reset();                                           // discards all state
+
+    //  newExchange() adds the result of a completed exchange. hostSend and hostReceive are the
+    //  host times (t1 and t4), the rest are from the RTARDULINK_TIMESYNC response.
+
+    void newExchange(uint64_t hostSend, uint64_t hostReceive, uint32_t subsystemReceive,
+        uint32_t subsystemSend, uint32_t subsystemSendMillis);
+
+    bool isValid() { return m_valid; }                      // true once there is an estimate
+
+    uint64_t unwrapMillis(uint32_t millis);                 // converts a subsystem millis() value to uS since reset
+    uint64_t unwrapMicros(uint32_t micros);                 // converts a subsystem micros() value to uS since reset (after an exchange)
+    uint64_t toHostTime(uint64_t subsystemTime);            // converts subsystem uS since reset to host uS
+
+    double getOffset();                                     // host time minus subsystem time in uS at the reference point
+    double getDrift() { return (m_slope - 1.0) * 1000000.0; }   // how much faster the host clock runs in parts per million
+    uint32_t getRoundTrip() { return m_bestRoundTrip; }     // best round trip in the window in uS
+
+private:
+    typedef struct
+    {
+        uint64_t hostTime;                                  // host time at the midpoint of the exchange
+        uint64_t subsystemTime;                             // subsystem time at the midpoint of the exchange
+        uint32_t roundTrip;                                 // round trip less subsystem processing time
+    } RTARDULINKHOST_TIMESYNC_SAMPLE;
+
+    void fit();                                             // recomputes the estimate from the window
+
+    RTARDULINKHOST_TIMESYNC_SAMPLE m_samples[RTARDULINKHOST_TIMESYNC_WINDOW]; // the window
+    int m_sampleCount;                                      // number of valid samples in the window
+    int m_nextSample;                                       // where the next one goes
+
+    bool m_microsValid;                                     // true if m_lastMicros is valid
+    uint32_t m_lastMicros;                                  // last raw micros() value seen
+    uint64_t m_lastMicrosUnwrapped;                         // and its unwrapped version
+    bool m_millisValid;                                     // true if m_lastMillis is valid
+    uint32_t m_lastMillis;                                  // last raw millis() value seen
+    uint64_t m_lastMillisUnwrapped;                         // and its unwrapped version
+
+    bool m_valid;                                           // true if the estimate is valid
+    uint64_t m_hostRef;                                     // host time at the reference point
+    uint64_t m_subsystemRef;                                // subsystem time at the reference point
+    double m_slope;                                         // host uS per subsystem uS
+    uint32_t m_bestRoundTrip;                               // best round trip in the window
+};
+
+#endif // _RTARDULINKHOSTTIMESYNC_H
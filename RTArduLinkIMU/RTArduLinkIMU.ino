@@ -43,11 +43,21 @@ RTIMU *imu;                                           // the IMU object
 RTIMUSettings settings;                               // the settings object
 RTArduLinkIMU linkIMU;                                // the link object
 RTARDULINKIMU_MESSAGE linkMessage;                    // the message that is sent to the host
+RTARDULINKIMU_SUMMARY linkSummary;                    // accumulates samples when the link can't keep up
+unsigned long summaryCount;                           // number of samples in linkSummary
+
+void sendSummary(unsigned char state);
 
 //  SERIAL_PORT_SPEED defines the speed to use for the serial port
 
 #define  SERIAL_PORT_SPEED  115200
 
+//  IMU samples are sent as RTARDULINK_MESSAGE_IMU_MICROS with uS timestamps. Uncomment
+//  RTARDULINKIMU_MILLIS to send RTARDULINK_MESSAGE_IMU with mS timestamps instead, for
+//  RTHostIMU and RTHostIMUGL from the main RTIMULib repo
+
+//#define RTARDULINKIMU_MILLIS
+
 void setup()
 {
     int errcode;
@@ -70,6 +80,7 @@ void setup()
 
     RTArduLinkHALEEPROMDisplay();
 
+    summaryCount = 0;
     linkIMU.sendDebugMessage("RTArduLinkIMU starting");
 }
 
@@ -79,8 +90,23 @@ void loop()
     
     linkIMU.background();
     if (imu->IMURead()) {                                // get the latest data if ready yet
+        state = 0;
+        if (imu->IMUGyroBiasValid())
+            state |= RTARDULINKIMU_STATE_GYRO_BIAS_VALID;
+        if (imu->getCalibrationValid())
+            state |= RTARDULINKIMU_STATE_MAG_CAL_VALID;
+
+        if ((summaryCount > 0) || !linkIMU.canSendMessage(sizeof(RTARDULINKIMU_MESSAGE))) {
+            sendSummary(state);                          // link can't keep up so summarise
+            return;
+        }
+
         // build message
-        RTArduLinkConvertLongToUC4(millis(), linkMessage.timestamp);
+#ifdef RTARDULINKIMU_MILLIS
+        RTArduLinkConvertLongToUC4(imu->getTimestamp() / 1000, linkMessage.timestamp);
+#else
+        RTArduLinkConvertLongToUC4(imu->getTimestamp(), linkMessage.timestamp);
+#endif
         linkMessage.gyro[0] = imu->getGyro().x();
         linkMessage.gyro[1] = imu->getGyro().y();
         linkMessage.gyro[2] = imu->getGyro().z();
@@ -90,17 +116,53 @@ void loop()
         linkMessage.mag[0] = imu->getCompass().x();
         linkMessage.mag[1] = imu->getCompass().y();
         linkMessage.mag[2] = imu->getCompass().z();
-        
-        state = 0;
-        if (imu->IMUGyroBiasValid())
-            state |= RTARDULINKIMU_STATE_GYRO_BIAS_VALID;
-        if (imu->getCalibrationValid())
-            state |= RTARDULINKIMU_STATE_MAG_CAL_VALID;
-            
+
         // send the message
+#ifdef RTARDULINKIMU_MILLIS
         linkIMU.sendMessage(RTARDULINK_MESSAGE_IMU, state,
                 (unsigned char *)(&linkMessage), sizeof(RTARDULINKIMU_MESSAGE));
+#else
+        linkIMU.sendMessage(RTARDULINK_MESSAGE_IMU_MICROS, state,
+                (unsigned char *)(&linkMessage), sizeof(RTARDULINKIMU_MESSAGE));
+#endif
+    }
+}
+
+//  sendSummary adds the latest sample to the summary and sends it if the link is ready
+
+void sendSummary(unsigned char state)
+{
+    if (summaryCount == 0) {
+        for (int i = 0; i < 3; i++) {
+            linkSummary.gyro[i] = 0;
+            linkSummary.accel[i] = 0;
+            linkSummary.mag[i] = 0;
+        }
+    }
+    linkSummary.gyro[0] += imu->getGyro().x();
+    linkSummary.gyro[1] += imu->getGyro().y();
+    linkSummary.gyro[2] += imu->getGyro().z();
+    linkSummary.accel[0] += imu->getAccel().x();
+    linkSummary.accel[1] += imu->getAccel().y();
+    linkSummary.accel[2] += imu->getAccel().z();
+    linkSummary.mag[0] += imu->getCompass().x();
+    linkSummary.mag[1] += imu->getCompass().y();
+    linkSummary.mag[2] += imu->getCompass().z();
+    summaryCount++;
+
+    if (!linkIMU.canSendMessage(sizeof(RTARDULINKIMU_SUMMARY)))
+        return;                                          // keep accumulating
+
+    for (int i = 0; i < 3; i++) {
+        linkSummary.gyro[i] /= summaryCount;
+        linkSummary.accel[i] /= summaryCount;
+        linkSummary.mag[i] /= summaryCount;
     }
+    RTArduLinkConvertLongToUC4(imu->getTimestamp(), linkSummary.timestamp);
+    RTArduLinkConvertLongToUC4(summaryCount, linkSummary.sampleCount);
+    linkIMU.sendMessage(RTARDULINK_MESSAGE_IMU_SUMMARY, state,
+            (unsigned char *)(&linkSummary), sizeof(RTARDULINKIMU_SUMMARY));
+    summaryCount = 0;
 }
 
 void RTArduLinkIMU::processCustomMessage(unsigned char messageType, unsigned char messageParam,
@@ -32,19 +32,42 @@
 
 //  RTARDULINKIMU_MESSAGE is used to send messages to the host. 
 //  Note: the gyro bias and mag cal state come back in the messageParam field
+//  Note: the timestamp is in mS when sent as RTARDULINK_MESSAGE_IMU and in uS when sent as
+//  RTARDULINK_MESSAGE_IMU_MICROS
 
 typedef struct
 {
-    RTARDULINK_UC4 timestamp;                               // timestamp in mS
+    RTARDULINK_UC4 timestamp;                               // sample time in mS or uS (subsystem clock, wraps)
     float gyro[3];                                          // the de-biased gyro data in rads/sec
     float accel[3];                                         // raw accel data in gs
     float mag[3];                                           // magnetometer data in uT
 } RTARDULINKIMU_MESSAGE;
 
+//  RTARDULINKIMU_SUMMARY is sent instead of RTARDULINKIMU_MESSAGE when the link can't keep up with
+//  the IMU sample rate. It carries the mean of the samples since the last message sent so the host
+//  gets the same average rotation rate, just at a lower rate. Note: the gyro bias and mag cal state
+//  come back in the messageParam field
+
+typedef struct
+{
+    RTARDULINK_UC4 timestamp;                               // sample time of the last sample in uS
+    RTARDULINK_UC4 sampleCount;                             // number of samples in the summary
+    float gyro[3];                                          // mean de-biased gyro data in rads/sec
+    float accel[3];                                         // mean raw accel data in gs
+    float mag[3];                                           // mean magnetometer data in uT
+} RTARDULINKIMU_SUMMARY;
+
 
 //  Message type
+//
+//  RTARDULINK_MESSAGE_IMU is the original format with the timestamp in mS. It's what RTHostIMU and
+//  RTHostIMUGL in the main RTIMULib repo expect. RTARDULINK_MESSAGE_IMU_MICROS is the same record
+//  with the timestamp in uS - it has its own type so that a host that only knows the mS format
+//  ignores it rather than working out time deltas 1000 times too large.
 
 #define RTARDULINK_MESSAGE_IMU  (RTARDULINK_MESSAGE_CUSTOM + 1)
+#define RTARDULINK_MESSAGE_IMU_SUMMARY  (RTARDULINK_MESSAGE_CUSTOM + 2)
+#define RTARDULINK_MESSAGE_IMU_MICROS  (RTARDULINK_MESSAGE_CUSTOM + 3)
 
 //  Defines for the messageParam field
 
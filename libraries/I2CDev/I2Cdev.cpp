@@ -85,6 +85,317 @@ THE SOFTWARE.
     // Originally offered to the i2cdevlib project at http://arduino.cc/forum/index.php/topic,68210.30.html
     TwoWire Wire;
 
+#elif I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED
+
+    #include "I2CdevSim.h"
+
+#endif
+
+// The device table holds the maximum clock in kHz for each device that has declared
+// one, and the error counters for every device that has had an error. Devices with
+// no declared clock run at standard mode. The clock that was last set is cached so
+// that switching only costs anything when it changes.
+
+typedef struct
+{
+    uint8_t devAddr;                                        // I2C slave device address
+    uint16_t clock;                                         // maximum clock in kHz (0 if not declared)
+    I2CDEV_ERRORS errors;                                   // error counters
+} I2CDEV_DEVICE;
+
+static I2CDEV_DEVICE i2cdev_devices[I2CDEV_MAX_DEVICES];
+static uint8_t i2cdev_deviceCount = 0;
+static uint16_t i2cdev_busLimit = I2CDEV_DEFAULT_BUS_LIMIT / 1000;
+static uint16_t i2cdev_currentClock = 0;                    // 0 if unknown
+static uint16_t i2cdev_recoveries = 0;
+
+static I2CDEV_DEVICE *i2cdev_findDevice(uint8_t devAddr, bool create) {
+    for (uint8_t i = 0; i < i2cdev_deviceCount; i++) {
+        if (i2cdev_devices[i].devAddr == devAddr)
+            return i2cdev_devices + i;
+    }
+    if (!create || (i2cdev_deviceCount >= I2CDEV_MAX_DEVICES))
+        return 0;
+    I2CDEV_DEVICE *device = i2cdev_devices + i2cdev_deviceCount++;
+    memset(device, 0, sizeof(I2CDEV_DEVICE));
+    device->devAddr = devAddr;
+    return device;
+}
+
+static uint16_t i2cdev_deviceClock(uint8_t devAddr) {
+    I2CDEV_DEVICE *device = i2cdev_findDevice(devAddr, false);
+    uint16_t clock = I2CDEV_CLOCK_STANDARD / 1000;
+
+    if ((device != 0) && (device->clock != 0))
+        clock = device->clock;
+    return clock > i2cdev_busLimit ? i2cdev_busLimit : clock;
+}
+
+static void i2cdev_selectClock(uint8_t devAddr) {
+    uint16_t clock = i2cdev_deviceClock(devAddr);
+
+    if (clock == i2cdev_currentClock)
+        return;
+
+    #if defined(TWBR)
+        // AVR TWI (all implementations), prescaler 1: SCL = F_CPU / (16 + 2 * TWBR)
+        long twbr = ((F_CPU / 1000L) / clock - 16) / 2;
+        TWBR = twbr < 0 ? 0 : (twbr > 255 ? 255 : twbr);
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO >= 157)
+        Wire.setClock((uint32_t)clock * 1000);
+    #endif
+    i2cdev_currentClock = clock;
+}
+
+// The time budget for the transaction in progress. i2cdev_startBudget() is called as
+// each transaction starts and the implementations check i2cdev_budgetExpired() in
+// their wait loops.
+
+static uint32_t i2cdev_budgetStart;
+static uint32_t i2cdev_budget;
+
+static uint32_t i2cdev_transactionBudget(uint8_t devAddr, uint8_t length) {
+    if (I2Cdev::timeoutMicros != 0)
+        return I2Cdev::timeoutMicros;
+    return I2CDEV_TIMEOUT_BASE_MICROS + ((uint32_t)length + 2) * (I2CDEV_TIMEOUT_BYTE_BITS * 1000L) / i2cdev_deviceClock(devAddr);
+}
+
+static void i2cdev_startBudget(uint8_t devAddr, uint8_t length) {
+    i2cdev_budget = i2cdev_transactionBudget(devAddr, length);
+    i2cdev_budgetStart = micros();
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE) && defined(WIRE_HAS_TIMEOUT)
+        Wire.setWireTimeout(i2cdev_budget, true);           // Wire aborts and resets the TWI itself
+        Wire.clearWireTimeoutFlag();
+    #endif
+}
+
+static bool i2cdev_budgetExpired() {
+    return (micros() - i2cdev_budgetStart) >= i2cdev_budget;
+}
+
+// Records an error against the device. Anything other than a NACK may have left
+// the bus in a bad state so the bus is recovered straight away.
+
+static void i2cdev_error(uint8_t devAddr, uint8_t error) {
+    I2CDEV_DEVICE *device = i2cdev_findDevice(devAddr, true);
+
+    switch (error) {
+    case I2CDEV_ERROR_NACK:
+        if (device) device->errors.nack++;
+        return;
+
+    case I2CDEV_ERROR_TIMEOUT:
+        if (device) device->errors.timeout++;
+        break;
+
+    default:
+        if (device) device->errors.busError++;
+        break;
+    }
+    I2Cdev::recoverBus();
+    if (device) device->errors.recovered++;
+}
+
+// The last error from a blocking call, for the synchronous transaction queue
+
+static uint8_t i2cdev_lastError = I2CDEV_ERROR_NONE;
+
+static uint8_t i2cdev_finish(uint8_t devAddr, uint8_t error) {
+    if (error != I2CDEV_ERROR_NONE)
+        i2cdev_error(devAddr, error);
+    i2cdev_lastError = error;
+    return error;
+}
+
+#if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE) || (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+
+    // maps the endTransmission() status codes
+
+    static uint8_t i2cdev_wireError(uint8_t status) {
+        switch (status) {
+        case 0:  return I2CDEV_ERROR_NONE;
+        case 2:                                             // address NACK
+        case 3:  return I2CDEV_ERROR_NACK;                  // data NACK
+        case 5:  return I2CDEV_ERROR_TIMEOUT;               // Wire timeout (WIRE_HAS_TIMEOUT)
+        default: return i2cdev_budgetExpired() ? I2CDEV_ERROR_TIMEOUT : I2CDEV_ERROR_BUS;
+        }
+    }
+
+#elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
+
+    // Fastwire reports a failed wait for TWINT and a NACK with different codes
+    // at each step, so classify by whether the budget ran out
+
+    static uint8_t i2cdev_fastwireError(uint8_t status) {
+        if (status == 0)
+            return I2CDEV_ERROR_NONE;
+        return i2cdev_budgetExpired() ? I2CDEV_ERROR_TIMEOUT : I2CDEV_ERROR_NACK;
+    }
+
+#endif
+
+// works out what went wrong when fewer bytes than expected were transferred
+
+static uint8_t i2cdev_shortError() {
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE) && defined(WIRE_HAS_TIMEOUT)
+        if (Wire.getWireTimeoutFlag())
+            return I2CDEV_ERROR_TIMEOUT;
+    #endif
+    return i2cdev_budgetExpired() ? I2CDEV_ERROR_TIMEOUT : I2CDEV_ERROR_NACK;
+}
+
+#ifdef I2CDEV_TRACE
+
+    // The trace ring is written by every transaction and drained by traceRead().
+    // When it is full new entries are dropped and counted rather than
+    // overwriting ones the sketch hasn't collected yet.
+
+    static I2CDEV_TRACE_ENTRY i2cdev_trace[I2CDEV_TRACE_LENGTH];
+    static uint8_t i2cdev_traceHead = 0;
+    static uint8_t i2cdev_traceCount = 0;
+    static uint16_t i2cdev_traceLost = 0;
+
+    static void i2cdev_traceRecord(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t flags, uint32_t start) {
+        I2CDEV_TRACE_ENTRY *entry;
+        uint32_t duration = micros() - start;
+
+        if (i2cdev_traceCount >= I2CDEV_TRACE_LENGTH) {
+            i2cdev_traceLost++;
+            return;
+        }
+        entry = i2cdev_trace + ((i2cdev_traceHead + i2cdev_traceCount) % I2CDEV_TRACE_LENGTH);
+        entry->start = start;
+        entry->duration = duration > 0xffff ? 0xffff : duration;
+        entry->devAddr = devAddr;
+        entry->regAddr = regAddr;
+        entry->length = length;
+        entry->flags = flags;
+        i2cdev_traceCount++;
+    }
+
+    #define I2CDEV_TRACE_START      uint32_t traceStart = micros();
+    #define I2CDEV_TRACE_RECORD(devAddr, regAddr, length, flags) \
+        i2cdev_traceRecord(devAddr, regAddr, length, flags, traceStart);
+
+#else
+
+    #define I2CDEV_TRACE_START
+    #define I2CDEV_TRACE_RECORD(devAddr, regAddr, length, flags)
+
+#endif
+
+#ifdef I2CDEV_SAM3X_PDC
+
+    // SAM3X PDC backend. A queued read is set up on Wire's TWI in internal address
+    // (register) mode and the PDC moves all but the last two bytes straight into the
+    // transaction's buffer. The TWI holds SCL low while a received byte waits in RHR,
+    // so poll() can take the last two bytes and set STOP whenever it next runs. The
+    // time budget runs from the last step forward rather than from the start, so a
+    // transfer that was only waiting for poll() doesn't time out.
+
+    #define I2CDEV_PDC_TWI          WIRE_INTERFACE          // the TWI Wire uses
+    #define I2CDEV_PDC_MIN_LENGTH   3                       // shorter reads and all writes go through Wire
+
+    #define I2CDEV_PDC_IDLE         0                       // no PDC transfer
+    #define I2CDEV_PDC_DMA          1                       // PDC receiving
+    #define I2CDEV_PDC_TAIL         2                       // waiting for the next to last byte
+    #define I2CDEV_PDC_LAST         3                       // STOP set, waiting for the last byte
+    #define I2CDEV_PDC_STOP         4                       // waiting for the STOP to complete
+
+    static void i2cdev_complete(I2CDEV_TRANSACTION *transaction, int8_t count, uint8_t error);
+
+    static I2CDEV_TRANSACTION *i2cdev_pdcTransaction = 0;
+    static uint8_t i2cdev_pdcState = I2CDEV_PDC_IDLE;
+    static uint32_t i2cdev_pdcProgress;                     // micros() at the last state change
+
+    static void i2cdev_pdcStart(I2CDEV_TRANSACTION *transaction) {
+        Twi *twi = I2CDEV_PDC_TWI;
+
+        i2cdev_selectClock(transaction->devAddr);
+        twi->TWI_PTCR = TWI_PTCR_RXTDIS | TWI_PTCR_TXTDIS;
+        (void)twi->TWI_SR;                                  // clear stale NACK/OVRE
+        twi->TWI_MMR = 0;
+        twi->TWI_MMR = TWI_MMR_MREAD | TWI_MMR_IADRSZ_1_BYTE | TWI_MMR_DADR(transaction->devAddr);
+        twi->TWI_IADR = transaction->regAddr;
+        twi->TWI_RPR = (uint32_t)(uintptr_t)transaction->data;
+        twi->TWI_RCR = transaction->length - 2;
+        twi->TWI_PTCR = TWI_PTCR_RXTEN;
+        i2cdev_pdcTransaction = transaction;
+        i2cdev_pdcState = I2CDEV_PDC_DMA;
+        i2cdev_pdcProgress = micros();
+        twi->TWI_CR = TWI_CR_START;
+    }
+
+    static void i2cdev_pdcFinish(int8_t count, uint8_t error) {
+        I2CDEV_TRANSACTION *transaction = i2cdev_pdcTransaction;
+        Twi *twi = I2CDEV_PDC_TWI;
+
+        if (error != I2CDEV_ERROR_NONE) {
+            twi->TWI_PTCR = TWI_PTCR_RXTDIS;
+            twi->TWI_CR = TWI_CR_STOP;
+        }
+        i2cdev_pdcTransaction = 0;
+        i2cdev_pdcState = I2CDEV_PDC_IDLE;
+        #ifdef I2CDEV_TRACE
+            i2cdev_traceRecord(transaction->devAddr, transaction->regAddr, transaction->length,
+                    I2CDEV_TRACE_ASYNC | (error != I2CDEV_ERROR_NONE ? I2CDEV_TRACE_ERROR : 0), transaction->startTime);
+        #endif
+        i2cdev_complete(transaction, count, error);
+        if (error != I2CDEV_ERROR_NONE)
+            i2cdev_error(transaction->devAddr, error);
+    }
+
+    // moves the active PDC transfer on as far as it can go - true once there isn't one
+
+    static bool i2cdev_pdcService() {
+        I2CDEV_TRANSACTION *transaction = i2cdev_pdcTransaction;
+        Twi *twi = I2CDEV_PDC_TWI;
+        uint8_t state = i2cdev_pdcState;
+        uint32_t status;
+
+        if (transaction == 0)
+            return true;
+
+        status = twi->TWI_SR;
+        if (status & TWI_SR_NACK) {
+            i2cdev_pdcFinish(-1, I2CDEV_ERROR_NACK);
+            return true;
+        }
+        if ((i2cdev_pdcState == I2CDEV_PDC_DMA) && (status & TWI_SR_ENDRX)) {
+            twi->TWI_PTCR = TWI_PTCR_RXTDIS;
+            i2cdev_pdcState = I2CDEV_PDC_TAIL;
+        }
+        if ((i2cdev_pdcState == I2CDEV_PDC_TAIL) && (status & TWI_SR_RXRDY)) {
+            twi->TWI_CR = TWI_CR_STOP;                      // the byte after this one is the last
+            transaction->data[transaction->length - 2] = twi->TWI_RHR;
+            i2cdev_pdcState = I2CDEV_PDC_LAST;
+            status = twi->TWI_SR;
+        }
+        if ((i2cdev_pdcState == I2CDEV_PDC_LAST) && (status & TWI_SR_RXRDY)) {
+            transaction->data[transaction->length - 1] = twi->TWI_RHR;
+            i2cdev_pdcState = I2CDEV_PDC_STOP;
+            status = twi->TWI_SR;
+        }
+        if ((i2cdev_pdcState == I2CDEV_PDC_STOP) && (status & TWI_SR_TXCOMP)) {
+            i2cdev_pdcFinish(transaction->length, I2CDEV_ERROR_NONE);
+            return true;
+        }
+        if (i2cdev_pdcState != state)
+            i2cdev_pdcProgress = micros();
+        else if ((uint32_t)(micros() - i2cdev_pdcProgress) >= i2cdev_transactionBudget(transaction->devAddr, transaction->length)) {
+            i2cdev_pdcFinish(-1, I2CDEV_ERROR_TIMEOUT);
+            return true;
+        }
+        return false;
+    }
+
+    // the blocking calls use Wire on the same TWI so any PDC transfer has to finish first
+
+    static void i2cdev_pdcWait() {
+        while (!i2cdev_pdcService())
+            ;
+    }
+
 #endif
 
 /** Default constructor.
@@ -214,81 +525,117 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
         Serial.print("...");
     #endif
 
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+        // NBWire shares the TWI with the transaction queue so let that drain first
+        if (!flush(timeout)) return -1;
+    #elif defined(I2CDEV_SAM3X_PDC)
+        i2cdev_pdcWait();
+    #endif
+
     int8_t count = 0;
     uint32_t t1 = millis();
+    uint8_t error = I2CDEV_ERROR_NONE;
+    I2CDEV_TRACE_START
+    i2cdev_selectClock(devAddr);
+    i2cdev_startBudget(devAddr, length);
 
     #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE)
 
+        // I2C/TWI subsystem uses internal buffer that breaks with large data requests
+        // so if user requests more than BUFFER_LENGTH bytes, we have to do it in
+        // smaller chunks instead of all at once. The register address is only sent
+        // once - the device's register pointer carries on from where the previous
+        // chunk left off (auto-increment, or the same FIFO register).
+
         #if (ARDUINO < 100)
             // Arduino v00xx (before v1.0), Wire library
 
-            // I2C/TWI subsystem uses internal buffer that breaks with large data requests
-            // so if user requests more than BUFFER_LENGTH bytes, we have to do it in
-            // smaller chunks instead of all at once
-            for (uint8_t k = 0; k < length; k += min(length, BUFFER_LENGTH)) {
-                Wire.beginTransmission(devAddr);
-                Wire.send(regAddr);
-                Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (uint8_t)min(length - k, BUFFER_LENGTH));
+            Wire.beginTransmission(devAddr);
+            Wire.send(regAddr);
+            if ((error = i2cdev_wireError(Wire.endTransmission())) == I2CDEV_ERROR_NONE) {
+                for (uint8_t k = 0; k < length; k = count) {
+                    Wire.requestFrom(devAddr, (uint8_t)min(length - k, BUFFER_LENGTH));
 
-                for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
-                    data[count] = Wire.receive();
-                    #ifdef I2CDEV_SERIAL_DEBUG
-                        Serial.print(data[count], HEX);
-                        if (count + 1 < length) Serial.print(" ");
-                    #endif
+                    for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
+                        data[count] = Wire.receive();
+                        #ifdef I2CDEV_SERIAL_DEBUG
+                            Serial.print(data[count], HEX);
+                            if (count + 1 < length) Serial.print(" ");
+                        #endif
+                    }
+                    if (count == k)
+                        break;                              // nothing read - NACK or timeout
                 }
-
-                Wire.endTransmission();
             }
         #elif (ARDUINO == 100)
             // Arduino v1.0.0, Wire library
             // Adds standardized write() and read() stream methods instead of send() and receive()
 
-            // I2C/TWI subsystem uses internal buffer that breaks with large data requests
-            // so if user requests more than BUFFER_LENGTH bytes, we have to do it in
-            // smaller chunks instead of all at once
-            for (uint8_t k = 0; k < length; k += min(length, BUFFER_LENGTH)) {
-                Wire.beginTransmission(devAddr);
-                Wire.write(regAddr);
-                Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (uint8_t)min(length - k, BUFFER_LENGTH));
-        
-                for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
-                    data[count] = Wire.read();
-                    #ifdef I2CDEV_SERIAL_DEBUG
-                        Serial.print(data[count], HEX);
-                        if (count + 1 < length) Serial.print(" ");
-                    #endif
+            Wire.beginTransmission(devAddr);
+            Wire.write(regAddr);
+            if ((error = i2cdev_wireError(Wire.endTransmission())) == I2CDEV_ERROR_NONE) {
+                for (uint8_t k = 0; k < length; k = count) {
+                    Wire.requestFrom(devAddr, (uint8_t)min(length - k, BUFFER_LENGTH));
+
+                    for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
+                        data[count] = Wire.read();
+                        #ifdef I2CDEV_SERIAL_DEBUG
+                            Serial.print(data[count], HEX);
+                            if (count + 1 < length) Serial.print(" ");
+                        #endif
+                    }
+                    if (count == k)
+                        break;                              // nothing read - NACK or timeout
                 }
-        
-                Wire.endTransmission();
             }
         #elif (ARDUINO > 100)
             // Arduino v1.0.1+, Wire library
             // Adds official support for repeated start condition, yay!
 
-            // I2C/TWI subsystem uses internal buffer that breaks with large data requests
-            // so if user requests more than BUFFER_LENGTH bytes, we have to do it in
-            // smaller chunks instead of all at once
-            for (uint8_t k = 0; k < length; k += min(length, BUFFER_LENGTH)) {
-                Wire.beginTransmission(devAddr);
-                Wire.write(regAddr);
-                Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (uint8_t)min(length - k, BUFFER_LENGTH));
-        
-                for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
-                    data[count] = Wire.read();
+            // The register address write ends with a repeated start rather than a STOP
+            // and the chunks are chained the same way, so the whole read is a single
+            // bus transaction with a STOP only after the last byte.
+
+            Wire.beginTransmission(devAddr);
+            Wire.write(regAddr);
+            if ((error = i2cdev_wireError(Wire.endTransmission(false))) == I2CDEV_ERROR_NONE) {
+                for (uint8_t k = 0; k < length; k = count) {
+                    uint8_t chunk = min(length - k, BUFFER_LENGTH);
+
+                    Wire.requestFrom(devAddr, chunk, (uint8_t)(k + chunk >= length));
+
+                    for (; Wire.available() && (timeout == 0 || millis() - t1 < timeout); count++) {
+                        data[count] = Wire.read();
+                        #ifdef I2CDEV_SERIAL_DEBUG
+                            Serial.print(data[count], HEX);
+                            if (count + 1 < length) Serial.print(" ");
+                        #endif
+                    }
+                    if (count == k)
+                        break;                              // nothing read - NACK or timeout
+                }
+            }
+        #endif
+
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+
+        // no repeated start in NBWire - chunks continue from the device's register pointer
+        Wire.beginTransmission(devAddr);
+        Wire.send(regAddr);
+        if ((error = i2cdev_wireError(Wire.endTransmission(timeout))) == I2CDEV_ERROR_NONE) {
+            for (uint8_t k = 0; k < length; k = count) {
+                Wire.requestFrom(devAddr, (uint8_t)min(length - k, NBWIRE_BUFFER_LENGTH), timeout);
+                for (; Wire.available() && count < length; count++) {
+                    data[count] = Wire.receive();
                     #ifdef I2CDEV_SERIAL_DEBUG
                         Serial.print(data[count], HEX);
                         if (count + 1 < length) Serial.print(" ");
                     #endif
                 }
+                if (count == k)
+                    break;                                  // nothing read - NACK or timeout
             }
-        #endif
+        }
 
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
 
@@ -299,13 +646,27 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
             count = length; // success
         } else {
             count = -1; // error
+            error = i2cdev_fastwireError(status);
         }
 
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED)
+
+        // device models - see I2CdevSim.h
+        count = I2CdevSim::read(devAddr, regAddr, length, data, i2cdev_currentClock);
+        if (count < 0)
+            error = I2CDEV_ERROR_NACK;
+
     #endif
 
     // check for timeout
     if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
 
+    if ((error == I2CDEV_ERROR_NONE) && (count < length))
+        error = i2cdev_shortError();
+    i2cdev_finish(devAddr, error);
+
+    I2CDEV_TRACE_RECORD(devAddr, regAddr, count < 0 ? 0 : count, count < length ? I2CDEV_TRACE_ERROR : 0)
+
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print(". Done (");
         Serial.print(count, DEC);
@@ -334,8 +695,18 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
         Serial.print("...");
     #endif
 
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+        // NBWire shares the TWI with the transaction queue so let that drain first
+        if (!flush(timeout)) return -1;
+    #elif defined(I2CDEV_SAM3X_PDC)
+        i2cdev_pdcWait();
+    #endif
+
     int8_t count = 0;
     uint32_t t1 = millis();
+    I2CDEV_TRACE_START
+    i2cdev_selectClock(devAddr);
+    i2cdev_startBudget(devAddr, length * 2);
 
     #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE)
 
@@ -408,34 +779,35 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
             // Arduino v1.0.1+, Wire library
             // Adds official support for repeated start condition, yay!
 
-            // I2C/TWI subsystem uses internal buffer that breaks with large data requests
-            // so if user requests more than BUFFER_LENGTH bytes, we have to do it in
-            // smaller chunks instead of all at once
-            for (uint8_t k = 0; k < length * 2; k += min(length * 2, BUFFER_LENGTH)) {
-                Wire.beginTransmission(devAddr);
-                Wire.write(regAddr);
-                Wire.endTransmission();
-                Wire.beginTransmission(devAddr);
-                Wire.requestFrom(devAddr, (uint8_t)(length * 2)); // length=words, this wants bytes
-        
+            // Register address then repeated start, with the chunks chained the same
+            // way so the register pointer advances through the whole read
+            Wire.beginTransmission(devAddr);
+            Wire.write(regAddr);
+            if (Wire.endTransmission(false) == 0) {
                 bool msb = true; // starts with MSB, then LSB
-                for (; Wire.available() && count < length && (timeout == 0 || millis() - t1 < timeout);) {
-                    if (msb) {
-                        // first byte is bits 15-8 (MSb=15)
-                        data[count] = Wire.read() << 8;
-                    } else {
-                        // second byte is bits 7-0 (LSb=0)
-                        data[count] |= Wire.read();
-                        #ifdef I2CDEV_SERIAL_DEBUG
-                            Serial.print(data[count], HEX);
-                            if (count + 1 < length) Serial.print(" ");
-                        #endif
-                        count++;
+                for (uint16_t k = 0; k < length * 2; ) {
+                    uint8_t chunk = min(length * 2 - k, BUFFER_LENGTH);
+                    uint8_t got = Wire.requestFrom(devAddr, chunk, (uint8_t)(k + chunk >= length * 2));
+
+                    for (; Wire.available() && count < length && (timeout == 0 || millis() - t1 < timeout);) {
+                        if (msb) {
+                            // first byte is bits 15-8 (MSb=15)
+                            data[count] = Wire.read() << 8;
+                        } else {
+                            // second byte is bits 7-0 (LSb=0)
+                            data[count] |= Wire.read();
+                            #ifdef I2CDEV_SERIAL_DEBUG
+                                Serial.print(data[count], HEX);
+                                if (count + 1 < length) Serial.print(" ");
+                            #endif
+                            count++;
+                        }
+                        msb = !msb;
                     }
-                    msb = !msb;
+                    if (got < chunk)
+                        break;                              // NACK
+                    k += chunk;
                 }
-        
-                Wire.endTransmission();
             }
         #endif
 
@@ -454,10 +826,27 @@ int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint1
             count = -1; // error
         }
 
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED)
+
+        // device models - see I2CdevSim.h
+        uint8_t intermediate[(uint8_t)length * 2];
+        if (I2CdevSim::read(devAddr, regAddr, length * 2, intermediate, i2cdev_currentClock) == length * 2) {
+            count = length;
+            for (uint8_t i = 0; i < length; i++) {
+                data[i] = (intermediate[2*i] << 8) | intermediate[2*i + 1];
+            }
+        } else {
+            count = -1;
+        }
+
     #endif
 
     if (timeout > 0 && millis() - t1 >= timeout && count < length) count = -1; // timeout
 
+    i2cdev_finish(devAddr, count < length ? i2cdev_shortError() : I2CDEV_ERROR_NONE);
+
+    I2CDEV_TRACE_RECORD(devAddr, regAddr, count < 0 ? 0 : count * 2, count < length ? I2CDEV_TRACE_ERROR : 0)
+
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print(". Done (");
         Serial.print(count, DEC);
@@ -590,7 +979,15 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         Serial.print(regAddr, HEX);
         Serial.print("...");
     #endif
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+        if (!flush()) return false;
+    #elif defined(I2CDEV_SAM3X_PDC)
+        i2cdev_pdcWait();
+    #endif
     uint8_t status = 0;
+    I2CDEV_TRACE_START
+    i2cdev_selectClock(devAddr);
+    i2cdev_startBudget(devAddr, length);
     #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         Wire.beginTransmission(devAddr);
         Wire.send((uint8_t) regAddr); // send address
@@ -598,8 +995,8 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         Wire.beginTransmission(devAddr);
         Wire.write((uint8_t) regAddr); // send address
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
-        Fastwire::beginTransmission(devAddr);
-        Fastwire::write(regAddr);
+        if ((status = Fastwire::beginTransmission(devAddr)) == 0)
+            status = Fastwire::write(regAddr);
     #endif
     for (uint8_t i = 0; i < length; i++) {
         #ifdef I2CDEV_SERIAL_DEBUG
@@ -611,17 +1008,21 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
         #elif (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO >= 100)
             Wire.write((uint8_t) data[i]);
         #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
-            Fastwire::write((uint8_t) data[i]);
+            if (status != 0) break;
+            status = Fastwire::write((uint8_t) data[i]);
         #endif
     }
-    #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
-        Wire.endTransmission();
-    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO >= 100)
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         status = Wire.endTransmission();
+        i2cdev_finish(devAddr, i2cdev_wireError(status));
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
         Fastwire::stop();
-        //status = Fastwire::endTransmission();
+        i2cdev_finish(devAddr, status == 0 ? I2CDEV_ERROR_NONE : i2cdev_fastwireError(status));
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED)
+        status = I2CdevSim::write(devAddr, regAddr, length, data, i2cdev_currentClock) ? 0 : 2;
+        i2cdev_finish(devAddr, status == 0 ? I2CDEV_ERROR_NONE : I2CDEV_ERROR_NACK);
     #endif
+    I2CDEV_TRACE_RECORD(devAddr, regAddr, length, I2CDEV_TRACE_WRITE | (status == 0 ? 0 : I2CDEV_TRACE_ERROR))
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
@@ -645,7 +1046,15 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         Serial.print(regAddr, HEX);
         Serial.print("...");
     #endif
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+        if (!flush()) return false;
+    #elif defined(I2CDEV_SAM3X_PDC)
+        i2cdev_pdcWait();
+    #endif
     uint8_t status = 0;
+    I2CDEV_TRACE_START
+    i2cdev_selectClock(devAddr);
+    i2cdev_startBudget(devAddr, length * 2);
     #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         Wire.beginTransmission(devAddr);
         Wire.send(regAddr); // send address
@@ -653,8 +1062,8 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
         Wire.beginTransmission(devAddr);
         Wire.write(regAddr); // send address
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
-        Fastwire::beginTransmission(devAddr);
-        Fastwire::write(regAddr);
+        if ((status = Fastwire::beginTransmission(devAddr)) == 0)
+            status = Fastwire::write(regAddr);
     #endif
     for (uint8_t i = 0; i < length * 2; i++) {
         #ifdef I2CDEV_SERIAL_DEBUG
@@ -668,19 +1077,27 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
             Wire.write((uint8_t)(data[i] >> 8));    // send MSB
             Wire.write((uint8_t)data[i++]);         // send LSB
         #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
-            Fastwire::write((uint8_t)(data[i] >> 8));       // send MSB
-            status = Fastwire::write((uint8_t)data[i++]);   // send LSB
             if (status != 0) break;
+            if ((status = Fastwire::write((uint8_t)(data[i] >> 8))) == 0)  // send MSB
+                status = Fastwire::write((uint8_t)data[i++]);               // send LSB
         #endif
     }
-    #if ((I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO < 100) || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
-        Wire.endTransmission();
-    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE && ARDUINO >= 100)
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE || I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
         status = Wire.endTransmission();
+        i2cdev_finish(devAddr, i2cdev_wireError(status));
     #elif (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE)
         Fastwire::stop();
-        //status = Fastwire::endTransmission();
+        i2cdev_finish(devAddr, status == 0 ? I2CDEV_ERROR_NONE : i2cdev_fastwireError(status));
+    #elif (I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED)
+        uint8_t intermediate[(uint8_t)length * 2];
+        for (uint8_t i = 0; i < length; i++) {
+            intermediate[2*i] = data[i] >> 8;               // MSB first
+            intermediate[2*i + 1] = data[i];
+        }
+        status = I2CdevSim::write(devAddr, regAddr, length * 2, intermediate, i2cdev_currentClock) ? 0 : 2;
+        i2cdev_finish(devAddr, status == 0 ? I2CDEV_ERROR_NONE : I2CDEV_ERROR_NACK);
     #endif
+    I2CDEV_TRACE_RECORD(devAddr, regAddr, length * 2, I2CDEV_TRACE_WRITE | (status == 0 ? 0 : I2CDEV_TRACE_ERROR))
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.println(". Done.");
     #endif
@@ -692,6 +1109,11 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
  */
 uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
 
+/** Time budget for each transaction in microseconds.
+ * Set this to 0 (the default) to work it out from the length and bus clock.
+ */
+uint16_t I2Cdev::timeoutMicros = I2CDEV_DEFAULT_TIMEOUT_MICROS;
+
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
     // I2C library
     //////////////////////
@@ -712,9 +1134,12 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
      */
 
     boolean Fastwire::waitInt() {
-        int l = 250;
-        while (!(TWCR & (1 << TWINT)) && l-- > 0);
-        return l > 0;
+        // wait within the time budget of the I2Cdev transaction in progress
+        while (!(TWCR & (1 << TWINT))) {
+            if (i2cdev_budgetExpired())
+                return false;
+        }
+        return true;
     }
 
     void Fastwire::setup(int khz, boolean pullup) {
@@ -994,14 +1419,15 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
         uint8_t i;
     } twi_Write_Vars;
 
-    twi_Write_Vars *ptwv = 0;
+    // The transfer parameters are in static storage rather than malloc()ed per transfer: the
+    // queued transactions start their read from the TWI interrupt and malloc() and free()
+    // aren't safe to call there. Only one transfer is ever in progress.
+
+    static twi_Write_Vars twi_Vars;
+    twi_Write_Vars *ptwv = &twi_Vars;
     static void (*fNextInterruptFunction)(void) = 0;
 
     void twi_Finish(byte bRetVal) {
-        if (ptwv) {
-            free(ptwv);
-            ptwv = 0;
-        }
         twi_Done = 0xFF;
         twi_Return_Value = bRetVal;
         fNextInterruptFunction = 0;
@@ -1009,7 +1435,12 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
     
     uint8_t twii_WaitForDone(uint16_t timeout) {
         uint32_t endMillis = millis() + timeout;
-        while (!twi_Done && (timeout == 0 || millis() < endMillis)) continue;
+        while (!twi_Done && (timeout == 0 || millis() < endMillis)) {
+            if (i2cdev_budgetExpired())
+                break;
+        }
+        if (!twi_Done)
+            return 0xFF;                                    // overran, the caller recovers the bus
         return twi_Return_Value;
     }
     
@@ -1083,7 +1514,6 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
     
     void twi_writeTo(uint8_t address, uint8_t* data, uint8_t length, uint8_t wait) {
         uint8_t i;
-        ptwv = (twi_Write_Vars *)malloc(sizeof(twi_Write_Vars));
         ptwv -> address = address;
         ptwv -> data = data;
         ptwv -> length = length;
@@ -1117,7 +1547,6 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
     void twi_readFrom(uint8_t address, uint8_t* data, uint8_t length) {
         uint8_t i;
 
-        ptwv = (twi_Write_Vars *)malloc(sizeof(twi_Write_Vars));
         ptwv -> address = address;
         ptwv -> data = data;
         ptwv -> length = length;
@@ -1421,6 +1850,8 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
         twi_cbreadFromDone = NULL;
         twi_readFrom(address, rxBuffer, quantity);
         uint8_t read = twii_WaitForDone(timeout);
+        if (read == 0xFF)
+            read = 0;
 
         // set rx buffer iterator vars
         rxBufferIndex = 0;
@@ -1455,3 +1886,512 @@ uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
     }
 
 #endif
+
+// -----------------------------------------------------------------------------
+// Asynchronous transaction queue
+// -----------------------------------------------------------------------------
+
+static I2CDEV_TRANSACTION *i2cdev_queue[I2CDEV_QUEUE_LENGTH];
+static uint8_t i2cdev_queueHead = 0;
+static uint8_t i2cdev_queueCount = 0;
+static bool i2cdev_polling = false;
+
+static void i2cdev_complete(I2CDEV_TRANSACTION *transaction, int8_t count, uint8_t error) {
+    transaction->count = count;
+    transaction->error = error;
+    transaction->status = count < 0 ? I2CDEV_STATUS_ERROR : I2CDEV_STATUS_DONE;
+}
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
+
+    // The transfer is chained from the TWI interrupt using the NBWire callbacks:
+    // the register address (plus data for a write) goes out with nbendTransmission
+    // and, for a read, its completion starts the nbrequestFrom for the data.
+    // Only the transaction at the head of the queue is ever on the bus.
+
+    static I2CDEV_TRANSACTION * volatile i2cdev_active = 0;
+
+    static void i2cdev_readDone(int count) {
+        I2CDEV_TRANSACTION *transaction = i2cdev_active;
+
+        if (transaction == 0)
+            return;
+        i2cdev_active = 0;
+        if (count != transaction->length) {
+            i2cdev_complete(transaction, -1, I2CDEV_ERROR_NACK);
+            return;
+        }
+        for (uint8_t i = 0; i < transaction->length; i++)
+            transaction->data[i] = Wire.receive();
+        i2cdev_complete(transaction, transaction->length, I2CDEV_ERROR_NONE);
+    }
+
+    static void i2cdev_transmitDone(int result) {
+        I2CDEV_TRANSACTION *transaction = i2cdev_active;
+
+        if (transaction == 0)
+            return;
+        if (result != 0) {
+            i2cdev_active = 0;
+            i2cdev_complete(transaction, -1, i2cdev_wireError(result));
+            return;
+        }
+        if (transaction->type == I2CDEV_TRANSACTION_WRITE) {
+            i2cdev_active = 0;
+            i2cdev_complete(transaction, transaction->length, I2CDEV_ERROR_NONE);
+            return;
+        }
+        Wire.nbrequestFrom(transaction->devAddr, transaction->length, i2cdev_readDone);
+    }
+
+    static void i2cdev_start(I2CDEV_TRANSACTION *transaction) {
+        transaction->status = I2CDEV_STATUS_ACTIVE;
+        transaction->startTime = micros();
+        i2cdev_selectClock(transaction->devAddr);
+        i2cdev_active = transaction;
+        Wire.beginTransmission(transaction->devAddr);
+        Wire.send(transaction->regAddr);
+        if (transaction->type == I2CDEV_TRANSACTION_WRITE) {
+            for (uint8_t i = 0; i < transaction->length; i++)
+                Wire.send(transaction->data[i]);
+        }
+        Wire.nbendTransmission(i2cdev_transmitDone);
+    }
+
+    // drops whatever the TWI interrupt was doing and resets the TWI
+
+    static void i2cdev_abort() {
+        uint8_t sreg = SREG;
+        cli();
+        fNextInterruptFunction = 0;
+        twi_Done = 0xFF;
+        i2cdev_active = 0;
+        SREG = sreg;
+
+        twi_init();                                         // reset the TWI and its state
+        i2cdev_currentClock = 0;                            // twi_init() sets its own bit rate
+    }
+
+    // the interrupt does the work - this abandons the active transfer if it has
+    // overrun its time budget. True once the transaction is off the bus.
+
+    static bool i2cdev_service(I2CDEV_TRANSACTION *transaction) {
+        uint32_t budget = i2cdev_transactionBudget(transaction->devAddr, transaction->length);
+
+        if ((uint32_t)(micros() - transaction->startTime) < budget)
+            return false;
+
+        i2cdev_abort();
+        i2cdev_complete(transaction, -1, I2CDEV_ERROR_TIMEOUT);
+        return true;
+    }
+
+#else
+
+    // Wire and Fastwire have no interrupt driven path so the transfer is
+    // done in full here using the blocking calls (except for SAM3X PDC reads)
+
+    static void i2cdev_start(I2CDEV_TRANSACTION *transaction) {
+        transaction->status = I2CDEV_STATUS_ACTIVE;
+        transaction->startTime = micros();
+        #ifdef I2CDEV_SAM3X_PDC
+            if ((transaction->type == I2CDEV_TRANSACTION_READ) && (transaction->length >= I2CDEV_PDC_MIN_LENGTH)) {
+                i2cdev_pdcStart(transaction);
+                return;
+            }
+        #endif
+        if (transaction->type == I2CDEV_TRANSACTION_READ) {
+            int8_t count = I2Cdev::readBytes(transaction->devAddr, transaction->regAddr,
+                    transaction->length, transaction->data);
+            i2cdev_complete(transaction, count == transaction->length ? count : -1, i2cdev_lastError);
+        } else {
+            bool ok = I2Cdev::writeBytes(transaction->devAddr, transaction->regAddr,
+                    transaction->length, transaction->data);
+            i2cdev_complete(transaction, ok ? transaction->length : -1, i2cdev_lastError);
+        }
+    }
+
+    static bool i2cdev_service(I2CDEV_TRANSACTION *transaction) {
+        #ifdef I2CDEV_SAM3X_PDC
+            i2cdev_pdcService();
+            return transaction->status != I2CDEV_STATUS_ACTIVE;
+        #else
+            return true;
+        #endif
+    }
+
+#endif
+
+/** Queue a register read.
+ * @param transaction Descriptor to fill in and submit (must stay valid until complete)
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address to read from
+ * @param length Number of bytes to read (up to I2CDEV_TRANSACTION_MAX_LENGTH)
+ * @param data Buffer to store read data in
+ * @return Status of operation (true = queued)
+ */
+bool I2Cdev::submitRead(I2CDEV_TRANSACTION *transaction, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+    transaction->devAddr = devAddr;
+    transaction->regAddr = regAddr;
+    transaction->length = length;
+    transaction->data = data;
+    transaction->type = I2CDEV_TRANSACTION_READ;
+    return submit(transaction);
+}
+
+/** Queue a register write.
+ * @param transaction Descriptor to fill in and submit (must stay valid until complete)
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address to write to
+ * @param length Number of bytes to write (up to I2CDEV_TRANSACTION_MAX_WRITE)
+ * @param data Buffer to copy new data from (must stay valid until complete)
+ * @return Status of operation (true = queued)
+ */
+bool I2Cdev::submitWrite(I2CDEV_TRANSACTION *transaction, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data) {
+    transaction->devAddr = devAddr;
+    transaction->regAddr = regAddr;
+    transaction->length = length;
+    transaction->data = data;
+    transaction->type = I2CDEV_TRANSACTION_WRITE;
+    return submit(transaction);
+}
+
+/** Queue a transaction descriptor.
+ * The caller owns the descriptor and its buffer. Completion is seen either by
+ * checking status after poll() or through the optional callback.
+ * @param transaction Descriptor with devAddr, regAddr, length, type, data and callback set up
+ * @return Status of operation (true = queued, false = queue full or bad descriptor)
+ */
+bool I2Cdev::submit(I2CDEV_TRANSACTION *transaction) {
+    if (pending(transaction) || (i2cdev_queueCount >= I2CDEV_QUEUE_LENGTH))
+        return false;
+
+    if ((transaction->length == 0) ||
+            (transaction->length > I2CDEV_TRANSACTION_MAX_LENGTH) ||
+            ((transaction->type == I2CDEV_TRANSACTION_WRITE) && (transaction->length > I2CDEV_TRANSACTION_MAX_WRITE))) {
+        i2cdev_complete(transaction, -1, I2CDEV_ERROR_LENGTH);
+        return false;
+    }
+
+    transaction->count = 0;
+    transaction->error = I2CDEV_ERROR_NONE;
+    transaction->status = I2CDEV_STATUS_QUEUED;
+    i2cdev_queue[(i2cdev_queueHead + i2cdev_queueCount) % I2CDEV_QUEUE_LENGTH] = transaction;
+    i2cdev_queueCount++;
+
+    if (!i2cdev_polling)
+        poll();                                             // start it if the bus is free
+    return true;
+}
+
+/** Advance the transaction queue.
+ * Starts the next queued transaction when the bus is free, times out a stuck
+ * transfer and runs completion callbacks. Call this regularly from loop().
+ */
+void I2Cdev::poll() {
+    I2CDEV_TRANSACTION *transaction;
+
+    i2cdev_polling = true;
+    while (i2cdev_queueCount > 0) {
+        transaction = i2cdev_queue[i2cdev_queueHead];
+        if (transaction->status == I2CDEV_STATUS_QUEUED)
+            i2cdev_start(transaction);
+        if ((transaction->status == I2CDEV_STATUS_ACTIVE) && !i2cdev_service(transaction))
+            break;                                          // still on the bus
+
+        i2cdev_queueHead = (i2cdev_queueHead + 1) % I2CDEV_QUEUE_LENGTH;
+        i2cdev_queueCount--;
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
+        // the synchronous implementations are traced and counted by readBytes/writeBytes
+#ifdef I2CDEV_TRACE
+        i2cdev_traceRecord(transaction->devAddr, transaction->regAddr, transaction->length,
+                I2CDEV_TRACE_ASYNC | (transaction->type == I2CDEV_TRANSACTION_WRITE ? I2CDEV_TRACE_WRITE : 0) |
+                (transaction->status == I2CDEV_STATUS_ERROR ? I2CDEV_TRACE_ERROR : 0), transaction->startTime);
+#endif
+        if (transaction->error != I2CDEV_ERROR_NONE)
+            i2cdev_error(transaction->devAddr, transaction->error);
+#endif
+        if (transaction->callback)
+            transaction->callback(transaction);
+    }
+    i2cdev_polling = false;
+}
+
+/** Check for an empty transaction queue.
+ * @return true if nothing is queued or on the bus
+ */
+bool I2Cdev::idle() {
+    return i2cdev_queueCount == 0;
+}
+
+/** Wait for all queued transactions to complete.
+ * @param timeout Optional timeout in milliseconds (0 to disable)
+ * @return Status of operation (true = queue empty)
+ */
+bool I2Cdev::flush(uint16_t timeout) {
+    uint32_t t1 = millis();
+
+    while (!idle()) {
+        poll();
+        if ((timeout > 0) && ((millis() - t1) >= timeout))
+            return idle();
+    }
+    return true;
+}
+
+// completion callback for the burst transfers - does the buffer handoff
+
+static void i2cdev_burstDone(I2CDEV_TRANSACTION *transaction) {
+    I2CDEV_DOUBLE_BUFFER *burst = (I2CDEV_DOUBLE_BUFFER *)transaction->context;
+
+    if (transaction->status != I2CDEV_STATUS_DONE)
+        return;
+    if (burst->held) {
+        burst->overruns++;                                  // nowhere to put it, the fill buffer gets reused
+        return;
+    }
+    if (burst->ready)
+        burst->overruns++;                                  // the previous burst was never taken
+    burst->fill ^= 1;
+    burst->ready = true;
+}
+
+/** Set up a double buffer for burst reads.
+ * @param burst Double buffer descriptor (must stay valid while bursts are queued)
+ * @param buffer0 First sample area
+ * @param buffer1 Second sample area
+ * @param length Size of each sample area and of each burst
+ */
+void I2Cdev::initDoubleBuffer(I2CDEV_DOUBLE_BUFFER *burst, uint8_t *buffer0, uint8_t *buffer1, uint8_t length) {
+    burst->buffer[0] = buffer0;
+    burst->buffer[1] = buffer1;
+    burst->length = length;
+    burst->fill = 0;
+    burst->ready = false;
+    burst->held = false;
+    burst->overruns = 0;
+    burst->transaction.status = I2CDEV_STATUS_IDLE;
+    burst->transaction.callback = i2cdev_burstDone;
+    burst->transaction.context = burst;
+}
+
+/** Queue a burst read into the free buffer.
+ * @param burst Double buffer set up with initDoubleBuffer()
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address to read from
+ * @return Status of operation (true = queued, false = previous burst still pending or queue full)
+ */
+bool I2Cdev::submitBurst(I2CDEV_DOUBLE_BUFFER *burst, uint8_t devAddr, uint8_t regAddr) {
+    if (pending(&burst->transaction))
+        return false;
+    return submitRead(&burst->transaction, devAddr, regAddr, burst->length, burst->buffer[burst->fill]);
+}
+
+/** Take the most recent completed burst.
+ * The buffer belongs to the caller until releaseBurst() is called.
+ * @param burst Double buffer set up with initDoubleBuffer()
+ * @return Pointer to the burst data, or 0 if there isn't a new one
+ */
+uint8_t *I2Cdev::takeBurst(I2CDEV_DOUBLE_BUFFER *burst) {
+    poll();
+    if (!burst->ready)
+        return 0;
+    burst->ready = false;
+    burst->held = true;
+    return burst->buffer[burst->fill ^ 1];
+}
+
+/** Give a buffer from takeBurst() back for the next burst to use.
+ * @param burst Double buffer set up with initDoubleBuffer()
+ */
+void I2Cdev::releaseBurst(I2CDEV_DOUBLE_BUFFER *burst) {
+    burst->held = false;
+}
+
+#ifdef I2CDEV_TRACE
+
+/** Add a marker to the bus trace.
+ * Drivers or sketches call this once per sample so that the trace can be
+ * split into transactions per sample.
+ * @param id Identifies the marker (stored in regAddr of the entry)
+ */
+void I2Cdev::traceMark(uint8_t id) {
+    i2cdev_traceRecord(0, id, 0, I2CDEV_TRACE_MARK, micros());
+}
+
+/** Remove entries from the bus trace, oldest first.
+ * @param entries Buffer to copy the entries to
+ * @param maxEntries Size of the buffer in entries
+ * @return Number of entries copied
+ */
+uint8_t I2Cdev::traceRead(I2CDEV_TRACE_ENTRY *entries, uint8_t maxEntries) {
+    uint8_t count = 0;
+
+    while ((count < maxEntries) && (i2cdev_traceCount > 0)) {
+        entries[count++] = i2cdev_trace[i2cdev_traceHead];
+        i2cdev_traceHead = (i2cdev_traceHead + 1) % I2CDEV_TRACE_LENGTH;
+        i2cdev_traceCount--;
+    }
+    return count;
+}
+
+/** Get and reset the count of trace entries dropped because the ring was full.
+ * @return Number of entries lost since the last call
+ */
+uint16_t I2Cdev::traceLost() {
+    uint16_t lost = i2cdev_traceLost;
+
+    i2cdev_traceLost = 0;
+    return lost;
+}
+
+#endif
+
+/** Declare the fastest bus clock a device supports.
+ * The bus is switched to this clock (capped by the bus limit) whenever the device
+ * is addressed. Drivers call this from their init functions.
+ * @param devAddr I2C slave device address
+ * @param maxClock Maximum clock in Hz (I2CDEV_CLOCK_STANDARD, FAST or FASTPLUS)
+ * @return Status of operation (true = success, false = device table full)
+ */
+bool I2Cdev::setDeviceClock(uint8_t devAddr, uint32_t maxClock) {
+    I2CDEV_DEVICE *device = i2cdev_findDevice(devAddr, true);
+
+    if (device == 0)
+        return false;
+    device->clock = maxClock / 1000;
+    i2cdev_currentClock = 0;                                // force a reselect
+    return true;
+}
+
+/** Get the clock that will be used for a device.
+ * @param devAddr I2C slave device address
+ * @return Clock in Hz after applying the bus limit
+ */
+uint32_t I2Cdev::getDeviceClock(uint8_t devAddr) {
+    return (uint32_t)i2cdev_deviceClock(devAddr) * 1000;
+}
+
+/** Set the fastest clock the bus itself can run at.
+ * Defaults to I2CDEV_DEFAULT_BUS_LIMIT. Lower it for long wires or weak pull-ups,
+ * raise it to I2CDEV_CLOCK_FASTPLUS if everything on the bus can take it. Also call
+ * this after changing the clock outside I2Cdev (Wire.setClock(), Fastwire::setup()).
+ * @param maxClock Maximum clock in Hz
+ */
+void I2Cdev::setBusClockLimit(uint32_t maxClock) {
+    i2cdev_busLimit = maxClock / 1000;
+    i2cdev_currentClock = 0;                                // force a reselect
+}
+
+/** Recover a stuck bus.
+ * A slave that was interrupted mid byte can hold SDA low for ever. This clocks
+ * SCL up to nine times until it lets go, generates a STOP and re-initializes the
+ * TWI. Called automatically on a timeout or bus error, and safe to call at any
+ * time the queue is not being polled.
+ * @return Status of operation (true = bus free afterwards)
+ */
+bool I2Cdev::recoverBus() {
+    bool free = true;
+
+    #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
+        if (i2cdev_active) {
+            I2CDEV_TRANSACTION *transaction = i2cdev_active;
+            i2cdev_abort();
+            i2cdev_complete(transaction, -1, I2CDEV_ERROR_NONE); // fails, but don't count it or recover again
+        }
+    #elif defined(I2CDEV_SAM3X_PDC)
+        if (i2cdev_pdcTransaction) {
+            I2CDEV_TRANSACTION *transaction = i2cdev_pdcTransaction;
+            I2CDEV_PDC_TWI->TWI_PTCR = TWI_PTCR_RXTDIS;
+            i2cdev_pdcTransaction = 0;
+            i2cdev_pdcState = I2CDEV_PDC_IDLE;
+            i2cdev_complete(transaction, -1, I2CDEV_ERROR_NONE);
+        }
+    #endif
+
+    #if defined(PIN_WIRE_SDA) && defined(PIN_WIRE_SCL)
+        #ifdef TWCR
+            TWCR = 0;                                       // release the pins from the TWI
+
+            // the bit banging below turns the internal pull-ups on - remember how they were
+            uint8_t sdaPullup = *portOutputRegister(digitalPinToPort(PIN_WIRE_SDA)) & digitalPinToBitMask(PIN_WIRE_SDA);
+            uint8_t sclPullup = *portOutputRegister(digitalPinToPort(PIN_WIRE_SCL)) & digitalPinToBitMask(PIN_WIRE_SCL);
+        #endif
+        pinMode(PIN_WIRE_SDA, INPUT);
+        digitalWrite(PIN_WIRE_SDA, HIGH);                   // pull-up on older cores
+        pinMode(PIN_WIRE_SCL, INPUT);
+        digitalWrite(PIN_WIRE_SCL, HIGH);
+        delayMicroseconds(5);
+
+        for (uint8_t i = 0; (i < 9) && (digitalRead(PIN_WIRE_SDA) == LOW); i++) {
+            pinMode(PIN_WIRE_SCL, OUTPUT);                  // drive SCL low
+            digitalWrite(PIN_WIRE_SCL, LOW);
+            delayMicroseconds(5);
+            pinMode(PIN_WIRE_SCL, INPUT);                   // let SCL float high
+            digitalWrite(PIN_WIRE_SCL, HIGH);
+            delayMicroseconds(5);
+        }
+
+        // STOP: SDA rises while SCL is high
+
+        pinMode(PIN_WIRE_SDA, OUTPUT);
+        digitalWrite(PIN_WIRE_SDA, LOW);
+        delayMicroseconds(5);
+        pinMode(PIN_WIRE_SDA, INPUT);
+        digitalWrite(PIN_WIRE_SDA, HIGH);
+        delayMicroseconds(5);
+
+        free = (digitalRead(PIN_WIRE_SDA) == HIGH) && (digitalRead(PIN_WIRE_SCL) == HIGH);
+
+        #ifdef TWCR
+            digitalWrite(PIN_WIRE_SDA, sdaPullup ? HIGH : LOW);
+            digitalWrite(PIN_WIRE_SCL, sclPullup ? HIGH : LOW);
+        #endif
+    #endif
+
+    #if (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE) || (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE)
+        Wire.begin();
+    #elif I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
+        // re-initialize the TWI only - Fastwire::setup() would also change the pull-ups and
+        // the bit rate, which i2cdev_selectClock() sets on the next transfer
+
+        TWCR = 0;
+        TWSR = 0;                                           // prescaler 1
+        TWCR = 1 << TWEN;                                   // enable twi module, no interrupt
+    #endif
+
+    i2cdev_currentClock = 0;                                // re-initializing resets the bit rate
+    i2cdev_recoveries++;
+    return free;
+}
+
+/** Get the error counters for a device.
+ * @param devAddr I2C slave device address
+ * @param errors Where to copy the counters
+ * @return Status of operation (true = device has been seen)
+ */
+bool I2Cdev::getDeviceErrors(uint8_t devAddr, I2CDEV_ERRORS *errors) {
+    I2CDEV_DEVICE *device = i2cdev_findDevice(devAddr, false);
+
+    if (device == 0) {
+        memset(errors, 0, sizeof(I2CDEV_ERRORS));
+        return false;
+    }
+    *errors = device->errors;
+    return true;
+}
+
+/** Zero the error counters of every device and the bus recovery count.
+ */
+void I2Cdev::clearDeviceErrors() {
+    for (uint8_t i = 0; i < i2cdev_deviceCount; i++)
+        memset(&i2cdev_devices[i].errors, 0, sizeof(I2CDEV_ERRORS));
+    i2cdev_recoveries = 0;
+}
+
+/** Get the number of times the bus has been recovered.
+ * @return Count since startup or the last clearDeviceErrors()
+ */
+uint16_t I2Cdev::getBusRecoveries() {
+    return i2cdev_recoveries;
+}
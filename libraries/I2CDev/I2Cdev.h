@@ -64,12 +64,51 @@ THE SOFTWARE.
                                       // ^^^ NBWire implementation is still buggy w/some interrupts!
 #define I2CDEV_BUILTIN_FASTWIRE     3 // FastWire object from Francesco Ferrara's project
 #define I2CDEV_I2CMASTER_LIBRARY    4 // I2C object from DSSCircuits I2C-Master Library at https://github.com/DSSCircuits/I2C-Master-Library
+#define I2CDEV_SIMULATED            5 // device models from I2CdevSim.h (selected by I2CDEV_SIMULATOR)
 
 // -----------------------------------------------------------------------------
 // Arduino-style "Serial.print" debug constant (uncomment to enable)
 // -----------------------------------------------------------------------------
 //#define I2CDEV_SERIAL_DEBUG
 
+// -----------------------------------------------------------------------------
+// Binary bus trace (uncomment to enable)
+// -----------------------------------------------------------------------------
+// Records every transaction in a small RAM ring without touching Serial. The
+// sketch drains it with I2Cdev::traceRead() when convenient.
+//#define I2CDEV_TRACE
+
+// -----------------------------------------------------------------------------
+// SAM3X (Arduino Due) PDC backend (uncomment to enable)
+// -----------------------------------------------------------------------------
+// With the Wire implementation on a SAM3X, queued reads of 3 bytes or more are
+// moved by the TWI's peripheral DMA controller into the transaction buffer
+// instead of byte by byte through Wire. Ignored on other targets.
+//#define I2CDEV_SAM3X_PDC
+
+// -----------------------------------------------------------------------------
+// Simulated bus for host builds (uncomment or define on the compiler command line)
+// -----------------------------------------------------------------------------
+// Replaces the TWI with the register-level device models attached with
+// I2CdevSim::attach() so the drivers can be run and measured off target.
+//#define I2CDEV_SIMULATOR
+
+#ifdef I2CDEV_SIMULATOR
+    #undef I2CDEV_IMPLEMENTATION
+    #define I2CDEV_IMPLEMENTATION   I2CDEV_SIMULATED
+#endif
+
+#if defined(I2CDEV_SAM3X_PDC) && !(defined(__SAM3X8E__) && (I2CDEV_IMPLEMENTATION == I2CDEV_ARDUINO_WIRE))
+    #undef I2CDEV_SAM3X_PDC
+#endif
+
+// I2CDEV_ASYNC is defined when submitted transactions run in the background rather
+// than completing inside submit()
+
+#if (I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE) || defined(I2CDEV_SAM3X_PDC)
+    #define I2CDEV_ASYNC
+#endif
+
 #ifdef ARDUINO
     #if ARDUINO < 100
         #include "WProgram.h"
@@ -87,6 +126,129 @@ THE SOFTWARE.
 // 1000ms default read timeout (modify with "I2Cdev::readTimeout = [ms];")
 #define I2CDEV_DEFAULT_READ_TIMEOUT     1000
 
+// -----------------------------------------------------------------------------
+// Transaction time budget and error recovery
+// -----------------------------------------------------------------------------
+// Every transaction gets a time budget in microseconds. By default it is worked
+// out from the length and the device's bus clock (set "I2Cdev::timeoutMicros = [us];"
+// to use a fixed budget instead). A transaction that overruns it, or hits a bus
+// error or arbitration loss, triggers I2Cdev::recoverBus() which clocks out a stuck
+// slave, sends a STOP and re-initializes the TWI. readTimeout is still honoured as
+// an outer limit on the whole call.
+
+#define I2CDEV_DEFAULT_TIMEOUT_MICROS   0       // 0 means work it out per transaction
+#define I2CDEV_TIMEOUT_BASE_MICROS      1000    // fixed part of the automatic budget (clock stretching etc)
+#define I2CDEV_TIMEOUT_BYTE_BITS        18      // bit times allowed per byte (9 bits with 2x margin)
+
+#define I2CDEV_ERROR_NONE               0       // no error
+#define I2CDEV_ERROR_NACK               1       // address or data not acknowledged
+#define I2CDEV_ERROR_TIMEOUT            2       // transaction overran its time budget
+#define I2CDEV_ERROR_BUS                3       // arbitration lost, bus error or bus stuck
+#define I2CDEV_ERROR_LENGTH             4       // descriptor length is 0 or too long - never sent
+
+typedef struct
+{
+    uint16_t nack;                                          // NACKs from the device
+    uint16_t timeout;                                       // transactions that overran their budget
+    uint16_t busError;                                      // bus errors and arbitration loss
+    uint16_t recovered;                                     // bus recoveries triggered by this device
+} I2CDEV_ERRORS;
+
+// -----------------------------------------------------------------------------
+// Asynchronous transaction queue
+// -----------------------------------------------------------------------------
+// Transactions are submitted with I2Cdev::submit() and advanced by I2Cdev::poll().
+// With I2CDEV_BUILTIN_NBWIRE the transfer runs from the TWI interrupt, and with
+// I2CDEV_SAM3X_PDC reads are moved by the PDC, while the caller gets on with other
+// work. Otherwise each transaction completes synchronously inside submit() so the
+// same driver code runs everywhere.
+
+#define I2CDEV_QUEUE_LENGTH             4       // maximum number of outstanding transactions
+#if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_NBWIRE
+#define I2CDEV_TRANSACTION_MAX_LENGTH   32      // largest single transfer (NBWire buffer size)
+#else
+#define I2CDEV_TRANSACTION_MAX_LENGTH   127     // readBytes chunks longer reads (count is an int8_t)
+#endif
+#define I2CDEV_TRANSACTION_MAX_WRITE    31      // register address plus data must fit the Wire buffer
+
+#define I2CDEV_TRANSACTION_READ         0       // read length bytes starting at regAddr
+#define I2CDEV_TRANSACTION_WRITE        1       // write length bytes starting at regAddr
+
+#define I2CDEV_STATUS_IDLE              0       // not submitted
+#define I2CDEV_STATUS_QUEUED            1       // waiting for the bus
+#define I2CDEV_STATUS_ACTIVE            2       // transfer in progress
+#define I2CDEV_STATUS_DONE              3       // completed successfully
+#define I2CDEV_STATUS_ERROR             4       // NACK, timeout or bad descriptor
+
+// -----------------------------------------------------------------------------
+// Per-device bus clock
+// -----------------------------------------------------------------------------
+// Drivers declare the fastest clock each of their devices supports with
+// I2Cdev::setDeviceClock() and I2Cdev switches the bus clock whenever the
+// address changes. The bus limit caps everything (pull-ups, wiring, other masters).
+
+#define I2CDEV_CLOCK_STANDARD           100000L // standard mode
+#define I2CDEV_CLOCK_FAST               400000L // fast mode
+#define I2CDEV_CLOCK_FASTPLUS           1000000L // fast mode plus
+
+#define I2CDEV_MAX_DEVICES              8       // entries in the device clock table
+#define I2CDEV_DEFAULT_BUS_LIMIT        I2CDEV_CLOCK_FAST // default cap on the bus clock
+
+// -----------------------------------------------------------------------------
+// Bus trace entries
+// -----------------------------------------------------------------------------
+
+#define I2CDEV_TRACE_LENGTH             32      // entries in the trace ring
+
+#define I2CDEV_TRACE_WRITE              0x01    // register write (else read)
+#define I2CDEV_TRACE_ERROR              0x02    // NACK, timeout or short read
+#define I2CDEV_TRACE_ASYNC              0x04    // transfer ran from the TWI interrupt
+#define I2CDEV_TRACE_MARK               0x80    // sample marker from traceMark() - regAddr is the id
+
+typedef struct
+{
+    uint32_t start;                                         // micros() at the start of the transaction
+    uint16_t duration;                                      // length of the transaction in uS
+    uint8_t devAddr;                                        // I2C slave device address
+    uint8_t regAddr;                                        // first register address
+    uint8_t length;                                         // bytes transferred
+    uint8_t flags;                                          // I2CDEV_TRACE_xxx
+} I2CDEV_TRACE_ENTRY;
+
+typedef struct _I2CDEV_TRANSACTION
+{
+    uint8_t devAddr;                                        // I2C slave device address
+    uint8_t regAddr;                                        // first register address
+    uint8_t length;                                         // number of bytes to transfer
+    uint8_t type;                                           // I2CDEV_TRANSACTION_READ or WRITE
+    uint8_t *data;                                          // buffer to read into or write from
+    void (*callback)(struct _I2CDEV_TRANSACTION *);         // optional completion callback (called from poll())
+    void *context;                                          // for use by the owner of the transaction
+    volatile uint8_t status;                                // I2CDEV_STATUS_xxx
+    volatile int8_t count;                                  // bytes transferred (-1 on error)
+    volatile uint8_t error;                                 // I2CDEV_ERROR_xxx if status is I2CDEV_STATUS_ERROR
+    uint32_t startTime;                                     // micros() when the transfer started
+} I2CDEV_TRANSACTION;
+
+// -----------------------------------------------------------------------------
+// Double-buffered bursts
+// -----------------------------------------------------------------------------
+// A burst read (a FIFO chunk for example) goes into one buffer while the sketch
+// works on the other. When a burst completes the buffers swap, unless the sketch
+// is still holding the other one, in which case the new burst is dropped. The
+// handoff is the same whichever implementation moves the data.
+
+typedef struct
+{
+    uint8_t *buffer[2];                                     // the two sample areas
+    uint8_t length;                                         // bytes per burst
+    volatile uint8_t fill;                                  // index of the buffer the bus writes
+    volatile bool ready;                                    // the other buffer has an untaken burst
+    volatile bool held;                                     // the sketch is using the other buffer
+    volatile uint16_t overruns;                             // bursts dropped or never taken
+    I2CDEV_TRANSACTION transaction;                         // the burst transfer
+} I2CDEV_DOUBLE_BUFFER;
+
 class I2Cdev {
     public:
         I2Cdev();
@@ -109,7 +271,38 @@ class I2Cdev {
         static bool writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
+        static bool submitRead(I2CDEV_TRANSACTION *transaction, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+        static bool submitWrite(I2CDEV_TRANSACTION *transaction, uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+        static bool submit(I2CDEV_TRANSACTION *transaction);
+        static void poll();
+        static bool idle();
+        static bool flush(uint16_t timeout=I2Cdev::readTimeout);
+
+        static void initDoubleBuffer(I2CDEV_DOUBLE_BUFFER *burst, uint8_t *buffer0, uint8_t *buffer1, uint8_t length);
+        static bool submitBurst(I2CDEV_DOUBLE_BUFFER *burst, uint8_t devAddr, uint8_t regAddr);
+        static uint8_t *takeBurst(I2CDEV_DOUBLE_BUFFER *burst);
+        static void releaseBurst(I2CDEV_DOUBLE_BUFFER *burst);
+
+        static bool pending(I2CDEV_TRANSACTION *transaction) {
+            return (transaction->status == I2CDEV_STATUS_QUEUED) || (transaction->status == I2CDEV_STATUS_ACTIVE); }
+
+        static bool setDeviceClock(uint8_t devAddr, uint32_t maxClock);
+        static uint32_t getDeviceClock(uint8_t devAddr);
+        static void setBusClockLimit(uint32_t maxClock);
+
+        static bool recoverBus();
+        static bool getDeviceErrors(uint8_t devAddr, I2CDEV_ERRORS *errors);
+        static void clearDeviceErrors();
+        static uint16_t getBusRecoveries();
+
+#ifdef I2CDEV_TRACE
+        static void traceMark(uint8_t id);
+        static uint8_t traceRead(I2CDEV_TRACE_ENTRY *entries, uint8_t maxEntries);
+        static uint16_t traceLost();
+#endif
+
         static uint16_t readTimeout;
+        static uint16_t timeoutMicros;
 };
 
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
@@ -0,0 +1,195 @@
+// I2Cdev library collection - Simulated I2C bus
+// Register-level device models that stand in for real hardware on host builds
+//
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#include "I2CdevSim.h"
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED
+
+/** Create a device with an empty register file.
+ * @param devAddr I2C slave device address the device answers to
+ */
+I2CdevSimDevice::I2CdevSimDevice(uint8_t devAddr) {
+    this->devAddr = devAddr;
+    transactions = 0;
+    bytes = 0;
+    next = 0;
+    pointer = 0;
+    memset(registers, 0, sizeof(registers));
+}
+
+/** Start a transaction - the first byte after the address sets the register pointer.
+ * @param regAddr Register address (or command) byte from the master
+ */
+void I2CdevSimDevice::start(uint8_t regAddr) {
+    pointer = regAddr;
+}
+
+/** Read the current register and advance the pointer.
+ * @return Register contents
+ */
+uint8_t I2CdevSimDevice::read() {
+    uint8_t data = readRegister(pointer);
+    pointer = nextRegister(pointer);
+    return data;
+}
+
+/** Write the current register and advance the pointer.
+ * @param data Byte from the master
+ */
+void I2CdevSimDevice::write(uint8_t data) {
+    writeRegister(pointer, data);
+    pointer = nextRegister(pointer);
+}
+
+/** Put a device on the simulated bus.
+ * @param device Device to attach (must stay valid until detached)
+ * @return Status of operation (false = address already in use)
+ */
+bool I2CdevSim::attach(I2CdevSimDevice *device) {
+    if (find(device->devAddr) != 0)
+        return false;
+    device->next = devices;
+    devices = device;
+    return true;
+}
+
+/** Take a device off the simulated bus.
+ * @param device Device to detach
+ */
+void I2CdevSim::detach(I2CdevSimDevice *device) {
+    for (I2CdevSimDevice **link = &devices; *link != 0; link = &(*link)->next) {
+        if (*link == device) {
+            *link = device->next;
+            device->next = 0;
+            return;
+        }
+    }
+}
+
+/** Find the device at an address.
+ * @param devAddr I2C slave device address
+ * @return Device, or 0 if nothing is attached there
+ */
+I2CdevSimDevice *I2CdevSim::find(uint8_t devAddr) {
+    for (I2CdevSimDevice *device = devices; device != 0; device = device->next) {
+        if (device->devAddr == devAddr)
+            return device;
+    }
+    return 0;
+}
+
+/** Zero the bus counters and those of every attached device.
+ */
+void I2CdevSim::clearCounters() {
+    transactions = 0;
+    bytes = 0;
+    busMicros = 0;
+    for (I2CdevSimDevice *device = devices; device != 0; device = device->next) {
+        device->transactions = 0;
+        device->bytes = 0;
+    }
+}
+
+/** Run a register read against the simulated bus.
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address (or command) to read from
+ * @param length Number of bytes to read
+ * @param data Buffer to store read data in
+ * @param clock Bus clock in kHz (for the bus time)
+ * @return Number of bytes read (-1 if the address was not acknowledged)
+ */
+int8_t I2CdevSim::read(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t clock) {
+    I2CdevSimDevice *device = find(devAddr);
+
+    transactions++;
+    if (device != 0)
+        device->update(micros());
+    if ((device == 0) || !device->present()) {
+        busTime(1, clock);                                  // the address byte is NACKed
+        return -1;
+    }
+    device->transactions++;
+    device->start(regAddr);
+    for (uint8_t i = 0; i < length; i++)
+        data[i] = device->read();
+    device->stop();
+    device->bytes += length;
+    bytes += length;
+    busTime(length + 3, clock);                             // address, register, repeated start address
+    return length;
+}
+
+/** Run a register write against the simulated bus.
+ * @param devAddr I2C slave device address
+ * @param regAddr First register address (or command) to write to
+ * @param length Number of bytes to write (0 for a bare command)
+ * @param data Buffer to copy new data from
+ * @param clock Bus clock in kHz (for the bus time)
+ * @return Status of operation (true = success)
+ */
+bool I2CdevSim::write(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t clock) {
+    I2CdevSimDevice *device = find(devAddr);
+
+    transactions++;
+    if (device != 0)
+        device->update(micros());
+    if ((device == 0) || !device->present()) {
+        busTime(1, clock);
+        return false;
+    }
+    device->transactions++;
+    device->start(regAddr);
+    for (uint8_t i = 0; i < length; i++)
+        device->write(data[i]);
+    device->stop();
+    device->bytes += length;
+    bytes += length;
+    busTime(length + 2, clock);                             // address, register
+    return true;
+}
+
+// Accounts for the bus time of a transaction - 9 bit times per byte plus START and STOP.
+
+uint32_t I2CdevSim::busTime(uint16_t count, uint16_t clock) {
+    uint32_t time;
+
+    if (clock == 0)
+        clock = I2CDEV_CLOCK_STANDARD / 1000;
+    time = ((uint32_t)count * 9 + I2CDEVSIM_START_STOP_BITS) * 1000L / clock;
+    busMicros += time;
+    if (advance != 0)
+        advance(time);
+    return time;
+}
+
+uint32_t I2CdevSim::transactions = 0;
+uint32_t I2CdevSim::bytes = 0;
+uint32_t I2CdevSim::busMicros = 0;
+void (*I2CdevSim::advance)(uint32_t micros) = 0;
+I2CdevSimDevice *I2CdevSim::devices = 0;
+
+#endif // I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED
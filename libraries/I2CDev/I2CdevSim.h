@@ -0,0 +1,100 @@
+// I2Cdev library collection - Simulated I2C bus header file
+// Register-level device models that stand in for real hardware on host builds
+//
+/* ============================================
+I2Cdev device library code is placed under the MIT license
+Copyright (c) 2013 Jeff Rowberg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+===============================================
+*/
+
+#ifndef _I2CDEVSIM_H_
+#define _I2CDEVSIM_H_
+
+#include "I2Cdev.h"
+
+// With I2CDEV_SIMULATOR defined I2Cdev sends every transaction to the device model
+// attached at the address instead of the TWI. A model sees the same address,
+// register (or command) byte and data bytes as the real part, in the same order,
+// so drivers run unchanged and the counters below are exact. Time comes from
+// micros(); the modelled bus time of each transaction is passed to
+// I2CdevSim::advance (if set) so a host clock can account for it.
+
+#if I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED
+
+#define I2CDEVSIM_REGISTERS             256     // size of the default register file
+#define I2CDEVSIM_START_STOP_BITS       2       // bit times for the START and STOP conditions
+
+// A device on the simulated bus. The default behaviour is a register file with an
+// auto-incrementing pointer set by the first byte of each transaction. Models
+// override the register hooks for registers with side effects, or the transaction
+// hooks for devices that take commands rather than register addresses.
+
+class I2CdevSimDevice {
+    public:
+        I2CdevSimDevice(uint8_t devAddr);
+        virtual ~I2CdevSimDevice() {}
+
+        // transaction hooks (called by I2CdevSim)
+        virtual bool present() { return true; }             // false to NACK the address
+        virtual void update(uint32_t now) {}                // bring the model up to date before a transaction
+        virtual void start(uint8_t regAddr);                // register address (or command) byte
+        virtual uint8_t read();                             // next byte to the master
+        virtual void write(uint8_t data);                   // next byte from the master
+        virtual void stop() {}                              // end of the transaction
+
+        uint8_t devAddr;                                    // I2C slave device address
+        uint32_t transactions;                              // transactions addressed to this device
+        uint32_t bytes;                                     // data bytes transferred (not address bytes)
+        I2CdevSimDevice *next;                              // next device on the bus
+
+    protected:
+        // register hooks (called by the default transaction hooks)
+        virtual uint8_t readRegister(uint8_t regAddr) { return registers[regAddr]; }
+        virtual void writeRegister(uint8_t regAddr, uint8_t data) { registers[regAddr] = data; }
+        virtual uint8_t nextRegister(uint8_t regAddr) { return regAddr + 1; }
+
+        uint8_t registers[I2CDEVSIM_REGISTERS];
+        uint8_t pointer;                                    // current register
+};
+
+class I2CdevSim {
+    public:
+        static bool attach(I2CdevSimDevice *device);
+        static void detach(I2CdevSimDevice *device);
+        static I2CdevSimDevice *find(uint8_t devAddr);
+        static void clearCounters();
+
+        static int8_t read(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t clock);
+        static bool write(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t clock);
+
+        static uint32_t transactions;                       // transactions on the bus (including NACKs)
+        static uint32_t bytes;                              // data bytes transferred
+        static uint32_t busMicros;                          // modelled time the bus was busy
+        static void (*advance)(uint32_t micros);            // optional - told the bus time of each transaction
+
+    private:
+        static uint32_t busTime(uint16_t count, uint16_t clock);
+        static I2CdevSimDevice *devices;
+};
+
+#endif // I2CDEV_IMPLEMENTATION == I2CDEV_SIMULATED
+
+#endif /* _I2CDEVSIM_H_ */
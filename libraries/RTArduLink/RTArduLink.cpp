@@ -45,6 +45,7 @@ RTArduLink::~RTArduLink()
 void RTArduLink::begin(const char *identitySuffix)
 {
     RTARDULINK_PORT *portInfo;
+    int queueCount;
 
     if (!RTArduLinkHALEEPROMValid())
         RTArduLinkHALEEPROMDefault();
@@ -53,13 +54,34 @@ void RTArduLink::begin(const char *identitySuffix)
 
     // now set up host and subsystem ports based on EEPROM configuration
 
+    queueCount = 0;
     for (int i = 0; i < RTARDULINKHAL_MAX_PORTS; i++) {
         portInfo = m_ports + i;
         portInfo->index = i;
         portInfo->inUse = RTArduLinkHALConfigurePort(&(portInfo->portHAL), i);
+        if (portInfo->inUse && (queueCount == RTARDULINKHAL_HARDWARE_PORTS))
+            portInfo->inUse = false;                        // more ports configured than the board has
+
         RTArduLinkRXFrameInit(&(portInfo->RXFrame), &(portInfo->RXFrameBuffer));
+        if (portInfo->inUse) {
+            RTArduLinkTXQueueInit(portInfo->TXQueue + RTARDULINK_TXPRIORITY_HIGH, m_TXHighBuffer[queueCount], RTARDULINK_TXQUEUE_HIGH_LEN);
+            RTArduLinkTXQueueInit(portInfo->TXQueue + RTARDULINK_TXPRIORITY_LOW, m_TXLowBuffer[queueCount], RTARDULINK_TXQUEUE_LOW_LEN);
+            queueCount++;
+        } else {
+            RTArduLinkTXQueueInit(portInfo->TXQueue + RTARDULINK_TXPRIORITY_HIGH, NULL, 0);   // anything sent is dropped
+            RTArduLinkTXQueueInit(portInfo->TXQueue + RTARDULINK_TXPRIORITY_LOW, NULL, 0);
+        }
+        portInfo->TXActive = -1;
+        portInfo->speed = RTArduLinkHALConfig.portSpeed[i];
+        portInfo->cutThroughTo = -1;
+        portInfo->cutThroughActive = false;
     }
     m_hostPort = m_ports;
+    buildRoutes();
+
+    m_flowControl = false;
+    m_TXCount = 0;
+    m_TXCreditLimit = 0;
 }
 
 
@@ -67,19 +89,50 @@ void RTArduLink::background()
 {
     unsigned char index;
     RTARDULINK_PORT *portInfo;
+    RTARDULINK_PORT *cutThroughPort;
+    unsigned char data;
+    bool ok;
 
     for (index = 0; index < RTARDULINKHAL_MAX_PORTS; index++) {
         portInfo = m_ports + index;
         if (!portInfo->inUse)
             continue;
 
+        transmit(portInfo);
+
+        if ((portInfo->cutThroughTo >= 0) &&
+                ((RTArduLinkHALMillis() - portInfo->cutThroughTime) >= RTARDULINK_CUTTHROUGH_TIMEOUT)) {
+            endCutThrough(portInfo);                        // source has stalled - give up on this frame
+            RTArduLinkRXFrameInit(&(portInfo->RXFrame), &(portInfo->RXFrameBuffer));
+        }
+
         while (RTArduLinkHALPortAvailable(&(portInfo->portHAL))) {
-            if (!RTArduLinkReassemble(&(portInfo->RXFrame), RTArduLinkHALPortRead(&(portInfo->portHAL)))) {
+            data = RTArduLinkHALPortRead(&(portInfo->portHAL));
+            ok = RTArduLinkReassemble(&(portInfo->RXFrame), data);
+
+            if (portInfo->cutThroughTo >= 0) {
+                //  frame is being cut through so pass this byte straight on
+
+                cutThroughPort = m_ports + portInfo->cutThroughTo;
+                RTArduLinkHALPortWrite(&(cutThroughPort->portHAL), &data, 1);
+                portInfo->cutThroughTime = RTArduLinkHALMillis();
+                if (!ok || portInfo->RXFrame.complete) {
+                    endCutThrough(portInfo);
+                    RTArduLinkRXFrameInit(&(portInfo->RXFrame), &(portInfo->RXFrameBuffer));
+                }
+                if (!ok)
+                    sendDebugMessage("Reassembly error");
+                continue;
+            }
+
+            if (!ok) {
                 sendDebugMessage("Reassembly error");
             } else {
                 if (portInfo->RXFrame.complete) {
                     processReceivedMessage(portInfo);
                     RTArduLinkRXFrameInit(&(portInfo->RXFrame), &(portInfo->RXFrameBuffer));
+                } else if (portInfo->RXFrame.length == (RTARDULINK_FRAME_HEADER_LEN + sizeof(RTARDULINK_UC2))) {
+                    startCutThrough(portInfo);              // have the address so see if the frame can be passed straight on
                 }
             }
         }
@@ -91,27 +144,17 @@ void RTArduLink::processReceivedMessage(RTARDULINK_PORT *portInfo)
     RTARDULINK_MESSAGE *message;                            // a pointer to the message part of the frame
     unsigned int address;
 
-    message = &(portInfo->RXFrameBuffer.message);           // get the message pointer
-    address = RTArduLinkConvertUC2ToUInt(message->messageAddress);
-
-    switch (portInfo->index) {
-        case  RTARDULINK_HOST_PORT:
-            processHostMessage();                           // came from this upstream link
-            return;
-
-        case RTARDULINK_DAISY_PORT:                         // came from dasiy chain port
-            if (address != RTARDULINK_HOST_PORT)            // true if it came from a daisy chained subsystem, not a directly connected subsystem
-                RTArduLinkConvertIntToUC2(address + RTARDULINKHAL_MAX_PORTS, message->messageAddress);
-             else
-                RTArduLinkConvertIntToUC2(RTARDULINK_DAISY_PORT, message->messageAddress);
-            break;
-
-        default:
-            RTArduLinkConvertIntToUC2(address + portInfo->index, message->messageAddress);
-            break;
+    if (portInfo->index == RTARDULINK_HOST_PORT) {
+        processHostMessage();                               // came from this upstream link
+        return;
     }
 
-    // if get here, need to forward to host port
+    //  came from a subsystem so it goes to the host with the address mapped into the host's address space
+
+    message = &(portInfo->RXFrameBuffer.message);           // get the message pointer
+    if (!routeUpstream(portInfo, RTArduLinkConvertUC2ToUInt(message->messageAddress), &address))
+        return;                                             // no route for this address
+    RTArduLinkConvertIntToUC2(address, message->messageAddress);
 
     sendFrame(m_hostPort, &(portInfo->RXFrameBuffer), portInfo->RXFrameBuffer.messageLength);
 }
@@ -120,10 +163,15 @@ void RTArduLink::processReceivedMessage(RTARDULINK_PORT *portInfo)
 void RTArduLink::processHostMessage()
 {
     RTARDULINK_MESSAGE *message;                            // a pointer to the message part of the frame
+    RTARDULINK_PORT *portInfo;
+    RTARDULINK_TIMESYNC *timeSync;
+    RTARDULINK_FLOWCONTROL *flowControl;
+    unsigned long receiveTime;
     int identityLength;
     int suffixLength;
     unsigned int address;
 
+    receiveTime = RTArduLinkHALMicros();                    // as early as possible for RTARDULINK_MESSAGE_TIMESYNC
     message = &(m_hostPort->RXFrameBuffer.message);         // get the message pointer
     address = RTArduLinkConvertUC2ToUInt(message->messageAddress);
 
@@ -142,6 +190,36 @@ void RTArduLink::processHostMessage()
                 sendFrame(m_hostPort, &(m_hostPort->RXFrameBuffer), m_hostPort->RXFrameBuffer.messageLength);   // just send the frame back as received
                 break;
 
+            case RTARDULINK_MESSAGE_TIMESYNC:
+                timeSync = (RTARDULINK_TIMESYNC *)(message->data);
+                RTArduLinkConvertLongToUC4(receiveTime, timeSync->receiveTime);
+                RTArduLinkConvertIntToUC2(RTARDULINK_MY_ADDRESS, message->messageAddress);
+                // the send times are filled in by stampTimeSync() when the response goes out
+                sendFrame(m_hostPort, &(m_hostPort->RXFrameBuffer), RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINK_TIMESYNC));
+                break;
+
+            case RTARDULINK_MESSAGE_FLOWCONTROL:
+                flowControl = (RTARDULINK_FLOWCONTROL *)(message->data);
+                switch (message->messageParam) {
+                    case RTARDULINK_FLOWCONTROL_LIMIT:
+                        m_flowControl = true;
+                        m_TXCreditLimit = RTArduLinkConvertUC4ToLong(flowControl->count);
+                        break;
+
+                    case RTARDULINK_FLOWCONTROL_RELATIVE:
+                        m_flowControl = true;
+                        m_TXCreditLimit = m_TXCount + RTArduLinkConvertUC4ToLong(flowControl->count);
+                        break;
+
+                    default:
+                        m_flowControl = false;
+                        break;
+                }
+                RTArduLinkConvertLongToUC4(m_TXCount, flowControl->count);
+                RTArduLinkConvertIntToUC2(RTARDULINK_MY_ADDRESS, message->messageAddress);
+                sendFrame(m_hostPort, &(m_hostPort->RXFrameBuffer), RTARDULINK_MESSAGE_HEADER_LEN + sizeof(RTARDULINK_FLOWCONTROL));
+                break;
+
             case RTARDULINK_MESSAGE_IDENTITY:
                 identityLength = strlen(RTArduLinkHALConfig.identity);
                 suffixLength = strlen(m_identitySuffix);
@@ -174,20 +252,147 @@ void RTArduLink::processHostMessage()
         return;
     }
 
-    if (address >= RTARDULINKHAL_MAX_PORTS) {               // need to pass it to the first subsystem
-        if (!m_ports[RTARDULINK_DAISY_PORT].inUse)
-            return;                                         // there is no daisy chain port
-        RTArduLinkConvertIntToUC2(address - RTARDULINKHAL_MAX_PORTS, message->messageAddress); // adjust the address
-        sendFrame(m_ports +RTARDULINK_DAISY_PORT, &(m_hostPort->RXFrameBuffer), m_hostPort->RXFrameBuffer.messageLength);
+    // if get here, needs to go to a subsystem
+
+    if (!routeDownstream(address, &portInfo, &address))
+        return;                                             // nothing at this address
+    RTArduLinkConvertIntToUC2(address, message->messageAddress);   // adjust the address
+    sendFrame(portInfo, &(m_hostPort->RXFrameBuffer), m_hostPort->RXFrameBuffer.messageLength);
+}
+
+void RTArduLink::buildRoutes()
+{
+    RTARDULINK_ROUTE *route;
+
+    m_routeCount = 0;
+
+    //  each directly connected subsystem has the address of its port
+
+    for (int i = RTARDULINK_HOST_PORT + 1; i < RTARDULINKHAL_MAX_PORTS; i++) {
+        if (!m_ports[i].inUse)
+            continue;
+        route = m_routes + m_routeCount++;
+        route->firstAddress = i;
+        route->lastAddress = i;
+        route->remoteAddress = RTARDULINK_MY_ADDRESS;
+        route->port = m_ports + i;
+    }
+
+    //  everything else goes down the daisy chain
+
+    if (m_ports[RTARDULINK_DAISY_PORT].inUse) {
+        route = m_routes + m_routeCount++;
+        route->firstAddress = RTARDULINKHAL_MAX_PORTS;
+        route->lastAddress = RTARDULINK_BROADCAST_ADDRESS - 1;
+        route->remoteAddress = RTARDULINK_MY_ADDRESS;
+        route->port = m_ports + RTARDULINK_DAISY_PORT;
+    }
+}
+
+bool RTArduLink::routeDownstream(unsigned int address, RTARDULINK_PORT **port, unsigned int *remoteAddress)
+{
+    RTARDULINK_ROUTE *route;
+
+    for (int i = 0; i < m_routeCount; i++) {
+        route = m_routes + i;
+        if ((address >= route->firstAddress) && (address <= route->lastAddress)) {
+            *port = route->port;
+            *remoteAddress = address - route->firstAddress + route->remoteAddress;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RTArduLink::routeUpstream(RTARDULINK_PORT *portInfo, unsigned int remoteAddress, unsigned int *address)
+{
+    RTARDULINK_ROUTE *route;
+
+    for (int i = 0; i < m_routeCount; i++) {
+        route = m_routes + i;
+        if ((route->port == portInfo) && (remoteAddress >= route->remoteAddress) &&
+                ((remoteAddress - route->remoteAddress) <= (route->lastAddress - route->firstAddress))) {
+            *address = remoteAddress - route->remoteAddress + route->firstAddress;
+            return true;
+        }
+    }
+    return false;
+}
+
+void RTArduLink::startCutThrough(RTARDULINK_PORT *portInfo)
+{
+    RTARDULINK_FRAME *frame;
+    RTARDULINK_PORT *destPort;
+    unsigned int address;
+    unsigned char oldSum;
+
+    frame = &(portInfo->RXFrameBuffer);
+    address = RTArduLinkConvertUC2ToUInt(frame->message.messageAddress);
+
+    if (portInfo->index == RTARDULINK_HOST_PORT) {
+        if ((address == RTARDULINK_MY_ADDRESS) || (address == RTARDULINK_BROADCAST_ADDRESS))
+            return;                                         // needs local processing
+        if (!routeDownstream(address, &destPort, &address))
+            return;
+    } else {
+        if (!routeUpstream(portInfo, address, &address))
+            return;
+        destPort = m_hostPort;
+    }
+
+    //  only cut through if the destination can keep up and isn't busy with anything else
+
+    if (destPort->speed < portInfo->speed)
+        return;
+    if (destPort->cutThroughActive || (destPort->TXActive >= 0))
         return;
+    for (int i = 0; i < RTARDULINK_TXPRIORITY_COUNT; i++) {
+        if (destPort->TXQueue[i].count > 0)
+            return;
     }
+    if (RTArduLinkHALPortTXSpace(&(destPort->portHAL)) < (frame->messageLength + RTARDULINK_FRAME_HEADER_LEN))
+        return;                                             // the whole frame must fit so that forwarding never blocks
+
+    //  rewrite the address and fix up the checksum for the change
+
+    oldSum = frame->message.messageAddress[0] + frame->message.messageAddress[1];
+    RTArduLinkConvertIntToUC2(address, frame->message.messageAddress);
+    frame->frameChecksum += oldSum - (unsigned char)(frame->message.messageAddress[0] + frame->message.messageAddress[1]);
 
-    // if get here, needs to go to a local subsystem port
+    RTArduLinkHALPortWrite(&(destPort->portHAL), (unsigned char *)frame, portInfo->RXFrame.length);
+    portInfo->cutThroughTo = destPort->index;
+    portInfo->cutThroughTime = RTArduLinkHALMillis();
+    destPort->cutThroughActive = true;                      // hold off anything queued for the destination
+}
 
-    if (m_ports[address].inUse) {
-        RTArduLinkConvertIntToUC2(0, message->messageAddress);     // indicates that the target should process it
-        sendFrame(m_ports + address, &(m_hostPort->RXFrameBuffer), m_hostPort->RXFrameBuffer.messageLength);
+void RTArduLink::endCutThrough(RTARDULINK_PORT *portInfo)
+{
+    RTARDULINK_PORT *destPort;
+    unsigned char *data;
+    unsigned char sum;
+    unsigned char pad;
+
+    destPort = m_ports + portInfo->cutThroughTo;
+
+    //  if the frame was abandoned part way through, finish it off with bytes that make sure its checksum
+    //  fails so that the far end discards it and is in sync for the next frame. There's room for them as
+    //  startCutThrough() made sure that the whole frame would fit.
+
+    if (portInfo->RXFrame.bytesLeft > 0) {
+        sum = 0;
+        data = &(portInfo->RXFrameBuffer.frameChecksum);
+        for (int i = 3; i < portInfo->RXFrame.length; i++)
+            sum += *data++;
+        pad = 0;
+        for (int i = 1; i < portInfo->RXFrame.bytesLeft; i++)
+            RTArduLinkHALPortWrite(&(destPort->portHAL), &pad, 1);
+        pad = 1 - sum;                                      // the checksummed bytes add up to 1, not 0
+        RTArduLinkHALPortWrite(&(destPort->portHAL), &pad, 1);
     }
+
+    destPort->cutThroughActive = false;
+    portInfo->cutThroughTo = -1;
+    transmit(destPort);                                     // restart anything that was held off
 }
 
 void RTArduLink::sendDebugMessage(const char *debugMessage)
@@ -218,14 +423,110 @@ void RTArduLink::sendMessage(unsigned char messageType, unsigned char messagePar
     memcpy(frame.message.data, data, length);
 
     sendFrame(m_hostPort, &frame, length + RTARDULINK_MESSAGE_HEADER_LEN);
+    m_TXCount++;
+}
+
+bool RTArduLink::canSendMessage(int length)
+{
+    RTARDULINK_TXQUEUE *queue;
+
+    if (m_flowControl && ((long)(m_TXCreditLimit - m_TXCount) <= 0))
+        return false;                                       // host hasn't given permission
+
+    //  make sure it can be queued without throwing away something that hasn't been sent yet
+
+    queue = m_hostPort->TXQueue + RTARDULINK_TXPRIORITY_HIGH;
+    return (queue->size - queue->count) >= (length + RTARDULINK_MESSAGE_HEADER_LEN + RTARDULINK_FRAME_HEADER_LEN);
 }
 
 void RTArduLink::sendFrame(RTARDULINK_PORT *portInfo, RTARDULINK_FRAME *frame, int length)
 {
+    int priority;
+
     frame->sync0 = RTARDULINK_MESSAGE_SYNC0;
     frame->sync1 = RTARDULINK_MESSAGE_SYNC1;
     frame->messageLength = length;                          // set length
     RTArduLinkSetChecksum(frame);                           // compute checksum
-    RTArduLinkHALPortWrite(&(portInfo->portHAL), (unsigned char *)frame, frame->messageLength + RTARDULINK_FRAME_HEADER_LEN);
+
+    if ((frame->message.messageType == RTARDULINK_MESSAGE_DEBUG) || (frame->message.messageType == RTARDULINK_MESSAGE_INFO))
+        priority = RTARDULINK_TXPRIORITY_LOW;
+    else
+        priority = RTARDULINK_TXPRIORITY_HIGH;
+
+    RTArduLinkTXQueuePut(portInfo->TXQueue + priority, frame);
+    transmit(portInfo);                                     // get it going if there's room
 }
 
+void RTArduLink::transmit(RTARDULINK_PORT *portInfo)
+{
+    RTARDULINK_TXQUEUE *queue;
+    int space;
+    int length;
+
+    if (!portInfo->inUse || portInfo->cutThroughActive)
+        return;
+
+    space = RTArduLinkHALPortTXSpace(&(portInfo->portHAL));
+
+    while (space > 0) {
+        if (portInfo->TXActive < 0) {
+            //  not in the middle of a frame so pick the highest priority class with something waiting
+
+            for (int i = 0; i < RTARDULINK_TXPRIORITY_COUNT; i++) {
+                if (portInfo->TXQueue[i].count > 0) {
+                    portInfo->TXActive = i;
+                    break;
+                }
+            }
+            if (portInfo->TXActive < 0)
+                return;                                     // nothing to send
+            queue = portInfo->TXQueue + portInfo->TXActive;
+            if (portInfo == m_hostPort)
+                stampTimeSync(queue);
+            queue->frameLeft = RTArduLinkTXQueueHeadLength(queue);
+        } else {
+            queue = portInfo->TXQueue + portInfo->TXActive;
+        }
+
+        //  send as much of the frame as possible, limited by the space and the end of the ring
+
+        length = queue->frameLeft;
+        if (length > space)
+            length = space;
+        if (length > (queue->size - queue->head))
+            length = queue->size - queue->head;
+
+        RTArduLinkHALPortWrite(&(portInfo->portHAL), queue->buffer + queue->head, length);
+
+        queue->head += length;
+        if (queue->head == queue->size)
+            queue->head = 0;
+        queue->count -= length;
+        queue->frameLeft -= length;
+        space -= length;
+
+        if (queue->frameLeft == 0)
+            portInfo->TXActive = -1;                        // frame complete
+    }
+}
+
+//  stampTimeSync sets the send times in a RTARDULINK_MESSAGE_TIMESYNC response from this subsystem
+//  as it starts to be written to the port. Stamping it when it was queued would count the time spent
+//  behind other frames as link delay in one direction only, which skews the host's offset estimate.
+
+void RTArduLink::stampTimeSync(RTARDULINK_TXQUEUE *queue)
+{
+    RTARDULINK_FRAME frame;
+    RTARDULINK_TIMESYNC *timeSync;
+
+    RTArduLinkTXQueueHeadRead(queue, 0, (unsigned char *)&frame, RTARDULINK_FRAME_HEADER_LEN + RTARDULINK_MESSAGE_HEADER_LEN);
+    if ((frame.message.messageType != RTARDULINK_MESSAGE_TIMESYNC) ||
+            (RTArduLinkConvertUC2ToUInt(frame.message.messageAddress) != RTARDULINK_MY_ADDRESS))
+        return;                                             // not a response from here (could be passing through from a subsystem)
+
+    timeSync = (RTARDULINK_TIMESYNC *)(frame.message.data);
+    RTArduLinkConvertLongToUC4(RTArduLinkHALMicros(), timeSync->sendTime);
+    RTArduLinkConvertLongToUC4(RTArduLinkHALMillis(), timeSync->sendTimeMillis);
+    RTArduLinkTXQueueHeadWrite(queue, (int)(timeSync->sendTime - (unsigned char *)&frame),
+            timeSync->sendTime, sizeof(RTARDULINK_UC4) * 2);
+}
@@ -37,15 +37,70 @@
 #define	RTARDULINK_HOST_PORT                0               // host port is always 0
 #define	RTARDULINK_DAISY_PORT               1               // daisy chain port is always 1
 
+//  Transmit priority classes. Frames are queued per port and per class and written to the
+//  hardware from background() only as fast as the port can accept them. A waiting high priority
+//  frame is always sent before a waiting low priority frame. If a queue is full, its oldest
+//  frames are discarded so that the most recent data is what gets sent.
+
+#define RTARDULINK_TXPRIORITY_HIGH          0               // data and protocol responses
+#define RTARDULINK_TXPRIORITY_LOW           1               // debug and info messages
+#define RTARDULINK_TXPRIORITY_COUNT         2               // number of priority classes
+
+//  Transmit queue sizes in bytes. Each must be at least the length of the longest frame
+//  that will be sent in that class. The high priority default holds two IMU frames. Storage
+//  is only allocated for RTARDULINKHAL_HARDWARE_PORTS ports and handed to the ports in use.
+
+#define RTARDULINK_TXQUEUE_HIGH_LEN         96              // high priority queue size per port
+#define RTARDULINK_TXQUEUE_LOW_LEN          RTARDULINK_FRAME_MAX_LEN    // low priority queue size per port
+
 typedef struct
 {
     int index;                                              // port index
     bool inUse;                                             // true if in use
     RTARDULINK_RXFRAME RXFrame;                             // structure to maintain receive frame state
     RTARDULINK_FRAME RXFrameBuffer;                         // used to assemble received frames
+    RTARDULINK_TXQUEUE TXQueue[RTARDULINK_TXPRIORITY_COUNT];    // the transmit queues, one per priority class
+    int TXActive;                                           // priority class of the frame being sent or -1 if none
+    unsigned char speed;                                    // port speed code
+    int cutThroughTo;                                       // index of port the frame being received is cut through to or -1
+    bool cutThroughActive;                                  // true while another port is cutting a frame through to this one
+    unsigned long cutThroughTime;                           // time in mS that the last cut through byte was received
     RTARDULINKHAL_PORT portHAL;                             // the actual hardware port interface
 } RTARDULINK_PORT;
 
+//  Routing. The routing table is built by begin() from the ports that are in use. Each entry maps
+//  a range of addresses as seen from the host port onto a subsystem port and the addresses used on
+//  that port. Messages from the host are routed by finding the entry that covers the address. Messages
+//  from a subsystem are routed to the host by finding the first entry for the port that covers the address.
+//
+//  With the standard configuration, address n (1 to 3) is the subsystem on port n and addresses from
+//  RTARDULINKHAL_MAX_PORTS upwards are passed down the daisy chain with RTARDULINKHAL_MAX_PORTS subtracted.
+
+#define RTARDULINK_MAX_ROUTES               (RTARDULINKHAL_MAX_SUBSYSTEM_PORTS + 1) // one per port plus the daisy chain
+
+typedef struct
+{
+    unsigned int firstAddress;                              // first host side address covered by this route
+    unsigned int lastAddress;                               // last host side address covered by this route
+    unsigned int remoteAddress;                             // address on the port that corresponds to firstAddress
+    RTARDULINK_PORT *port;                                  // the port that the addresses are reached through
+} RTARDULINK_ROUTE;
+
+//  Cut through forwarding. Frames that are just passing through are normally forwarded as soon as the
+//  frame header and address have arrived rather than after the whole frame has been received. The address
+//  is rewritten and the checksum adjusted to match, so a corrupted frame still fails its checksum at the
+//  far end. This is only done if the destination port is at least as fast as the source, has nothing
+//  else to send and has room in its hardware transmit buffer for the whole frame, so forwarding a byte
+//  never blocks. Otherwise the frame is queued as normal when complete. Broadcasts and messages for this
+//  subsystem are never cut through.
+//
+//  If the source stops sending in the middle of a frame for RTARDULINK_CUTTHROUGH_TIMEOUT mS, the cut
+//  through is abandoned so that the destination port can carry on with other traffic. The part of the
+//  frame already sent is padded out to its full length with bytes that make its checksum fail, so the
+//  far end discards it rather than losing sync. The frame is lost either way.
+
+#define RTARDULINK_CUTTHROUGH_TIMEOUT       100             // mS of silence before a cut through is abandoned
+
 class RTArduLink
 {
 public:
@@ -57,6 +112,7 @@ public:
     void sendDebugMessage(const char *debugMesssage);       // sends a debug message to the host port
     void sendMessage(unsigned char messageType, unsigned char messageParam,
         unsigned char *data, int length);                   // sends a message to the host port
+    bool canSendMessage(int length);                        // true if a message with length bytes of data can be sent now
 
 protected:
 //  These are functions that can be overridden
@@ -65,16 +121,31 @@ protected:
         unsigned char messageParam, unsigned char *data, int dataLength) {}
 
     RTARDULINK_PORT m_ports[RTARDULINKHAL_MAX_PORTS];       // port array
+    unsigned char m_TXHighBuffer[RTARDULINKHAL_HARDWARE_PORTS][RTARDULINK_TXQUEUE_HIGH_LEN]; // high priority queue storage for the ports in use
+    unsigned char m_TXLowBuffer[RTARDULINKHAL_HARDWARE_PORTS][RTARDULINK_TXQUEUE_LOW_LEN];   // low priority queue storage for the ports in use
     RTARDULINK_PORT *m_hostPort;                            // a link to the entry for the host port
+    RTARDULINK_ROUTE m_routes[RTARDULINK_MAX_ROUTES];       // the routing table
+    int m_routeCount;                                       // number of entries in the routing table
 
 
 private:
     void processReceivedMessage(RTARDULINK_PORT *port);     // process a completed message
     void processHostMessage();                              // special case for stuff received from the host port
-    void sendFrame(RTARDULINK_PORT *portInfo, RTARDULINK_FRAME *frame, int length);	// send a frame to the host. length is length of data field
+    void buildRoutes();                                     // sets up the routing table from the ports in use
+    bool routeDownstream(unsigned int address, RTARDULINK_PORT **port, unsigned int *remoteAddress); // finds the port for a host side address
+    bool routeUpstream(RTARDULINK_PORT *portInfo, unsigned int remoteAddress, unsigned int *address); // maps a subsystem address to the host side
+    void startCutThrough(RTARDULINK_PORT *portInfo);        // starts forwarding the frame being received if possible
+    void endCutThrough(RTARDULINK_PORT *portInfo);          // ends forwarding when the frame is complete or abandoned
+    void sendFrame(RTARDULINK_PORT *portInfo, RTARDULINK_FRAME *frame, int length);	// queue a frame for a port. length is length of message field
+    void transmit(RTARDULINK_PORT *portInfo);               // write as much queued data to the port as it can take without blocking
+    void stampTimeSync(RTARDULINK_TXQUEUE *queue);          // sets the send times if the head frame is a time sync response from here
 
     const char *m_identitySuffix;                           // what to add to the EEPROM identity string
 
+    bool m_flowControl;                                     // true if the host has turned on flow control
+    unsigned long m_TXCount;                                // number of data messages sent with sendMessage()
+    unsigned long m_TXCreditLimit;                          // the value m_TXCount may reach if flow control is on
+
 };
 
 #endif // _RTARDULINK_H
@@ -141,6 +141,20 @@ typedef struct
     bool complete;                                          // true if frame is complete and correct (as far as checksum goes)
 } RTARDULINK_RXFRAME;
 
+//  RTARDULINK_TXQUEUE is a ring of complete frames waiting to be written to a port. Frames are stored
+//  back to back exactly as they go on the wire so the length of the frame at the head can always be
+//  found from its messageLength byte. The frame at the head may be partially sent (frameLeft != 0).
+
+typedef struct
+{
+    unsigned char *buffer;                                  // the ring storage
+    int size;                                               // size of the ring in bytes
+    int head;                                               // index of the next byte to send
+    int count;                                              // number of bytes in the ring
+    int frameLeft;                                          // bytes still to send of the head frame (0 if not started)
+    unsigned int dropCount;                                 // number of frames discarded to make room
+} RTARDULINK_TXQUEUE;
+
 //  Message types
 
 //  RTARDULINK_MESSAGE_POLL
@@ -184,6 +198,50 @@ typedef struct
 
 #define	RTARDULINK_MESSAGE_ECHO         5                   // echo message
 
+//  RTARDULINK_MESSAGE_TIMESYNC
+//
+//  The host uses this message pair to relate the subsystem's clock to its own. The host sends
+//  the message with a sequence number in messageParam and no data, noting its own time when
+//  sent (t1). The addressed subsystem returns the message with messageParam unchanged and data
+//  set to an RTARDULINK_TIMESYNC structure. The host notes the time the response arrives (t4).
+//  The round trip is (t4 - t1) - (sendTime - receiveTime) and the offset between the clocks is
+//  estimated from the responses with the smallest round trip.
+
+#define	RTARDULINK_MESSAGE_TIMESYNC     6                   // time synchronisation message
+
+typedef struct
+{
+    RTARDULINK_UC4 receiveTime;                             // subsystem micros() when the request was processed
+    RTARDULINK_UC4 sendTime;                                // subsystem micros() when the response was sent
+    RTARDULINK_UC4 sendTimeMillis;                          // subsystem millis() when the response was sent
+} RTARDULINK_TIMESYNC;
+
+//  RTARDULINK_MESSAGE_FLOWCONTROL
+//
+//  Credit based flow control for the data messages that a subsystem sends with sendMessage(). Flow control
+//  is off until the host first sends this message so hosts that don't use it see no change. The data field
+//  is an RTARDULINK_FLOWCONTROL structure.
+//
+//  Host -> subsystem: count is the credit limit - the value that the subsystem's count of data messages sent
+//  may reach. If messageParam is RTARDULINK_FLOWCONTROL_RELATIVE, count is instead the number of further data
+//  messages that may be sent. This is used when the host does not yet know the subsystem's count.
+//  If messageParam is RTARDULINK_FLOWCONTROL_OFF, flow control is turned off again.
+//
+//  Subsystem -> host: the request is returned with count set to the subsystem's count of data messages sent.
+//  Since this is queued behind any data messages already sent, the host can use it to keep its credit limits
+//  in step with the subsystem even if messages are lost.
+
+#define	RTARDULINK_MESSAGE_FLOWCONTROL  7                   // flow control message
+
+#define	RTARDULINK_FLOWCONTROL_LIMIT    0                   // count is the credit limit
+#define	RTARDULINK_FLOWCONTROL_RELATIVE 1                   // count is relative to the number sent so far
+#define	RTARDULINK_FLOWCONTROL_OFF      2                   // turn flow control off
+
+typedef struct
+{
+    RTARDULINK_UC4 count;                                   // credit limit or the number sent
+} RTARDULINK_FLOWCONTROL;
+
 //  RTARDULINK_MESSAGE_CUSTOM
 //
 //  This is the first message code that should be used for custom messages 16-255 are available.
@@ -29,6 +29,7 @@
 //  DEALINGS IN THE SOFTWARE.
 
 #include <string.h>
+#include <Arduino.h>
 #include "RTArduLinkHAL.h"
 
 //----------------------------------------------------------
@@ -71,6 +72,21 @@ void RTArduLinkHALPortWrite(RTARDULINKHAL_PORT *port, unsigned char *data, unsig
     port->serialPort->write(data, length);
 }
 
+int RTArduLinkHALPortTXSpace(RTARDULINKHAL_PORT *port)
+{
+    return port->serialPort->availableForWrite();
+}
+
+unsigned long RTArduLinkHALMillis()
+{
+    return millis();
+}
+
+unsigned long RTArduLinkHALMicros()
+{
+    return micros();
+}
+
 
 bool RTArduLinkHALAddHardwarePort(RTARDULINKHAL_PORT *port, long portSpeed, unsigned char hardwarePort)
 {
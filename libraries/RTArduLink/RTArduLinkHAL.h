@@ -46,6 +46,20 @@
 #define RTARDULINKHAL_MAX_PORTS             (RTARDULINKHAL_MAX_SUBSYSTEM_PORTS + 1)	// max total ports (including host)
 #define RTARDULINKHAL_EEPROM_OFFSET         256             // where the config starts in EEPROM
 
+//  RTARDULINKHAL_HARDWARE_PORTS is the number of serial ports this board actually has. No more
+//  than this many ports can be in use at once so it sets how many transmit queues are allocated.
+//  On USB boards such as the Leonardo, hardware ports 0 and 1 are both Serial1.
+
+#if defined(UBRR3H)
+#define RTARDULINKHAL_HARDWARE_PORTS        4
+#elif defined(UBRR2H)
+#define RTARDULINKHAL_HARDWARE_PORTS        3
+#elif defined(UBRR1H) && !defined(USBCON)
+#define RTARDULINKHAL_HARDWARE_PORTS        2
+#else
+#define RTARDULINKHAL_HARDWARE_PORTS        1
+#endif
+
 //  RTARDULINKHAL_PORT should be modified as appropriate for the target.
 //  There is one copy of this per port. It contains all state needed about
 //  a serial port.
@@ -102,6 +116,23 @@ extern RTARDULINKHAL_EEPROM RTArduLinkHALConfig;
     void RTArduLinkHALPortWrite(RTARDULINKHAL_PORT *port, unsigned char *data, unsigned char length);
 
 
+//  RTArduLinkHALPortTXSpace() returns the number of bytes that can be written to the specified port
+//  without blocking.
+
+    int RTArduLinkHALPortTXSpace(RTARDULINKHAL_PORT *port);
+
+
+//  RTArduLinkHALMillis() returns a free running time in milliseconds.
+
+    unsigned long RTArduLinkHALMillis();
+
+
+//  RTArduLinkHALMicros() returns a free running time in microseconds. It must run from
+//  the same clock as RTArduLinkHALMillis().
+
+    unsigned long RTArduLinkHALMicros();
+
+
 //  RTArduLinkHALEEPROMValid() returns true if the EEPROM contains a valid configuration,
 //  false otherwise.
 
@@ -90,6 +90,105 @@ bool RTArduLinkReassemble(RTARDULINK_RXFRAME *RXFrame, unsigned char data)
     return flag;
 }
 
+//  RTArduLinkTXQueueInit initializes an empty transmit queue using buffer (of size bytes) for storage
+
+void RTArduLinkTXQueueInit(RTARDULINK_TXQUEUE *TXQueue, unsigned char *buffer, int size)
+{
+    TXQueue->buffer = buffer;
+    TXQueue->size = size;
+    TXQueue->head = 0;
+    TXQueue->count = 0;
+    TXQueue->frameLeft = 0;
+    TXQueue->dropCount = 0;
+}
+
+//  RTArduLinkTXQueueHeadLength returns the total length of the frame at the head of the queue.
+//  Only valid if the head frame has not been started (frameLeft == 0).
+
+int RTArduLinkTXQueueHeadLength(RTARDULINK_TXQUEUE *TXQueue)
+{
+    if (TXQueue->count == 0)
+        return 0;
+    return TXQueue->buffer[(TXQueue->head + 2) % TXQueue->size] + RTARDULINK_FRAME_HEADER_LEN;
+}
+
+//  RTArduLinkTXQueueHeadRead copies length bytes of the frame at the head of the queue, starting offset
+//  bytes from the start of the frame, to data. Only valid if the head frame has not been started.
+
+void RTArduLinkTXQueueHeadRead(RTARDULINK_TXQUEUE *TXQueue, int offset, unsigned char *data, int length)
+{
+    for (int i = 0; i < length; i++)
+        data[i] = TXQueue->buffer[(TXQueue->head + offset + i) % TXQueue->size];
+}
+
+//  RTArduLinkTXQueueHeadWrite overwrites length bytes of the frame at the head of the queue with data,
+//  starting offset bytes from the start of the frame, and corrects the frame checksum for the change.
+//  The bytes must be in the message field. Only valid if the head frame has not been started.
+
+void RTArduLinkTXQueueHeadWrite(RTARDULINK_TXQUEUE *TXQueue, int offset, unsigned char *data, int length)
+{
+    unsigned char *checksum;
+    int index;
+
+    checksum = TXQueue->buffer + (TXQueue->head + 3) % TXQueue->size;
+
+    for (int i = 0; i < length; i++) {
+        index = (TXQueue->head + offset + i) % TXQueue->size;
+        *checksum += TXQueue->buffer[index] - data[i];
+        TXQueue->buffer[index] = data[i];
+    }
+}
+
+//  RTArduLinkTXQueuePut adds a complete frame to the tail of the queue. If there isn't room, the oldest
+//  frames are discarded until there is. A frame that has been partially sent can't be discarded as this
+//  would corrupt the stream so in that case the next oldest is discarded instead. Returns false if the
+//  frame could not be queued.
+
+bool RTArduLinkTXQueuePut(RTARDULINK_TXQUEUE *TXQueue, RTARDULINK_FRAME *frame)
+{
+    int length;
+    int dropLength;
+    int index;
+    unsigned char *data;
+
+    length = frame->messageLength + RTARDULINK_FRAME_HEADER_LEN;
+    if (length > TXQueue->size) {
+        TXQueue->dropCount++;
+        return false;                                       // can never fit
+    }
+
+    while ((TXQueue->size - TXQueue->count) < length) {
+        if (TXQueue->frameLeft == 0) {
+            dropLength = RTArduLinkTXQueueHeadLength(TXQueue);
+        } else {
+            if (TXQueue->count == TXQueue->frameLeft) {     // only the partially sent frame is left
+                TXQueue->dropCount++;
+                return false;
+            }
+
+            //  discard the frame after the partial one and slide the rest of the partial frame up to close the gap
+
+            dropLength = TXQueue->buffer[(TXQueue->head + TXQueue->frameLeft + 2) % TXQueue->size] + RTARDULINK_FRAME_HEADER_LEN;
+            for (index = TXQueue->frameLeft - 1; index >= 0; index--)
+                TXQueue->buffer[(TXQueue->head + dropLength + index) % TXQueue->size] =
+                    TXQueue->buffer[(TXQueue->head + index) % TXQueue->size];
+        }
+        TXQueue->head = (TXQueue->head + dropLength) % TXQueue->size;
+        TXQueue->count -= dropLength;
+        TXQueue->dropCount++;
+    }
+
+    index = (TXQueue->head + TXQueue->count) % TXQueue->size;
+    data = (unsigned char *)frame;
+    for (int i = 0; i < length; i++) {
+        TXQueue->buffer[index++] = *data++;
+        if (index == TXQueue->size)
+            index = 0;
+    }
+    TXQueue->count += length;
+    return true;
+}
+
 //  RTArduLinkSetChecksum correctly sets the checksum field on an RCP frame prior to transmission
 //
 
@@ -38,6 +38,14 @@
 void RTArduLinkRXFrameInit(RTARDULINK_RXFRAME *RXFrame, RTARDULINK_FRAME *frameBuffer);	// initializes RTARDULINK_RXFRAME for a new frame
 bool RTArduLinkReassemble(RTARDULINK_RXFRAME *RXFrame, unsigned char data);	// adds a byte to the reassembly, returns false if error
 
+//  Transmit queue utilities
+
+void RTArduLinkTXQueueInit(RTARDULINK_TXQUEUE *TXQueue, unsigned char *buffer, int size); // initializes an empty queue using buffer for storage
+bool RTArduLinkTXQueuePut(RTARDULINK_TXQUEUE *TXQueue, RTARDULINK_FRAME *frame);   // adds a frame, discarding oldest frames if needed. false if it can't fit
+int RTArduLinkTXQueueHeadLength(RTARDULINK_TXQUEUE *TXQueue);  // returns the length of the frame at the head of the queue
+void RTArduLinkTXQueueHeadRead(RTARDULINK_TXQUEUE *TXQueue, int offset, unsigned char *data, int length); // copies bytes out of the head frame
+void RTArduLinkTXQueueHeadWrite(RTARDULINK_TXQUEUE *TXQueue, int offset, unsigned char *data, int length); // changes message bytes of the head frame
+
 //  Checksum utilities
 
 void RTArduLinkSetChecksum(RTARDULINK_FRAME *frame);        // sets the checksum field prior to transmission
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef RTARDULINK_MODE
+
+#include "RTAltitudeFusion.h"
+
+#define RTALTITUDE_GRAVITY              (RTFLOAT)9.80665    // m/s/s per g
+
+//  initial uncertainty of the climb rate (m/s) and accel bias (m/s/s)
+
+#define RTALTITUDE_CLIMB_RATE_INIT      (RTFLOAT)1.0
+#define RTALTITUDE_BIAS_INIT            (RTFLOAT)0.5
+
+RTAltitudeFusion::RTAltitudeFusion()
+{
+    m_seaLevelPressure = RTALTITUDE_SEA_LEVEL;
+    setAccelNoise(RTALTITUDE_ACCEL_NOISE);
+    setPressureNoise(RTALTITUDE_PRESSURE_NOISE);
+    setBiasNoise(RTALTITUDE_BIAS_NOISE);
+    reset();
+}
+
+RTAltitudeFusion::~RTAltitudeFusion()
+{
+}
+
+void RTAltitudeFusion::reset()
+{
+    m_altitudeValid = false;
+    m_firstTime = true;
+    m_altitude = 0;
+    m_climbRate = 0;
+    m_accelBias = 0;
+    m_verticalAccel = 0;
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            m_P[i][j] = 0;
+}
+
+RTFLOAT RTAltitudeFusion::pressureToAltitude(RTFLOAT pressure, RTFLOAT seaLevelPressure)
+{
+    return (RTFLOAT)44330.0 * ((RTFLOAT)1.0 - pow(pressure / seaLevelPressure, (RTFLOAT)0.190295));
+}
+
+void RTAltitudeFusion::newIMUData(const RTQuaternion& fusionQPose, const RTVector3& accel, unsigned long timestamp)
+{
+    RTQuaternion earthAccel(0, accel.x(), accel.y(), accel.z());
+    RTFLOAT timeDelta;
+
+    //  rotate the accels into the earth frame - z is then 1g plus any vertical acceleration
+
+    earthAccel = fusionQPose * earthAccel * fusionQPose.conjugate();
+
+    if (m_firstTime) {
+        m_lastFusionTime = timestamp;
+        m_firstTime = false;
+        return;
+    }
+
+    timeDelta = (RTFLOAT)(int32_t)(timestamp - m_lastFusionTime) / (RTFLOAT)1000000;
+    if (timeDelta <= 0)
+        return;
+    m_lastFusionTime = timestamp;
+
+    m_verticalAccel = (earthAccel.z() - (RTFLOAT)1.0) * RTALTITUDE_GRAVITY - m_accelBias;
+
+    if (m_altitudeValid)
+        predict(timeDelta);
+}
+
+//  x' = F x + G a where x is (altitude, climb rate, bias) and a the vertical accel:
+//
+//      F = | 1  dt  -dt*dt/2 |     G = | dt*dt/2 |
+//          | 0   1  -dt      |         | dt      |
+//          | 0   0   1       |         | 0       |
+//
+//  and P' = F P F' + G G' accel variance + bias variance * dt on the bias
+
+void RTAltitudeFusion::predict(RTFLOAT timeDelta)
+{
+    RTFLOAT halfDt2 = timeDelta * timeDelta / 2;
+    RTFLOAT F[3][3] = {{1, timeDelta, -halfDt2}, {0, 1, -timeDelta}, {0, 0, 1}};
+    RTFLOAT G[3] = {halfDt2, timeDelta, 0};
+    RTFLOAT FP[3][3];
+
+    m_altitude += m_climbRate * timeDelta + m_verticalAccel * halfDt2;
+    m_climbRate += m_verticalAccel * timeDelta;
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            FP[i][j] = F[i][0] * m_P[0][j] + F[i][1] * m_P[1][j] + F[i][2] * m_P[2][j];
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            m_P[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2] +
+                    G[i] * G[j] * m_accelVariance;
+
+    m_P[2][2] += m_biasVariance * timeDelta;
+}
+
+void RTAltitudeFusion::newPressureData(RTFLOAT pressure)
+{
+    RTFLOAT measuredAltitude;
+    RTFLOAT innovation;
+    RTFLOAT S;
+    RTFLOAT K[3];
+    RTFLOAT P0[3];
+
+    if (pressure <= 0)
+        return;
+
+    measuredAltitude = pressureToAltitude(pressure, m_seaLevelPressure);
+
+    if (!m_altitudeValid) {
+        m_altitude = measuredAltitude;
+        m_climbRate = 0;
+        m_accelBias = 0;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                m_P[i][j] = 0;
+        m_P[0][0] = m_pressureVariance;
+        m_P[1][1] = RTALTITUDE_CLIMB_RATE_INIT * RTALTITUDE_CLIMB_RATE_INIT;
+        m_P[2][2] = RTALTITUDE_BIAS_INIT * RTALTITUDE_BIAS_INIT;
+        m_altitudeValid = true;
+        return;
+    }
+
+    //  the measurement is the altitude state so H = (1, 0, 0)
+
+    innovation = measuredAltitude - m_altitude;
+    S = m_P[0][0] + m_pressureVariance;
+
+    for (int i = 0; i < 3; i++) {
+        K[i] = m_P[i][0] / S;
+        P0[i] = m_P[0][i];
+    }
+
+    m_altitude += K[0] * innovation;
+    m_climbRate += K[1] * innovation;
+    m_accelBias += K[2] * innovation;
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            m_P[i][j] -= K[i] * P0[j];
+}
+
+#endif // #ifndef RTARDULINK_MODE
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTALTITUDEFUSION_H
+#define	_RTALTITUDEFUSION_H
+
+#ifndef RTARDULINK_MODE
+
+#include "RTMath.h"
+
+//  RTAltitudeFusion estimates altitude and climb rate by combining the vertical
+//  acceleration (the accels rotated into the earth frame by the fused pose) with the
+//  altitude from a pressure sensor. It's a three state Kalman filter - altitude, climb
+//  rate and the vertical accel bias. The accels give the fast response at the IMU rate
+//  and the pressure readings stop the drift.
+
+//  The default noise values - accel noise in m/s/s, pressure altitude noise in m and
+//  accel bias drift in m/s/s per root second
+
+#define RTALTITUDE_ACCEL_NOISE          (RTFLOAT)0.5
+#define RTALTITUDE_PRESSURE_NOISE       (RTFLOAT)0.5
+#define RTALTITUDE_BIAS_NOISE           (RTFLOAT)0.01
+
+//  Standard sea level pressure in hPa
+
+#define RTALTITUDE_SEA_LEVEL            (RTFLOAT)1013.25
+
+class RTAltitudeFusion
+{
+public:
+    RTAltitudeFusion();
+    ~RTAltitudeFusion();
+
+    //  reset() resets the state but keeps any setting changes
+
+    void reset();
+
+    //  newIMUData() predicts the altitude and climb rate. It should be called for each
+    //  IMU sample, after the pose fusion has been given the same sample.
+    //  timestamp is in uS, the same as for RTFusionRTQF::newIMUData()
+
+    void newIMUData(const RTQuaternion& fusionQPose, const RTVector3& accel, unsigned long timestamp);
+
+    //  newPressureData() corrects the prediction with a new pressure reading in hPa.
+    //  It should only be called when the pressure sensor has a new reading - 0 (no
+    //  valid reading yet) is ignored.
+
+    void newPressureData(RTFLOAT pressure);
+
+    //  setSeaLevelPressure() sets the pressure in hPa that corresponds to 0 altitude
+
+    void setSeaLevelPressure(RTFLOAT pressure) { m_seaLevelPressure = pressure; }
+
+    //  the following functions can be called to customize the noise values
+
+    void setAccelNoise(RTFLOAT noise) { m_accelVariance = noise * noise; }
+    void setPressureNoise(RTFLOAT noise) { m_pressureVariance = noise * noise; }
+    void setBiasNoise(RTFLOAT noise) { m_biasVariance = noise * noise; }
+
+    inline bool getAltitudeValid() { return m_altitudeValid; }   // true once there's been a pressure reading
+    inline RTFLOAT getAltitude() { return m_altitude; }          // altitude in m
+    inline RTFLOAT getClimbRate() { return m_climbRate; }        // climb rate in m/s
+    inline RTFLOAT getVerticalAccel() { return m_verticalAccel; } // vertical accel (less gravity and bias) in m/s/s
+
+    //  pressureToAltitude() converts pressure in hPa to altitude in m using the standard atmosphere
+
+    static RTFLOAT pressureToAltitude(RTFLOAT pressure, RTFLOAT seaLevelPressure = RTALTITUDE_SEA_LEVEL);
+
+private:
+    void predict(RTFLOAT timeDelta);                        // predicts the state and covariance
+
+    RTFLOAT m_seaLevelPressure;                             // pressure at 0 altitude in hPa
+    RTFLOAT m_accelVariance;                                // accel noise variance
+    RTFLOAT m_pressureVariance;                             // pressure altitude noise variance
+    RTFLOAT m_biasVariance;                                 // accel bias drift variance
+
+    RTFLOAT m_altitude;                                     // the altitude state
+    RTFLOAT m_climbRate;                                    // the climb rate state
+    RTFLOAT m_accelBias;                                    // the vertical accel bias state
+    RTFLOAT m_verticalAccel;                                // the latest vertical accel
+    RTFLOAT m_P[3][3];                                      // the state covariance
+
+    bool m_altitudeValid;                                   // true once initialized from a pressure reading
+    bool m_firstTime;                                       // if first IMU sample after reset
+    unsigned long m_lastFusionTime;                         // for delta time calculation
+};
+
+#endif // #ifndef RTARDULINK_MODE
+
+#endif // _RTALTITUDEFUSION_H
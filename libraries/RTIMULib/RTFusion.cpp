@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef RTARDULINK_MODE
+
+#include "RTIMULibDefs.h"
+#include "RTFusion.h"
+
+#if defined(RTFUSION_MEKF)
+#include "RTFusionMEKF.h"
+#elif defined(RTFUSION_MADGWICK)
+#include "RTFusionMadgwick.h"
+#elif defined(RTFUSION_MAHONY)
+#include "RTFusionMahony.h"
+#else
+#include "RTFusionRTQF.h"
+#endif
+
+RTFusion *RTFusion::createFusion()
+{
+#if defined(RTFUSION_MEKF)
+    return new RTFusionMEKF();
+#elif defined(RTFUSION_MADGWICK)
+    return new RTFusionMadgwick();
+#elif defined(RTFUSION_MAHONY)
+    return new RTFusionMahony();
+#else
+    return new RTFusionRTQF();
+#endif
+}
+
+RTFusion::RTFusion()
+{
+    m_enableGyro = true;
+    m_enableAccel = true;
+    m_enableCompass = true;
+}
+
+RTFusion::~RTFusion()
+{
+}
+
+void RTFusion::reset()
+{
+    m_firstTime = true;
+    m_fusionPose = RTVector3();
+    m_fusionQPose.fromEuler(m_fusionPose);
+    m_fusionPoseValid = true;
+}
+
+const RTVector3& RTFusion::getFusionPose()
+{
+    if (!m_fusionPoseValid) {
+        m_fusionQPose.toEuler(m_fusionPose);
+        m_fusionPoseValid = true;
+    }
+    return m_fusionPose;
+}
+
+bool RTFusion::updateTimeDelta(unsigned long timestamp)
+{
+    m_timeDelta = (RTFLOAT)(int32_t)(timestamp - m_lastFusionTime) / (RTFLOAT)1000000;
+    if (m_timeDelta <= 0)
+        return false;
+    m_lastFusionTime = timestamp;
+    return true;
+}
+
+void RTFusion::initialPose(const RTVector3& accel, const RTVector3& compass)
+{
+    bool compassValid = (compass.x() != 0) || (compass.y() != 0) || (compass.z() != 0);
+
+    m_fusionPose = RTVector3();
+
+    if (m_enableAccel && m_enableCompass && compassValid)
+        m_fusionPose = RTMath::poseFromAccelMag(accel, compass);
+    else if (m_enableAccel)
+        accel.accelToEuler(m_fusionPose);
+
+    m_fusionQPose.fromEuler(m_fusionPose);
+    m_fusionPoseValid = true;
+}
+
+#endif // #ifndef RTARDULINK_MODE
@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTFUSION_H
+#define	_RTFUSION_H
+
+#ifndef RTARDULINK_MODE
+
+#include "RTMath.h"
+
+//  RTFusion is the interface to the fusion engines - RTFusionRTQF, RTFusionMEKF,
+//  RTFusionMadgwick and RTFusionMahony. A sketch can use an engine directly or call
+//  createFusion() to get the one selected in RTIMULibDefs.h.
+
+class RTFusion
+{
+public:
+    RTFusion();
+    virtual ~RTFusion();
+
+    //  createFusion() creates the fusion engine selected in RTIMULibDefs.h
+
+    static RTFusion *createFusion();
+
+    //  reset() resets the state but keeps any setting changes (such as enables)
+
+    virtual void reset();
+
+    //  newIMUData() should be called for subsequent updates
+    //  timestamp is the sample time in uS (as from RTIMU::getTimestamp()). Only the low
+    //  32 bits are used so it can wrap. A sample that isn't later than the last is ignored.
+    //  It returns true if the fusion pose was updated.
+
+    virtual bool newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp) = 0;
+
+    //  the following three functions control the influence of the gyro, accel and compass sensors
+
+    void setGyroEnable(bool enable) { m_enableGyro = enable;}
+    void setAccelEnable(bool enable) { m_enableAccel = enable; }
+    void setCompassEnable(bool enable) { m_enableCompass = enable;}
+
+    //  getFusionPose() returns the pose as Euler angles. Engines that don't need them
+    //  only convert the quaternion pose when it's called.
+
+    const RTVector3& getFusionPose();
+    inline const RTQuaternion& getFusionQPose() {return m_fusionQPose;}
+
+protected:
+    bool updateTimeDelta(unsigned long timestamp);          // sets m_timeDelta, false if the sample isn't later
+    void initialPose(const RTVector3& accel, const RTVector3& compass); // sets the pose from the accels and compass
+
+    RTFLOAT m_timeDelta;                                    // time between predictions
+
+    RTQuaternion m_fusionQPose;                             // quaternion form of pose from fusion
+    RTVector3 m_fusionPose;                                 // vector form of pose from fusion
+    bool m_fusionPoseValid;                                 // false if m_fusionPose needs converting from m_fusionQPose
+
+    bool m_enableGyro;                                      // enables gyro as input
+    bool m_enableAccel;                                     // enables accel as input
+    bool m_enableCompass;                                   // enables compass a input
+
+    bool m_firstTime;                                       // if first time after reset
+    unsigned long m_lastFusionTime;                         // for delta time calculation
+};
+
+#endif // #ifndef RTARDULINK_MODE
+
+#endif // _RTFUSION_H
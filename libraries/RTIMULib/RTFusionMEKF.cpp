@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusionMEKF.h"
+
+//  initial uncertainty of the attitude (radians) and gyro bias (radians/s)
+
+#define RTFUSIONMEKF_ATTITUDE_INIT      (RTFLOAT)0.1
+#define RTFUSIONMEKF_BIAS_INIT          (RTFLOAT)0.05
+
+RTFusionMEKF::RTFusionMEKF()
+{
+    setGyroNoise(RTFUSIONMEKF_GYRO_NOISE);
+    setBiasNoise(RTFUSIONMEKF_BIAS_NOISE);
+    setAccelNoise(RTFUSIONMEKF_ACCEL_NOISE);
+    setCompassNoise(RTFUSIONMEKF_COMPASS_NOISE);
+    reset();
+}
+
+RTFusionMEKF::~RTFusionMEKF()
+{
+}
+
+void RTFusionMEKF::reset()
+{
+    RTFusion::reset();
+    m_gyroBias = RTVector3();
+
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 6; j++)
+            m_P[i][j] = 0;
+
+    for (int i = 0; i < 3; i++) {
+        m_P[i][i] = RTFUSIONMEKF_ATTITUDE_INIT * RTFUSIONMEKF_ATTITUDE_INIT;
+        m_P[i + 3][i + 3] = RTFUSIONMEKF_BIAS_INIT * RTFUSIONMEKF_BIAS_INIT;
+    }
+}
+
+bool RTFusionMEKF::newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp)
+{
+    RTQuaternion errorQ;
+
+    if (m_firstTime) {
+        m_lastFusionTime = timestamp;
+        initialPose(accel, compass);
+        m_firstTime = false;
+        return true;
+    }
+
+    if (!updateTimeDelta(timestamp))
+        return false;
+
+    predict(gyro);
+
+    for (int i = 0; i < 6; i++)
+        m_error[i] = 0;
+
+    if (m_enableCompass)
+        correctCompass(compass);
+    if (m_enableAccel)
+        correctAccel(accel);
+
+    //  move the error into the pose and bias - the attitude error is a small rotation in the body frame
+
+    errorQ.setScalar(1);
+    errorQ.setX(m_error[0] / (RTFLOAT)2.0);
+    errorQ.setY(m_error[1] / (RTFLOAT)2.0);
+    errorQ.setZ(m_error[2] / (RTFLOAT)2.0);
+    m_fusionQPose *= errorQ;
+    m_fusionQPose.normalize();
+
+    if (m_enableGyro) {
+        m_gyroBias.setX(m_gyroBias.x() + m_error[3]);
+        m_gyroBias.setY(m_gyroBias.y() + m_error[4]);
+        m_gyroBias.setZ(m_gyroBias.z() + m_error[5]);
+    }
+
+    m_fusionPoseValid = false;
+    return true;
+}
+
+//  The pose is rotated by the bias corrected gyro rates, a = (w - b) dt. The error state
+//  (attitude error e, bias error) has the transition matrix
+//
+//      F = | A  -dt |     where A = I - [a x]
+//          | 0   1  |
+//
+//  so with P in 3 x 3 blocks
+//
+//      Pab' = A Pab - dt Pbb
+//      Paa' = (A Paa - dt Pba) A' - dt Pab'
+//
+//  plus the gyro noise on Paa and bias drift on Pbb. Pbb itself doesn't change.
+
+void RTFusionMEKF::predict(const RTVector3& gyro)
+{
+    RTVector3 angle;
+    RTQuaternion rotation;
+    RTFLOAT angle2;
+    RTFLOAT vectorScale;
+    RTFLOAT T[3][3];
+    RTFLOAT AB[3][3];
+
+    if (m_enableGyro) {
+        angle.setX((gyro.x() - m_gyroBias.x()) * m_timeDelta);
+        angle.setY((gyro.y() - m_gyroBias.y()) * m_timeDelta);
+        angle.setZ((gyro.z() - m_gyroBias.z()) * m_timeDelta);
+    }
+
+    //  the rotation quaternion from the series for sin and cos, as RTFusionRTQF::predictConing()
+
+    angle2 = angle.squareLength();
+    vectorScale = (RTFLOAT)0.5 - angle2 / (RTFLOAT)48.0;
+
+    rotation.setScalar((RTFLOAT)1.0 - angle2 / (RTFLOAT)8.0 + angle2 * angle2 / (RTFLOAT)384.0);
+    rotation.setX(angle.x() * vectorScale);
+    rotation.setY(angle.y() * vectorScale);
+    rotation.setZ(angle.z() * vectorScale);
+
+    m_fusionQPose *= rotation;
+
+    RTFLOAT A[3][3] = {{1, angle.z(), -angle.y()}, {-angle.z(), 1, angle.x()}, {angle.y(), -angle.x(), 1}};
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            T[i][j] = A[i][0] * m_P[0][j] + A[i][1] * m_P[1][j] + A[i][2] * m_P[2][j] - m_timeDelta * m_P[i + 3][j];
+            AB[i][j] = A[i][0] * m_P[0][j + 3] + A[i][1] * m_P[1][j + 3] + A[i][2] * m_P[2][j + 3] -
+                    m_timeDelta * m_P[i + 3][j + 3];
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = i; j < 3; j++)
+            m_P[i][j] = T[i][0] * A[j][0] + T[i][1] * A[j][1] + T[i][2] * A[j][2] - m_timeDelta * AB[i][j];
+        for (int j = 0; j < 3; j++)
+            m_P[i][j + 3] = AB[i][j];
+        m_P[i][i] += m_gyroVariance * m_timeDelta;
+        m_P[i + 3][i + 3] += m_biasVariance * m_timeDelta;
+    }
+
+    for (int i = 0; i < 6; i++)
+        for (int j = i + 1; j < 6; j++)
+            m_P[j][i] = m_P[i][j];
+}
+
+//  correct() applies one scalar measurement. H is the attitude part of the measurement
+//  row (the measurements don't depend on the bias directly) and residual is the
+//  measurement less its prediction from the pose before this sample's updates. As P
+//  is symmetric, P H' is also H P and the update only needs the upper triangle.
+
+void RTFusionMEKF::correct(const RTFLOAT *H, RTFLOAT residual, RTFLOAT variance)
+{
+    RTFLOAT PH[6];
+    RTFLOAT K[6];
+    RTFLOAT S;
+
+    for (int i = 0; i < 6; i++)
+        PH[i] = m_P[i][0] * H[0] + m_P[i][1] * H[1] + m_P[i][2] * H[2];
+
+    S = H[0] * PH[0] + H[1] * PH[1] + H[2] * PH[2] + variance;
+
+    //  the error state already includes the earlier updates from this sample
+
+    residual -= H[0] * m_error[0] + H[1] * m_error[1] + H[2] * m_error[2];
+
+    for (int i = 0; i < 6; i++)
+        K[i] = PH[i] / S;
+
+    for (int i = 0; i < 6; i++) {
+        m_error[i] += K[i] * residual;
+        for (int j = i; j < 6; j++) {
+            m_P[i][j] -= K[i] * PH[j];
+            m_P[j][i] = m_P[i][j];
+        }
+    }
+}
+
+//  The accels should measure the earth's z axis in the body frame, h = R' z which is
+//  the bottom row of the rotation matrix R. For a small attitude error e this is
+//  h + [h x] e, so each axis is a scalar update with a row of [h x].
+
+void RTFusionMEKF::correctAccel(const RTVector3& accel)
+{
+    RTVector3 normAccel = accel;
+    RTFLOAT length = normAccel.length();
+    RTFLOAT qs = m_fusionQPose.scalar();
+    RTFLOAT qx = m_fusionQPose.x();
+    RTFLOAT qy = m_fusionQPose.y();
+    RTFLOAT qz = m_fusionQPose.z();
+    RTFLOAT H[3];
+
+    if (fabs(length - (RTFLOAT)1.0) > RTFUSIONMEKF_ACCEL_GATE)
+        return;
+
+    normAccel.normalize();
+
+    RTVector3 h(2 * (qx * qz - qs * qy), 2 * (qy * qz + qs * qx), 1 - 2 * (qx * qx + qy * qy));
+
+    H[0] = 0; H[1] = -h.z(); H[2] = h.y();
+    correct(H, normAccel.x() - h.x(), m_accelVariance);
+    H[0] = h.z(); H[1] = 0; H[2] = -h.x();
+    correct(H, normAccel.y() - h.y(), m_accelVariance);
+    H[0] = -h.y(); H[1] = h.x(); H[2] = 0;
+    correct(H, normAccel.z() - h.z(), m_accelVariance);
+}
+
+//  The compass only corrects the heading. The compass vector is rotated into the earth
+//  frame and its heading is the heading error - north is along x. A small body frame
+//  attitude error e changes the heading by the earth z axis component of the error,
+//  which is the bottom row of R dotted with e.
+
+void RTFusionMEKF::correctCompass(const RTVector3& compass)
+{
+    RTFLOAT qs = m_fusionQPose.scalar();
+    RTFLOAT qx = m_fusionQPose.x();
+    RTFLOAT qy = m_fusionQPose.y();
+    RTFLOAT qz = m_fusionQPose.z();
+    RTFLOAT earthX;
+    RTFLOAT earthY;
+    RTFLOAT H[3];
+
+    if ((compass.x() == 0) && (compass.y() == 0) && (compass.z() == 0))
+        return;
+
+    earthX = (1 - 2 * (qy * qy + qz * qz)) * compass.x() + 2 * (qx * qy - qs * qz) * compass.y() +
+            2 * (qx * qz + qs * qy) * compass.z();
+    earthY = 2 * (qx * qy + qs * qz) * compass.x() + (1 - 2 * (qx * qx + qz * qz)) * compass.y() +
+            2 * (qy * qz - qs * qx) * compass.z();
+
+    H[0] = 2 * (qx * qz - qs * qy);
+    H[1] = 2 * (qy * qz + qs * qx);
+    H[2] = 1 - 2 * (qx * qx + qy * qy);
+    correct(H, -atan2(earthY, earthX), m_compassVariance);
+}
+
+#endif // #ifndef RTARDULINK_MODE
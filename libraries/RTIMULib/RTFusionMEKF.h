@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTFUSIONMEKF_H
+#define	_RTFUSIONMEKF_H
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusion.h"
+
+//  RTFusionMEKF is a multiplicative extended Kalman filter. The quaternion pose is
+//  propagated by the gyros and the filter estimates a small attitude error and the gyro
+//  biases - six states. The accels correct the roll and pitch and the compass only
+//  corrects the heading so that magnetic disturbances can't tilt the pose. The covariance
+//  is a fixed 6 x 6 array and each measurement is applied as a scalar update, so there's
+//  no matrix inverse and only the upper triangle of the covariance is calculated.
+
+//  The default noise values - gyro noise in radians per root second, gyro bias drift in
+//  radians/s per root second, accel noise in g and the compass heading noise in radians
+
+#define RTFUSIONMEKF_GYRO_NOISE         (RTFLOAT)0.01
+#define RTFUSIONMEKF_BIAS_NOISE         (RTFLOAT)0.0005
+#define RTFUSIONMEKF_ACCEL_NOISE        (RTFLOAT)0.05
+#define RTFUSIONMEKF_COMPASS_NOISE      (RTFLOAT)0.05
+
+//  The accels aren't used if the magnitude is further than this from 1g as the IMU
+//  is accelerating
+
+#define RTFUSIONMEKF_ACCEL_GATE         (RTFLOAT)0.15
+
+class RTFusionMEKF : public RTFusion
+{
+public:
+    RTFusionMEKF();
+    ~RTFusionMEKF();
+
+    //  reset() resets the state but keeps any setting changes (such as enables)
+
+    void reset();
+
+    //  newIMUData() should be called for subsequent updates
+    //  It returns true as the fusion pose is updated on every sample.
+
+    bool newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp);
+
+    //  the following functions can be called to customize the noise values
+
+    void setGyroNoise(RTFLOAT noise) { m_gyroVariance = noise * noise; }
+    void setBiasNoise(RTFLOAT noise) { m_biasVariance = noise * noise; }
+    void setAccelNoise(RTFLOAT noise) { m_accelVariance = noise * noise; }
+    void setCompassNoise(RTFLOAT noise) { m_compassVariance = noise * noise; }
+
+    inline const RTVector3& getGyroBias() {return m_gyroBias;}   // the estimated residual gyro bias in radians/s
+
+private:
+    void predict(const RTVector3& gyro);                    // propagates the pose and covariance over m_timeDelta
+    void correct(const RTFLOAT *H, RTFLOAT residual, RTFLOAT variance); // scalar measurement update
+    void correctAccel(const RTVector3& accel);              // roll and pitch from the accels
+    void correctCompass(const RTVector3& compass);          // heading from the compass
+
+    RTFLOAT m_gyroVariance;                                 // gyro noise variance
+    RTFLOAT m_biasVariance;                                 // gyro bias drift variance
+    RTFLOAT m_accelVariance;                                // accel noise variance
+    RTFLOAT m_compassVariance;                              // compass heading noise variance
+
+    RTVector3 m_gyroBias;                                   // the gyro bias states
+    RTFLOAT m_error[6];                                     // attitude error and bias correction from this sample's updates
+    RTFLOAT m_P[6][6];                                      // the error state covariance
+};
+
+#endif // #ifndef RTARDULINK_MODE
+
+#endif // _RTFUSIONMEKF_H
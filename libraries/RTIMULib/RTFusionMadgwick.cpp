@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusionMadgwick.h"
+
+RTFusionMadgwick::RTFusionMadgwick()
+{
+    m_beta = RTFUSIONMADGWICK_BETA;
+    reset();
+}
+
+RTFusionMadgwick::~RTFusionMadgwick()
+{
+}
+
+//  The accels should measure the earth's z axis in the body frame and the compass the
+//  earth's field b = (bx, 0, bz), where b is the compass rotated into the earth frame
+//  with its horizontal part put onto x (north). The objective functions are the
+//  differences between these predictions and the normalized measurements:
+//
+//      fa = | 2(qx qz - qs qy) - ax        |
+//           | 2(qs qx + qy qz) - ay        |
+//           | 1 - 2(qx qx + qy qy) - az    |
+//
+//      fm = | bx(1 - 2(qy qy + qz qz)) + 2bz(qx qz - qs qy) - mx  |
+//           | 2bx(qx qy - qs qz) + 2bz(qs qx + qy qz) - my        |
+//           | 2bx(qs qy + qx qz) + bz(1 - 2(qx qx + qy qy)) - mz  |
+//
+//  and the gradient step is J'f, normalized.
+
+bool RTFusionMadgwick::newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp)
+{
+    RTFLOAT qs, qx, qy, qz;
+    RTFLOAT gx, gy, gz;
+    RTFLOAT ds, dx, dy, dz;
+    RTFLOAT s0, s1, s2, s3;
+    RTFLOAT norm;
+
+    if (m_firstTime) {
+        m_lastFusionTime = timestamp;
+        initialPose(accel, compass);
+        m_firstTime = false;
+        return true;
+    }
+
+    if (!updateTimeDelta(timestamp))
+        return false;
+
+    qs = m_fusionQPose.scalar();
+    qx = m_fusionQPose.x();
+    qy = m_fusionQPose.y();
+    qz = m_fusionQPose.z();
+
+    gx = gy = gz = 0;
+
+    if (m_enableGyro) {
+        gx = gyro.x();
+        gy = gyro.y();
+        gz = gyro.z();
+    }
+
+    //  the rate of change of the pose from the gyros
+
+    ds = (-qx * gx - qy * gy - qz * gz) / (RTFLOAT)2.0;
+    dx = (qs * gx + qy * gz - qz * gy) / (RTFLOAT)2.0;
+    dy = (qs * gy - qx * gz + qz * gx) / (RTFLOAT)2.0;
+    dz = (qs * gz + qx * gy - qy * gx) / (RTFLOAT)2.0;
+
+    norm = accel.x() * accel.x() + accel.y() * accel.y() + accel.z() * accel.z();
+
+    if (m_enableAccel && (norm > 0)) {
+        norm = (RTFLOAT)1.0 / sqrt(norm);
+        RTFLOAT ax = accel.x() * norm;
+        RTFLOAT ay = accel.y() * norm;
+        RTFLOAT az = accel.z() * norm;
+
+        RTFLOAT f0 = 2 * (qx * qz - qs * qy) - ax;
+        RTFLOAT f1 = 2 * (qs * qx + qy * qz) - ay;
+        RTFLOAT f2 = 1 - 2 * (qx * qx + qy * qy) - az;
+
+        s0 = -2 * qy * f0 + 2 * qx * f1;
+        s1 = 2 * qz * f0 + 2 * qs * f1 - 4 * qx * f2;
+        s2 = -2 * qs * f0 + 2 * qz * f1 - 4 * qy * f2;
+        s3 = 2 * qx * f0 + 2 * qy * f1;
+
+        norm = compass.x() * compass.x() + compass.y() * compass.y() + compass.z() * compass.z();
+
+        if (m_enableCompass && (norm > 0)) {
+            norm = (RTFLOAT)1.0 / sqrt(norm);
+            RTFLOAT mx = compass.x() * norm;
+            RTFLOAT my = compass.y() * norm;
+            RTFLOAT mz = compass.z() * norm;
+
+            //  the compass in the earth frame
+
+            RTFLOAT hx = (1 - 2 * (qy * qy + qz * qz)) * mx + 2 * (qx * qy - qs * qz) * my + 2 * (qx * qz + qs * qy) * mz;
+            RTFLOAT hy = 2 * (qx * qy + qs * qz) * mx + (1 - 2 * (qx * qx + qz * qz)) * my + 2 * (qy * qz - qs * qx) * mz;
+            RTFLOAT bz = 2 * (qx * qz - qs * qy) * mx + 2 * (qs * qx + qy * qz) * my + (1 - 2 * (qx * qx + qy * qy)) * mz;
+            RTFLOAT bx = sqrt(hx * hx + hy * hy);
+
+            RTFLOAT f3 = bx * (1 - 2 * (qy * qy + qz * qz)) + 2 * bz * (qx * qz - qs * qy) - mx;
+            RTFLOAT f4 = 2 * bx * (qx * qy - qs * qz) + 2 * bz * (qs * qx + qy * qz) - my;
+            RTFLOAT f5 = 2 * bx * (qs * qy + qx * qz) + bz * (1 - 2 * (qx * qx + qy * qy)) - mz;
+
+            s0 += -2 * bz * qy * f3 + 2 * (bz * qx - bx * qz) * f4 + 2 * bx * qy * f5;
+            s1 += 2 * bz * qz * f3 + 2 * (bx * qy + bz * qs) * f4 + 2 * (bx * qz - 2 * bz * qx) * f5;
+            s2 += -2 * (2 * bx * qy + bz * qs) * f3 + 2 * (bx * qx + bz * qz) * f4 + 2 * (bx * qs - 2 * bz * qy) * f5;
+            s3 += 2 * (bz * qx - 2 * bx * qz) * f3 + 2 * (bz * qy - bx * qs) * f4 + 2 * bx * qx * f5;
+        }
+
+        norm = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+
+        if (norm > 0) {
+            norm = m_beta / sqrt(norm);
+            ds -= s0 * norm;
+            dx -= s1 * norm;
+            dy -= s2 * norm;
+            dz -= s3 * norm;
+        }
+    }
+
+    m_fusionQPose.setScalar(qs + ds * m_timeDelta);
+    m_fusionQPose.setX(qx + dx * m_timeDelta);
+    m_fusionQPose.setY(qy + dy * m_timeDelta);
+    m_fusionQPose.setZ(qz + dz * m_timeDelta);
+    m_fusionQPose.normalize();
+    m_fusionPoseValid = false;
+    return true;
+}
+
+#endif // #ifndef RTARDULINK_MODE
@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTFUSIONMADGWICK_H
+#define	_RTFUSIONMADGWICK_H
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusion.h"
+
+//  RTFusionMadgwick is Sebastian Madgwick's gradient descent orientation filter. Each
+//  sample takes one gradient descent step towards the pose that matches the accels (and
+//  compass) and adds it to the gyro rate, scaled by beta. There's no trig on the update
+//  path - the fusion pose Euler angles are only calculated when asked for.
+
+//  The default beta in radians/s - bigger follows the accels and compass more closely
+
+#define RTFUSIONMADGWICK_BETA           (RTFLOAT)0.05
+
+class RTFusionMadgwick : public RTFusion
+{
+public:
+    RTFusionMadgwick();
+    ~RTFusionMadgwick();
+
+    //  newIMUData() should be called for subsequent updates
+    //  It returns true as the fusion pose is updated on every sample.
+
+    bool newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp);
+
+    //  the following function can be called to set beta
+
+    void setBeta(RTFLOAT beta) { m_beta = beta; }
+
+private:
+    RTFLOAT m_beta;                                         // the gradient descent step gain
+};
+
+#endif // #ifndef RTARDULINK_MODE
+
+#endif // _RTFUSIONMADGWICK_H
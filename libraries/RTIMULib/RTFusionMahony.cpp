@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusionMahony.h"
+
+RTFusionMahony::RTFusionMahony()
+{
+    m_kp = RTFUSIONMAHONY_KP;
+    m_ki = RTFUSIONMAHONY_KI;
+    reset();
+}
+
+RTFusionMahony::~RTFusionMahony()
+{
+}
+
+void RTFusionMahony::reset()
+{
+    RTFusion::reset();
+    m_gyroBias = RTVector3();
+}
+
+//  The error is the cross product of the measured and estimated directions - the
+//  accels against the earth's z axis in the body frame and the compass against the
+//  earth's field b = (bx, 0, bz), where b is the compass rotated into the earth frame
+//  with its horizontal part put onto x (north). It's the axis (and for small errors
+//  the angle) to rotate the estimate by to match the measurements.
+
+bool RTFusionMahony::newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp)
+{
+    RTFLOAT qs, qx, qy, qz;
+    RTFLOAT gx, gy, gz;
+    RTFLOAT ex, ey, ez;
+    RTFLOAT norm;
+
+    if (m_firstTime) {
+        m_lastFusionTime = timestamp;
+        initialPose(accel, compass);
+        m_firstTime = false;
+        return true;
+    }
+
+    if (!updateTimeDelta(timestamp))
+        return false;
+
+    qs = m_fusionQPose.scalar();
+    qx = m_fusionQPose.x();
+    qy = m_fusionQPose.y();
+    qz = m_fusionQPose.z();
+
+    ex = ey = ez = 0;
+
+    norm = accel.x() * accel.x() + accel.y() * accel.y() + accel.z() * accel.z();
+
+    if (m_enableAccel && (norm > 0)) {
+        norm = (RTFLOAT)1.0 / sqrt(norm);
+        RTFLOAT ax = accel.x() * norm;
+        RTFLOAT ay = accel.y() * norm;
+        RTFLOAT az = accel.z() * norm;
+
+        RTFLOAT vx = 2 * (qx * qz - qs * qy);
+        RTFLOAT vy = 2 * (qs * qx + qy * qz);
+        RTFLOAT vz = 1 - 2 * (qx * qx + qy * qy);
+
+        ex = ay * vz - az * vy;
+        ey = az * vx - ax * vz;
+        ez = ax * vy - ay * vx;
+    }
+
+    norm = compass.x() * compass.x() + compass.y() * compass.y() + compass.z() * compass.z();
+
+    if (m_enableCompass && (norm > 0)) {
+        norm = (RTFLOAT)1.0 / sqrt(norm);
+        RTFLOAT mx = compass.x() * norm;
+        RTFLOAT my = compass.y() * norm;
+        RTFLOAT mz = compass.z() * norm;
+
+        //  the compass in the earth frame
+
+        RTFLOAT hx = (1 - 2 * (qy * qy + qz * qz)) * mx + 2 * (qx * qy - qs * qz) * my + 2 * (qx * qz + qs * qy) * mz;
+        RTFLOAT hy = 2 * (qx * qy + qs * qz) * mx + (1 - 2 * (qx * qx + qz * qz)) * my + 2 * (qy * qz - qs * qx) * mz;
+        RTFLOAT bz = 2 * (qx * qz - qs * qy) * mx + 2 * (qs * qx + qy * qz) * my + (1 - 2 * (qx * qx + qy * qy)) * mz;
+        RTFLOAT bx = sqrt(hx * hx + hy * hy);
+
+        //  and the estimated direction of the field in the body frame
+
+        RTFLOAT wx = bx * (1 - 2 * (qy * qy + qz * qz)) + 2 * bz * (qx * qz - qs * qy);
+        RTFLOAT wy = 2 * bx * (qx * qy - qs * qz) + 2 * bz * (qs * qx + qy * qz);
+        RTFLOAT wz = 2 * bx * (qs * qy + qx * qz) + bz * (1 - 2 * (qx * qx + qy * qy));
+
+        ex += my * wz - mz * wy;
+        ey += mz * wx - mx * wz;
+        ez += mx * wy - my * wx;
+    }
+
+    gx = gy = gz = 0;
+
+    if (m_enableGyro) {
+        if (m_ki > 0) {
+            m_gyroBias.setX(m_gyroBias.x() - m_ki * ex * m_timeDelta);
+            m_gyroBias.setY(m_gyroBias.y() - m_ki * ey * m_timeDelta);
+            m_gyroBias.setZ(m_gyroBias.z() - m_ki * ez * m_timeDelta);
+        }
+        gx = gyro.x() - m_gyroBias.x();
+        gy = gyro.y() - m_gyroBias.y();
+        gz = gyro.z() - m_gyroBias.z();
+    }
+
+    gx += m_kp * ex;
+    gy += m_kp * ey;
+    gz += m_kp * ez;
+
+    //  integrate the corrected rates
+
+    m_fusionQPose.setScalar(qs + (-qx * gx - qy * gy - qz * gz) * m_timeDelta / (RTFLOAT)2.0);
+    m_fusionQPose.setX(qx + (qs * gx + qy * gz - qz * gy) * m_timeDelta / (RTFLOAT)2.0);
+    m_fusionQPose.setY(qy + (qs * gy - qx * gz + qz * gx) * m_timeDelta / (RTFLOAT)2.0);
+    m_fusionQPose.setZ(qz + (qs * gz + qx * gy - qy * gx) * m_timeDelta / (RTFLOAT)2.0);
+    m_fusionQPose.normalize();
+    m_fusionPoseValid = false;
+    return true;
+}
+
+#endif // #ifndef RTARDULINK_MODE
@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTFUSIONMAHONY_H
+#define	_RTFUSIONMAHONY_H
+
+#ifndef RTARDULINK_MODE
+
+#include "RTFusion.h"
+
+//  RTFusionMahony is Robert Mahony's nonlinear complementary filter. The error between
+//  the measured and estimated directions of gravity (and the magnetic field) is fed back
+//  into the gyro rates through a PI controller - the integral term removes any gyro
+//  bias. There's no trig on the update path - the fusion pose Euler angles are only
+//  calculated when asked for.
+
+//  The default proportional and integral gains
+
+#define RTFUSIONMAHONY_KP               (RTFLOAT)1.0
+#define RTFUSIONMAHONY_KI               (RTFLOAT)0.05
+
+class RTFusionMahony : public RTFusion
+{
+public:
+    RTFusionMahony();
+    ~RTFusionMahony();
+
+    //  reset() resets the state but keeps any setting changes (such as enables)
+
+    void reset();
+
+    //  newIMUData() should be called for subsequent updates
+    //  It returns true as the fusion pose is updated on every sample.
+
+    bool newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp);
+
+    //  the following functions can be called to set the gains
+
+    void setKp(RTFLOAT kp) { m_kp = kp; }
+    void setKi(RTFLOAT ki) { m_ki = ki; }
+
+    inline const RTVector3& getGyroBias() {return m_gyroBias;}   // the estimated residual gyro bias in radians/s
+
+private:
+    RTFLOAT m_kp;                                           // proportional gain
+    RTFLOAT m_ki;                                           // integral gain
+    RTVector3 m_gyroBias;                                   // the integral term - the gyro bias estimate
+};
+
+#endif // #ifndef RTARDULINK_MODE
+
+#endif // _RTFUSIONMAHONY_H
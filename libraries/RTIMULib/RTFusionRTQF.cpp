@@ -51,9 +51,8 @@ RTFusionRTQF::RTFusionRTQF()
     m_Q = RTQF_QVALUE;
     m_R = RTQF_RVALUE;
 #endif
-    m_enableGyro = true;
-    m_enableAccel = true;
-    m_enableCompass = true;
+    m_correctionInterval = 0;
+    m_outputInterval = 0;
     reset();
 }
 
@@ -63,17 +62,13 @@ RTFusionRTQF::~RTFusionRTQF()
 
 void RTFusionRTQF::reset()
 {
-    m_firstTime = true;
-    m_fusionPose = RTVector3();
-    m_fusionQPose.fromEuler(m_fusionPose);
+    RTFusion::reset();
     m_measuredPose = RTVector3();
     m_measuredQPose.fromEuler(m_measuredPose);
 }
 
-void RTFusionRTQF::newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp)
+bool RTFusionRTQF::newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp)
 {
-    RTVector3 fusionGyro;
-
     if (m_firstTime) {
         m_lastFusionTime = timestamp;
         calculatePose(accel, compass);
@@ -82,90 +77,166 @@ void RTFusionRTQF::newIMUData(const RTVector3& gyro, const RTVector3& accel, con
 
         m_fusionQPose.fromEuler(m_measuredPose);
         m_fusionPose = m_measuredPose;
+        m_lastCorrectionTime = m_lastOutputTime = timestamp;
+        m_correctionTime = 0;
+        m_correctionSamples = 0;
+        m_lastRate = m_enableGyro ? gyro : RTVector3();
         m_firstTime = false;
-    } else {
-        m_timeDelta = (RTFLOAT)(timestamp - m_lastFusionTime) / (RTFLOAT)1000;
-        m_lastFusionTime = timestamp;
-        if (m_timeDelta <= 0)
-            return;
+        return true;
+    }
+
+    if (!updateTimeDelta(timestamp))
+        return false;
 
+    if (m_correctionInterval == 0) {
         calculatePose(accel, compass);
+        predict(gyro);
+        update(m_timeDelta, 1);
+    } else {
+        predictConing(gyro);
+        m_correctionTime += m_timeDelta;
+        m_correctionSamples++;
+
+        if ((timestamp - m_lastCorrectionTime) >= m_correctionInterval) {
+            calculatePose(accel, compass);
+            update(m_correctionTime, m_correctionSamples);
+            m_lastCorrectionTime = timestamp;
+            m_correctionTime = 0;
+            m_correctionSamples = 0;
+        }
+    }
 
-//      predict();
+    m_fusionQPose.normalize();
 
-        RTFLOAT x2, y2, z2;
-        RTFLOAT qs, qx, qy,qz;
+    if ((m_outputInterval != 0) && ((timestamp - m_lastOutputTime) < m_outputInterval))
+        return false;
 
-        qs = m_fusionQPose.scalar();
-        qx = m_fusionQPose.x();
-        qy = m_fusionQPose.y();
-        qz = m_fusionQPose.z();
+    m_lastOutputTime = timestamp;
+    m_fusionQPose.toEuler(m_fusionPose);
+    return true;
+}
 
-        if (m_enableGyro)
-            fusionGyro = gyro;
-        else
-            fusionGyro = RTVector3();
+void RTFusionRTQF::predict(const RTVector3& gyro)
+{
+    RTVector3 fusionGyro;
+    RTFLOAT x2, y2, z2;
+    RTFLOAT qs, qx, qy,qz;
 
-        x2 = fusionGyro.x() / (RTFLOAT)2.0;
-        y2 = fusionGyro.y() / (RTFLOAT)2.0;
-        z2 = fusionGyro.z() / (RTFLOAT)2.0;
+    qs = m_fusionQPose.scalar();
+    qx = m_fusionQPose.x();
+    qy = m_fusionQPose.y();
+    qz = m_fusionQPose.z();
 
-        // Predict new state
+    if (m_enableGyro)
+        fusionGyro = gyro;
+    else
+        fusionGyro = RTVector3();
 
-        m_fusionQPose.setScalar(qs + (-x2 * qx - y2 * qy - z2 * qz) * m_timeDelta);
-        m_fusionQPose.setX(qx + (x2 * qs + z2 * qy - y2 * qz) * m_timeDelta);
-        m_fusionQPose.setY(qy + (y2 * qs - z2 * qx + x2 * qz) * m_timeDelta);
-        m_fusionQPose.setZ(qz + (z2 * qs + y2 * qx - x2 * qy) * m_timeDelta);
+    m_lastRate = fusionGyro;
 
-//      update();
+    x2 = fusionGyro.x() / (RTFLOAT)2.0;
+    y2 = fusionGyro.y() / (RTFLOAT)2.0;
+    z2 = fusionGyro.z() / (RTFLOAT)2.0;
 
-#ifdef USE_SLERP
-        if (m_enableCompass || m_enableAccel) {
+    // Predict new state
 
-            // calculate rotation delta
+    m_fusionQPose.setScalar(qs + (-x2 * qx - y2 * qy - z2 * qz) * m_timeDelta);
+    m_fusionQPose.setX(qx + (x2 * qs + z2 * qy - y2 * qz) * m_timeDelta);
+    m_fusionQPose.setY(qy + (y2 * qs - z2 * qx + x2 * qz) * m_timeDelta);
+    m_fusionQPose.setZ(qz + (z2 * qs + y2 * qx - x2 * qy) * m_timeDelta);
+}
 
-            m_rotationDelta = m_fusionQPose.conjugate() * m_measuredQPose;
-            m_rotationDelta.normalize();
+//  predictConing() rotates the pose by the rotation vector over the sample interval. With
+//  the rates at each end of the interval, that's the trapezoidal angle plus a coning term
+//  for the rate vector turning during the interval. The rotation quaternion uses the series
+//  for sin and cos, good to the fourth power of the angle, so there's no trig per sample.
 
-            // take it to the power (0 to 1) to give the desired amount of correction
+void RTFusionRTQF::predictConing(const RTVector3& gyro)
+{
+    RTVector3 rate;
+    RTVector3 coning;
+    RTVector3 angle;
+    RTQuaternion rotation;
+    RTFLOAT angle2;
+    RTFLOAT vectorScale;
 
-            RTFLOAT theta = acos(m_rotationDelta.scalar());
+    if (m_enableGyro)
+        rate = gyro;
 
-            RTFLOAT sinPowerTheta = sin(theta * m_slerpPower);
-            RTFLOAT cosPowerTheta = cos(theta * m_slerpPower);
+    RTVector3::crossProduct(m_lastRate, rate, coning);
 
-            m_rotationUnitVector.setX(m_rotationDelta.x());
-            m_rotationUnitVector.setY(m_rotationDelta.y());
-            m_rotationUnitVector.setZ(m_rotationDelta.z());
-            m_rotationUnitVector.normalize();
+    angle.setX((m_lastRate.x() + rate.x()) * m_timeDelta / (RTFLOAT)2.0 + coning.x() * m_timeDelta * m_timeDelta / (RTFLOAT)12.0);
+    angle.setY((m_lastRate.y() + rate.y()) * m_timeDelta / (RTFLOAT)2.0 + coning.y() * m_timeDelta * m_timeDelta / (RTFLOAT)12.0);
+    angle.setZ((m_lastRate.z() + rate.z()) * m_timeDelta / (RTFLOAT)2.0 + coning.z() * m_timeDelta * m_timeDelta / (RTFLOAT)12.0);
+    m_lastRate = rate;
 
-            m_rotationPower.setScalar(cosPowerTheta);
-            m_rotationPower.setX(sinPowerTheta * m_rotationUnitVector.x());
-            m_rotationPower.setY(sinPowerTheta * m_rotationUnitVector.y());
-            m_rotationPower.setZ(sinPowerTheta * m_rotationUnitVector.z());
-            m_rotationPower.normalize();
+    angle2 = angle.squareLength();
+    vectorScale = (RTFLOAT)0.5 - angle2 / (RTFLOAT)48.0;
 
-            //  multiple this by predicted value to get result
+    rotation.setScalar((RTFLOAT)1.0 - angle2 / (RTFLOAT)8.0 + angle2 * angle2 / (RTFLOAT)384.0);
+    rotation.setX(angle.x() * vectorScale);
+    rotation.setY(angle.y() * vectorScale);
+    rotation.setZ(angle.z() * vectorScale);
 
-            m_fusionQPose *= m_rotationPower;
-        }
-#else
-        if (m_enableCompass || m_enableAccel) {
-            m_stateQError = m_measuredQPose - m_fusionQPose;
-        } else {
-            m_stateQError = RTQuaternion();
-        }
-        // make new state estimate
+    m_fusionQPose *= rotation;
+}
 
-        RTFLOAT qt = m_Q * m_timeDelta;
+//  update() corrects the predicted pose towards the measured one. timeDelta and samples
+//  cover the predictions since the last correction so that the overall correction rate
+//  doesn't depend on how often it's done.
 
-        m_fusionQPose += m_stateQError * (qt / (qt + m_R));
-#endif
+void RTFusionRTQF::update(RTFLOAT timeDelta, int samples)
+{
+#ifdef USE_SLERP
+    (void)timeDelta;                                        // only the Kalman version needs it
+
+    if (m_enableCompass || m_enableAccel) {
+
+        // calculate rotation delta
+
+        m_rotationDelta = m_fusionQPose.conjugate() * m_measuredQPose;
+        m_rotationDelta.normalize();
+
+        // take it to the power (0 to 1) to give the desired amount of correction - the
+        // power compounds over the samples since the last correction
+
+        RTFLOAT power = m_slerpPower;
+
+        if (samples > 1)
+            power = (RTFLOAT)1.0 - pow((RTFLOAT)1.0 - m_slerpPower, (RTFLOAT)samples);
+
+        RTFLOAT theta = acos(m_rotationDelta.scalar());
+
+        RTFLOAT sinPowerTheta = sin(theta * power);
+        RTFLOAT cosPowerTheta = cos(theta * power);
+
+        m_rotationUnitVector.setX(m_rotationDelta.x());
+        m_rotationUnitVector.setY(m_rotationDelta.y());
+        m_rotationUnitVector.setZ(m_rotationDelta.z());
+        m_rotationUnitVector.normalize();
 
-        m_fusionQPose.normalize();
+        m_rotationPower.setScalar(cosPowerTheta);
+        m_rotationPower.setX(sinPowerTheta * m_rotationUnitVector.x());
+        m_rotationPower.setY(sinPowerTheta * m_rotationUnitVector.y());
+        m_rotationPower.setZ(sinPowerTheta * m_rotationUnitVector.z());
+        m_rotationPower.normalize();
 
-        m_fusionQPose.toEuler(m_fusionPose);
+        //  multiple this by predicted value to get result
+
+        m_fusionQPose *= m_rotationPower;
     }
+#else
+    if (m_enableCompass || m_enableAccel) {
+        m_stateQError = m_measuredQPose - m_fusionQPose;
+    } else {
+        m_stateQError = RTQuaternion();
+    }
+    // make new state estimate
+
+    RTFLOAT qt = m_Q * timeDelta;
+
+    m_fusionQPose += m_stateQError * (qt / (qt + m_R));
+#endif
 }
 
 void RTFusionRTQF::calculatePose(const RTVector3& accel, const RTVector3& mag)
@@ -175,10 +246,17 @@ void RTFusionRTQF::calculatePose(const RTVector3& accel, const RTVector3& mag)
 
     bool compassValid = (mag.x() != 0) || (mag.y() != 0) || (mag.z() != 0);
 
+    //  the fusion pose is only up to date with no output interval
+
+    RTVector3 fusionPose = m_fusionPose;
+
+    if ((m_outputInterval != 0) && (!m_enableAccel || !m_enableCompass || !compassValid))
+        m_fusionQPose.toEuler(fusionPose);
+
     if (m_enableAccel) {
         accel.accelToEuler(m_measuredPose);
     } else {
-        m_measuredPose = m_fusionPose;
+        m_measuredPose = fusionPose;
     }
 
     if (m_enableCompass && compassValid) {
@@ -202,7 +280,7 @@ void RTFusionRTQF::calculatePose(const RTVector3& accel, const RTVector3& mag)
         m = q * m * q.conjugate();
         m_measuredPose.setZ(-atan2(m.y(), m.x()));
     } else {
-        m_measuredPose.setZ(m_fusionPose.z());
+        m_measuredPose.setZ(fusionPose.z());
     }
 
     m_measuredQPose.fromEuler(m_measuredPose);
@@ -26,13 +26,13 @@
 
 #ifndef RTARDULINK_MODE
 
-#include "RTMath.h"
+#include "RTFusion.h"
 
 //  Define this symbol to use more scientific prediction correction
 
 #define USE_SLERP
 
-class RTFusionRTQF
+class RTFusionRTQF : public RTFusion
 {
 public:
     RTFusionRTQF();
@@ -43,15 +43,22 @@ public:
     void reset();
 
     //  newIMUData() should be called for subsequent updates
-    //  deltaTime is in units of seconds
+    //  It returns true if the fusion pose (the Euler angles) was updated - that's every
+    //  sample unless an output interval has been set.
 
-    void newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp);
+    bool newIMUData(const RTVector3& gyro, const RTVector3& accel, const RTVector3& compass, unsigned long timestamp);
 
-    //  the following three functions control the influence of the gyro, accel and compass sensors
+    //  By default every sample is integrated, corrected by the accels and compass and
+    //  converted to the fusion pose. setCorrectionInterval() sets the time in uS between
+    //  corrections instead. The gyros are then integrated on every sample with a second
+    //  order, coning compensated rotation vector update, which holds up much better at high
+    //  angular rates than the simple one, and the correction (most of the trig) only runs
+    //  that often.
+    //  setOutputInterval() does the same for the fusion pose. The quaternion pose is
+    //  always up to date. 0 for either goes back to every sample.
 
-    void setGyroEnable(bool enable) { m_enableGyro = enable;}
-    void setAccelEnable(bool enable) { m_enableAccel = enable; }
-    void setCompassEnable(bool enable) { m_enableCompass = enable;}
+    void setCorrectionInterval(unsigned long interval) { m_correctionInterval = interval; }
+    void setOutputInterval(unsigned long interval) { m_outputInterval = interval; }
 
 #ifdef USE_SLERP
     //  the following function can be called to set the SLERP power
@@ -64,13 +71,12 @@ public:
 #endif
     inline const RTVector3& getMeasuredPose() {return m_measuredPose;}
     inline const RTQuaternion& getMeasuredQPose() {return m_measuredQPose;}
-    inline const RTVector3& getFusionPose() {return m_fusionPose;}
-    inline const RTQuaternion& getFusionQPose() {return m_fusionQPose;}
 
 private:
     void calculatePose(const RTVector3& accel, const RTVector3& mag); // generates pose from accels and heading
-
-    RTFLOAT m_timeDelta;                                    // time between predictions
+    void predict(const RTVector3& gyro);                    // integrates the gyros over m_timeDelta
+    void predictConing(const RTVector3& gyro);              // the same with the coning compensated update
+    void update(RTFLOAT timeDelta, int samples);            // corrects towards the measured pose
 
     RTQuaternion m_stateQError;                             // difference between stateQ and measuredQ
 
@@ -85,15 +91,14 @@ private:
 #endif
     RTQuaternion m_measuredQPose;       					// quaternion form of pose from measurement
     RTVector3 m_measuredPose;								// vector form of pose from measurement
-    RTQuaternion m_fusionQPose;                             // quaternion form of pose from fusion
-    RTVector3 m_fusionPose;                                 // vector form of pose from fusion
-
-    bool m_enableGyro;                                      // enables gyro as input
-    bool m_enableAccel;                                     // enables accel as input
-    bool m_enableCompass;                                   // enables compass a input
 
-    bool m_firstTime;                                       // if first time after reset
-    unsigned long m_lastFusionTime;                         // for delta time calculation
+    unsigned long m_correctionInterval;                     // uS between corrections (0 for every sample)
+    unsigned long m_outputInterval;                         // uS between fusion pose updates (0 for every sample)
+    unsigned long m_lastCorrectionTime;
+    unsigned long m_lastOutputTime;
+    RTFLOAT m_correctionTime;                               // time integrated since the last correction
+    int m_correctionSamples;                                // and the samples
+    RTVector3 m_lastRate;                                   // previous gyro rates for the coning update
 };
 
 #endif // #ifndef RTARDULINK_MODE
@@ -246,6 +246,21 @@ void RTIMU::gyroBiasInit()
     m_gyroSampleCount = 0;
 }
 
+//  The bias learnt so far is kept. The learning rate follows the new sample rate and the
+//  stable sample count is rescaled so that the same stable time is still needed.
+
+void RTIMU::gyroBiasRateChange(int oldRate)
+{
+    m_gyroAlpha = 2.0f / m_sampleRate;
+
+    if (m_gyroBiasValid || (oldRate == m_sampleRate))
+        return;
+
+    m_gyroSampleCount = (int)((long)m_gyroSampleCount * m_sampleRate / oldRate);
+    if (m_gyroSampleCount >= (5 * m_sampleRate))
+        m_gyroSampleCount = 5 * m_sampleRate - 1;           // the next stable sample makes it valid
+}
+
 //  Note - code assumes that this is the first thing called after axis swapping
 //  for each specific IMU chip has occurred.
 
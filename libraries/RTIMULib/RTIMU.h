@@ -27,6 +27,21 @@
 #include "RTMath.h"
 #include "RTIMULibDefs.h"
 #include "I2Cdev.h"
+#include "RTIMUSPI.h"
+#include "RTIMUShadow.h"
+
+//  The register transport for the drivers that can use SPI as well as I2C (MPU9250 and
+//  LSM9DS0). RTIMUSPI has the same static interface as I2Cdev with the chip select pin
+//  in place of the I2C address.
+
+#ifdef RTIMU_SPI
+typedef RTIMUSPI RTIMUBus;
+#else
+typedef I2Cdev RTIMUBus;
+#ifdef I2CDEV_ASYNC
+#define RTIMUBUS_ASYNC                                      // transactions run in the background
+#endif
+#endif
 
 #define I2CWrite(x, y, z) I2Cdev::writeByte(x, y, z)
 #define I2CRead(w, x, y, z) I2Cdev::readBytes(w, x, y, z)
@@ -53,6 +68,9 @@ public:
     virtual int IMUGetPollInterval() = 0;                   // returns the recommended poll interval in mS
     virtual bool IMURead() = 0;                             // get a sample
 
+    inline int IMUGetSampleRate() { return m_sampleRate; }  // the configured sample rate in samples per second
+    virtual unsigned long IMUGetLostSamples() { return 0; } // samples lost to the chip's FIFO overflowing
+
     //  This one wanted a similar name but isn't pure virtual
 
     virtual bool IMUCompassCalValid() { return m_calibrationValid; }
@@ -77,10 +95,11 @@ public:
     inline const RTVector3& getGyro() { return m_gyro; }            // gets gyro rates in radians/sec
     inline const RTVector3& getAccel() { return m_accel; }          // get accel data in gs
     inline const RTVector3& getCompass() { return m_compass; }      // gets compass data in uT
-    inline unsigned long getTimestamp() { return m_timestamp; }     // and the timestamp for it
+    inline unsigned long getTimestamp() { return m_timestamp; }     // and the timestamp for it in uS
 
 protected:
     void gyroBiasInit();                                    // sets up gyro bias calculation
+    void gyroBiasRateChange(int oldRate);                   // keeps gyro bias learning across a sample rate change
     void handleGyroBias();                                  // adjust gyro for bias
     void calibrateAverageCompass();                         // calibrate and smooth compass
     bool m_calibrationMode;                                 // true if cal mode so don't use cal data!
@@ -89,12 +108,12 @@ protected:
     RTVector3 m_gyro;                                       // the gyro readings
     RTVector3 m_accel;                                      // the accel readings
     RTVector3 m_compass;                                    // the compass readings
-    unsigned long m_timestamp;                              // the timestamp
+    unsigned long m_timestamp;                              // the sample time in uS (micros() - it wraps every 71 minutes)
 
     RTIMUSettings *m_settings;                              // the settings object pointer
 
     int m_sampleRate;                                       // samples per second
-    uint64_t m_sampleInterval;                              // interval between samples in microseonds
+    uint64_t m_sampleInterval;                              // interval between samples in microseconds
 
     RTFLOAT m_gyroAlpha;                                    // gyro bias learning rate
     int m_gyroSampleCount;                                  // number of gyro samples used
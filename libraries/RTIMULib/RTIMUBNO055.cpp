@@ -43,7 +43,7 @@
 RTIMUBNO055::RTIMUBNO055(RTIMUSettings *settings) : RTIMU(settings)
 {
     m_sampleRate = 100;
-    m_sampleInterval = (unsigned long)1000 / m_sampleRate;
+    m_sampleInterval = (unsigned long)1000000 / m_sampleRate;
 }
 
 RTIMUBNO055::~RTIMUBNO055()
@@ -55,7 +55,8 @@ int RTIMUBNO055::IMUInit()
     unsigned char result;
 
     m_slaveAddr = m_settings->m_I2CSlaveAddress;
-    m_lastReadTime = millis();
+    I2Cdev::setDeviceClock(m_slaveAddr, I2CDEV_CLOCK_FAST);  // up to 400kHz
+    m_lastReadTime = micros();
 
     if (!I2Cdev::readByte(m_slaveAddr, BNO055_WHO_AM_I, &result))
         return -1;
@@ -64,50 +65,50 @@ int RTIMUBNO055::IMUInit()
         return -2;
     }
 
+    m_shadow.setDevice(m_slaveAddr, RTIMUSHADOW_WRITES_INCREMENT);
+
     if (!I2Cdev::writeByte(m_slaveAddr, BNO055_OPER_MODE, BNO055_OPER_MODE_CONFIG))
         return -3;
 
-    delay(50);
-
     if (!I2Cdev::writeByte(m_slaveAddr, BNO055_SYS_TRIGGER, 0x20))
         return -4;
 
     delay(50);
 
-    while (1) {
-        if (!I2Cdev::readByte(m_slaveAddr, BNO055_WHO_AM_I, &result))
-            continue;
-        if (result == BNO055_ID)
-            break;
-        delay(50);
-    }
+    //  the reset takes about 650mS - the chip NACKs until it is back so don't poll too often
 
-    delay(50);
+    if (!RTIMUShadow::waitFor(m_slaveAddr, BNO055_WHO_AM_I, 0xff, BNO055_ID, 1000, 10))
+        return -10;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, BNO055_PWR_MODE, BNO055_PWR_MODE_NORMAL))
-        return -5;
+    //  the reset leaves normal power mode, page 0 and no triggers so those writes are skipped
 
-    delay(50);
+    m_shadow.invalidate();
+    m_shadow.assume(BNO055_PWR_MODE, BNO055_PWR_MODE_NORMAL);
+    m_shadow.assume(BNO055_PAGE_ID, 0);
+    m_shadow.assume(BNO055_SYS_TRIGGER, 0x00);
 
-    if (!I2Cdev::writeByte(m_slaveAddr, BNO055_PAGE_ID, 0))
-        return -6;
+    if (!m_shadow.write(BNO055_PWR_MODE, BNO055_PWR_MODE_NORMAL))
+        return -5;
 
-    delay(50);
+    if (!m_shadow.write(BNO055_PAGE_ID, 0))
+        return -6;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, BNO055_SYS_TRIGGER, 0x00))
+    if (!m_shadow.write(BNO055_SYS_TRIGGER, 0x00))
         return -7;
 
-    delay(50);
-
-    if (!I2Cdev::writeByte(m_slaveAddr, BNO055_UNIT_SEL, 0x87))
+    if (!m_shadow.write(BNO055_UNIT_SEL, 0x87))
         return -8;
 
-    delay(50);
+    if (!m_shadow.write(BNO055_OPER_MODE, BNO055_OPER_MODE_NDOF))
+        return -9;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, BNO055_OPER_MODE, BNO055_OPER_MODE_NDOF))
+    if (!m_shadow.flush())
         return -9;
 
-    delay(50);
+    //  the fusion algorithm starts a few mS after leaving config mode
+
+    if (!RTIMUShadow::waitFor(m_slaveAddr, BNO055_SYS_STATUS, 0xff, BNO055_SYS_STATUS_FUSION, 100))
+        return -11;
 
     return 1;
 }
@@ -121,10 +122,10 @@ bool RTIMUBNO055::IMURead()
 {
     unsigned char buffer[24];
 
-    if ((millis() - m_lastReadTime) < m_sampleInterval)
+    if ((micros() - m_lastReadTime) < m_sampleInterval)
         return false;                                       // too soon
 
-    m_lastReadTime = millis();
+    m_lastReadTime = micros();
     if (!I2Cdev::readBytes(m_slaveAddr, BNO055_ACCEL_DATA, 24, buffer))
         return false;
 
@@ -174,7 +175,7 @@ bool RTIMUBNO055::IMURead()
 
     m_fusionQPose.fromEuler(m_fusionPose);
 
-    m_timestamp = millis();
+    m_timestamp = micros();
     return true;
 }
 #endif
\ No newline at end of file
@@ -42,6 +42,7 @@
 #define BNO055_GYRO_DATA            0x14
 #define BNO055_FUSED_EULER          0x1a
 #define BNO055_FUSED_QUAT           0x20
+#define BNO055_SYS_STATUS           0x39
 #define BNO055_UNIT_SEL             0x3b
 #define BNO055_OPER_MODE            0x3d
 #define BNO055_PWR_MODE             0x3e
@@ -54,6 +55,12 @@
 #define BNO055_OPER_MODE_CONFIG     0x00
 #define BNO055_OPER_MODE_NDOF       0x0c
 
+//  System status
+
+#define BNO055_SYS_STATUS_IDLE      0x00
+#define BNO055_SYS_STATUS_FUSION    0x05
+#define BNO055_SYS_STATUS_RUNNING   0x06
+
 //  Power modes
 
 #define BNO055_PWR_MODE_NORMAL      0x00
@@ -75,8 +82,9 @@ public:
 
 private:
     unsigned char m_slaveAddr;                              // I2C address of BNO055
+    RTIMUShadow m_shadow;                                   // configuration registers written
 
-    uint64_t m_lastReadTime;
+    unsigned long m_lastReadTime;
 
     RTQuaternion m_fusionQPose;
     RTVector3 m_fusionPose;
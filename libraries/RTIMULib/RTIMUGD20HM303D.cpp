@@ -29,6 +29,8 @@
 RTIMUGD20HM303D::RTIMUGD20HM303D(RTIMUSettings *settings) : RTIMU(settings)
 {
     m_sampleRate = 100;
+    m_running = false;
+    m_discardSample = false;
 }
 
 RTIMUGD20HM303D::~RTIMUGD20HM303D()
@@ -39,6 +41,8 @@ int RTIMUGD20HM303D::IMUInit()
 {
     unsigned char result;
 
+    m_running = false;
+
     //  configure IMU
 
     m_gyroSlaveAddr = m_settings->m_I2CSlaveAddress;
@@ -47,6 +51,11 @@ int RTIMUGD20HM303D::IMUInit()
     else
         m_accelCompassSlaveAddr = LSM303D_ADDRESS1;
 
+    //  all of these parts run at up to 400kHz
+
+    I2Cdev::setDeviceClock(m_gyroSlaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(m_accelCompassSlaveAddr, I2CDEV_CLOCK_FAST);
+
     setCalibrationData();
 
     //  Set up the gyro
@@ -101,7 +110,112 @@ int RTIMUGD20HM303D::IMUInit()
             return -16;
 
     gyroBiasInit();
+    m_running = true;
+    m_discardSample = false;
+
+    return true;
+}
+
+bool RTIMUGD20HM303D::setGyroSampleRate(unsigned char rate)
+{
+    int oldRate = m_sampleRate;
+
+    if ((rate < L3GD20H_SAMPLERATE_12_5) || (rate > L3GD20H_SAMPLERATE_800))
+        return false;
+
+    m_settings->m_GD20HM303DGyroSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), oldRate);
+}
+
+bool RTIMUGD20HM303D::setGyroBandwidth(unsigned char bandwidth)
+{
+    if (bandwidth > L3GD20H_BANDWIDTH_3)
+        return false;
+
+    m_settings->m_GD20HM303DGyroBW = bandwidth;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303D::setGyroFsr(unsigned char fsr)
+{
+    if (fsr > L3GD20H_FSR_2000)
+        return false;
+
+    m_settings->m_GD20HM303DGyroFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroCTRL4(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303D::setAccelSampleRate(unsigned char rate)
+{
+    if ((rate < LSM303D_ACCEL_SAMPLERATE_3_125) || (rate > LSM303D_ACCEL_SAMPLERATE_1600))
+        return false;
+
+    m_settings->m_GD20HM303DAccelSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL1(), m_sampleRate);
+}
 
+bool RTIMUGD20HM303D::setAccelLpf(unsigned char lpf)
+{
+    if (lpf > LSM303D_ACCEL_LPF_50)
+        return false;
+
+    m_settings->m_GD20HM303DAccelLpf = lpf;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL2(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303D::setAccelFsr(unsigned char fsr)
+{
+    if (fsr > LSM303D_ACCEL_FSR_16)
+        return false;
+
+    m_settings->m_GD20HM303DAccelFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL2(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303D::setCompassSampleRate(unsigned char rate)
+{
+    if ((rate < LSM303D_COMPASS_SAMPLERATE_3_125) || (rate > LSM303D_COMPASS_SAMPLERATE_100))
+        return false;
+
+    m_settings->m_GD20HM303DCompassSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCTRL5(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303D::setCompassFsr(unsigned char fsr)
+{
+    if (fsr > LSM303D_COMPASS_FSR_12)
+        return false;
+
+    m_settings->m_GD20HM303DCompassFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCTRL6(), m_sampleRate);
+}
+
+//  reconfigured() finishes a set function on a running IMU. The sample in the output registers
+//  may have been converted with the old settings so the next one is dropped.
+
+bool RTIMUGD20HM303D::reconfigured(bool written, int oldRate)
+{
+    if (!written)
+        return false;
+
+    m_discardSample = true;
+    gyroBiasRateChange(oldRate);
     return true;
 }
 
@@ -366,7 +480,7 @@ bool RTIMUGD20HM303D::IMURead()
     if (!I2CRead(m_gyroSlaveAddr, 0x80 | L3GD20H_OUT_X_L, 6, gyroData))
         return false;
 
-    m_timestamp = millis();
+    m_timestamp = micros();
 
     if (!I2CRead(m_accelCompassSlaveAddr, 0x80 | LSM303D_OUT_X_L_A, 6, accelData))
         return false;
@@ -374,6 +488,11 @@ bool RTIMUGD20HM303D::IMURead()
     if (!I2CRead(m_accelCompassSlaveAddr, 0x80 | LSM303D_OUT_X_L_M, 6, compassData))
         return false;
 
+    if (m_discardSample) {
+        m_discardSample = false;
+        return false;
+    }
+
     RTMath::convertToVector(gyroData, m_gyro, m_gyroScale, false);
     RTMath::convertToVector(accelData, m_accel, m_accelScale, false);
     RTMath::convertToVector(compassData, m_compass, m_compassScale, false);
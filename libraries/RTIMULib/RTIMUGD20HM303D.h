@@ -216,7 +216,20 @@ public:
     virtual int IMUGetPollInterval();
     virtual bool IMURead();
 
+    //  The set functions can be called while the IMU is running. Only the register that
+    //  holds the setting is rewritten - there's no reset and the gyro bias is kept.
+
+    bool setGyroSampleRate(unsigned char rate);
+    bool setGyroBandwidth(unsigned char bandwidth);
+    bool setGyroFsr(unsigned char fsr);
+    bool setAccelSampleRate(unsigned char rate);
+    bool setAccelLpf(unsigned char lpf);
+    bool setAccelFsr(unsigned char fsr);
+    bool setCompassSampleRate(unsigned char rate);
+    bool setCompassFsr(unsigned char fsr);
+
 private:
+    bool reconfigured(bool written, int oldRate);
     bool setGyroSampleRate();
     bool setGyroCTRL2();
     bool setGyroCTRL4();
@@ -227,6 +240,9 @@ private:
     bool setCompassCTRL6();
     bool setCompassCTRL7();
 
+    bool m_running;                                         // true once IMUInit() has succeeded
+    bool m_discardSample;                                   // drop the next sample after a set function
+
     unsigned char m_gyroSlaveAddr;                          // I2C address of L3GD20H
     unsigned char m_accelCompassSlaveAddr;                  // I2C address of LSM303D
 
@@ -29,6 +29,8 @@
 RTIMUGD20HM303DLHC::RTIMUGD20HM303DLHC(RTIMUSettings *settings) : RTIMU(settings)
 {
     m_sampleRate = 100;
+    m_running = false;
+    m_discardSample = false;
 }
 
 RTIMUGD20HM303DLHC::~RTIMUGD20HM303DLHC()
@@ -39,12 +41,20 @@ int RTIMUGD20HM303DLHC::IMUInit()
 {
     unsigned char result;
 
+    m_running = false;
+
     //  configure IMU
 
     m_gyroSlaveAddr = m_settings->m_I2CSlaveAddress;
     m_accelSlaveAddr = LSM303DLHC_ACCEL_ADDRESS;
     m_compassSlaveAddr = LSM303DLHC_COMPASS_ADDRESS;
 
+    //  all of these parts run at up to 400kHz
+
+    I2Cdev::setDeviceClock(m_gyroSlaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(m_accelSlaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(m_compassSlaveAddr, I2CDEV_CLOCK_FAST);
+
     setCalibrationData();
 
     //  Set up the gyro
@@ -94,10 +104,104 @@ int RTIMUGD20HM303DLHC::IMUInit()
             return -13;
 
     gyroBiasInit();
+    m_running = true;
+    m_discardSample = false;
 
     return true;
 }
 
+bool RTIMUGD20HM303DLHC::setGyroSampleRate(unsigned char rate)
+{
+    int oldRate = m_sampleRate;
+
+    if ((rate < L3GD20H_SAMPLERATE_12_5) || (rate > L3GD20H_SAMPLERATE_800))
+        return false;
+
+    m_settings->m_GD20HM303DLHCGyroSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), oldRate);
+}
+
+bool RTIMUGD20HM303DLHC::setGyroBandwidth(unsigned char bandwidth)
+{
+    if (bandwidth > L3GD20H_BANDWIDTH_3)
+        return false;
+
+    m_settings->m_GD20HM303DLHCGyroBW = bandwidth;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303DLHC::setGyroFsr(unsigned char fsr)
+{
+    if (fsr > L3GD20H_FSR_2000)
+        return false;
+
+    m_settings->m_GD20HM303DLHCGyroFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroCTRL4(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303DLHC::setAccelSampleRate(unsigned char rate)
+{
+    if ((rate < LSM303DLHC_ACCEL_SAMPLERATE_1) || (rate > LSM303DLHC_ACCEL_SAMPLERATE_400))
+        return false;
+
+    m_settings->m_GD20HM303DLHCAccelSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL1(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303DLHC::setAccelFsr(unsigned char fsr)
+{
+    if (fsr > LSM303DLHC_ACCEL_FSR_16)
+        return false;
+
+    m_settings->m_GD20HM303DLHCAccelFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL4(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303DLHC::setCompassSampleRate(unsigned char rate)
+{
+    if ((rate < LSM303DLHC_COMPASS_SAMPLERATE_0_75) || (rate > LSM303DLHC_COMPASS_SAMPLERATE_220))
+        return false;
+
+    m_settings->m_GD20HM303DLHCCompassSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCRA(), m_sampleRate);
+}
+
+bool RTIMUGD20HM303DLHC::setCompassFsr(unsigned char fsr)
+{
+    if ((fsr < LSM303DLHC_COMPASS_FSR_1_3) || (fsr > LSM303DLHC_COMPASS_FSR_8_1))
+        return false;
+
+    m_settings->m_GD20HM303DLHCCompassFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCRB(), m_sampleRate);
+}
+
+//  reconfigured() finishes a set function on a running IMU. The sample in the output registers
+//  may have been converted with the old settings so the next one is dropped.
+
+bool RTIMUGD20HM303DLHC::reconfigured(bool written, int oldRate)
+{
+    if (!written)
+        return false;
+
+    m_discardSample = true;
+    gyroBiasRateChange(oldRate);
+    return true;
+}
+
 bool RTIMUGD20HM303DLHC::setGyroSampleRate()
 {
     unsigned char ctrl1;
@@ -267,7 +371,7 @@ bool RTIMUGD20HM303DLHC::setAccelCTRL4()
 
     ctrl4 = (m_settings->m_GD20HM303DLHCAccelFsr << 4);
 
-    return I2CWrite(m_accelSlaveAddr,  LSM303DLHC_CTRL2_A, ctrl4);
+    return I2CWrite(m_accelSlaveAddr,  LSM303DLHC_CTRL4_A, ctrl4);
 }
 
 
@@ -367,7 +471,7 @@ bool RTIMUGD20HM303DLHC::IMURead()
     if (!I2CRead(m_gyroSlaveAddr, 0x80 | L3GD20H_OUT_X_L, 6, gyroData))
         return false;
 
-    m_timestamp = millis();
+    m_timestamp = micros();
 
     if (!I2CRead(m_accelSlaveAddr, 0x80 | LSM303DLHC_OUT_X_L_A, 6, accelData))
         return false;
@@ -375,6 +479,11 @@ bool RTIMUGD20HM303DLHC::IMURead()
     if (!I2CRead(m_compassSlaveAddr, 0x80 | LSM303DLHC_OUT_X_H_M, 6, compassData))
         return false;
 
+    if (m_discardSample) {
+        m_discardSample = false;
+        return false;
+    }
+
     RTMath::convertToVector(gyroData, m_gyro, m_gyroScale, false);
     RTMath::convertToVector(accelData, m_accel, m_accelScale, false);
 
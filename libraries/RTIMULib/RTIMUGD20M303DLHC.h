@@ -180,7 +180,19 @@ public:
     virtual int IMUGetPollInterval();
     virtual bool IMURead();
 
+    //  The set functions can be called while the IMU is running. Only the register that
+    //  holds the setting is rewritten - there's no reset and the gyro bias is kept.
+
+    bool setGyroSampleRate(unsigned char rate);
+    bool setGyroBandwidth(unsigned char bandwidth);
+    bool setGyroFsr(unsigned char fsr);
+    bool setAccelSampleRate(unsigned char rate);
+    bool setAccelFsr(unsigned char fsr);
+    bool setCompassSampleRate(unsigned char rate);
+    bool setCompassFsr(unsigned char fsr);
+
 private:
+    bool reconfigured(bool written, int oldRate);
     bool setGyroSampleRate();
     bool setGyroCTRL2();
     bool setGyroCTRL4();
@@ -191,6 +203,9 @@ private:
     bool setCompassCRB();
     bool setCompassCRM();
 
+    bool m_running;                                         // true once IMUInit() has succeeded
+    bool m_discardSample;                                   // drop the next sample after a set function
+
     unsigned char m_gyroSlaveAddr;                          // I2C address of L3GD20
     unsigned char m_accelSlaveAddr;                         // I2C address of LSM303DLHC accel
     unsigned char m_compassSlaveAddr;                       // I2C address of LSM303DLHC compass
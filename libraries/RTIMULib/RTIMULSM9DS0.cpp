@@ -30,6 +30,8 @@
 RTIMULSM9DS0::RTIMULSM9DS0(RTIMUSettings *settings) : RTIMU(settings)
 {
     m_sampleRate = 100;
+    m_running = false;
+    m_discardSample = false;
 }
 
 RTIMULSM9DS0::~RTIMULSM9DS0()
@@ -40,22 +42,39 @@ int RTIMULSM9DS0::IMUInit()
 {
     unsigned char result;
 
+    m_running = false;
+
     //  configure IMU
 
+#ifdef RTIMU_SPI
+    //  the gyro and the accel/mag have their own chip selects and run at up to 10MHz
+
+    m_gyroSlaveAddr = RTIMU_SPI_CS;
+    m_accelCompassSlaveAddr = RTIMU_SPI_CS_XM;
+
+    RTIMUSPI::setDevice(m_gyroSlaveAddr, RTIMUSPI_PROTOCOL_ST, LSM9DS0_SPI_CLOCK, LSM9DS0_SPI_CLOCK);
+    RTIMUSPI::setDevice(m_accelCompassSlaveAddr, RTIMUSPI_PROTOCOL_ST, LSM9DS0_SPI_CLOCK, LSM9DS0_SPI_CLOCK);
+#else
     m_gyroSlaveAddr = m_settings->m_I2CSlaveAddress;
     if (m_gyroSlaveAddr == LSM9DS0_GYRO_ADDRESS0)
         m_accelCompassSlaveAddr = LSM9DS0_ACCELMAG_ADDRESS0;
     else
         m_accelCompassSlaveAddr = LSM9DS0_ACCELMAG_ADDRESS1;
 
+    //  all of these parts run at up to 400kHz
+
+    I2Cdev::setDeviceClock(m_gyroSlaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(m_accelCompassSlaveAddr, I2CDEV_CLOCK_FAST);
+#endif
+
     setCalibrationData();
 
     //  Set up the gyro
 
-    if (!I2Cdev::writeByte(m_gyroSlaveAddr, LSM9DS0_GYRO_CTRL5, 0x80))
+    if (!RTIMUBus::writeByte(m_gyroSlaveAddr, LSM9DS0_GYRO_CTRL5, 0x80))
         return -1;
 
-    if (!I2Cdev::readByte(m_gyroSlaveAddr, LSM9DS0_GYRO_WHO_AM_I, &result))
+    if (!RTIMUBus::readByte(m_gyroSlaveAddr, LSM9DS0_GYRO_WHO_AM_I, &result))
         return -2;
 
     if (result != LSM9DS0_GYRO_ID) {
@@ -73,7 +92,7 @@ int RTIMULSM9DS0::IMUInit()
 
     //  Set up the accel
 
-    if (!I2Cdev::readByte(m_accelCompassSlaveAddr, LSM9DS0_WHO_AM_I, &result))
+    if (!RTIMUBus::readByte(m_accelCompassSlaveAddr, LSM9DS0_WHO_AM_I, &result))
         return -7;
 
     if (result != LSM9DS0_ACCELMAG_ID) {
@@ -99,9 +118,114 @@ int RTIMULSM9DS0::IMUInit()
             return -14;
 
     gyroBiasInit();
+    m_running = true;
+    m_discardSample = false;
     return 1;
 }
 
+bool RTIMULSM9DS0::setGyroSampleRate(unsigned char rate)
+{
+    int oldRate = m_sampleRate;
+
+    if (rate > LSM9DS0_GYRO_SAMPLERATE_760)
+        return false;
+
+    m_settings->m_LSM9DS0GyroSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), oldRate);
+}
+
+bool RTIMULSM9DS0::setGyroBandwidth(unsigned char bandwidth)
+{
+    if (bandwidth > LSM9DS0_GYRO_BANDWIDTH_3)
+        return false;
+
+    m_settings->m_LSM9DS0GyroBW = bandwidth;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroSampleRate(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setGyroFsr(unsigned char fsr)
+{
+    if (fsr > LSM9DS0_GYRO_FSR_2000)
+        return false;
+
+    m_settings->m_LSM9DS0GyroFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setGyroCTRL4(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setAccelSampleRate(unsigned char rate)
+{
+    if ((rate < LSM9DS0_ACCEL_SAMPLERATE_3_125) || (rate > LSM9DS0_ACCEL_SAMPLERATE_1600))
+        return false;
+
+    m_settings->m_LSM9DS0AccelSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL1(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setAccelLpf(unsigned char lpf)
+{
+    if (lpf > LSM9DS0_ACCEL_LPF_50)
+        return false;
+
+    m_settings->m_LSM9DS0AccelLpf = lpf;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL2(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setAccelFsr(unsigned char fsr)
+{
+    if (fsr > LSM9DS0_ACCEL_FSR_16)
+        return false;
+
+    m_settings->m_LSM9DS0AccelFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setAccelCTRL2(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setCompassSampleRate(unsigned char rate)
+{
+    if ((rate < LSM9DS0_COMPASS_SAMPLERATE_3_125) || (rate > LSM9DS0_COMPASS_SAMPLERATE_100))
+        return false;
+
+    m_settings->m_LSM9DS0CompassSampleRate = rate;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCTRL5(), m_sampleRate);
+}
+
+bool RTIMULSM9DS0::setCompassFsr(unsigned char fsr)
+{
+    if (fsr > LSM9DS0_COMPASS_FSR_12)
+        return false;
+
+    m_settings->m_LSM9DS0CompassFsr = fsr;
+    if (!m_running)
+        return true;                                        // IMUInit() will write it
+    return reconfigured(setCompassCTRL6(), m_sampleRate);
+}
+
+//  reconfigured() finishes a set function on a running IMU. The sample in the output registers
+//  may have been converted with the old settings so the next one is dropped.
+
+bool RTIMULSM9DS0::reconfigured(bool written, int oldRate)
+{
+    if (!written)
+        return false;
+
+    m_discardSample = true;
+    gyroBiasRateChange(oldRate);
+    return true;
+}
+
 bool RTIMULSM9DS0::setGyroSampleRate()
 {
     unsigned char ctrl1;
@@ -152,7 +276,7 @@ bool RTIMULSM9DS0::setGyroSampleRate()
 
     }
 
-    return (I2Cdev::writeByte(m_gyroSlaveAddr, LSM9DS0_GYRO_CTRL1, ctrl1));
+    return (RTIMUBus::writeByte(m_gyroSlaveAddr, LSM9DS0_GYRO_CTRL1, ctrl1));
 }
 
 bool RTIMULSM9DS0::setGyroCTRL2()
@@ -160,7 +284,7 @@ bool RTIMULSM9DS0::setGyroCTRL2()
     if ((m_settings->m_LSM9DS0GyroHpf < LSM9DS0_GYRO_HPF_0) || (m_settings->m_LSM9DS0GyroHpf > LSM9DS0_GYRO_HPF_9)) {
         return false;
     }
-    return I2Cdev::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL2, m_settings->m_LSM9DS0GyroHpf);
+    return RTIMUBus::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL2, m_settings->m_LSM9DS0GyroHpf);
 }
 
 bool RTIMULSM9DS0::setGyroCTRL4()
@@ -187,7 +311,7 @@ bool RTIMULSM9DS0::setGyroCTRL4()
         return false;
     }
 
-    return I2Cdev::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL4, ctrl4);
+    return RTIMUBus::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL4, ctrl4);
 }
 
 
@@ -199,7 +323,7 @@ bool RTIMULSM9DS0::setGyroCTRL5()
 
     ctrl5 = 0x10;
 
-    return I2Cdev::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL5, ctrl5);
+    return RTIMUBus::writeByte(m_gyroSlaveAddr,  LSM9DS0_GYRO_CTRL5, ctrl5);
 }
 
 
@@ -213,7 +337,7 @@ bool RTIMULSM9DS0::setAccelCTRL1()
 
     ctrl1 = (m_settings->m_LSM9DS0AccelSampleRate << 4) | 0x07;
 
-    return I2Cdev::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL1, ctrl1);
+    return RTIMUBus::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL1, ctrl1);
 }
 
 bool RTIMULSM9DS0::setAccelCTRL2()
@@ -251,7 +375,7 @@ bool RTIMULSM9DS0::setAccelCTRL2()
 
     ctrl2 = (m_settings->m_LSM9DS0AccelLpf << 6) | (m_settings->m_LSM9DS0AccelFsr << 3);
 
-    return I2Cdev::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL2, ctrl2);
+    return RTIMUBus::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL2, ctrl2);
 }
 
 
@@ -265,7 +389,7 @@ bool RTIMULSM9DS0::setCompassCTRL5()
 
     ctrl5 = (m_settings->m_LSM9DS0CompassSampleRate << 2);
 
-    return I2Cdev::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL5, ctrl5);
+    return RTIMUBus::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL5, ctrl5);
 }
 
 bool RTIMULSM9DS0::setCompassCTRL6()
@@ -299,12 +423,12 @@ bool RTIMULSM9DS0::setCompassCTRL6()
         return false;
     }
 
-    return I2Cdev::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL6, ctrl6);
+    return RTIMUBus::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL6, ctrl6);
 }
 
 bool RTIMULSM9DS0::setCompassCTRL7()
 {
-     return I2Cdev::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL7, 0x60);
+     return RTIMUBus::writeByte(m_accelCompassSlaveAddr,  LSM9DS0_CTRL7, 0x60);
 }
 
 int RTIMULSM9DS0::IMUGetPollInterval()
@@ -319,23 +443,28 @@ bool RTIMULSM9DS0::IMURead()
     unsigned char accelData[6];
     unsigned char compassData[6];
 
-    if (!I2Cdev::readByte(m_gyroSlaveAddr, LSM9DS0_GYRO_STATUS, &status))
+    if (!RTIMUBus::readByte(m_gyroSlaveAddr, LSM9DS0_GYRO_STATUS, &status))
         return false;
 
     if ((status & 0x8) == 0)
         return false;
 
-    if (!I2Cdev::readBytes(m_gyroSlaveAddr, 0x80 | LSM9DS0_GYRO_OUT_X_L, 6, gyroData))
+    if (!RTIMUBus::readBytes(m_gyroSlaveAddr, 0x80 | LSM9DS0_GYRO_OUT_X_L, 6, gyroData))
         return false;
 
-    m_timestamp = millis();
+    m_timestamp = micros();
 
-    if (!I2Cdev::readBytes(m_accelCompassSlaveAddr, 0x80 | LSM9DS0_OUT_X_L_A, 6, accelData))
+    if (!RTIMUBus::readBytes(m_accelCompassSlaveAddr, 0x80 | LSM9DS0_OUT_X_L_A, 6, accelData))
         return false;
 
-    if (!I2Cdev::readBytes(m_accelCompassSlaveAddr, 0x80 | LSM9DS0_OUT_X_L_M, 6, compassData))
+    if (!RTIMUBus::readBytes(m_accelCompassSlaveAddr, 0x80 | LSM9DS0_OUT_X_L_M, 6, compassData))
         return false;
 
+    if (m_discardSample) {
+        m_discardSample = false;
+        return false;
+    }
+
     RTMath::convertToVector(gyroData, m_gyro, m_gyroScale, false);
     RTMath::convertToVector(accelData, m_accel, m_accelScale, false);
     RTMath::convertToVector(compassData, m_compass, m_compassScale, false);
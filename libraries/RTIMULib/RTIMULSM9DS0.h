@@ -36,6 +36,10 @@
 #define LSM9DS0_ACCELMAG_ADDRESS1   0x1d
 #define LSM9DS0_ACCELMAG_ID         0x49
 
+//  SPI clock for both parts
+
+#define LSM9DS0_SPI_CLOCK           10000000
+
 //  L3GD20 Register map
 
 #define LSM9DS0_GYRO_WHO_AM_I       0x0f
@@ -212,8 +216,21 @@ public:
     virtual int IMUInit();
     virtual int IMUGetPollInterval();
     virtual bool IMURead();
+
+    //  The set functions can be called while the IMU is running. Only the register that
+    //  holds the setting is rewritten - there's no reset and the gyro bias is kept.
+
+    bool setGyroSampleRate(unsigned char rate);
+    bool setGyroBandwidth(unsigned char bandwidth);
+    bool setGyroFsr(unsigned char fsr);
+    bool setAccelSampleRate(unsigned char rate);
+    bool setAccelLpf(unsigned char lpf);
+    bool setAccelFsr(unsigned char fsr);
+    bool setCompassSampleRate(unsigned char rate);
+    bool setCompassFsr(unsigned char fsr);
  
 private:
+    bool reconfigured(bool written, int oldRate);
     bool setGyroSampleRate();
     bool setGyroCTRL2();
     bool setGyroCTRL4();
@@ -224,8 +241,11 @@ private:
     bool setCompassCTRL6();
     bool setCompassCTRL7();
 
-    unsigned char m_gyroSlaveAddr;                          // I2C address of gyro
-    unsigned char m_accelCompassSlaveAddr;                  // I2C address of accel and mag
+    bool m_running;                                         // true once IMUInit() has succeeded
+    bool m_discardSample;                                   // drop the next sample after a set function
+
+    unsigned char m_gyroSlaveAddr;                          // I2C address (or SPI chip select) of gyro
+    unsigned char m_accelCompassSlaveAddr;                  // I2C address (or SPI chip select) of accel and mag
     unsigned char m_bus;                                    // I2C bus (usually 1 for Raspberry Pi for example)
 
     RTFLOAT m_gyroScale;
@@ -27,7 +27,10 @@
 #include "RTMath.h"
 #include "RTPressureDefs.h"
 
-//  IMU enable defs - only one should be enabled, the rest commented out
+//  IMU enable defs - only one should be enabled, the rest commented out. A host build can
+//  define RTIMULIB_SENSORS_EXTERNAL and select the IMU and pressure sensor with -D instead.
+
+#ifndef RTIMULIB_SENSORS_EXTERNAL
 
 #define MPU9150_68                      // MPU9150 at address 0x68
 //#define MPU9150_69                      // MPU9150 at address 0x69
@@ -44,6 +47,18 @@
 //#define BNO055_28                       // BNO055 at address 0x28
 //#define BNO055_29                       // BNO055 at address 0x29
 
+#endif // RTIMULIB_SENSORS_EXTERNAL
+
+//  IMU transport - the MPU9250 and LSM9DS0 can be connected by SPI instead of I2C.
+//  Uncomment RTIMU_SPI and set the chip select pins to suit the wiring (the address
+//  variant chosen above doesn't matter). RTIMU_SPI_SIMULATOR replaces the SPI hardware
+//  with the simulated devices in RTIMUSPISim.h for host testing.
+
+//#define RTIMU_SPI                                         // use SPI for the IMU
+//#define RTIMU_SPI_SIMULATOR                               // use simulated SPI devices
+#define RTIMU_SPI_CS                    10                  // MPU9250 or LSM9DS0 gyro chip select pin
+#define RTIMU_SPI_CS_XM                 9                   // LSM9DS0 accel/mag chip select pin
+
 //  IMU type codes
 
 #define RTIMU_TYPE_MPU9150                  1                   // InvenSense MPU9150
@@ -56,12 +71,24 @@
 
 //  Pressure enable defs - only one should be enabled, the rest commented out
 
+#ifndef RTIMULIB_SENSORS_EXTERNAL
+
 //#define BMP180                              // BMP180
 //#define LPS25H_5c                           // LPS25H at standard address
 //#define LPS25H_5d                           // LPS25H at option address
 //#define MS5611_76                           // MS5611 at standard address
 //#define MS5611_77                           // MS5611 at option address
 
+#endif // RTIMULIB_SENSORS_EXTERNAL
+
+//  Fusion enable defs - only one should be enabled, the rest commented out. This selects
+//  the engine created by RTFusion::createFusion().
+
+#define RTFUSION_RTQF                       // RTFusionRTQF (SLERP complementary filter)
+//#define RTFUSION_MEKF                       // RTFusionMEKF (multiplicative extended Kalman filter)
+//#define RTFUSION_MADGWICK                   // RTFusionMadgwick (gradient descent filter)
+//#define RTFUSION_MAHONY                     // RTFusionMahony (PI complementary filter)
+
 //  IMU Axis rotation defs
 //
 //  These allow the IMU to be virtually repositioned if it is in a non-standard configuration
@@ -28,7 +28,10 @@
 
 RTIMUMPU9150::RTIMUMPU9150(RTIMUSettings *settings) : RTIMU(settings)
 {
-
+    m_transaction.callback = 0;
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9150_READ_IDLE;
+    m_running = false;
 }
 
 RTIMUMPU9150::~RTIMUMPU9150()
@@ -46,24 +49,24 @@ bool RTIMUMPU9150::setLpf(unsigned char lpf)
     case MPU9150_LPF_10:
     case MPU9150_LPF_5:
         m_lpf = lpf;
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 
 bool RTIMUMPU9150::setSampleRate(int rate)
 {
+    int oldRate = m_sampleRate;
+
     if ((rate < MPU9150_SAMPLERATE_MIN) || (rate > MPU9150_SAMPLERATE_MAX)) {
         return false;
     }
     m_sampleRate = rate;
-    m_sampleInterval = (unsigned long)1000 / m_sampleRate;
-    if (m_sampleInterval == 0)
-        m_sampleInterval = 1;
-    return true;
+    return reconfigure(oldRate);
 }
 
 bool RTIMUMPU9150::setCompassRate(int rate)
@@ -72,7 +75,7 @@ bool RTIMUMPU9150::setCompassRate(int rate)
         return false;
     }
     m_compassRate = rate;
-    return true;
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9150::setGyroFsr(unsigned char fsr)
@@ -81,26 +84,27 @@ bool RTIMUMPU9150::setGyroFsr(unsigned char fsr)
     case MPU9150_GYROFSR_250:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (131.0 * 180.0);
-        return true;
+        break;
 
     case MPU9150_GYROFSR_500:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (62.5 * 180.0);
-        return true;
+        break;
 
     case MPU9150_GYROFSR_1000:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (32.8 * 180.0);
-        return true;
+        break;
 
     case MPU9150_GYROFSR_2000:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (16.4 * 180.0);
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9150::setAccelFsr(unsigned char fsr)
@@ -109,26 +113,27 @@ bool RTIMUMPU9150::setAccelFsr(unsigned char fsr)
     case MPU9150_ACCELFSR_2:
         m_accelFsr = fsr;
         m_accelScale = 1.0/16384.0;
-        return true;
+        break;
 
     case MPU9150_ACCELFSR_4:
         m_accelFsr = fsr;
         m_accelScale = 1.0/8192.0;
-        return true;
+        break;
 
     case MPU9150_ACCELFSR_8:
         m_accelFsr = fsr;
         m_accelScale = 1.0/4096.0;
-        return true;
+        break;
 
     case MPU9150_ACCELFSR_16:
         m_accelFsr = fsr;
         m_accelScale = 1.0/2048.0;
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 
@@ -136,7 +141,13 @@ int RTIMUMPU9150::IMUInit()
 {
     unsigned char result;
 
-    m_firstTime = true;
+    //  make sure nothing is left on the bus from a previous IMURead
+
+    I2Cdev::flush();
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9150_READ_IDLE;
+    m_running = false;
+
     m_compassPresent = true;
 
 #ifdef MPU9150_CACHE_MODE
@@ -145,6 +156,13 @@ int RTIMUMPU9150::IMUInit()
     //  configure IMU
 
     m_slaveAddr = m_settings->m_I2CSlaveAddress;
+
+    //  the MPU-9150 and the compasses reached through bypass mode all run at up to 400kHz
+
+    I2Cdev::setDeviceClock(m_slaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(AK8975_ADDRESS, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(HMC5883_ADDRESS, I2CDEV_CLOCK_FAST);
+
     setSampleRate(m_settings->m_MPU9150GyroAccelSampleRate);
     setCompassRate(m_settings->m_MPU9150CompassSampleRate);
     setLpf(m_settings->m_MPU9150GyroAccelLpf);
@@ -153,16 +171,22 @@ int RTIMUMPU9150::IMUInit()
 
     setCalibrationData();
 
-    //  reset the MPU9150
+    //  reset the MPU9150 - DEVICE_RESET clears itself when the reset is done
+
+    m_shadow.setDevice(m_slaveAddr, RTIMUSHADOW_WRITES_INCREMENT);
 
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_PWR_MGMT_1, 0x80))
         return -1;
 
-    delay(100);
+    if (!RTIMUShadow::waitFor(m_slaveAddr, MPU9150_PWR_MGMT_1, 0x80, 0, 100))
+        return -3;
 
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_PWR_MGMT_1, 0x00))
         return -4;
 
+    m_shadow.assume(MPU9150_PWR_MGMT_1, 0x00);
+    m_shadow.assume(MPU9150_PWR_MGMT_2, 0x00);             // reset default
+
     if (!I2Cdev::readByte(m_slaveAddr, MPU9150_WHO_AM_I, &result))
         return -5;
 
@@ -170,20 +194,23 @@ int RTIMUMPU9150::IMUInit()
          return -6;
     }
 
-    //  now configure the various components
-
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_LPF_CONFIG, m_lpf))
-        return -7;
+    //  now configure the various components - SMPLRT_DIV to ACCEL_CONFIG go as one write
 
     if (!setSampleRate())
         return -8;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_GYRO_CONFIG, m_gyroFsr))
+    if (!m_shadow.write(MPU9150_LPF_CONFIG, m_lpf))
+        return -7;
+
+    if (!m_shadow.write(MPU9150_GYRO_CONFIG, m_gyroFsr))
         return -9;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_ACCEL_CONFIG, m_accelFsr))
+    if (!m_shadow.write(MPU9150_ACCEL_CONFIG, m_accelFsr))
          return -10;
 
+    if (!m_shadow.flush())
+        return -2;
+
     //  now configure compass
 
     result = configureCompass();
@@ -192,18 +219,24 @@ int RTIMUMPU9150::IMUInit()
 
     //  enable the sensors
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_PWR_MGMT_1, 1))
+    if (!m_shadow.write(MPU9150_PWR_MGMT_1, 1))
         return -28;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_PWR_MGMT_2, 0))
+    if (!m_shadow.write(MPU9150_PWR_MGMT_2, 0))
          return -29;
 
+    if (!m_shadow.flush())
+        return -31;
+
+    m_sampleClock.start(m_sampleInterval);                  // the timestamps need a new lock
+
     //  select the data to go into the FIFO and enable
 
     if (!resetFifo())
         return -30;
 
     gyroBiasInit();
+    m_running = true;
     return 1;
 }
 
@@ -290,47 +323,47 @@ bool RTIMUMPU9150::configureCompass()
     if (!bypassOff())
         return -16;
 
-    //  now set up MPU9150 to talk to the compass chip
+    //  now set up MPU9150 to talk to the compass chip (I2C_MST_CTRL to I2C_SLV1_CTRL go as one write)
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_MST_CTRL, 0x40))
+    if (!m_shadow.write(MPU9150_I2C_MST_CTRL, 0x40))
         return -17;
 
     if (m_compassIs5883) {
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_ADDR, 0x80 | HMC5883_ADDRESS))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_ADDR, 0x80 | HMC5883_ADDRESS))
             return -18;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_REG, HMC5883_DATA_X_HI))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_REG, HMC5883_DATA_X_HI))
             return -19;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_CTRL, 0x86))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_CTRL, 0x86))
             return -20;
     } else {
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_ADDR, 0x80 | AK8975_ADDRESS))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_ADDR, 0x80 | AK8975_ADDRESS))
             return -18;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_REG, AK8975_ST1))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_REG, AK8975_ST1))
             return -19;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV0_CTRL, 0x88))
+        if (!m_shadow.write(MPU9150_I2C_SLV0_CTRL, 0x88))
             return -20;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV1_ADDR, AK8975_ADDRESS))
+        if (!m_shadow.write(MPU9150_I2C_SLV1_ADDR, AK8975_ADDRESS))
             return -21;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV1_REG, AK8975_CNTL))
+        if (!m_shadow.write(MPU9150_I2C_SLV1_REG, AK8975_CNTL))
             return -22;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV1_CTRL, 0x81))
+        if (!m_shadow.write(MPU9150_I2C_SLV1_CTRL, 0x81))
             return -23;
 
-        if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV1_DO, 0x1))
+        if (!m_shadow.write(MPU9150_I2C_SLV1_DO, 0x1))
             return -24;
     }
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_MST_DELAY_CTRL, 0x3))
+    if (!m_shadow.write(MPU9150_I2C_MST_DELAY_CTRL, 0x3))
         return -25;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_YG_OFFS_TC, 0x80))
+    if (!m_shadow.write(MPU9150_YG_OFFS_TC, 0x80))
         return -26;
 
     if (!setCompassRate())
@@ -351,11 +384,12 @@ bool RTIMUMPU9150::resetFifo()
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_USER_CTRL, 0x04))
         return false;
 
+    if (!RTIMUShadow::waitFor(m_slaveAddr, MPU9150_USER_CTRL, 0x04, 0, 50))
+        return false;                                       // FIFO_RESET clears itself when done
+
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_USER_CTRL, 0x60))
         return false;
 
-    delay(50);
-
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_INT_ENABLE, 1))
         return false;
 
@@ -365,25 +399,71 @@ bool RTIMUMPU9150::resetFifo()
     return true;
 }
 
+//  reconfigure() writes the settings to a running IMU. The shadow only writes the registers
+//  that change and if any did, the FIFO is emptied so that samples taken with the old
+//  settings aren't scaled with the new ones. The gyro bias is kept.
+
+bool RTIMUMPU9150::reconfigure(int oldRate)
+{
+    unsigned int transfers = m_shadow.m_transfers;
+
+    if (!m_running)
+        return true;                                        // IMUInit() will write it all
+
+    //  let any IMURead transfer finish first - it carries on as usual if nothing changes
+
+    I2Cdev::flush();
+
+    if (!setSampleRate() || !m_shadow.write(MPU9150_LPF_CONFIG, m_lpf) ||
+            !m_shadow.write(MPU9150_GYRO_CONFIG, m_gyroFsr) || !m_shadow.write(MPU9150_ACCEL_CONFIG, m_accelFsr))
+        return false;
+
+    if ((m_compassPresent && !setCompassRate()))
+        return false;
+
+    if (!m_shadow.flush())
+        return false;
+
+    if (m_shadow.m_transfers == transfers)
+        return true;
+
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9150_READ_IDLE;
+    m_fifoCount = 0;
+    m_fifoDiscard = false;
+    m_sampleClock.start(m_sampleInterval);                  // the timestamps need a new lock
+
+    if (!resetFifo())
+        return false;
+
+    gyroBiasRateChange(oldRate);
+    return true;
+}
+
 bool RTIMUMPU9150::bypassOn()
 {
     unsigned char userControl;
+    bool masterOn;
 
     if (!I2Cdev::readByte(m_slaveAddr, MPU9150_USER_CTRL, &userControl))
         return false;
 
+    masterOn = (userControl & 0x20) != 0;
     userControl &= ~0x20;
     userControl |= 2;
 
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_USER_CTRL, userControl))
         return false;
 
-    delay(50);
+    //  the bypass switch is immediate but a running I2C master may be part way
+    //  through its transfers for this sample
+
+    if (masterOn)
+        delay(1000 / m_sampleRate + 1);
 
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_INT_PIN_CFG, 0x82))
         return false;
 
-    delay(50);
     return true;
 }
 
@@ -400,12 +480,9 @@ bool RTIMUMPU9150::bypassOff()
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_USER_CTRL, userControl))
         return false;
 
-    delay(50);
-
     if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_INT_PIN_CFG, 0x80))
          return false;
 
-    delay(50);
     return true;
 }
 
@@ -416,9 +493,12 @@ bool RTIMUMPU9150::setSampleRate()
     if (m_lpf == MPU9150_LPF_256)
         clockRate = 8000;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_SMPRT_DIV, (unsigned char)(clockRate / m_sampleRate - 1)))
+    if (!m_shadow.write(MPU9150_SMPRT_DIV, (unsigned char)(clockRate / m_sampleRate - 1)))
         return false;
 
+    //  the chip runs at clockRate / (SMPRT_DIV + 1) which may not be quite the rate asked for
+
+    m_sampleInterval = (unsigned long)(1000000 / clockRate) * (unsigned long)(clockRate / m_sampleRate);
     return true;
 }
 
@@ -430,7 +510,7 @@ bool RTIMUMPU9150::setCompassRate()
 
     if (rate > 31)
         rate = 31;
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9150_I2C_SLV4_CTRL, rate))
+    if (!m_shadow.write(MPU9150_I2C_SLV4_CTRL, rate))
          return false;
     return true;
 }
@@ -442,48 +522,114 @@ int RTIMUMPU9150::IMUGetPollInterval()
 
 bool RTIMUMPU9150::IMURead()
 {
-    unsigned char fifoCount[2];
-    unsigned int count;
-    unsigned char fifoData[12];
-    unsigned char compassData[8];
+    //  The read is run as a small state machine on the I2Cdev transaction queue.
+    //  Each call advances it as far as the bus allows and returns true when a
+    //  complete sample has been processed. The next transfer is queued before
+    //  returning so that, with an interrupt driven bus, it runs during fusion.
+
+    I2Cdev::poll();
+
+    while (!I2Cdev::pending(&m_transaction)) {
+        if (m_transaction.status == I2CDEV_STATUS_ERROR) {
+            m_transaction.status = I2CDEV_STATUS_IDLE;
+            m_readState = MPU9150_READ_IDLE;
+            return false;
+        }
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9150_FIFO_COUNT_H, 2, fifoCount))
-         return false;
+        switch (m_readState) {
+        case MPU9150_READ_IDLE:
+            if (!I2Cdev::submitRead(&m_transaction, m_slaveAddr, MPU9150_FIFO_COUNT_H, 2, m_fifoCountData))
+                return false;
+            m_readState = MPU9150_READ_FIFOCOUNT;
+            break;
 
-    count = ((unsigned int)fifoCount[0] << 8) + fifoCount[1];
+        case MPU9150_READ_FIFOCOUNT:
+            m_fifoCount = ((unsigned int)m_fifoCountData[0] << 8) + m_fifoCountData[1];
+            m_readState = MPU9150_READ_IDLE;
 
-    if (count == 1024) {
-        resetFifo();
-        m_timestamp += m_sampleInterval * (1024 / MPU9150_FIFO_CHUNK_SIZE + 1); // try to fix timestamp
-        return false;
-    }
+            //  a full FIFO has overflowed or is about to - the clock works out how many were lost
+
+            if (m_fifoCount > 1024 - MPU9150_FIFO_CHUNK_SIZE) {
+                resetFifo();
+                m_sampleClock.overflow(micros());
+                return false;
+            }
+
+            m_sampleClock.count(m_transaction.startTime, m_fifoCount / MPU9150_FIFO_CHUNK_SIZE);
+
+            // more than 40 samples behind - going too slowly so discard some samples but maintain timestamp correctly
+            m_fifoDiscard = m_fifoCount > MPU9150_FIFO_CHUNK_SIZE * 40;
 
-    if (count > MPU9150_FIFO_CHUNK_SIZE * 40) {
-        // more than 40 samples behind - going too slowly so discard some samples but maintain timestamp correctly
-        while (count >= MPU9150_FIFO_CHUNK_SIZE * 10) {
-            if (!I2Cdev::readBytes(m_slaveAddr, MPU9150_FIFO_R_W, MPU9150_FIFO_CHUNK_SIZE, fifoData))
+            if (!readFifoChunk())
                 return false;
-            count -= MPU9150_FIFO_CHUNK_SIZE;
-            m_timestamp += m_sampleInterval;
+            break;
+
+        case MPU9150_READ_FIFODATA:
+            m_fifoCount -= MPU9150_FIFO_CHUNK_SIZE;
+            if (m_fifoDiscard) {
+                m_sampleClock.next();
+                if (!readFifoChunk())
+                    return false;
+                break;
+            }
+            if (!I2Cdev::submitRead(&m_transaction, m_slaveAddr, MPU9150_EXT_SENS_DATA_00, m_compassDataLength, m_compassData)) {
+                m_readState = MPU9150_READ_IDLE;
+                return false;
+            }
+            m_readState = MPU9150_READ_COMPASS;
+            break;
+
+        case MPU9150_READ_COMPASS:
+            processSample();
+
+            //  start on the next sample - if there's more in the FIFO there's no need to read the count
+
+            if (m_fifoCount >= MPU9150_FIFO_CHUNK_SIZE) {
+                m_fifoDiscard = false;
+                readFifoChunk();
+            } else {
+                m_readState = MPU9150_READ_IDLE;
+#ifdef I2CDEV_ASYNC
+                //  with an interrupt driven bus the count is read during fusion. Otherwise
+                //  it would complete now and be a loop period old by the next call, so it's
+                //  read then instead.
+
+                if (I2Cdev::submitRead(&m_transaction, m_slaveAddr, MPU9150_FIFO_COUNT_H, 2, m_fifoCountData))
+                    m_readState = MPU9150_READ_FIFOCOUNT;
+#endif
+            }
+            return true;
         }
     }
+    return false;
+}
 
-    if (count < MPU9150_FIFO_CHUNK_SIZE)
-        return false;
+bool RTIMUMPU9150::readFifoChunk()
+{
+    if (m_fifoDiscard && (m_fifoCount < MPU9150_FIFO_CHUNK_SIZE * 10))
+        m_fifoDiscard = false;
+
+    m_readState = MPU9150_READ_IDLE;
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9150_FIFO_R_W, MPU9150_FIFO_CHUNK_SIZE, fifoData))
+    if (m_fifoCount < MPU9150_FIFO_CHUNK_SIZE)
         return false;
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9150_EXT_SENS_DATA_00, m_compassDataLength, compassData))
+    if (!I2Cdev::submitRead(&m_transaction, m_slaveAddr, MPU9150_FIFO_R_W, MPU9150_FIFO_CHUNK_SIZE, m_fifoData))
         return false;
 
-    RTMath::convertToVector(fifoData, m_accel, m_accelScale, true);
-    RTMath::convertToVector(fifoData + 6, m_gyro, m_gyroScale, true);
+    m_readState = MPU9150_READ_FIFODATA;
+    return true;
+}
+
+void RTIMUMPU9150::processSample()
+{
+    RTMath::convertToVector(m_fifoData, m_accel, m_accelScale, true);
+    RTMath::convertToVector(m_fifoData + 6, m_gyro, m_gyroScale, true);
 
     if (m_compassIs5883)
-        RTMath::convertToVector(compassData, m_compass, 0.092f, true);
+        RTMath::convertToVector(m_compassData, m_compass, 0.092f, true);
     else
-        RTMath::convertToVector(compassData + 1, m_compass, 0.3f, false);
+        RTMath::convertToVector(m_compassData + 1, m_compass, 0.3f, false);
 
 
     //  sort out gyro axes
@@ -533,13 +679,8 @@ bool RTIMUMPU9150::IMURead()
     if (m_compassPresent)
         calibrateAverageCompass();
 
-    if (m_firstTime)
-        m_timestamp = millis();
-    else
-        m_timestamp += m_sampleInterval;
-
-    m_firstTime = false;
+    //  the timestamp is when the chip took the sample, from its locked sample clock
 
-    return true;
+    m_timestamp = m_sampleClock.next();
 }
 #endif
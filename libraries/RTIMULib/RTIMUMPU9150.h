@@ -25,6 +25,7 @@
 #define	_RTIMUMPU9150_H
 
 #include "RTIMU.h"
+#include "RTIMUSampleClock.h"
 
 //  MPU9150 I2C Slave Addresses
 
@@ -123,12 +124,22 @@
 
 #define MPU9150_FIFO_CHUNK_SIZE     12                      // gyro and accels take 12 bytes
 
+//  IMURead state machine
+
+#define MPU9150_READ_IDLE         0                       // nothing on the bus
+#define MPU9150_READ_FIFOCOUNT    1                       // waiting for the FIFO count
+#define MPU9150_READ_FIFODATA     2                       // waiting for a FIFO chunk
+#define MPU9150_READ_COMPASS      3                       // waiting for the compass data
+
 class RTIMUMPU9150 : public RTIMU
 {
 public:
     RTIMUMPU9150(RTIMUSettings *settings);
     ~RTIMUMPU9150();
 
+    //  The set functions can be called while the IMU is running. Only the registers that
+    //  change are written and the FIFO is flushed - there's no reset and the gyro bias is kept.
+
     bool setLpf(unsigned char lpf);
     bool setSampleRate(int rate);
     bool setCompassRate(int rate);
@@ -140,6 +151,7 @@ public:
     virtual int IMUInit();
     virtual bool IMURead();
     virtual int IMUGetPollInterval();
+    virtual unsigned long IMUGetLostSamples() { return m_sampleClock.m_lost; }
 
 private:
     bool configureCompass();                                // configure the compass
@@ -148,10 +160,23 @@ private:
     bool setSampleRate();
     bool setCompassRate();
     bool resetFifo();
+    bool reconfigure(int oldRate);                          // write changed settings to a running IMU
+    bool readFifoChunk();                                   // queue the next FIFO chunk read
+    void processSample();                                   // convert and correct a complete sample
+
+    bool m_running;                                         // true once IMUInit() has succeeded
 
-    bool m_firstTime;                                       // if first sample
+    I2CDEV_TRANSACTION m_transaction;                       // the async I2C transfer used by IMURead
+    unsigned char m_readState;                              // IMURead state machine state
+    unsigned char m_fifoCountData[2];                       // raw FIFO count
+    unsigned char m_fifoData[MPU9150_FIFO_CHUNK_SIZE];       // current FIFO chunk
+    unsigned char m_compassData[8];                         // current compass data
+    unsigned int m_fifoCount;                               // bytes believed to be in the FIFO
+    RTIMUSampleClock m_sampleClock;                         // the chip's sample clock locked to micros()
+    bool m_fifoDiscard;                                     // true if discarding to catch up
 
     unsigned char m_slaveAddr;                              // I2C address of MPU9150
+    RTIMUShadow m_shadow;                                   // configuration registers written
     unsigned char m_bus;                                    // I2C bus (usually 1 for Raspberry Pi for example)
 
     unsigned char m_lpf;                                    // low pass filter setting
@@ -28,7 +28,10 @@
 
 RTIMUMPU9250::RTIMUMPU9250(RTIMUSettings *settings) : RTIMU(settings)
 {
-
+    m_transaction.callback = 0;
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9250_READ_IDLE;
+    m_running = false;
 }
 
 RTIMUMPU9250::~RTIMUMPU9250()
@@ -38,14 +41,13 @@ RTIMUMPU9250::~RTIMUMPU9250()
 
 bool RTIMUMPU9250::setSampleRate(int rate)
 {
+    int oldRate = m_sampleRate;
+
     if ((rate < MPU9250_SAMPLERATE_MIN) || (rate > MPU9250_SAMPLERATE_MAX)) {
         return false;
     }
     m_sampleRate = rate;
-    m_sampleInterval = (unsigned long)1000 / m_sampleRate;
-    if (m_sampleInterval == 0)
-        m_sampleInterval = 1;
-    return true;
+    return reconfigure(oldRate);
 }
 
 bool RTIMUMPU9250::setGyroLpf(unsigned char lpf)
@@ -61,11 +63,12 @@ bool RTIMUMPU9250::setGyroLpf(unsigned char lpf)
     case MPU9250_GYRO_LPF_10:
     case MPU9250_GYRO_LPF_5:
         m_gyroLpf = lpf;
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9250::setAccelLpf(unsigned char lpf)
@@ -80,11 +83,12 @@ bool RTIMUMPU9250::setAccelLpf(unsigned char lpf)
     case MPU9250_ACCEL_LPF_10:
     case MPU9250_ACCEL_LPF_5:
         m_accelLpf = lpf;
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9250::setCompassRate(int rate)
@@ -93,7 +97,7 @@ bool RTIMUMPU9250::setCompassRate(int rate)
         return false;
     }
     m_compassRate = rate;
-    return true;
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9250::setGyroFsr(unsigned char fsr)
@@ -102,26 +106,27 @@ bool RTIMUMPU9250::setGyroFsr(unsigned char fsr)
     case MPU9250_GYROFSR_250:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (131.0 * 180.0);
-        return true;
+        break;
 
     case MPU9250_GYROFSR_500:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (62.5 * 180.0);
-        return true;
+        break;
 
     case MPU9250_GYROFSR_1000:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (32.8 * 180.0);
-        return true;
+        break;
 
     case MPU9250_GYROFSR_2000:
         m_gyroFsr = fsr;
         m_gyroScale = RTMATH_PI / (16.4 * 180.0);
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 bool RTIMUMPU9250::setAccelFsr(unsigned char fsr)
@@ -130,26 +135,27 @@ bool RTIMUMPU9250::setAccelFsr(unsigned char fsr)
     case MPU9250_ACCELFSR_2:
         m_accelFsr = fsr;
         m_accelScale = 1.0/16384.0;
-        return true;
+        break;
 
     case MPU9250_ACCELFSR_4:
         m_accelFsr = fsr;
         m_accelScale = 1.0/8192.0;
-        return true;
+        break;
 
     case MPU9250_ACCELFSR_8:
         m_accelFsr = fsr;
         m_accelScale = 1.0/4096.0;
-        return true;
+        break;
 
     case MPU9250_ACCELFSR_16:
         m_accelFsr = fsr;
         m_accelScale = 1.0/2048.0;
-        return true;
+        break;
 
     default:
         return false;
     }
+    return reconfigure(m_sampleRate);
 }
 
 
@@ -158,15 +164,34 @@ int RTIMUMPU9250::IMUInit()
     unsigned char result;
     unsigned char asa[3];
 
-    m_firstTime = true;
+    //  make sure nothing is left on the bus from a previous IMURead
+
+    RTIMUBus::flush();
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9250_READ_IDLE;
+    m_running = false;
+
 
 #ifdef MPU9250_CACHE_MODE
     m_cacheIn = m_cacheOut = m_cacheCount = 0;
 #endif
     //  configure IMU
 
+#ifdef RTIMU_SPI
+    //  everything goes at 1MHz until IMURead() only needs the sensor registers
+
+    m_slaveAddr = RTIMU_SPI_CS;
+    RTIMUSPI::setDevice(m_slaveAddr, RTIMUSPI_PROTOCOL_INVENSENSE, MPU9250_SPI_CLOCK, MPU9250_SPI_CLOCK);
+#else
     m_slaveAddr = m_settings->m_I2CSlaveAddress;
 
+    //  the MPU-9250 and the AK8963 reached through bypass mode both run at up to 400kHz
+
+    I2Cdev::setDeviceClock(m_slaveAddr, I2CDEV_CLOCK_FAST);
+    I2Cdev::setDeviceClock(AK8963_ADDRESS, I2CDEV_CLOCK_FAST);
+#endif
+
+
     setSampleRate(m_settings->m_MPU9250GyroAccelSampleRate);
     setCompassRate(m_settings->m_MPU9250CompassSampleRate);
     setGyroLpf(m_settings->m_MPU9250GyroLpf);
@@ -176,24 +201,40 @@ int RTIMUMPU9250::IMUInit()
 
     setCalibrationData();
 
-    //  reset the MPU9250
+    //  reset the MPU9250 - DEVICE_RESET clears itself when the reset is done
+
+    m_shadow.setDevice(m_slaveAddr, RTIMUSHADOW_WRITES_INCREMENT);
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_1, 0x80))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_1, 0x80))
         return -1;
 
-    delay(100);
+    if (!RTIMUShadow::waitFor(m_slaveAddr, MPU9250_PWR_MGMT_1, 0x80, 0, 100))
+        return -3;
+
+#ifdef RTIMU_SPI
+    //  turn off the I2C slave interface so that SPI traffic can't be mistaken for it
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, MPU9250_USER_CTRL_IF))
+        return -2;
+#endif
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_1, 0x00))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_1, 0x00))
         return -4;
 
-    if (!I2Cdev::readByte(m_slaveAddr, MPU9250_WHO_AM_I, &result))
+    m_shadow.assume(MPU9250_PWR_MGMT_1, 0x00);
+    m_shadow.assume(MPU9250_PWR_MGMT_2, 0x00);             // reset default
+
+    if (!RTIMUBus::readByte(m_slaveAddr, MPU9250_WHO_AM_I, &result))
         return -5;
 
     if (result != MPU9250_ID) {
          return -6;
     }
 
-    //  now configure the various components
+    //  now configure the various components - SMPLRT_DIV to ACCEL_CONFIG2 go as one write
+
+    if (!setSampleRate())
+        return -9;
 
     if (!setGyroConfig())
         return -7;
@@ -201,8 +242,8 @@ int RTIMUMPU9250::IMUInit()
     if (!setAccelConfig())
         return -8;
 
-    if (!setSampleRate())
-        return -9;
+    if (!m_shadow.flush())
+        return -10;
 
     //  now configure compass
 
@@ -211,17 +252,17 @@ int RTIMUMPU9250::IMUInit()
 
     // get fuse ROM data
 
-    if (!I2Cdev::writeByte(AK8963_ADDRESS, AK8963_CNTL, 0)) {
+    if (!compassWrite(AK8963_CNTL, 0)) {
         bypassOff();
         return -12;
     }
 
-    if (!I2Cdev::writeByte(AK8963_ADDRESS, AK8963_CNTL, 0x0f)) {
+    if (!compassWrite(AK8963_CNTL, 0x0f)) {
         bypassOff();
         return -13;
     }
 
-    if (!I2Cdev::readBytes(AK8963_ADDRESS, AK8963_ASAX, 3, asa)) {
+    if (!compassRead(AK8963_ASAX, 3, asa)) {
         bypassOff();
         return -14;
     }
@@ -232,7 +273,7 @@ int RTIMUMPU9250::IMUInit()
     m_compassAdjust[1] = ((float)asa[1] - 128.0) / 256.0 + 1.0f;
     m_compassAdjust[2] = ((float)asa[2] - 128.0) / 256.0 + 1.0f;
 
-    if (!I2Cdev::writeByte(AK8963_ADDRESS, AK8963_CNTL, 0)) {
+    if (!compassWrite(AK8963_CNTL, 0)) {
         bypassOff();
         return -15;
     }
@@ -240,33 +281,33 @@ int RTIMUMPU9250::IMUInit()
     if (!bypassOff())
         return -16;
 
-    //  now set up MPU9250 to talk to the compass chip
+    //  now set up MPU9250 to talk to the compass chip (I2C_MST_CTRL to I2C_SLV1_CTRL go as one write)
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_MST_CTRL, 0x40))
+    if (!m_shadow.write(MPU9250_I2C_MST_CTRL, 0x40))
         return -17;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV0_ADDR, 0x80 | AK8963_ADDRESS))
+    if (!m_shadow.write(MPU9250_I2C_SLV0_ADDR, 0x80 | AK8963_ADDRESS))
         return -18;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV0_REG, AK8963_ST1))
+    if (!m_shadow.write(MPU9250_I2C_SLV0_REG, AK8963_ST1))
         return -19;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV0_CTRL, 0x88))
+    if (!m_shadow.write(MPU9250_I2C_SLV0_CTRL, 0x88))
         return -20;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV1_ADDR, AK8963_ADDRESS))
+    if (!m_shadow.write(MPU9250_I2C_SLV1_ADDR, AK8963_ADDRESS))
         return -21;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV1_REG, AK8963_CNTL))
+    if (!m_shadow.write(MPU9250_I2C_SLV1_REG, AK8963_CNTL))
         return -22;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV1_CTRL, 0x81))
+    if (!m_shadow.write(MPU9250_I2C_SLV1_CTRL, 0x81))
         return -23;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV1_DO, 0x1))
+    if (!m_shadow.write(MPU9250_I2C_SLV1_DO, 0x1))
         return -24;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_MST_DELAY_CTRL, 0x3))
+    if (!m_shadow.write(MPU9250_I2C_MST_DELAY_CTRL, 0x3))
         return -25;
 
     if (!setCompassRate())
@@ -274,66 +315,190 @@ int RTIMUMPU9250::IMUInit()
 
     //  enable the sensors
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_1, 1))
+    if (!m_shadow.write(MPU9250_PWR_MGMT_1, 1))
         return -28;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_PWR_MGMT_2, 0))
+    if (!m_shadow.write(MPU9250_PWR_MGMT_2, 0))
          return -29;
 
+    if (!m_shadow.flush())
+        return -26;
+
+    m_sampleClock.start(m_sampleInterval);                  // the timestamps need a new lock
+
     //  select the data to go into the FIFO and enable
 
     if (!resetFifo())
         return -30;
 
+#ifdef RTIMU_SPI
+    RTIMUSPI::setDevice(m_slaveAddr, RTIMUSPI_PROTOCOL_INVENSENSE, MPU9250_SPI_READ_CLOCK, MPU9250_SPI_CLOCK);
+#endif
+
     gyroBiasInit();
+    m_running = true;
     return 1;
 }
 
 bool RTIMUMPU9250::resetFifo()
 {
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_INT_ENABLE, 0))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_INT_ENABLE, 0))
+        return false;
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_FIFO_EN, 0))
+        return false;
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, MPU9250_USER_CTRL_IF))
+        return false;
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, MPU9250_USER_CTRL_IF | 0x04))
+        return false;
+
+    if (!RTIMUShadow::waitFor(m_slaveAddr, MPU9250_USER_CTRL, 0x04, 0, 50))
+        return false;                                       // FIFO_RESET clears itself when done
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, MPU9250_USER_CTRL_IF | 0x60))
+        return false;
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_INT_ENABLE, 1))
         return false;
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_FIFO_EN, 0))
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_FIFO_EN, 0x78))
         return false;
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_USER_CTRL, 0))
+
+    return true;
+}
+
+//  reconfigure() writes the settings to a running IMU. The shadow only writes the registers
+//  that change and if any did, the FIFO is emptied so that samples taken with the old
+//  settings aren't scaled with the new ones. The gyro bias is kept.
+
+bool RTIMUMPU9250::reconfigure(int oldRate)
+{
+    unsigned int transfers = m_shadow.m_transfers;
+
+    if (!m_running)
+        return true;                                        // IMUInit() will write it all
+
+    //  let any IMURead transfer finish first - it carries on as usual if nothing changes
+
+    RTIMUBus::flush();
+
+    if (!setSampleRate() || !setGyroConfig() || !setAccelConfig())
+        return false;
+
+    if (!setCompassRate())
+        return false;
+
+    if (!m_shadow.flush())
+        return false;
+
+    if (m_shadow.m_transfers == transfers)
+        return true;
+
+    m_transaction.status = I2CDEV_STATUS_IDLE;
+    m_readState = MPU9250_READ_IDLE;
+    m_fifoCount = 0;
+    m_fifoDiscard = false;
+    m_sampleClock.start(m_sampleInterval);                  // the timestamps need a new lock
+
+    if (!resetFifo())
         return false;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_USER_CTRL, 0x04))
+    gyroBiasRateChange(oldRate);
+    return true;
+}
+
+#ifdef RTIMU_SPI
+
+//  There's no bypass mode over SPI so the AK8963 is reached through the I2C master's
+//  slave 4 interface, one byte at a time. bypassOn() turns the I2C master on for that.
+
+bool RTIMUMPU9250::bypassOn()
+{
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_MST_CTRL, 0x40))
         return false;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_USER_CTRL, 0x60))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, MPU9250_USER_CTRL_IF | 0x20))
         return false;
 
-    delay(50);
+    delay(10);
+    return true;
+}
+
+bool RTIMUMPU9250::bypassOff()
+{
+    return true;                                            // the I2C master stays on for slaves 0 and 1
+}
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_INT_ENABLE, 1))
+bool RTIMUMPU9250::compassWrite(unsigned char reg, unsigned char data)
+{
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_ADDR, AK8963_ADDRESS))
+        return false;
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_REG, reg))
         return false;
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_DO, data))
+        return false;
+    return slave4Transfer();
+}
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_FIFO_EN, 0x78))
+bool RTIMUMPU9250::compassRead(unsigned char reg, unsigned char length, unsigned char *data)
+{
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_ADDR, 0x80 | AK8963_ADDRESS))
         return false;
 
+    for (unsigned char i = 0; i < length; i++) {
+        if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_REG, reg + i))
+            return false;
+        if (!slave4Transfer())
+            return false;
+        if (!RTIMUBus::readByte(m_slaveAddr, MPU9250_I2C_SLV4_DI, data + i))
+            return false;
+    }
     return true;
 }
 
+bool RTIMUMPU9250::slave4Transfer()
+{
+    unsigned char status;
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_CTRL, 0x80))
+        return false;
+
+    for (int i = 0; i < 10; i++) {
+        if (!RTIMUBus::readByte(m_slaveAddr, MPU9250_I2C_MST_STATUS, &status))
+            return false;
+        if (status & 0x40)                                  // SLV4_DONE
+            return true;
+        delay(1);
+    }
+    return false;
+}
+
+#else
+
 bool RTIMUMPU9250::bypassOn()
 {
     unsigned char userControl;
+    bool masterOn;
 
-    if (!I2Cdev::readByte(m_slaveAddr, MPU9250_USER_CTRL, &userControl))
+    if (!RTIMUBus::readByte(m_slaveAddr, MPU9250_USER_CTRL, &userControl))
         return false;
 
+    masterOn = (userControl & 0x20) != 0;
     userControl &= ~0x20;
     userControl |= 2;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_USER_CTRL, userControl))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, userControl))
         return false;
 
-    delay(50);
+    //  the bypass switch is immediate but a running I2C master may be part way
+    //  through its transfers for this sample
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_INT_PIN_CFG, 0x82))
+    if (masterOn)
+        delay(1000 / m_sampleRate + 1);
+
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_INT_PIN_CFG, 0x82))
         return false;
 
-    delay(50);
     return true;
 }
 
@@ -342,54 +507,68 @@ bool RTIMUMPU9250::bypassOff()
 {
     unsigned char userControl;
 
-    if (!I2Cdev::readByte(m_slaveAddr, MPU9250_USER_CTRL, &userControl))
+    if (!RTIMUBus::readByte(m_slaveAddr, MPU9250_USER_CTRL, &userControl))
         return false;
 
     userControl |= 0x20;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_USER_CTRL, userControl))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_USER_CTRL, userControl))
         return false;
 
-    delay(50);
-
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_INT_PIN_CFG, 0x80))
+    if (!RTIMUBus::writeByte(m_slaveAddr, MPU9250_INT_PIN_CFG, 0x80))
          return false;
 
-    delay(50);
     return true;
 }
 
+bool RTIMUMPU9250::compassWrite(unsigned char reg, unsigned char data)
+{
+    return I2Cdev::writeByte(AK8963_ADDRESS, reg, data);
+}
+
+bool RTIMUMPU9250::compassRead(unsigned char reg, unsigned char length, unsigned char *data)
+{
+    return I2Cdev::readBytes(AK8963_ADDRESS, reg, length, data) == length;
+}
+
+#endif
+
 bool RTIMUMPU9250::setGyroConfig()
 {
     unsigned char gyroConfig = m_gyroFsr + ((m_gyroLpf >> 3) & 3);
     unsigned char gyroLpf = m_gyroLpf & 7;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_GYRO_CONFIG, gyroConfig))
+    if (!m_shadow.write(MPU9250_GYRO_LPF, gyroLpf))
          return false;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_GYRO_LPF, gyroLpf))
+    if (!m_shadow.write(MPU9250_GYRO_CONFIG, gyroConfig))
          return false;
     return true;
 }
 
 bool RTIMUMPU9250::setAccelConfig()
 {
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_ACCEL_CONFIG, m_accelFsr))
+    if (!m_shadow.write(MPU9250_ACCEL_CONFIG, m_accelFsr))
          return false;
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_ACCEL_LPF, m_accelLpf))
+    if (!m_shadow.write(MPU9250_ACCEL_LPF, m_accelLpf))
          return false;
     return true;
 }
 
 bool RTIMUMPU9250::setSampleRate()
 {
-    if (m_sampleRate > 1000)
+    if (m_sampleRate > 1000) {
+        m_sampleInterval = (unsigned long)1000000 / m_sampleRate;
         return true;                                        // SMPRT not used above 1000Hz
+    }
 
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_SMPRT_DIV, (unsigned char) (1000 / m_sampleRate - 1)))
+    if (!m_shadow.write(MPU9250_SMPRT_DIV, (unsigned char) (1000 / m_sampleRate - 1)))
         return false;
 
+    //  the chip runs at 1000 / (SMPRT_DIV + 1) which may not be quite the rate asked for
+
+    m_sampleInterval = (unsigned long)1000 * (unsigned long)(1000 / m_sampleRate);
     return true;
 }
 
@@ -402,7 +581,7 @@ bool RTIMUMPU9250::setCompassRate()
 
     if (rate > 31)
         rate = 31;
-    if (!I2Cdev::writeByte(m_slaveAddr, MPU9250_I2C_SLV4_CTRL, rate))
+    if (!m_shadow.write(MPU9250_I2C_SLV4_CTRL, rate))
          return false;
     return true;
 }
@@ -414,44 +593,110 @@ int RTIMUMPU9250::IMUGetPollInterval()
 
 bool RTIMUMPU9250::IMURead()
 {
-    unsigned char fifoCount[2];
-    unsigned int count;
-    unsigned char fifoData[12];
-    unsigned char compassData[8];
+    //  The read is run as a small state machine on the I2Cdev transaction queue.
+    //  Each call advances it as far as the bus allows and returns true when a
+    //  complete sample has been processed. The next transfer is queued before
+    //  returning so that, with an interrupt driven bus, it runs during fusion.
+
+    RTIMUBus::poll();
+
+    while (!RTIMUBus::pending(&m_transaction)) {
+        if (m_transaction.status == I2CDEV_STATUS_ERROR) {
+            m_transaction.status = I2CDEV_STATUS_IDLE;
+            m_readState = MPU9250_READ_IDLE;
+            return false;
+        }
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9250_FIFO_COUNT_H, 2, fifoCount))
-         return false;
+        switch (m_readState) {
+        case MPU9250_READ_IDLE:
+            if (!RTIMUBus::submitRead(&m_transaction, m_slaveAddr, MPU9250_FIFO_COUNT_H, 2, m_fifoCountData))
+                return false;
+            m_readState = MPU9250_READ_FIFOCOUNT;
+            break;
 
-    count = ((unsigned int)fifoCount[0] << 8) + fifoCount[1];
+        case MPU9250_READ_FIFOCOUNT:
+            m_fifoCount = ((unsigned int)m_fifoCountData[0] << 8) + m_fifoCountData[1];
+            m_readState = MPU9250_READ_IDLE;
 
-    if (count == 1024) {
-        resetFifo();
-        m_timestamp += m_sampleInterval * (1024 / MPU9250_FIFO_CHUNK_SIZE + 1); // try to fix timestamp
-        return false;
-    }
+            //  a full FIFO has overflowed or is about to - the clock works out how many were lost
 
-    if (count > MPU9250_FIFO_CHUNK_SIZE * 40) {
-        // more than 40 samples behind - going too slowly so discard some samples but maintain timestamp correctly
-        while (count >= MPU9250_FIFO_CHUNK_SIZE * 10) {
-            if (!I2Cdev::readBytes(m_slaveAddr, MPU9250_FIFO_R_W, MPU9250_FIFO_CHUNK_SIZE, fifoData))
+            if (m_fifoCount > 1024 - MPU9250_FIFO_CHUNK_SIZE) {
+                resetFifo();
+                m_sampleClock.overflow(micros());
                 return false;
-            count -= MPU9250_FIFO_CHUNK_SIZE;
-            m_timestamp += m_sampleInterval;
+            }
+
+            m_sampleClock.count(m_transaction.startTime, m_fifoCount / MPU9250_FIFO_CHUNK_SIZE);
+
+            // more than 40 samples behind - going too slowly so discard some samples but maintain timestamp correctly
+            m_fifoDiscard = m_fifoCount > MPU9250_FIFO_CHUNK_SIZE * 40;
+
+            if (!readFifoChunk())
+                return false;
+            break;
+
+        case MPU9250_READ_FIFODATA:
+            m_fifoCount -= MPU9250_FIFO_CHUNK_SIZE;
+            if (m_fifoDiscard) {
+                m_sampleClock.next();
+                if (!readFifoChunk())
+                    return false;
+                break;
+            }
+            if (!RTIMUBus::submitRead(&m_transaction, m_slaveAddr, MPU9250_EXT_SENS_DATA_00, 8, m_compassData)) {
+                m_readState = MPU9250_READ_IDLE;
+                return false;
+            }
+            m_readState = MPU9250_READ_COMPASS;
+            break;
+
+        case MPU9250_READ_COMPASS:
+            processSample();
+
+            //  start on the next sample - if there's more in the FIFO there's no need to read the count
+
+            if (m_fifoCount >= MPU9250_FIFO_CHUNK_SIZE) {
+                m_fifoDiscard = false;
+                readFifoChunk();
+            } else {
+                m_readState = MPU9250_READ_IDLE;
+#ifdef RTIMUBUS_ASYNC
+                //  with an interrupt driven bus the count is read during fusion. Otherwise
+                //  it would complete now and be a loop period old by the next call, so it's
+                //  read then instead.
+
+                if (RTIMUBus::submitRead(&m_transaction, m_slaveAddr, MPU9250_FIFO_COUNT_H, 2, m_fifoCountData))
+                    m_readState = MPU9250_READ_FIFOCOUNT;
+#endif
+            }
+            return true;
         }
     }
+    return false;
+}
 
-    if (count < MPU9250_FIFO_CHUNK_SIZE)
-        return false;
+bool RTIMUMPU9250::readFifoChunk()
+{
+    if (m_fifoDiscard && (m_fifoCount < MPU9250_FIFO_CHUNK_SIZE * 10))
+        m_fifoDiscard = false;
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9250_FIFO_R_W, MPU9250_FIFO_CHUNK_SIZE, fifoData))
+    m_readState = MPU9250_READ_IDLE;
+
+    if (m_fifoCount < MPU9250_FIFO_CHUNK_SIZE)
         return false;
 
-    if (!I2Cdev::readBytes(m_slaveAddr, MPU9250_EXT_SENS_DATA_00, 8, compassData))
+    if (!RTIMUBus::submitRead(&m_transaction, m_slaveAddr, MPU9250_FIFO_R_W, MPU9250_FIFO_CHUNK_SIZE, m_fifoData))
         return false;
 
-    RTMath::convertToVector(fifoData, m_accel, m_accelScale, true);
-    RTMath::convertToVector(fifoData + 6, m_gyro, m_gyroScale, true);
-    RTMath::convertToVector(compassData + 1, m_compass, 0.6f, false);
+    m_readState = MPU9250_READ_FIFODATA;
+    return true;
+}
+
+void RTIMUMPU9250::processSample()
+{
+    RTMath::convertToVector(m_fifoData, m_accel, m_accelScale, true);
+    RTMath::convertToVector(m_fifoData + 6, m_gyro, m_gyroScale, true);
+    RTMath::convertToVector(m_compassData + 1, m_compass, 0.6f, false);
 
     //  sort out gyro axes
 
@@ -481,13 +726,8 @@ bool RTIMUMPU9250::IMURead()
     handleGyroBias();
     calibrateAverageCompass();
 
-    if (m_firstTime)
-        m_timestamp = millis();
-    else
-        m_timestamp += m_sampleInterval;
-
-    m_firstTime = false;
+    //  the timestamp is when the chip took the sample, from its locked sample clock
 
-    return true;
+    m_timestamp = m_sampleClock.next();
 }
 #endif
@@ -25,6 +25,7 @@
 #define	_RTIMUMPU9250_H
 
 #include "RTIMU.h"
+#include "RTIMUSampleClock.h"
 
 //  MPU9250 I2C Slave Addresses
 
@@ -52,7 +53,12 @@
 #define MPU9250_I2C_SLV2_ADDR       0x2b
 #define MPU9250_I2C_SLV2_REG        0x2c
 #define MPU9250_I2C_SLV2_CTRL       0x2d
+#define MPU9250_I2C_SLV4_ADDR       0x31
+#define MPU9250_I2C_SLV4_REG        0x32
+#define MPU9250_I2C_SLV4_DO         0x33
 #define MPU9250_I2C_SLV4_CTRL       0x34
+#define MPU9250_I2C_SLV4_DI         0x35
+#define MPU9250_I2C_MST_STATUS      0x36
 #define MPU9250_INT_PIN_CFG         0x37
 #define MPU9250_INT_ENABLE          0x38
 #define MPU9250_INT_STATUS          0x3a
@@ -122,16 +128,37 @@
 #define AK8963_CNTL                 0x0a                    // control reg
 #define AK8963_ASAX                 0x10                    // start of the fuse ROM data
 
+//  SPI clocks - all registers work at 1MHz, the sensor and FIFO registers can be read at 20MHz
+
+#define MPU9250_SPI_CLOCK           1000000
+#define MPU9250_SPI_READ_CLOCK      20000000
+
+#ifdef RTIMU_SPI
+#define MPU9250_USER_CTRL_IF        0x10                    // I2C_IF_DIS - keep the I2C slave off in SPI mode
+#else
+#define MPU9250_USER_CTRL_IF        0
+#endif
+
 //  FIFO transfer size
 
 #define MPU9250_FIFO_CHUNK_SIZE     12                      // gyro and accels take 12 bytes
 
+//  IMURead state machine
+
+#define MPU9250_READ_IDLE         0                       // nothing on the bus
+#define MPU9250_READ_FIFOCOUNT    1                       // waiting for the FIFO count
+#define MPU9250_READ_FIFODATA     2                       // waiting for a FIFO chunk
+#define MPU9250_READ_COMPASS      3                       // waiting for the compass data
+
 class RTIMUMPU9250 : public RTIMU
 {
 public:
     RTIMUMPU9250(RTIMUSettings *settings);
     ~RTIMUMPU9250();
 
+    //  The set functions can be called while the IMU is running. Only the registers that
+    //  change are written and the FIFO is flushed - there's no reset and the gyro bias is kept.
+
     bool setGyroLpf(unsigned char lpf);
     bool setAccelLpf(unsigned char lpf);
     bool setSampleRate(int rate);
@@ -144,6 +171,7 @@ public:
     virtual int IMUInit();
     virtual bool IMURead();
     virtual int IMUGetPollInterval();
+    virtual unsigned long IMUGetLostSamples() { return m_sampleClock.m_lost; }
 
 private:
     bool setGyroConfig();
@@ -152,12 +180,30 @@ private:
     bool compassSetup();
     bool setCompassRate();
     bool resetFifo();
+    bool reconfigure(int oldRate);                          // write changed settings to a running IMU
+    bool readFifoChunk();                                   // queue the next FIFO chunk read
+    void processSample();                                   // convert and correct a complete sample
     bool bypassOn();
     bool bypassOff();
-
-    bool m_firstTime;                                       // if first sample
-
-    unsigned char m_slaveAddr;                              // I2C address of MPU9250
+    bool compassWrite(unsigned char reg, unsigned char data);   // write an AK8963 register
+    bool compassRead(unsigned char reg, unsigned char length, unsigned char *data);
+#ifdef RTIMU_SPI
+    bool slave4Transfer();                                  // run a slave 4 transfer and wait for it
+#endif
+
+    bool m_running;                                         // true once IMUInit() has succeeded
+
+    I2CDEV_TRANSACTION m_transaction;                       // the async I2C transfer used by IMURead
+    unsigned char m_readState;                              // IMURead state machine state
+    unsigned char m_fifoCountData[2];                       // raw FIFO count
+    unsigned char m_fifoData[MPU9250_FIFO_CHUNK_SIZE];       // current FIFO chunk
+    unsigned char m_compassData[8];                         // current compass data
+    unsigned int m_fifoCount;                               // bytes believed to be in the FIFO
+    RTIMUSampleClock m_sampleClock;                         // the chip's sample clock locked to micros()
+    bool m_fifoDiscard;                                     // true if discarding to catch up
+
+    unsigned char m_slaveAddr;                              // I2C address (or SPI chip select) of MPU9250
+    RTIMUShadow m_shadow;                                   // configuration registers written
     unsigned char m_bus;                                    // I2C bus (usually 1 for Raspberry Pi for example)
 
     unsigned char m_gyroLpf;                                // gyro low pass filter setting
@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMUSPI.h"
+
+#ifdef RTIMU_SPI
+
+#ifdef RTIMU_SPI_SIMULATOR
+#include "RTIMUSPISim.h"
+#else
+#include <SPI.h>
+
+#ifndef SPI_HAS_TRANSACTION
+#error RTIMU_SPI needs the SPI library from Arduino 1.6 or later
+#endif
+#endif
+
+typedef struct
+{
+    uint8_t cs;                                             // chip select pin
+    uint8_t protocol;                                       // RTIMUSPI_PROTOCOL_xxx
+    uint32_t readClock;                                     // clock for reads in Hz
+    uint32_t writeClock;                                    // clock for writes in Hz
+#ifdef RTIMU_SPI_SIMULATOR
+    RTIMUSPISimDevice *simulator;                           // the simulated device
+#endif
+} RTIMUSPI_DEVICE;
+
+static RTIMUSPI_DEVICE rtimuspi_devices[RTIMUSPI_MAX_DEVICES];
+static uint8_t rtimuspi_deviceCount = 0;
+
+static RTIMUSPI_DEVICE *rtimuspi_findDevice(uint8_t cs, bool create)
+{
+    for (uint8_t i = 0; i < rtimuspi_deviceCount; i++) {
+        if (rtimuspi_devices[i].cs == cs)
+            return rtimuspi_devices + i;
+    }
+    if (!create || (rtimuspi_deviceCount == RTIMUSPI_MAX_DEVICES))
+        return 0;
+
+    RTIMUSPI_DEVICE *device = rtimuspi_devices + rtimuspi_deviceCount++;
+
+    device->cs = cs;
+    device->protocol = RTIMUSPI_PROTOCOL_INVENSENSE;
+    device->readClock = device->writeClock = RTIMUSPI_DEFAULT_CLOCK;
+#ifdef RTIMU_SPI_SIMULATOR
+    device->simulator = 0;
+#else
+    if (rtimuspi_deviceCount == 1)
+        SPI.begin();
+    digitalWrite(cs, HIGH);                                 // deselect before making it an output
+    pinMode(cs, OUTPUT);
+#endif
+    return device;
+}
+
+//  Builds the first byte of a transfer. The drivers use I2C style register addresses,
+//  so for ST parts the I2C auto-increment flag (bit 7) is swapped for the SPI one (bit 6).
+
+static uint8_t rtimuspi_address(RTIMUSPI_DEVICE *device, uint8_t regAddr, bool read, uint8_t length)
+{
+    if (device->protocol == RTIMUSPI_PROTOCOL_ST) {
+        regAddr &= 0x3f;
+        if (length > 1)
+            regAddr |= 0x40;
+    } else {
+        regAddr &= 0x7f;
+    }
+    return read ? (regAddr | 0x80) : regAddr;
+}
+
+//  Does one chip select cycle: the address byte followed by length data bytes
+
+static void rtimuspi_transfer(RTIMUSPI_DEVICE *device, uint8_t regAddr, bool read, uint8_t length, uint8_t *data)
+{
+    uint8_t address = rtimuspi_address(device, regAddr, read, length);
+
+#ifdef RTIMU_SPI_SIMULATOR
+    RTIMUSPISimDevice *sim = device->simulator;
+
+    if (sim == 0) {
+        if (read)
+            memset(data, 0xff, length);                     // nothing drives MISO
+        return;
+    }
+    sim->select();
+    sim->transfer(address);
+    for (uint8_t i = 0; i < length; i++) {
+        if (read)
+            data[i] = sim->transfer(0);
+        else
+            sim->transfer(data[i]);
+    }
+    sim->deselect();
+#else
+    SPI.beginTransaction(SPISettings(read ? device->readClock : device->writeClock, MSBFIRST, SPI_MODE3));
+    digitalWrite(device->cs, LOW);
+    SPI.transfer(address);
+    if (read) {
+        memset(data, 0, length);
+        SPI.transfer(data, length);                         // received bytes replace the zeros
+    } else {
+        for (uint8_t i = 0; i < length; i++)
+            SPI.transfer(data[i]);
+    }
+    digitalWrite(device->cs, HIGH);
+    SPI.endTransaction();
+#endif
+}
+
+bool RTIMUSPI::setDevice(uint8_t cs, uint8_t protocol, uint32_t readClock, uint32_t writeClock)
+{
+    RTIMUSPI_DEVICE *device = rtimuspi_findDevice(cs, true);
+
+    if (device == 0)
+        return false;
+    device->protocol = protocol;
+    device->readClock = readClock;
+    device->writeClock = writeClock;
+    return true;
+}
+
+bool RTIMUSPI::setDeviceClock(uint8_t cs, uint32_t maxClock)
+{
+    RTIMUSPI_DEVICE *device = rtimuspi_findDevice(cs, true);
+
+    if (device == 0)
+        return false;
+    device->readClock = device->writeClock = maxClock;
+    return true;
+}
+
+int8_t RTIMUSPI::readByte(uint8_t cs, uint8_t regAddr, uint8_t *data)
+{
+    return readBytes(cs, regAddr, 1, data);
+}
+
+int8_t RTIMUSPI::readBytes(uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data)
+{
+    RTIMUSPI_DEVICE *device = rtimuspi_findDevice(cs, true);
+
+    if ((device == 0) || (length == 0))
+        return -1;
+    rtimuspi_transfer(device, regAddr, true, length, data);
+    return length;
+}
+
+bool RTIMUSPI::writeByte(uint8_t cs, uint8_t regAddr, uint8_t data)
+{
+    return writeBytes(cs, regAddr, 1, &data);
+}
+
+bool RTIMUSPI::writeBytes(uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data)
+{
+    RTIMUSPI_DEVICE *device = rtimuspi_findDevice(cs, true);
+
+    if (device == 0)
+        return false;
+    rtimuspi_transfer(device, regAddr, false, length, data);
+    return true;
+}
+
+bool RTIMUSPI::submitRead(I2CDEV_TRANSACTION *transaction, uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data)
+{
+    transaction->devAddr = cs;
+    transaction->regAddr = regAddr;
+    transaction->length = length;
+    transaction->data = data;
+    transaction->type = I2CDEV_TRANSACTION_READ;
+    return submit(transaction);
+}
+
+bool RTIMUSPI::submitWrite(I2CDEV_TRANSACTION *transaction, uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data)
+{
+    transaction->devAddr = cs;
+    transaction->regAddr = regAddr;
+    transaction->length = length;
+    transaction->data = data;
+    transaction->type = I2CDEV_TRANSACTION_WRITE;
+    return submit(transaction);
+}
+
+bool RTIMUSPI::submit(I2CDEV_TRANSACTION *transaction)
+{
+    bool ok;
+
+    if (pending(transaction))
+        return false;
+
+    transaction->status = I2CDEV_STATUS_ACTIVE;
+    transaction->startTime = micros();
+    if (transaction->type == I2CDEV_TRANSACTION_READ)
+        ok = readBytes(transaction->devAddr, transaction->regAddr, transaction->length, transaction->data) == transaction->length;
+    else
+        ok = writeBytes(transaction->devAddr, transaction->regAddr, transaction->length, transaction->data);
+
+    transaction->count = ok ? transaction->length : -1;
+    transaction->error = I2CDEV_ERROR_NONE;
+    transaction->status = ok ? I2CDEV_STATUS_DONE : I2CDEV_STATUS_ERROR;
+    if (transaction->callback)
+        transaction->callback(transaction);
+    return true;                                            // failures are reported in status, as with I2Cdev
+}
+
+#ifdef RTIMU_SPI_SIMULATOR
+bool RTIMUSPI::attachSimulator(uint8_t cs, RTIMUSPISimDevice *device)
+{
+    RTIMUSPI_DEVICE *spiDevice = rtimuspi_findDevice(cs, true);
+
+    if (spiDevice == 0)
+        return false;
+    spiDevice->simulator = device;
+    return true;
+}
+#endif
+
+#endif // RTIMU_SPI
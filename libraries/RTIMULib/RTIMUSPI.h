@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSPI_H
+#define	_RTIMUSPI_H
+
+#include "RTIMULibDefs.h"
+#include "I2Cdev.h"
+
+//  RTIMUSPI is the SPI transport for the IMUs that support it (MPU9250 and LSM9DS0).
+//  It has the same static interface as I2Cdev so that a driver can be built for either
+//  through the RTIMUBus typedef in RTIMU.h. The "device address" is the chip select pin.
+//
+//  SPI transfers take a few microseconds so the transaction calls complete the transfer
+//  before returning - pending() is never true after submit().
+
+#ifdef RTIMU_SPI
+
+//  Register address protocols
+
+#define RTIMUSPI_PROTOCOL_INVENSENSE    0                   // bit 7 = read, address always auto-increments
+#define RTIMUSPI_PROTOCOL_ST            1                   // bit 7 = read, bit 6 = auto-increment
+
+#define RTIMUSPI_MAX_DEVICES            4                   // chip selects that can be registered
+#define RTIMUSPI_DEFAULT_CLOCK          1000000             // clock used for an unregistered chip select
+
+#ifdef RTIMU_SPI_SIMULATOR
+class RTIMUSPISimDevice;
+#endif
+
+class RTIMUSPI
+{
+public:
+    //  setDevice() registers a chip select. readClock is used for reads, writeClock for
+    //  writes (the MPU9250 only allows 20MHz for reading sensor registers)
+
+    static bool setDevice(uint8_t cs, uint8_t protocol, uint32_t readClock, uint32_t writeClock);
+    static bool setDeviceClock(uint8_t cs, uint32_t maxClock);
+
+    static int8_t readByte(uint8_t cs, uint8_t regAddr, uint8_t *data);
+    static int8_t readBytes(uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data);
+    static bool writeByte(uint8_t cs, uint8_t regAddr, uint8_t data);
+    static bool writeBytes(uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data);
+
+    static bool submitRead(I2CDEV_TRANSACTION *transaction, uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data);
+    static bool submitWrite(I2CDEV_TRANSACTION *transaction, uint8_t cs, uint8_t regAddr, uint8_t length, uint8_t *data);
+    static bool submit(I2CDEV_TRANSACTION *transaction);
+    static void poll() {}
+    static bool idle() { return true; }
+    static bool flush() { return true; }
+    static bool pending(I2CDEV_TRANSACTION *transaction) {
+        return (transaction->status == I2CDEV_STATUS_QUEUED) || (transaction->status == I2CDEV_STATUS_ACTIVE); }
+
+#ifdef RTIMU_SPI_SIMULATOR
+    //  connects a simulated device to a chip select in place of the SPI hardware
+
+    static bool attachSimulator(uint8_t cs, RTIMUSPISimDevice *device);
+#endif
+};
+
+#endif // RTIMU_SPI
+
+#endif // _RTIMUSPI_H
@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMUSPISim.h"
+#include "RTIMUMPU9250.h"
+
+#if defined(RTIMU_SPI) && defined(RTIMU_SPI_SIMULATOR)
+
+RTIMUSPISimDevice::RTIMUSPISimDevice(unsigned char protocol)
+{
+    m_protocol = protocol;
+    memset(m_registers, 0, sizeof(m_registers));
+    m_selects = 0;
+    m_bytes = 0;
+    m_selected = false;
+}
+
+void RTIMUSPISimDevice::select()
+{
+    m_selected = true;
+    m_addressed = false;
+    m_selects++;
+}
+
+unsigned char RTIMUSPISimDevice::transfer(unsigned char data)
+{
+    unsigned char reg;
+
+    if (!m_selected)
+        return 0xff;
+
+    m_bytes++;
+
+    if (!m_addressed) {
+        m_addressed = true;
+        m_read = (data & 0x80) != 0;
+        if (m_protocol == RTIMUSPI_PROTOCOL_ST) {
+            m_increment = (data & 0x40) != 0;
+            m_address = data & 0x3f;
+        } else {
+            m_increment = true;
+            m_address = data & 0x7f;
+        }
+        return 0xff;
+    }
+
+    reg = m_address;
+    if (m_increment && incrementAddress(reg))
+        m_address = (m_address + 1) % RTIMUSPISIM_REGISTERS;
+
+    if (m_read)
+        return readRegister(reg);
+
+    writeRegister(reg, data);
+    return 0xff;
+}
+
+void RTIMUSPISimDevice::deselect()
+{
+    m_selected = false;
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSPISimMPU9250
+
+RTIMUSPISimMPU9250::RTIMUSPISimMPU9250() : RTIMUSPISimDevice(RTIMUSPI_PROTOCOL_INVENSENSE)
+{
+    memset(m_compassRegisters, 0, sizeof(m_compassRegisters));
+    m_compassRegisters[0] = AK8963_DEVICEID;
+    m_compassRegisters[AK8963_ASAX] = 128;                  // unity sensitivity adjustment
+    m_compassRegisters[AK8963_ASAX + 1] = 128;
+    m_compassRegisters[AK8963_ASAX + 2] = 128;
+    m_fifoOverflows = 0;
+    reset();
+}
+
+void RTIMUSPISimMPU9250::reset()
+{
+    memset(m_registers, 0, sizeof(m_registers));
+    m_registers[MPU9250_WHO_AM_I] = MPU9250_ID;
+    m_registers[MPU9250_PWR_MGMT_1] = 0x01;
+    m_fifoOut = 0;
+    m_fifoCount = 0;
+}
+
+void RTIMUSPISimMPU9250::addSample(const short *accel, const short *gyro)
+{
+    unsigned char sample[MPU9250_FIFO_CHUNK_SIZE];
+
+    if (((m_registers[MPU9250_USER_CTRL] & 0x40) == 0) || (m_registers[MPU9250_FIFO_EN] == 0))
+        return;
+
+    for (int i = 0; i < 3; i++) {
+        sample[i * 2] = (unsigned short)accel[i] >> 8;
+        sample[i * 2 + 1] = accel[i];
+        sample[6 + i * 2] = (unsigned short)gyro[i] >> 8;
+        sample[6 + i * 2 + 1] = gyro[i];
+    }
+
+    if (m_fifoCount + MPU9250_FIFO_CHUNK_SIZE > RTIMUSPISIM_FIFO_SIZE) {
+        m_fifoOverflows++;
+        return;
+    }
+    for (int i = 0; i < MPU9250_FIFO_CHUNK_SIZE; i++)
+        m_fifo[(m_fifoOut + m_fifoCount++) % RTIMUSPISIM_FIFO_SIZE] = sample[i];
+}
+
+void RTIMUSPISimMPU9250::setCompass(const short *compass)
+{
+    //  slave 0 reads 8 bytes from ST1: ST1, X, Y, Z (little endian), ST2
+
+    m_registers[MPU9250_EXT_SENS_DATA_00] = 0x01;           // data ready
+    for (int i = 0; i < 3; i++) {
+        m_registers[MPU9250_EXT_SENS_DATA_00 + 1 + i * 2] = compass[i];
+        m_registers[MPU9250_EXT_SENS_DATA_00 + 2 + i * 2] = (unsigned short)compass[i] >> 8;
+    }
+    m_registers[MPU9250_EXT_SENS_DATA_00 + 7] = 0x10;       // 16 bit output
+}
+
+unsigned char RTIMUSPISimMPU9250::readRegister(unsigned char reg)
+{
+    unsigned char data;
+
+    switch (reg) {
+    case MPU9250_FIFO_COUNT_H:
+        return m_fifoCount >> 8;
+
+    case MPU9250_FIFO_COUNT_H + 1:
+        return m_fifoCount;
+
+    case MPU9250_FIFO_R_W:
+        if (m_fifoCount == 0)
+            return 0xff;
+        data = m_fifo[m_fifoOut];
+        m_fifoOut = (m_fifoOut + 1) % RTIMUSPISIM_FIFO_SIZE;
+        m_fifoCount--;
+        return data;
+
+    case MPU9250_I2C_MST_STATUS:
+        data = m_registers[reg];
+        m_registers[reg] &= ~0x40;                          // SLV4_DONE clears on read
+        return data;
+
+    default:
+        return m_registers[reg];
+    }
+}
+
+void RTIMUSPISimMPU9250::writeRegister(unsigned char reg, unsigned char data)
+{
+    unsigned char compassReg;
+
+    switch (reg) {
+    case MPU9250_PWR_MGMT_1:
+        if (data & 0x80) {
+            reset();
+            return;
+        }
+        break;
+
+    case MPU9250_USER_CTRL:
+        if (data & 0x04) {
+            m_fifoOut = 0;                                  // FIFO reset
+            m_fifoCount = 0;
+        }
+        data &= ~0x07;                                      // reset bits self clear
+        break;
+
+    case MPU9250_I2C_SLV4_CTRL:
+        if ((data & 0x80) && (m_registers[MPU9250_USER_CTRL] & 0x20)) {
+            //  run the slave 4 transfer straight away
+
+            compassReg = m_registers[MPU9250_I2C_SLV4_REG] % sizeof(m_compassRegisters);
+            if ((m_registers[MPU9250_I2C_SLV4_ADDR] & 0x7f) == AK8963_ADDRESS) {
+                if (m_registers[MPU9250_I2C_SLV4_ADDR] & 0x80)
+                    m_registers[MPU9250_I2C_SLV4_DI] = m_compassRegisters[compassReg];
+                else
+                    m_compassRegisters[compassReg] = m_registers[MPU9250_I2C_SLV4_DO];
+            }
+            m_registers[MPU9250_I2C_MST_STATUS] |= 0x40;    // SLV4_DONE
+            data &= ~0x80;
+        }
+        break;
+    }
+    m_registers[reg] = data;
+}
+
+bool RTIMUSPISimMPU9250::incrementAddress(unsigned char reg)
+{
+    return reg != MPU9250_FIFO_R_W;                         // burst reads of the FIFO stay on the FIFO
+}
+
+#endif // RTIMU_SPI && RTIMU_SPI_SIMULATOR
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSPISIM_H
+#define	_RTIMUSPISIM_H
+
+#include "RTIMUSPI.h"
+
+//  Simulated SPI devices for host testing. With RTIMU_SPI_SIMULATOR defined RTIMUSPI
+//  sends every byte to the device attached to the chip select with
+//  RTIMUSPI::attachSimulator() instead of the SPI hardware. The device sees the same
+//  chip select cycles and address bytes as a real part so transfer counts and sizes
+//  can be measured exactly.
+
+#if defined(RTIMU_SPI) && defined(RTIMU_SPI_SIMULATOR)
+
+#define RTIMUSPISIM_REGISTERS           128                 // size of the register file
+#define RTIMUSPISIM_FIFO_SIZE           1024                // MPU9250 FIFO size in bytes
+
+//  A plain register file using one of the RTIMUSPI_PROTOCOL_xxx address formats.
+//  Set up m_registers (WHO_AM_I etc) directly - it is enough for the LSM9DS0.
+
+class RTIMUSPISimDevice
+{
+public:
+    RTIMUSPISimDevice(unsigned char protocol);
+    virtual ~RTIMUSPISimDevice() {}
+
+    //  the wire as seen by RTIMUSPI
+
+    void select();                                          // chip select goes low
+    unsigned char transfer(unsigned char data);             // one byte each way
+    void deselect();                                        // chip select goes high
+
+    //  the register model - override for registers with side effects
+
+    virtual unsigned char readRegister(unsigned char reg) { return m_registers[reg]; }
+    virtual void writeRegister(unsigned char reg, unsigned char data) { m_registers[reg] = data; }
+    virtual bool incrementAddress(unsigned char reg) { return true; }
+
+    unsigned char m_registers[RTIMUSPISIM_REGISTERS];
+    unsigned long m_selects;                                // chip select cycles seen
+    unsigned long m_bytes;                                  // bytes clocked including address bytes
+
+protected:
+    unsigned char m_protocol;                               // RTIMUSPI_PROTOCOL_xxx
+    bool m_selected;                                        // chip select is low
+    bool m_addressed;                                       // address byte received
+    bool m_read;                                            // current cycle is a read
+    bool m_increment;                                       // address advances after each byte
+    unsigned char m_address;                                // current register
+};
+
+//  An MPU9250 with a FIFO fed by addSample() and an AK8963 behind the I2C master's
+//  slave 4 interface. Slave 0 (the compass data in EXT_SENS_DATA) is filled by setCompass().
+
+class RTIMUSPISimMPU9250 : public RTIMUSPISimDevice
+{
+public:
+    RTIMUSPISimMPU9250();
+
+    void addSample(const short *accel, const short *gyro);  // queue one sample if the FIFO is enabled
+    void setCompass(const short *compass);                  // update the slave 0 compass data
+
+    virtual unsigned char readRegister(unsigned char reg);
+    virtual void writeRegister(unsigned char reg, unsigned char data);
+    virtual bool incrementAddress(unsigned char reg);
+
+    unsigned char m_compassRegisters[32];                   // the AK8963 register file
+    unsigned long m_fifoOverflows;                          // samples lost to a full FIFO
+
+private:
+    void reset();
+
+    unsigned char m_fifo[RTIMUSPISIM_FIFO_SIZE];
+    unsigned int m_fifoOut;                                 // index of the next byte to read
+    unsigned int m_fifoCount;                               // bytes in the FIFO
+};
+
+#endif // RTIMU_SPI && RTIMU_SPI_SIMULATOR
+
+#endif // _RTIMUSPISIM_H
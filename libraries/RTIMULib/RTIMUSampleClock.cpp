@@ -0,0 +1,192 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMUSampleClock.h"
+
+RTIMUSampleClock::RTIMUSampleClock()
+{
+    m_lost = 0;
+    m_slips = 0;
+    start(20000);
+}
+
+void RTIMUSampleClock::start(unsigned long interval)
+{
+    m_nominal = interval;
+    m_interval = interval;
+    m_locked = false;
+    m_resync = false;
+}
+
+void RTIMUSampleClock::count(unsigned long time, unsigned int waiting)
+{
+    RTFLOAT late;
+    RTFLOAT early;
+    RTFLOAT move;
+    unsigned long run;
+    long slip;
+
+    if (!m_locked) {
+        //  assume the newest sample arrived half an interval before it was counted
+
+        m_next = time;
+        m_nextFraction = 0;
+        step(-m_interval * ((RTFLOAT)waiting - (RTFLOAT)0.5));
+        m_index = 0;
+        m_anchored = false;
+        m_moved = 0;
+        m_lateMin = m_earlyMin = m_interval;
+        m_centreIndex = 0;
+        m_locked = true;
+        return;
+    }
+
+    //  late is how long before the read the newest sample is predicted to have arrived
+    //  and early how long after it the next one is - neither can be negative
+
+    late = (RTFLOAT)(long)(time - m_next) - m_nextFraction - m_interval * ((RTFLOAT)waiting - 1);
+
+    if (m_resync) {
+        //  the overflow loss came from the clock - the phase is good so the prediction is
+        //  off by about a whole number of intervals if a sample more or less was lost
+
+        slip = (long)floor(late / m_interval + (RTFLOAT)0.5);
+        step(m_interval * slip);
+        m_index += slip;
+        m_lost += slip;
+        late -= m_interval * slip;
+        m_resync = false;
+    }
+
+    if ((late < -RTIMUSAMPLECLOCK_SLIP * m_interval) || (late > RTIMUSAMPLECLOCK_SLIP * m_interval)) {
+        m_slips++;
+        m_interval = m_nominal;
+        m_locked = false;
+        count(time, waiting);
+        return;
+    }
+
+    early = m_interval - late;
+
+    move = 0;
+    if (late < 0)
+        move = late;
+    else if (early < 0)
+        move = -early;
+    step(move);
+    m_moved += move;
+
+    //  the bounds kept are relative to the prediction so they shift when it moves
+
+    late -= move;
+    early += move;
+    m_lateMin -= move;
+    m_earlyMin += move;
+    if (late < m_lateMin)
+        m_lateMin = late;
+    if (early < m_earlyMin)
+        m_earlyMin = early;
+
+    //  the bounds only say much once reads have landed close to samples on both sides
+
+    if (((m_index - m_centreIndex) >= RTIMUSAMPLECLOCK_CENTRE) &&
+            ((m_lateMin + m_earlyMin) < m_interval / RTIMUSAMPLECLOCK_NARROW)) {
+        move = (m_lateMin - m_earlyMin) / 2;
+        step(move);
+        m_moved += move;
+
+        //  the phase had to be moved by m_moved over the samples since the last time so
+        //  the interval is that much out - take a share of it
+
+        m_interval += m_moved / (RTFLOAT)(m_index - m_centreIndex) / RTIMUSAMPLECLOCK_GAIN;
+        m_moved = 0;
+        m_lateMin = m_earlyMin = m_interval;
+        m_centreIndex = m_index;
+
+        if (!m_anchored) {
+            //  the first guess at the phase was rough - measure from here
+
+            m_anchorTime = m_next;
+            m_anchorFraction = m_nextFraction;
+            m_anchorIndex = m_index;
+            m_anchored = true;
+        }
+    }
+
+    //  over a long run the interval can be measured directly from the phase
+
+    run = m_index - m_anchorIndex;
+    if (m_anchored && (run >= RTIMUSAMPLECLOCK_WINDOW)) {
+        m_interval = ((RTFLOAT)(long)(m_next - m_anchorTime) + m_nextFraction - m_anchorFraction) / (RTFLOAT)run;
+        m_anchorTime = m_next;
+        m_anchorFraction = m_nextFraction;
+        m_anchorIndex = m_index;
+    }
+
+    if (m_interval > m_nominal * (1 + RTIMUSAMPLECLOCK_PULL))
+        m_interval = m_nominal * (1 + RTIMUSAMPLECLOCK_PULL);
+    if (m_interval < m_nominal * (1 - RTIMUSAMPLECLOCK_PULL))
+        m_interval = m_nominal * (1 - RTIMUSAMPLECLOCK_PULL);
+}
+
+unsigned long RTIMUSampleClock::overflow(unsigned long now)
+{
+    RTFLOAT elapsed;
+    unsigned long lost;
+
+    if (!m_locked)
+        return 0;
+
+    //  everything due by now has gone - the FIFO has been reset
+
+    elapsed = (RTFLOAT)(long)(now - m_next) - m_nextFraction;
+    if (elapsed < 0)
+        return 0;
+
+    lost = (unsigned long)(elapsed / m_interval) + 1;
+    step(m_interval * lost);
+    m_index += lost;
+    m_lost += lost;
+    m_resync = true;
+    return lost;
+}
+
+unsigned long RTIMUSampleClock::next()
+{
+    unsigned long time = m_next;
+
+    step(m_interval);
+    m_index++;
+    return time;
+}
+
+//  moves the next sample time by delta uS, keeping the fraction in 0 to 1
+
+void RTIMUSampleClock::step(RTFLOAT delta)
+{
+    RTFLOAT time = m_nextFraction + delta;
+    long whole = (long)floor(time);
+
+    m_next += whole;
+    m_nextFraction = time - whole;
+}
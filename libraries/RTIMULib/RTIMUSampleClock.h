@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSAMPLECLOCK_H
+#define	_RTIMUSAMPLECLOCK_H
+
+#include "RTMath.h"
+
+//  RTIMUSampleClock locks a chip's own sample clock to micros() so that every sample
+//  read from a FIFO gets the time it was actually taken. The chip's oscillator can be a
+//  percent or two away from its nominal rate, so counting nominal intervals drifts and
+//  using the time a sample was read adds the FIFO and bus latency instead.
+//
+//  Each time the FIFO count is read, count() checks the predicted arrival of the newest
+//  sample in the FIFO against the time the read started. The newest sample must have
+//  arrived before then and the one after it must not have. A prediction outside those
+//  bounds is moved onto them straight away. The tightest bounds seen on each side are
+//  kept and every few samples the prediction is moved to the middle of them - with reads
+//  at varying points in the sample interval that closes in on the truth. The phase moves
+//  also trim the interval, which is measured directly from the phase over long runs.
+//  next() hands out the sample times in FIFO order. After a FIFO overflow, overflow()
+//  works out how many samples were lost from the locked clock and the count that follows
+//  corrects that by a sample if needed.
+
+#define RTIMUSAMPLECLOCK_CENTRE         16                  // samples between moves to the middle of the bounds
+#define RTIMUSAMPLECLOCK_NARROW         4                   // and the bounds must be within 1/NARROW of an interval
+#define RTIMUSAMPLECLOCK_WINDOW         1024                // samples the interval is measured over
+#define RTIMUSAMPLECLOCK_GAIN           4                   // share of the phase moves taken into the interval
+#define RTIMUSAMPLECLOCK_PULL           0.05                // furthest the interval can be from nominal
+#define RTIMUSAMPLECLOCK_SLIP           4                   // intervals of error that lose the lock
+
+class RTIMUSampleClock
+{
+public:
+    RTIMUSampleClock();
+
+    //  start() sets the nominal interval in uS and drops the lock. The lock is taken
+    //  again on the next count().
+
+    void start(unsigned long interval);
+
+    //  count() is called with micros() when the FIFO count read started on the bus and
+    //  the number of samples waiting in the FIFO
+
+    void count(unsigned long time, unsigned int waiting);
+
+    //  overflow() is called with micros() after an overflowed FIFO has been reset and
+    //  returns the number of samples lost
+
+    unsigned long overflow(unsigned long now);
+
+    //  next() returns the sample time of the next sample read from the FIFO
+
+    unsigned long next();
+
+    inline bool locked() { return m_locked; }
+    inline RTFLOAT getInterval() { return m_interval; }     // the measured interval in uS
+
+    unsigned long m_lost;                                   // samples lost to FIFO overflows
+    unsigned long m_slips;                                  // times the lock was lost
+
+private:
+    void step(RTFLOAT delta);
+
+    unsigned long m_nominal;                                // nominal interval in uS
+    RTFLOAT m_interval;                                     // measured interval in uS
+    bool m_locked;
+    bool m_resync;                                          // the next count checks the overflow loss
+
+    unsigned long m_next;                                   // time of the next sample to be read
+    RTFLOAT m_nextFraction;                                 // and the fraction of a uS
+    unsigned long m_index;                                  // samples read or lost since the lock
+
+    RTFLOAT m_lateMin;                                      // tightest bounds since the last move to the middle
+    RTFLOAT m_earlyMin;
+    RTFLOAT m_moved;                                        // phase moved since the last move to the middle
+    unsigned long m_centreIndex;                            // sample index of the last move to the middle
+
+    unsigned long m_anchorTime;                             // time of sample m_anchorIndex
+    RTFLOAT m_anchorFraction;
+    unsigned long m_anchorIndex;                            // start of the run the interval is measured over
+    bool m_anchored;                                        // false until the phase is good enough to measure from
+};
+
+#endif // _RTIMUSAMPLECLOCK_H
@@ -283,26 +283,40 @@ RTIMUSettings::RTIMUSettings()
 #ifdef BMP180
     m_pressureType = RTPRESSURE_TYPE_BMP180;
     m_I2CPressureAddress = BMP180_ADDRESS;
+    m_BMP180Oss = BMP180_SCO_PRESSURECONV_UHR;
+    m_BMP180TemperatureInterval = 10;
 #endif
 
 #ifdef LPS25H_5c
     m_pressureType = RTPRESSURE_TYPE_LPS25H;
     m_I2CPressureAddress = LPS25H_ADDRESS0;
+    m_LPS25HSampleRate = LPS25H_SAMPLERATE_25;
+    m_LPS25HPressureAvg = LPS25H_PRESSURE_AVG_32;
+    m_LPS25HTemperatureAvg = LPS25H_TEMPERATURE_AVG_16;
+    m_LPS25HFifoMean = LPS25H_FIFO_MEAN_OFF;
 #endif
 
 #ifdef LPS25H_5d
     m_pressureType = RTPRESSURE_TYPE_LPS25H;
     m_I2CPressureAddress = LPS25H_ADDRESS1;
+    m_LPS25HSampleRate = LPS25H_SAMPLERATE_25;
+    m_LPS25HPressureAvg = LPS25H_PRESSURE_AVG_32;
+    m_LPS25HTemperatureAvg = LPS25H_TEMPERATURE_AVG_16;
+    m_LPS25HFifoMean = LPS25H_FIFO_MEAN_OFF;
 #endif
 
 #ifdef MS5611_76
     m_pressureType = RTPRESSURE_TYPE_MS5611;
     m_I2CPressureAddress = MS5611_ADDRESS0;
+    m_MS5611Osr = MS5611_OSR_4096;
+    m_MS5611TemperatureInterval = 10;
 #endif
 
 #ifdef MS5611_77
     m_pressureType = RTPRESSURE_TYPE_MS5611;
     m_I2CPressureAddress = MS5611_ADDRESS1;
+    m_MS5611Osr = MS5611_OSR_4096;
+    m_MS5611TemperatureInterval = 10;
 #endif
 
 }
@@ -118,6 +118,29 @@ public:
     int m_GD20HM303DLHCCompassFsr;                          // the compass full scale range
 #endif
 
+#if defined(BMP180)
+    //  BMP180
+
+    int m_BMP180Oss;                                        // pressure oversampling setting
+    int m_BMP180TemperatureInterval;                        // pressure conversions per temperature conversion
+#endif
+
+#if defined(LPS25H_5c) || defined(LPS25H_5d)
+    //  LPS25H
+
+    int m_LPS25HSampleRate;                                 // the output data rate code
+    int m_LPS25HPressureAvg;                                // internal pressure averaging code
+    int m_LPS25HTemperatureAvg;                             // internal temperature averaging code
+    int m_LPS25HFifoMean;                                   // FIFO mean mode depth
+#endif
+
+#if defined(MS5611_76) || defined(MS5611_77)
+    //  MS5611
+
+    int m_MS5611Osr;                                        // oversampling ratio code
+    int m_MS5611TemperatureInterval;                        // pressure conversions per temperature conversion
+#endif
+
 };
 
 #endif // _RTIMUSETTINGS_H
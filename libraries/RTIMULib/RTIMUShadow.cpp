@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMU.h"
+
+RTIMUShadow::RTIMUShadow()
+{
+    m_skipped = 0;
+    m_transfers = 0;
+    setDevice(0, RTIMUSHADOW_WRITES_SINGLE);
+}
+
+void RTIMUShadow::setDevice(unsigned char devAddr, unsigned char writeMode)
+{
+    m_devAddr = devAddr;
+    m_writeMode = writeMode;
+    m_batchLength = 0;
+    invalidate();
+}
+
+bool RTIMUShadow::write(unsigned char regAddr, unsigned char data)
+{
+    int entry = find(regAddr);
+
+    if ((entry >= 0) && (m_values[entry] == data)) {
+        m_skipped++;
+        return true;
+    }
+
+    //  the write joins the held back run if it is the next register
+
+    if ((m_batchLength > 0) && ((regAddr != m_batchStart + m_batchLength) || (m_batchLength == RTIMUSHADOW_BATCH))) {
+        if (!flush())
+            return false;
+    }
+
+    if (m_batchLength == 0)
+        m_batchStart = regAddr;
+    m_batch[m_batchLength++] = data;
+    remember(regAddr, data);
+
+    if (m_writeMode == RTIMUSHADOW_WRITES_SINGLE)
+        return flush();
+    return true;
+}
+
+bool RTIMUShadow::flush()
+{
+    unsigned char regAddr = m_batchStart;
+    unsigned char length = m_batchLength;
+    int entry;
+
+    if (length == 0)
+        return true;
+
+    m_batchLength = 0;
+    if ((length > 1) && (m_writeMode == RTIMUSHADOW_WRITES_INCREMENT_BIT))
+        regAddr |= 0x80;
+
+    m_transfers++;
+    if (RTIMUBus::writeBytes(m_devAddr, regAddr, length, m_batch))
+        return true;
+
+    //  the chip may have taken some of the run - forget all of it
+
+    for (unsigned char i = 0; i < length; i++) {
+        if ((entry = find(m_batchStart + i)) >= 0) {
+            m_count--;
+            m_registers[entry] = m_registers[m_count];
+            m_values[entry] = m_values[m_count];
+        }
+    }
+    return false;
+}
+
+void RTIMUShadow::assume(unsigned char regAddr, unsigned char data)
+{
+    remember(regAddr, data);
+}
+
+void RTIMUShadow::invalidate()
+{
+    m_count = 0;
+    m_replace = 0;
+}
+
+bool RTIMUShadow::waitFor(unsigned char devAddr, unsigned char regAddr, unsigned char mask,
+            unsigned char expected, unsigned long timeout, unsigned long interval)
+{
+    unsigned long start = millis();
+    unsigned char data;
+
+    while (true) {
+        if ((RTIMUBus::readByte(devAddr, regAddr, &data) == 1) && ((data & mask) == expected))
+            return true;
+        if ((millis() - start) >= timeout)
+            return false;
+        delay(interval);
+    }
+}
+
+int RTIMUShadow::find(unsigned char regAddr)
+{
+    for (int i = 0; i < m_count; i++) {
+        if (m_registers[i] == regAddr)
+            return i;
+    }
+    return -1;
+}
+
+void RTIMUShadow::remember(unsigned char regAddr, unsigned char data)
+{
+    int entry = find(regAddr);
+
+    if (entry < 0) {
+        if (m_count < RTIMUSHADOW_LENGTH) {
+            entry = m_count++;
+        } else {
+            entry = m_replace;
+            m_replace = (m_replace + 1) % RTIMUSHADOW_LENGTH;
+        }
+        m_registers[entry] = regAddr;
+    }
+    m_values[entry] = data;
+}
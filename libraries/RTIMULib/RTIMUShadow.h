@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSHADOW_H
+#define	_RTIMUSHADOW_H
+
+//  RTIMUShadow keeps a copy of the configuration registers a driver has written to one
+//  device. A write of the value the register already holds is skipped, and writes to
+//  consecutive registers are held back and sent as one multi-byte transfer when the run
+//  ends or flush() is called. Registers written through a shadow must only be written
+//  through it (or the shadow invalidated) and strobe or self-clearing bits should be
+//  written directly. Call invalidate() after resetting the chip.
+//
+//  waitFor() polls a status register in place of a fixed delay.
+
+#define RTIMUSHADOW_LENGTH              16                  // registers remembered per device
+#define RTIMUSHADOW_BATCH               8                   // longest coalesced write
+
+//  Multi-byte write modes
+
+#define RTIMUSHADOW_WRITES_SINGLE       0                   // one register per transfer
+#define RTIMUSHADOW_WRITES_INCREMENT    1                   // the chip steps the register address itself
+#define RTIMUSHADOW_WRITES_INCREMENT_BIT 2                  // bit 7 of the register address selects auto increment (STM)
+
+class RTIMUShadow
+{
+public:
+    RTIMUShadow();
+
+    //  setDevice() selects the device and forgets anything remembered
+
+    void setDevice(unsigned char devAddr, unsigned char writeMode);
+
+    //  write() returns false if sending an earlier run failed
+
+    bool write(unsigned char regAddr, unsigned char data);
+    bool flush();
+
+    //  assume() records a value known to be in the chip (a reset default for example)
+
+    void assume(unsigned char regAddr, unsigned char data);
+    void invalidate();
+
+    //  polls regAddr every interval mS until (value & mask) == expected or timeout mS
+    //  have passed - read errors count as not ready
+
+    static bool waitFor(unsigned char devAddr, unsigned char regAddr, unsigned char mask,
+            unsigned char expected, unsigned long timeout, unsigned long interval = 1);
+
+    unsigned int m_skipped;                                 // writes not needed
+    unsigned int m_transfers;                               // write transfers made
+
+private:
+    int find(unsigned char regAddr);
+    void remember(unsigned char regAddr, unsigned char data);
+
+    unsigned char m_devAddr;
+    unsigned char m_writeMode;
+
+    unsigned char m_registers[RTIMUSHADOW_LENGTH];          // register addresses remembered
+    unsigned char m_values[RTIMUSHADOW_LENGTH];             // and their values
+    unsigned char m_count;                                  // entries in use
+    unsigned char m_replace;                                // next entry to reuse when full
+
+    unsigned char m_batch[RTIMUSHADOW_BATCH];               // data for the run being held back
+    unsigned char m_batchStart;                             // first register of the run
+    unsigned char m_batchLength;                            // 0 if nothing held back
+};
+
+#endif // _RTIMUSHADOW_H
@@ -0,0 +1,1704 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMUSim.h"
+#include "RTIMUMPU9150.h"
+#include "RTIMUMPU9250.h"
+#include "RTIMULSM9DS0.h"
+#include "RTIMUGD20HM303D.h"
+#include "RTIMUGD20M303DLHC.h"
+#include "RTIMUBNO055.h"
+#include "RTPressureBMP180.h"
+
+#ifdef I2CDEV_SIMULATOR
+
+//  Registers the drivers don't use
+
+#define MPU9150_TEMP_OUT_H              0x41
+#define MPU9150_I2C_SLV0_DO             0x63
+#define MPU9150_FIFO_COUNT_L            0x73
+
+#define AK89XX_WIA                      0x00
+#define AK89XX_HXL                      0x03
+#define AK89XX_ST2                      0x09
+
+#define LPS25H_ONE_SHOT_TIME            40000               // uS - roughly one 25Hz period at the default averaging
+
+#define BNO055_QUAT_DATA                0x20
+#define BNO055_TEMP                     0x34
+#define BNO055_RESET_TIME               650000              // uS - the chip NACKs for this long after a reset
+
+//----------------------------------------------------------
+//
+//  RTIMUSimSensor
+
+RTIMUSimSensor::RTIMUSimSensor(unsigned char devAddr, RTIMUSimMotion *motion, bool incrementBit)
+    : I2CdevSimDevice(devAddr)
+{
+    m_motion = motion;
+    m_now = micros();
+    m_incrementBit = incrementBit;
+    m_increment = true;
+    m_clockError = 0;
+    setAxes(0, 0, 0);
+    clearCounters();
+}
+
+void RTIMUSimSensor::setAxes(const signed char *gyro, const signed char *accel, const signed char *compass)
+{
+    for (int i = 0; i < 3; i++) {
+        m_gyroAxes[i] = gyro == 0 ? i + 1 : gyro[i];
+        m_accelAxes[i] = accel == 0 ? i + 1 : accel[i];
+        m_compassAxes[i] = compass == 0 ? i + 1 : compass[i];
+    }
+}
+
+void RTIMUSimSensor::clearCounters()
+{
+    m_samples = 0;
+    m_overruns = 0;
+    m_samplesRead = 0;
+    m_latencyTotal = 0;
+    m_latencyMax = 0;
+    m_lastSampleTime = 0;
+    transactions = 0;
+    bytes = 0;
+}
+
+void RTIMUSimSensor::update(uint32_t now)
+{
+    m_now = now;
+    advance();
+}
+
+void RTIMUSimSensor::start(uint8_t regAddr)
+{
+    if (m_incrementBit) {
+        m_increment = (regAddr & 0x80) != 0;
+        regAddr &= 0x7f;
+    }
+    I2CdevSimDevice::start(regAddr);
+}
+
+uint8_t RTIMUSimSensor::nextRegister(uint8_t regAddr)
+{
+    return m_increment ? regAddr + 1 : regAddr;
+}
+
+//  (Re)starts a sample clock - the first sample is one period from now
+
+void RTIMUSimSensor::startClock(RTIMUSIM_CLOCK *clock, unsigned long period)
+{
+    period += (long)((long long)period * m_clockError / 1000000);
+    clock->period = period;
+    clock->next = m_now + period;
+    clock->last = m_now;
+}
+
+//  Returns the number of samples due by m_now and moves clock->last to the latest
+
+int RTIMUSimSensor::ticks(RTIMUSIM_CLOCK *clock)
+{
+    unsigned long count;
+
+    if ((clock->period == 0) || ((long)(m_now - clock->next) < 0))
+        return 0;
+
+    count = (m_now - clock->next) / clock->period;
+    clock->last = clock->next + count * clock->period;
+    clock->next = clock->last + clock->period;
+    return count + 1;
+}
+
+void RTIMUSimSensor::getState(unsigned long time, RTIMUSIM_STATE *state)
+{
+    m_motion->getState(time, state);
+}
+
+//  Called when the driver reads a new sample
+
+void RTIMUSimSensor::sampleRead(unsigned long sampleTime)
+{
+    unsigned long latency = m_now - sampleTime;
+
+    m_samplesRead++;
+    m_lastSampleTime = sampleTime;
+    m_latencyTotal += latency;
+    if (latency > m_latencyMax)
+        m_latencyMax = latency;
+}
+
+//  Maps a vector onto the chip axes and scales it (lsb is the value of one count)
+
+void RTIMUSimSensor::toRaw(const RTVector3& vec, const signed char *axes, RTFLOAT lsb, short *raw)
+{
+    for (int i = 0; i < 3; i++) {
+        int axis = axes[i] < 0 ? -axes[i] : axes[i];
+        RTFLOAT value = vec.data(axis - 1) / lsb;
+
+        if (axes[i] < 0)
+            value = -value;
+        value += value < 0 ? -0.5 : 0.5;
+        if (value > 32767)
+            value = 32767;
+        if (value < -32768)
+            value = -32768;
+        raw[i] = (short)value;
+    }
+}
+
+void RTIMUSimSensor::putRaw(unsigned char regAddr, const short *raw, bool bigEndian)
+{
+    for (int i = 0; i < 3; i++) {
+        registers[regAddr + i * 2 + (bigEndian ? 1 : 0)] = raw[i] & 0xff;
+        registers[regAddr + i * 2 + (bigEndian ? 0 : 1)] = (raw[i] >> 8) & 0xff;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimAK89xx
+
+RTIMUSimAK89xx::RTIMUSimAK89xx(RTIMUSimMotion *motion, bool ak8963)
+    : RTIMUSimSensor(AK8975_ADDRESS, motion, false)
+{
+    m_ak8963 = ak8963;
+    m_onBus = false;
+    m_converting = false;
+    m_unread = false;
+    m_clock.period = 0;
+    m_clock.last = 0;
+    registers[AK89XX_WIA] = 0x48;
+    registers[AK8975_ASAX] = 128;                           // no sensitivity adjustment
+    registers[AK8975_ASAX + 1] = 128;
+    registers[AK8975_ASAX + 2] = 128;
+}
+
+void RTIMUSimAK89xx::advance()
+{
+    if (m_converting && ((long)(m_now - m_done) >= 0)) {
+        m_converting = false;
+        registers[AK8975_CNTL] &= 0xf0;                     // back to power down
+        m_clock.last = m_done;
+        measure(m_done);
+    }
+
+    int count = ticks(&m_clock);
+
+    if (count > 0) {
+        m_samples += count - 1;
+        m_overruns += count - 1;
+        measure(m_clock.last);
+    }
+}
+
+void RTIMUSimAK89xx::measure(unsigned long time)
+{
+    RTIMUSIM_STATE state;
+    short raw[3];
+    RTFLOAT lsb = 0.3;                                      // AK8975
+
+    if (m_ak8963)
+        lsb = (registers[AK8975_CNTL] & 0x10) ? 0.15 : 0.6; // 16 or 14 bits
+
+    if (m_unread) {
+        m_overruns++;
+        registers[AK8975_ST1] |= 0x02;                      // data overrun
+    }
+    getState(time, &state);
+    toRaw(state.compass, m_compassAxes, lsb, raw);
+    putRaw(AK89XX_HXL, raw, false);
+    registers[AK8975_ST1] |= 0x01;                          // data ready
+    registers[AK89XX_ST2] = m_ak8963 ? (registers[AK8975_CNTL] & 0x10) : 0;
+    m_samples++;
+    m_unread = true;
+}
+
+uint8_t RTIMUSimAK89xx::readRegister(uint8_t regAddr)
+{
+    if (regAddr == AK89XX_ST2) {
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        registers[AK8975_ST1] &= ~0x03;                     // reading ST2 ends the data read
+    }
+    return registers[regAddr];
+}
+
+void RTIMUSimAK89xx::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    if (regAddr != AK8975_CNTL)
+        return;                                             // everything else is read only
+
+    registers[AK8975_CNTL] = data;
+    m_converting = false;
+    m_clock.period = 0;
+
+    switch (data & 0x0f) {
+    case 0x01:                                              // single measurement
+        m_converting = true;
+        m_done = m_now + (m_ak8963 ? 7200 : 7300);
+        break;
+
+    case 0x02:                                              // AK8963 continuous 8Hz
+        if (m_ak8963)
+            startClock(&m_clock, 125000);
+        break;
+
+    case 0x06:                                              // AK8963 continuous 100Hz
+        if (m_ak8963)
+            startClock(&m_clock, 10000);
+        break;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimMPU9150
+
+RTIMUSimMPU9150::RTIMUSimMPU9150(unsigned char devAddr, RTIMUSimMotion *motion, RTIMUSimAK89xx *compass, bool mpu9250)
+    : RTIMUSimSensor(devAddr, motion, false)
+{
+    m_compass = compass;
+    m_mpu9250 = mpu9250;
+    m_fifoOverflows = 0;
+    reset();
+}
+
+void RTIMUSimMPU9150::reset()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[MPU9150_WHO_AM_I] = m_mpu9250 ? MPU9250_ID : MPU9150_ID;
+    registers[MPU9150_PWR_MGMT_1] = 0x40;                   // asleep
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_slaveCount = 0;
+    m_unread = false;
+    m_fifoOut = 0;
+    m_fifoCount = 0;
+    m_fifoEntry = 0;
+    m_fifoPushed = 0;
+    m_fifoPopped = 0;
+    m_fifoOffset = 0;
+    setBypass();
+}
+
+//  The sample clock is the gyro output rate (8kHz with the DLPF off) divided by 1 + SMPLRT_DIV
+
+void RTIMUSimMPU9150::restart()
+{
+    unsigned char lpf = registers[MPU9150_LPF_CONFIG] & 0x07;
+    unsigned long rate = ((lpf == 0) || (lpf == 7)) ? 8000 : 1000;
+
+    if (registers[MPU9150_PWR_MGMT_1] & 0x40) {
+        m_clock.period = 0;
+        return;
+    }
+    startClock(&m_clock, 1000000L * (1 + registers[MPU9150_SMPRT_DIV]) / rate);
+}
+
+void RTIMUSimMPU9150::setBypass()
+{
+    if (m_compass != 0)
+        m_compass->m_onBus = (registers[MPU9150_INT_PIN_CFG] & 0x02) && !(registers[MPU9150_USER_CTRL] & 0x20);
+}
+
+void RTIMUSimMPU9150::advance()
+{
+    int count = ticks(&m_clock);
+    unsigned long time;
+
+    if (count == 0)
+        return;
+
+    //  after a long gap only the last RTIMUSIM_FIFO_ENTRIES samples can matter
+
+    if (count > RTIMUSIM_FIFO_ENTRIES) {
+        m_samples += count - RTIMUSIM_FIFO_ENTRIES;
+        if (registers[MPU9150_USER_CTRL] & 0x40)
+            m_fifoOverflows += count - RTIMUSIM_FIFO_ENTRIES;
+        count = RTIMUSIM_FIFO_ENTRIES;
+    }
+    time = m_clock.last - (count - 1) * m_clock.period;
+    for (int i = 0; i < count; i++, time += m_clock.period)
+        sample(time);
+}
+
+void RTIMUSimMPU9150::sample(unsigned long time)
+{
+    RTIMUSIM_STATE state;
+    short raw[3];
+    short temperature;
+    int fs;
+    unsigned char entry[32];
+    int length = 0;
+    unsigned char fifoEnable = registers[MPU9150_FIFO_EN];
+
+    getState(time, &state);
+
+    fs = (registers[MPU9150_ACCEL_CONFIG] >> 3) & 3;
+    toRaw(state.accel, m_accelAxes, 1.0 / (RTFLOAT)(16384 >> fs), raw);
+    putRaw(MPU9150_ACCEL_XOUT_H, raw, true);
+
+    fs = (registers[MPU9150_GYRO_CONFIG] >> 3) & 3;
+    toRaw(state.gyro, m_gyroAxes, RTMATH_DEGREE_TO_RAD * (RTFLOAT)(1 << fs) / 131.0, raw);
+    putRaw(MPU9150_GYRO_XOUT_H, raw, true);
+
+    if (m_mpu9250)
+        temperature = (short)((state.temperature - 21.0) * 333.87);
+    else
+        temperature = (short)((state.temperature - 35.0) * 340.0 - 521.0);
+    registers[MPU9150_TEMP_OUT_H] = temperature >> 8;
+    registers[MPU9150_TEMP_OUT_H + 1] = temperature & 0xff;
+
+    registers[MPU9150_INT_STATUS] |= 0x01;                  // data ready
+    m_samples++;
+    if (!(registers[MPU9150_USER_CTRL] & 0x40)) {
+        if (m_unread)
+            m_overruns++;
+        m_unread = true;
+    }
+
+    if (registers[MPU9150_USER_CTRL] & 0x20)
+        runSlaves(time);
+
+    if (!(registers[MPU9150_USER_CTRL] & 0x40) || (fifoEnable == 0))
+        return;
+
+    //  the FIFO takes the enabled outputs in register order
+
+    if (fifoEnable & 0x08) {
+        memcpy(entry + length, registers + MPU9150_ACCEL_XOUT_H, 6);
+        length += 6;
+    }
+    if (fifoEnable & 0x80) {
+        memcpy(entry + length, registers + MPU9150_TEMP_OUT_H, 2);
+        length += 2;
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        if (fifoEnable & (0x40 >> axis)) {
+            memcpy(entry + length, registers + MPU9150_GYRO_XOUT_H + axis * 2, 2);
+            length += 2;
+        }
+    }
+    if ((fifoEnable & 0x01) && (registers[MPU9150_I2C_SLV0_CTRL] & 0x80)) {
+        memcpy(entry + length, registers + MPU9150_EXT_SENS_DATA_00, registers[MPU9150_I2C_SLV0_CTRL] & 0x0f);
+        length += registers[MPU9150_I2C_SLV0_CTRL] & 0x0f;
+    }
+    fifoPush(entry, length, time);
+}
+
+//  A full FIFO loses its oldest data. Whole samples are dropped here so the
+//  timestamps stay lined up with the entries.
+
+void RTIMUSimMPU9150::fifoPush(const unsigned char *data, int length, unsigned long time)
+{
+    m_fifoEntry = length;
+    while (m_fifoCount + length > RTIMUSIM_FIFO_SIZE) {
+        m_fifoOut = (m_fifoOut + m_fifoEntry - m_fifoOffset) % RTIMUSIM_FIFO_SIZE;
+        m_fifoCount -= m_fifoEntry - m_fifoOffset;
+        m_fifoOffset = 0;
+        m_fifoPopped++;
+        m_fifoOverflows++;
+        registers[MPU9150_INT_STATUS] |= 0x10;              // FIFO overflow
+    }
+    for (int i = 0; i < length; i++)
+        m_fifo[(m_fifoOut + m_fifoCount + i) % RTIMUSIM_FIFO_SIZE] = data[i];
+    m_fifoCount += length;
+    m_fifoTimes[m_fifoPushed % RTIMUSIM_FIFO_ENTRIES] = time;
+    m_fifoPushed++;
+}
+
+//  The I2C master runs slaves 0 and 1 after each sample. Slaves with their bit set
+//  in I2C_MST_DELAY_CTRL only run every 1 + I2C_MST_DLY samples.
+
+void RTIMUSimMPU9150::runSlaves(unsigned long time)
+{
+    unsigned char extOffset = 0;
+    bool delayDue;
+
+    if (++m_slaveCount > (unsigned int)(registers[MPU9150_I2C_SLV4_CTRL] & 0x1f))
+        m_slaveCount = 0;
+    delayDue = m_slaveCount == 0;
+
+    for (int slave = 0; slave < 2; slave++) {
+        unsigned char addr = registers[MPU9150_I2C_SLV0_ADDR + slave * 3];
+        unsigned char reg = registers[MPU9150_I2C_SLV0_REG + slave * 3];
+        unsigned char ctrl = registers[MPU9150_I2C_SLV0_CTRL + slave * 3];
+        unsigned char length = ctrl & 0x0f;
+        bool read = (addr & 0x80) != 0;
+
+        if (!(ctrl & 0x80))
+            continue;
+        if ((registers[MPU9150_I2C_MST_DELAY_CTRL] & (1 << slave)) && !delayDue) {
+            if (read)
+                extOffset += length;
+            continue;
+        }
+        if ((m_compass == 0) || ((addr & 0x7f) != m_compass->devAddr)) {
+            if (read)
+                extOffset += length;
+            continue;
+        }
+
+        m_compass->update(time);
+        m_compass->start(reg);
+        if (read) {
+            for (int i = 0; i < length; i++)
+                registers[MPU9150_EXT_SENS_DATA_00 + extOffset++] = m_compass->read();
+        } else {
+            m_compass->write(registers[MPU9150_I2C_SLV0_DO + slave]);
+        }
+        m_compass->stop();
+    }
+}
+
+//  A slave 4 transfer runs straight away and sets SLV4_DONE in I2C_MST_STATUS
+
+void RTIMUSimMPU9150::slave4()
+{
+    unsigned char addr = registers[MPU9250_I2C_SLV4_ADDR];
+
+    registers[MPU9250_I2C_SLV4_CTRL] &= ~0x80;
+    if (!(registers[MPU9150_USER_CTRL] & 0x20))
+        return;                                             // I2C master is off
+
+    if ((m_compass != 0) && ((addr & 0x7f) == m_compass->devAddr)) {
+        m_compass->update(m_now);
+        m_compass->start(registers[MPU9250_I2C_SLV4_REG]);
+        if (addr & 0x80)
+            registers[MPU9250_I2C_SLV4_DI] = m_compass->read();
+        else
+            m_compass->write(registers[MPU9250_I2C_SLV4_DO]);
+        m_compass->stop();
+    }
+    registers[MPU9250_I2C_MST_STATUS] |= 0x40;
+}
+
+uint8_t RTIMUSimMPU9150::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    switch (regAddr) {
+    case MPU9150_INT_STATUS:
+        registers[MPU9150_INT_STATUS] = 0;                  // cleared by reading
+        break;
+
+    case MPU9250_I2C_MST_STATUS:
+        registers[MPU9250_I2C_MST_STATUS] &= ~0x40;
+        break;
+
+    case MPU9150_ACCEL_XOUT_H:
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        break;
+
+    case MPU9150_FIFO_COUNT_H:
+        data = m_fifoCount >> 8;
+        break;
+
+    case MPU9150_FIFO_COUNT_L:
+        data = m_fifoCount & 0xff;
+        break;
+
+    case MPU9150_FIFO_R_W:
+        if (m_fifoCount == 0)
+            return 0;
+        if (m_fifoOffset == 0)
+            sampleRead(m_fifoTimes[m_fifoPopped % RTIMUSIM_FIFO_ENTRIES]);
+        data = m_fifo[m_fifoOut];
+        m_fifoOut = (m_fifoOut + 1) % RTIMUSIM_FIFO_SIZE;
+        m_fifoCount--;
+        if (++m_fifoOffset >= m_fifoEntry) {
+            m_fifoOffset = 0;
+            m_fifoPopped++;
+        }
+        break;
+    }
+    return data;
+}
+
+void RTIMUSimMPU9150::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    switch (regAddr) {
+    case MPU9150_PWR_MGMT_1:
+        if (data & 0x80) {
+            reset();
+            return;
+        }
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    case MPU9150_SMPRT_DIV:
+    case MPU9150_LPF_CONFIG:
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    case MPU9150_USER_CTRL:
+        if (data & 0x04) {                                  // FIFO reset
+            m_fifoOut = 0;
+            m_fifoCount = 0;
+            m_fifoOffset = 0;
+            m_fifoPopped = m_fifoPushed;
+        }
+        registers[regAddr] = data & ~0x07;                  // the reset bits clear themselves
+        setBypass();
+        break;
+
+    case MPU9150_INT_PIN_CFG:
+        registers[regAddr] = data;
+        setBypass();
+        break;
+
+    case MPU9250_I2C_SLV4_CTRL:
+        registers[regAddr] = data;
+        if (data & 0x80)
+            slave4();
+        break;
+
+    case MPU9150_INT_STATUS:
+    case MPU9150_FIFO_COUNT_H:
+    case MPU9150_FIFO_COUNT_L:
+    case MPU9150_FIFO_R_W:
+    case MPU9150_WHO_AM_I:
+        break;                                              // read only (FIFO writes are ignored)
+
+    default:
+        registers[regAddr] = data;
+        break;
+    }
+}
+
+uint8_t RTIMUSimMPU9150::nextRegister(uint8_t regAddr)
+{
+    return regAddr == MPU9150_FIFO_R_W ? regAddr : regAddr + 1;
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimL3GD20
+
+RTIMUSimL3GD20::RTIMUSimL3GD20(unsigned char devAddr, RTIMUSimMotion *motion, unsigned char id)
+    : RTIMUSimSensor(devAddr, motion, true)
+{
+    m_id = id;
+    reset();
+}
+
+void RTIMUSimL3GD20::reset()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[L3GD20_WHO_AM_I] = m_id;
+    registers[L3GD20_CTRL1] = 0x07;                         // axes enabled, powered down
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_unread = false;
+}
+
+//  ODR from CTRL1 bits 7:6 - the L3GD20H also has the LOW_ODR rates
+
+void RTIMUSimL3GD20::restart()
+{
+    static const RTFLOAT gd20Rates[4] = {95, 190, 380, 760};
+    static const RTFLOAT gd20hRates[4] = {100, 200, 400, 800};
+    static const RTFLOAT gd20hLowRates[4] = {12.5, 25, 50, 50};
+    int odr = registers[L3GD20_CTRL1] >> 6;
+    RTFLOAT rate = gd20Rates[odr];
+
+    if (m_id == L3GD20H_ID)
+        rate = (registers[L3GD20H_LOW_ODR] & 0x01) ? gd20hLowRates[odr] : gd20hRates[odr];
+
+    if (!(registers[L3GD20_CTRL1] & 0x08)) {
+        m_clock.period = 0;                                 // powered down
+        return;
+    }
+    startClock(&m_clock, (unsigned long)(1000000.0 / rate));
+}
+
+void RTIMUSimL3GD20::advance()
+{
+    static const RTFLOAT sensitivity[4] = {0.00875, 0.0175, 0.07, 0.07};
+    RTIMUSIM_STATE state;
+    short raw[3];
+    int count = ticks(&m_clock);
+
+    if (count == 0)
+        return;
+
+    if (m_unread || (count > 1)) {
+        m_overruns += count - (m_unread ? 0 : 1);
+        registers[L3GD20_STATUS] |= 0xf0;                   // overrun
+    }
+    m_samples += count;
+    getState(m_clock.last, &state);
+    toRaw(state.gyro, m_gyroAxes, sensitivity[(registers[L3GD20_CTRL4] >> 4) & 3] * RTMATH_DEGREE_TO_RAD, raw);
+    putRaw(L3GD20_OUT_X_L, raw, (registers[L3GD20_CTRL4] & 0x40) != 0);
+    registers[L3GD20_STATUS] |= 0x0f;                       // data available
+    m_unread = true;
+}
+
+uint8_t RTIMUSimL3GD20::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    if (regAddr == L3GD20_OUT_X_L) {
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        registers[L3GD20_STATUS] = 0;
+    }
+    return data;
+}
+
+void RTIMUSimL3GD20::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    switch (regAddr) {
+    case L3GD20_WHO_AM_I:
+    case L3GD20_STATUS:
+        break;
+
+    case L3GD20H_LOW_ODR:
+        if ((m_id == L3GD20H_ID) && (data & 0x04)) {
+            reset();                                        // software reset
+            break;
+        }
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    case L3GD20_CTRL1:
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    default:
+        if ((regAddr < L3GD20_OUT_X_L) || (regAddr > L3GD20_OUT_X_L + 5))
+            registers[regAddr] = data;
+        break;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimLSM303D
+
+RTIMUSimLSM303D::RTIMUSimLSM303D(unsigned char devAddr, RTIMUSimMotion *motion)
+    : RTIMUSimSensor(devAddr, motion, true)
+{
+    reset();
+}
+
+void RTIMUSimLSM303D::reset()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[LSM303D_WHO_AM_I] = LSM303D_ID;
+    registers[LSM303D_CTRL1] = 0x07;
+    registers[LSM303D_CTRL5] = 0x18;
+    registers[LSM303D_CTRL6] = 0x20;
+    registers[LSM303D_CTRL7] = 0x02;                        // magnetometer powered down
+    m_accelUnread = false;
+    m_compassUnread = false;
+    restart();
+}
+
+void RTIMUSimLSM303D::restart()
+{
+    static const RTFLOAT accelRates[16] = {0, 3.125, 6.25, 12.5, 25, 50, 100, 200, 400, 800, 1600, 0, 0, 0, 0, 0};
+    static const RTFLOAT compassRates[8] = {3.125, 6.25, 12.5, 25, 50, 100, 100, 100};
+    RTFLOAT rate;
+
+    rate = accelRates[registers[LSM303D_CTRL1] >> 4];
+    if (rate == 0)
+        m_accelClock.period = 0;
+    else if (m_accelClock.period != (unsigned long)(1000000.0 / rate))
+        startClock(&m_accelClock, (unsigned long)(1000000.0 / rate));
+
+    rate = compassRates[(registers[LSM303D_CTRL5] >> 2) & 7];
+    if (registers[LSM303D_CTRL7] & 0x03)
+        m_compassClock.period = 0;                          // single conversion or power down
+    else if (m_compassClock.period != (unsigned long)(1000000.0 / rate))
+        startClock(&m_compassClock, (unsigned long)(1000000.0 / rate));
+}
+
+void RTIMUSimLSM303D::advance()
+{
+    static const RTFLOAT accelSensitivity[8] = {0.000061, 0.000122, 0.000183, 0.000244, 0.000732, 0.000732, 0.000732, 0.000732};
+    static const RTFLOAT compassSensitivity[4] = {0.008, 0.016, 0.032, 0.0479};
+    RTIMUSIM_STATE state;
+    short raw[3];
+    int count;
+
+    if ((count = ticks(&m_accelClock)) > 0) {
+        if (m_accelUnread || (count > 1)) {
+            m_overruns += count - (m_accelUnread ? 0 : 1);
+            registers[LSM303D_STATUS_A] |= 0xf0;
+        }
+        m_samples += count;
+        getState(m_accelClock.last, &state);
+        toRaw(state.accel, m_accelAxes, accelSensitivity[(registers[LSM303D_CTRL2] >> 3) & 7], raw);
+        putRaw(LSM303D_OUT_X_L_A, raw, false);
+        registers[LSM303D_STATUS_A] |= 0x0f;
+        m_accelUnread = true;
+    }
+
+    if ((count = ticks(&m_compassClock)) > 0) {
+        if (m_compassUnread || (count > 1)) {
+            m_overruns += count - (m_compassUnread ? 0 : 1);
+            registers[LSM303D_STATUS_M] |= 0xf0;
+        }
+        m_samples += count;
+        getState(m_compassClock.last, &state);
+        toRaw(state.compass, m_compassAxes, compassSensitivity[(registers[LSM303D_CTRL6] >> 5) & 3], raw);
+        putRaw(LSM303D_OUT_X_L_M, raw, false);
+        registers[LSM303D_STATUS_M] |= 0x0f;
+        m_compassUnread = true;
+    }
+}
+
+uint8_t RTIMUSimLSM303D::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    if (regAddr == LSM303D_OUT_X_L_A) {
+        if (m_accelUnread)
+            sampleRead(m_accelClock.last);
+        m_accelUnread = false;
+        registers[LSM303D_STATUS_A] = 0;
+    } else if (regAddr == LSM303D_OUT_X_L_M) {
+        if (m_compassUnread)
+            sampleRead(m_compassClock.last);
+        m_compassUnread = false;
+        registers[LSM303D_STATUS_M] = 0;
+    }
+    return data;
+}
+
+void RTIMUSimLSM303D::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    switch (regAddr) {
+    case LSM303D_CTRL0:
+        if (data & 0x80) {
+            reset();                                        // reboot
+            break;
+        }
+        registers[regAddr] = data;
+        break;
+
+    case LSM303D_CTRL1:
+    case LSM303D_CTRL5:
+    case LSM303D_CTRL7:
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    case LSM303D_WHO_AM_I:
+    case LSM303D_STATUS_A:
+    case LSM303D_STATUS_M:
+        break;
+
+    default:
+        registers[regAddr] = data;
+        break;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimLSM303DLHCAccel
+
+RTIMUSimLSM303DLHCAccel::RTIMUSimLSM303DLHCAccel(RTIMUSimMotion *motion)
+    : RTIMUSimSensor(LSM303DLHC_ACCEL_ADDRESS, motion, true)
+{
+    registers[LSM303DLHC_CTRL1_A] = 0x07;
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_unread = false;
+}
+
+void RTIMUSimLSM303DLHCAccel::advance()
+{
+    //  scaled the way the drivers read the left justified data
+
+    static const RTFLOAT sensitivity[4] = {0.001 / 64, 0.002 / 64, 0.004 / 64, 0.012 / 64};
+    RTIMUSIM_STATE state;
+    short raw[3];
+    int count = ticks(&m_clock);
+
+    if (count == 0)
+        return;
+
+    if (m_unread || (count > 1)) {
+        m_overruns += count - (m_unread ? 0 : 1);
+        registers[LSM303DLHC_STATUS_A] |= 0xf0;
+    }
+    m_samples += count;
+    getState(m_clock.last, &state);
+    toRaw(state.accel, m_accelAxes, sensitivity[(registers[LSM303DLHC_CTRL4_A] >> 4) & 3], raw);
+    putRaw(LSM303DLHC_OUT_X_L_A, raw, (registers[LSM303DLHC_CTRL4_A] & 0x40) != 0);
+    registers[LSM303DLHC_STATUS_A] |= 0x0f;
+    m_unread = true;
+}
+
+uint8_t RTIMUSimLSM303DLHCAccel::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    if (regAddr == LSM303DLHC_OUT_X_L_A) {
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        registers[LSM303DLHC_STATUS_A] = 0;
+    }
+    return data;
+}
+
+void RTIMUSimLSM303DLHCAccel::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    static const RTFLOAT rates[16] = {0, 1, 10, 25, 50, 100, 200, 400, 1620, 1344, 0, 0, 0, 0, 0, 0};
+
+    if ((regAddr == LSM303DLHC_STATUS_A) || ((regAddr >= LSM303DLHC_OUT_X_L_A) && (regAddr <= LSM303DLHC_OUT_Z_H_A)))
+        return;
+
+    registers[regAddr] = data;
+    if (regAddr == LSM303DLHC_CTRL1_A) {
+        RTFLOAT rate = rates[data >> 4];
+
+        if (rate == 0)
+            m_clock.period = 0;
+        else
+            startClock(&m_clock, (unsigned long)(1000000.0 / rate));
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimLSM303DLHCMag
+
+RTIMUSimLSM303DLHCMag::RTIMUSimLSM303DLHCMag(RTIMUSimMotion *motion)
+    : RTIMUSimSensor(LSM303DLHC_COMPASS_ADDRESS, motion, true)
+{
+    registers[LSM303DLHC_CRA_M] = 0x10;                     // 15Hz
+    registers[LSM303DLHC_CRB_M] = 0x20;
+    registers[LSM303DLHC_CRM_M] = 0x03;                     // sleep
+    registers[0x0a] = 'H';                                  // identification registers
+    registers[0x0b] = '4';
+    registers[0x0c] = '3';
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_converting = false;
+    m_unread = false;
+}
+
+void RTIMUSimLSM303DLHCMag::restart()
+{
+    static const RTFLOAT rates[8] = {0.75, 1.5, 3, 7.5, 15, 30, 75, 220};
+
+    m_clock.period = 0;
+    m_converting = false;
+
+    switch (registers[LSM303DLHC_CRM_M] & 0x03) {
+    case 0:                                                 // continuous
+        startClock(&m_clock, (unsigned long)(1000000.0 / rates[(registers[LSM303DLHC_CRA_M] >> 2) & 7]));
+        break;
+
+    case 1:                                                 // single conversion
+        m_converting = true;
+        m_done = m_now + (unsigned long)(1000000.0 / 220);
+        break;
+    }
+}
+
+void RTIMUSimLSM303DLHCMag::advance()
+{
+    static const RTFLOAT gainXY[8] = {1100, 1100, 855, 670, 450, 400, 330, 230};
+    static const RTFLOAT gainZ[8] = {980, 980, 760, 600, 400, 355, 295, 205};
+    RTIMUSIM_STATE state;
+    short rawXY[3];
+    short rawZ[3];
+    int gain = registers[LSM303DLHC_CRB_M] >> 5;
+    int count = ticks(&m_clock);
+
+    if (m_converting && ((long)(m_now - m_done) >= 0)) {
+        m_converting = false;
+        registers[LSM303DLHC_CRM_M] = 0x03;                 // back to sleep
+        m_clock.last = m_done;
+        count = 1;
+    }
+    if (count == 0)
+        return;
+
+    if (m_unread || (count > 1))
+        m_overruns += count - (m_unread ? 0 : 1);
+    m_samples += count;
+    getState(m_clock.last, &state);
+    toRaw(state.compass, m_compassAxes, 100.0 / gainXY[gain], rawXY);
+    toRaw(state.compass, m_compassAxes, 100.0 / gainZ[gain], rawZ);
+
+    //  the output registers are X, Z, Y - big endian
+
+    registers[0x03] = rawXY[0] >> 8;
+    registers[0x04] = rawXY[0] & 0xff;
+    registers[0x05] = rawZ[2] >> 8;
+    registers[0x06] = rawZ[2] & 0xff;
+    registers[0x07] = rawXY[1] >> 8;
+    registers[0x08] = rawXY[1] & 0xff;
+    registers[LSM303DLHC_STATUS_M] |= 0x01;
+    m_unread = true;
+}
+
+uint8_t RTIMUSimLSM303DLHCMag::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    if (regAddr == LSM303DLHC_OUT_X_H_M) {
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        registers[LSM303DLHC_STATUS_M] &= ~0x01;
+    }
+    return data;
+}
+
+void RTIMUSimLSM303DLHCMag::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    if (regAddr > LSM303DLHC_CRM_M)
+        return;                                             // only the control registers are writable
+    registers[regAddr] = data;
+    restart();
+}
+
+//  The address always increments, wrapping from the last output register to the first
+
+uint8_t RTIMUSimLSM303DLHCMag::nextRegister(uint8_t regAddr)
+{
+    return regAddr == 0x08 ? 0x03 : regAddr + 1;
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimBNO055
+
+RTIMUSimBNO055::RTIMUSimBNO055(unsigned char devAddr, RTIMUSimMotion *motion)
+    : RTIMUSimSensor(devAddr, motion, false)
+{
+    m_resetting = false;
+    reset();
+}
+
+void RTIMUSimBNO055::reset()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[BNO055_WHO_AM_I] = BNO055_ID;
+    registers[0x01] = 0xfb;                                 // accel, mag and gyro chip IDs
+    registers[0x02] = 0x32;
+    registers[0x03] = 0x0f;
+    registers[BNO055_UNIT_SEL] = 0x80;
+    registers[BNO055_AXIS_MAP_CONFIG] = 0x24;
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_unread = false;
+}
+
+bool RTIMUSimBNO055::present()
+{
+    if (m_resetting && ((long)(m_now - m_resetDone) >= 0))
+        m_resetting = false;
+    return !m_resetting;
+}
+
+void RTIMUSimBNO055::advance()
+{
+    static const signed char eulerAxes[3] = {3, 1, 2};      // heading, roll, pitch
+    RTIMUSIM_STATE state;
+    RTQuaternion quat;
+    short raw[3];
+    short w;
+    unsigned char units = registers[BNO055_UNIT_SEL];
+    int count = ticks(&m_clock);
+
+    if (count == 0)
+        return;
+
+    if (m_unread || (count > 1))
+        m_overruns += count - (m_unread ? 0 : 1);
+    m_samples += count;
+    getState(m_clock.last, &state);
+
+    toRaw(state.accel, m_accelAxes, (units & 0x01) ? 0.001 : 0.01 / 9.80665, raw);
+    putRaw(BNO055_ACCEL_DATA, raw, false);
+    toRaw(state.compass, m_compassAxes, 1.0 / 16.0, raw);
+    putRaw(BNO055_MAG_DATA, raw, false);
+    toRaw(state.gyro, m_gyroAxes, (units & 0x02) ? 1.0 / 900.0 : RTMATH_DEGREE_TO_RAD / 16.0, raw);
+    putRaw(BNO055_GYRO_DATA, raw, false);
+    toRaw(state.pose, eulerAxes, (units & 0x04) ? 1.0 / 900.0 : RTMATH_DEGREE_TO_RAD / 16.0, raw);
+    putRaw(BNO055_FUSED_EULER, raw, false);
+
+    quat.fromEuler(state.pose);
+    w = (short)(quat.scalar() * 16384.0);
+    registers[BNO055_QUAT_DATA] = w & 0xff;
+    registers[BNO055_QUAT_DATA + 1] = w >> 8;
+    raw[0] = (short)(quat.x() * 16384.0);
+    raw[1] = (short)(quat.y() * 16384.0);
+    raw[2] = (short)(quat.z() * 16384.0);
+    putRaw(BNO055_QUAT_DATA + 2, raw, false);
+
+    registers[BNO055_TEMP] = (signed char)state.temperature;
+    m_unread = true;
+}
+
+uint8_t RTIMUSimBNO055::readRegister(uint8_t regAddr)
+{
+    if ((regAddr == BNO055_ACCEL_DATA) && m_unread) {
+        sampleRead(m_clock.last);
+        m_unread = false;
+    }
+    return registers[regAddr];
+}
+
+void RTIMUSimBNO055::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    switch (regAddr) {
+    case BNO055_SYS_TRIGGER:
+        if (data & 0x20) {
+            reset();
+            m_resetting = true;
+            m_resetDone = m_now + BNO055_RESET_TIME;
+            break;
+        }
+        registers[regAddr] = data;
+        break;
+
+    case BNO055_OPER_MODE:
+        registers[regAddr] = data & 0x0f;
+        if ((data & 0x0f) == BNO055_OPER_MODE_CONFIG) {
+            m_clock.period = 0;                             // outputs frozen in config mode
+            registers[BNO055_SYS_STATUS] = BNO055_SYS_STATUS_IDLE;
+        } else {
+            startClock(&m_clock, 10000);                    // 100Hz
+            registers[BNO055_SYS_STATUS] = ((data & 0x0f) >= 0x08) ? BNO055_SYS_STATUS_FUSION : BNO055_SYS_STATUS_RUNNING;
+        }
+        break;
+
+    default:
+        if (regAddr >= BNO055_UNIT_SEL)
+            registers[regAddr] = data;                      // the outputs below are read only
+        else if (regAddr == BNO055_PAGE_ID)
+            registers[regAddr] = data;
+        break;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimBMP180
+//
+//  Conversions are turned back into raw values by searching the datasheet
+//  compensation, so the driver gets back the motion source's values to within
+//  the resolution of the part.
+
+//  datasheet example calibration
+
+static const short bmp180Calibration[11] = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+
+#define BMP180_AC1  bmp180Calibration[0]
+#define BMP180_AC2  bmp180Calibration[1]
+#define BMP180_AC3  bmp180Calibration[2]
+#define BMP180_AC4  ((unsigned short)bmp180Calibration[3])
+#define BMP180_AC5  ((unsigned short)bmp180Calibration[4])
+#define BMP180_AC6  ((unsigned short)bmp180Calibration[5])
+#define BMP180_B1   bmp180Calibration[6]
+#define BMP180_B2   bmp180Calibration[7]
+#define BMP180_MC   bmp180Calibration[9]
+#define BMP180_MD   bmp180Calibration[10]
+
+RTIMUSimBMP180::RTIMUSimBMP180(RTIMUSimMotion *motion)
+    : RTIMUSimSensor(BMP180_ADDRESS, motion, false)
+{
+    registers[BMP180_REG_ID] = BMP180_ID;
+    for (int i = 0; i < 11; i++) {
+        registers[BMP180_REG_AC1 + i * 2] = (bmp180Calibration[i] >> 8) & 0xff;
+        registers[BMP180_REG_AC1 + i * 2 + 1] = bmp180Calibration[i] & 0xff;
+    }
+    m_converting = false;
+    m_unread = false;
+    m_ut = 0;
+}
+
+//  The compensation is written the way RTPressureBMP180 does it so that the search
+//  finds the raw value the driver turns into the wanted result
+
+long RTIMUSimBMP180::compensateTemperature(long ut, long *b5)
+{
+    int32_t x1 = ((ut - (int32_t)BMP180_AC6) * (int32_t)BMP180_AC5) / 32768;
+    int32_t x2;
+
+    if ((x1 + BMP180_MD) == 0)
+        x1++;
+    x2 = ((int32_t)BMP180_MC * 2048) / (x1 + (int32_t)BMP180_MD);
+    *b5 = x1 + x2;
+    return (*b5 + 8) / 16;
+}
+
+long RTIMUSimBMP180::compensatePressure(long up, long b5, int oss)
+{
+    int32_t b6 = b5 - 4000;
+    int32_t x1 = (BMP180_B2 * ((b6 * b6) / 4096)) / 2048;
+    int32_t x2 = (BMP180_AC2 * b6) / 2048;
+    int32_t x3 = x1 + x2;
+    int32_t b3 = ((((int32_t)BMP180_AC1 * 4 + x3) << oss) + 2) / 4;
+    uint32_t b4, b7;
+    int32_t p;
+
+    if (up < b3)
+        return 0;                                           // below the range of the search
+
+    x1 = (BMP180_AC3 * b6) / 8192;
+    x2 = (BMP180_B1 * ((b6 * b6) / 4096)) / 65536;
+    x3 = ((x1 + x2) + 2) / 4;
+    b4 = (BMP180_AC4 * (uint32_t)(x3 + 32768)) / 32768;
+    b7 = (uint32_t)(up - b3) * (50000 >> oss);
+    if (b7 < 0x80000000)
+        p = (b7 * 2) / b4;
+    else
+        p = (b7 / b4) * 2;
+    x1 = (p / 256) * (p / 256);
+    x1 = (x1 * 3038) / 65536;
+    x2 = (-7357 * p) / 65536;
+    return p + (x1 + x2 + 3791) / 16;
+}
+
+void RTIMUSimBMP180::advance()
+{
+    RTIMUSIM_STATE state;
+    unsigned char control = registers[BMP180_REG_SCO];
+    int oss = control >> 6;
+    long b5;
+    long low, high, mid;
+
+    if (!m_converting || ((long)(m_now - m_done) < 0))
+        return;
+
+    m_converting = false;
+    registers[BMP180_REG_SCO] &= ~0x20;
+    getState(m_done, &state);
+
+    //  the raw temperature is wanted for the pressure too
+
+    long target = (long)floor(state.temperature * 10.0 + 0.5);
+
+    low = (long)BMP180_AC6 - ((long)BMP180_MD << 15) / (long)BMP180_AC5 + 1;
+    high = 65535;
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (compensateTemperature(mid, &b5) < target)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if ((control & 0x1f) == (BMP180_SCO_TEMPCONV & 0x1f)) {
+        m_ut = low;
+        registers[BMP180_REG_RESULT] = low >> 8;
+        registers[BMP180_REG_RESULT + 1] = low & 0xff;
+    } else {
+        if (m_ut != 0)
+            low = m_ut;                                     // the driver compensates with its last temperature
+        compensateTemperature(low, &b5);
+
+        target = (long)floor(state.pressure * 100.0 + 0.5);
+        low = 0;
+        high = (1L << (16 + oss)) - 1;
+        while (low < high) {
+            mid = (low + high) / 2;
+            if (compensatePressure(mid, b5, oss) < target)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        low <<= 8 - oss;
+        registers[BMP180_REG_RESULT] = (low >> 16) & 0xff;
+        registers[BMP180_REG_RESULT + 1] = (low >> 8) & 0xff;
+        registers[BMP180_REG_XLSB] = low & 0xff;
+    }
+    if (m_unread)
+        m_overruns++;
+    m_samples++;
+    m_unread = true;
+}
+
+uint8_t RTIMUSimBMP180::readRegister(uint8_t regAddr)
+{
+    if ((regAddr == BMP180_REG_RESULT) && m_unread) {
+        sampleRead(m_done);
+        m_unread = false;
+    }
+    return registers[regAddr];
+}
+
+void RTIMUSimBMP180::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    static const unsigned long pressureTimes[4] = {4500, 7500, 13500, 25500};
+
+    if (regAddr == 0xe0) {                                  // soft reset
+        if (data == 0xb6) {
+            registers[BMP180_REG_SCO] = 0;
+            m_converting = false;
+        }
+        return;
+    }
+    if (regAddr != BMP180_REG_SCO)
+        return;
+
+    registers[BMP180_REG_SCO] = data;
+    if (!(data & 0x20))
+        return;
+
+    m_converting = true;
+    m_started = m_now;
+    if ((data & 0x1f) == (BMP180_SCO_TEMPCONV & 0x1f))
+        m_done = m_now + 4500;
+    else
+        m_done = m_now + pressureTimes[data >> 6];
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimLPS25H
+
+RTIMUSimLPS25H::RTIMUSimLPS25H(unsigned char devAddr, RTIMUSimMotion *motion)
+    : RTIMUSimSensor(devAddr, motion, true)
+{
+    reset();
+}
+
+void RTIMUSimLPS25H::reset()
+{
+    memset(registers, 0, sizeof(registers));
+    registers[LPS25H_REG_ID] = LPS25H_ID;
+    registers[LPS25H_RES_CONF] = 0x0f;
+    m_clock.period = 0;
+    m_clock.last = m_now;
+    m_converting = false;
+    m_historyIn = 0;
+    m_historyCount = 0;
+    m_unread = false;
+}
+
+void RTIMUSimLPS25H::restart()
+{
+    static const RTFLOAT rates[8] = {0, 1, 7, 12.5, 25, 0, 0, 0};
+    RTFLOAT rate = rates[(registers[LPS25H_CTRL_REG_1] >> 4) & 7];
+
+    if (!(registers[LPS25H_CTRL_REG_1] & 0x80) || (rate == 0))
+        m_clock.period = 0;                                 // powered down or one shot
+    else
+        startClock(&m_clock, (unsigned long)(1000000.0 / rate));
+}
+
+void RTIMUSimLPS25H::sample(unsigned long time)
+{
+    RTIMUSIM_STATE state;
+    RTFLOAT pressure;
+    long raw;
+
+    getState(time, &state);
+
+    m_history[m_historyIn] = state.pressure;
+    m_historyIn = (m_historyIn + 1) % RTIMUSIM_LPS25H_HISTORY;
+    if (m_historyCount < RTIMUSIM_LPS25H_HISTORY)
+        m_historyCount++;
+
+    //  FIFO mean mode outputs the running mean of the last 2 to 32 samples
+
+    pressure = state.pressure;
+    if ((registers[LPS25H_CTRL_REG_2] & 0x40) && ((registers[LPS25H_FIFO_CTRL] >> 5) == 6)) {
+        int count = (registers[LPS25H_FIFO_CTRL] & 0x1f) + 1;
+
+        if (count > m_historyCount)
+            count = m_historyCount;
+        pressure = 0;
+        for (int i = 1; i <= count; i++)
+            pressure += m_history[(m_historyIn - i + RTIMUSIM_LPS25H_HISTORY) % RTIMUSIM_LPS25H_HISTORY];
+        pressure /= count;
+    }
+
+    raw = (long)floor(pressure * 4096.0 + 0.5);
+    registers[LPS25H_PRESS_OUT_XL] = raw & 0xff;
+    registers[LPS25H_PRESS_OUT_L] = (raw >> 8) & 0xff;
+    registers[LPS25H_PRESS_OUT_H] = (raw >> 16) & 0xff;
+
+    raw = (long)floor((state.temperature - 42.5) * 480.0 + 0.5);
+    registers[LPS25H_TEMP_OUT_L] = raw & 0xff;
+    registers[LPS25H_TEMP_OUT_H] = (raw >> 8) & 0xff;
+
+    if (registers[LPS25H_STATUS_REG] & 0x03)
+        registers[LPS25H_STATUS_REG] |= (registers[LPS25H_STATUS_REG] & 0x03) << 4;
+    registers[LPS25H_STATUS_REG] |= 0x03;
+
+    if (m_unread)
+        m_overruns++;
+    m_samples++;
+    m_unread = true;
+}
+
+void RTIMUSimLPS25H::advance()
+{
+    int count;
+
+    if (m_converting && ((long)(m_now - m_done) >= 0)) {
+        m_converting = false;
+        registers[LPS25H_CTRL_REG_2] &= ~0x01;              // ONE_SHOT clears when done
+        m_clock.last = m_done;
+        sample(m_done);
+    }
+
+    //  every sample goes into the FIFO so the mean mode sees them all
+
+    count = ticks(&m_clock);
+    if (count > RTIMUSIM_LPS25H_HISTORY) {
+        m_samples += count - RTIMUSIM_LPS25H_HISTORY;
+        m_overruns += count - RTIMUSIM_LPS25H_HISTORY;
+        count = RTIMUSIM_LPS25H_HISTORY;
+    }
+    for (int i = count - 1; i >= 0; i--)
+        sample(m_clock.last - i * m_clock.period);
+}
+
+uint8_t RTIMUSimLPS25H::readRegister(uint8_t regAddr)
+{
+    uint8_t data = registers[regAddr];
+
+    switch (regAddr) {
+    case LPS25H_PRESS_OUT_XL:
+        if (m_unread)
+            sampleRead(m_clock.last);
+        m_unread = false;
+        break;
+
+    case LPS25H_PRESS_OUT_H:
+        registers[LPS25H_STATUS_REG] &= ~0x22;
+        break;
+
+    case LPS25H_TEMP_OUT_H:
+        registers[LPS25H_STATUS_REG] &= ~0x11;
+        break;
+
+    case LPS25H_FIFO_STATUS:
+        data = m_historyCount;
+        break;
+    }
+    return data;
+}
+
+void RTIMUSimLPS25H::writeRegister(uint8_t regAddr, uint8_t data)
+{
+    switch (regAddr) {
+    case LPS25H_CTRL_REG_1:
+        registers[regAddr] = data;
+        restart();
+        break;
+
+    case LPS25H_CTRL_REG_2:
+        if (data & 0x04) {
+            reset();                                        // software reset
+            break;
+        }
+        registers[regAddr] = data;
+        if ((data & 0x01) && (registers[LPS25H_CTRL_REG_1] & 0x80) && (m_clock.period == 0)) {
+            m_converting = true;
+            m_done = m_now + LPS25H_ONE_SHOT_TIME;
+        }
+        break;
+
+    case LPS25H_REG_ID:
+    case LPS25H_STATUS_REG:
+    case LPS25H_FIFO_STATUS:
+        break;
+
+    default:
+        if ((regAddr < LPS25H_PRESS_OUT_XL) || (regAddr > LPS25H_TEMP_OUT_H))
+            registers[regAddr] = data;
+        break;
+    }
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSimMS5611
+//
+//  Like the BMP180 the ADC values are found by searching the datasheet compensation.
+
+RTIMUSimMS5611::RTIMUSimMS5611(unsigned char devAddr, RTIMUSimMotion *motion)
+    : RTIMUSimSensor(devAddr, motion, false)
+{
+    static const unsigned short coefficients[6] = {40127, 36924, 23317, 23282, 33464, 28312};
+    unsigned int remainder = 0;
+
+    m_prom[0] = 0;
+    for (int i = 0; i < 6; i++)
+        m_prom[i + 1] = coefficients[i];
+    m_prom[7] = 0;
+
+    //  CRC-4 over the PROM (AN520) in the bottom 4 bits of word 7
+
+    for (int i = 0; i < 16; i++) {
+        remainder ^= (i & 1) ? (m_prom[i >> 1] & 0xff) : (m_prom[i >> 1] >> 8);
+        for (int bit = 0; bit < 8; bit++)
+            remainder = (remainder & 0x8000) ? ((remainder << 1) ^ 0x3000) : (remainder << 1);
+        remainder &= 0xffff;
+    }
+    m_prom[7] = (remainder >> 12) & 0x0f;
+
+    m_command = 0;
+    m_index = 0;
+    m_converting = false;
+    m_pressure = false;
+    m_result = 0;
+    m_d2 = 0;
+}
+
+long RTIMUSimMS5611::compensate(unsigned long d1, unsigned long d2, long *temperature)
+{
+    int64_t deltaT = (int64_t)d2 - ((int64_t)m_prom[5] << 8);
+    int64_t temp = 2000 + ((deltaT * (int64_t)m_prom[6]) >> 23);
+    int64_t offset = ((int64_t)m_prom[2] << 16) + (((int64_t)m_prom[4] * deltaT) >> 7);
+    int64_t sens = ((int64_t)m_prom[1] << 15) + (((int64_t)m_prom[3] * deltaT) >> 8);
+
+    if (temp < 2000) {
+        int64_t offset2 = 5 * (temp - 2000) * (temp - 2000) / 2;
+        int64_t sens2 = offset2 / 2;
+
+        if (temp < -1500) {
+            offset2 += 7 * (temp + 1500) * (temp + 1500);
+            sens2 += 11 * (temp + 1500) * (temp + 1500) / 2;
+        }
+        temp -= (deltaT * deltaT) >> 31;
+        offset -= offset2;
+        sens -= sens2;
+    }
+    *temperature = (long)temp;
+    return (long)(((((int64_t)d1 * sens) >> 21) - offset) >> 15);
+}
+
+void RTIMUSimMS5611::start(uint8_t regAddr)
+{
+    static const unsigned long conversionTimes[5] = {600, 1170, 2280, 4540, 9040};
+
+    //  finish a conversion that has run its time before looking at the command
+
+    if (m_converting && ((long)(m_now - m_done) >= 0)) {
+        RTIMUSIM_STATE state;
+        long temperature;
+        long target;
+        unsigned long low, high, mid;
+
+        m_converting = false;
+        getState(m_done, &state);
+
+        target = (long)floor(state.temperature * 100.0 + 0.5);
+        low = 0;
+        high = 0xffffff;
+        while (low < high) {
+            mid = (low + high) / 2;
+            compensate(0, mid, &temperature);
+            if (temperature < target)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if (!m_pressure || (m_d2 == 0))
+            m_d2 = low;
+        m_result = low;
+
+        if (m_pressure) {
+            target = (long)floor(state.pressure * 100.0 + 0.5);
+            low = 0;
+            high = 0xffffff;
+            while (low < high) {
+                mid = (low + high) / 2;
+                if (compensate(mid, m_d2, &temperature) < target)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            m_result = low;
+        }
+        m_samples++;
+    }
+
+    m_command = regAddr;
+    m_index = 0;
+
+    if (regAddr == MS5611_CMD_RESET) {
+        m_converting = false;
+        m_result = 0;
+    } else if (((regAddr & 0xf0) == 0x40) || ((regAddr & 0xf0) == 0x50)) {
+        if ((regAddr & 0x0f) > 0x08)
+            return;
+        m_converting = true;
+        m_pressure = (regAddr & 0xf0) == 0x40;
+        m_started = m_now;
+        m_done = m_now + conversionTimes[(regAddr & 0x0f) >> 1];
+        m_result = 0;
+    }
+}
+
+uint8_t RTIMUSimMS5611::read()
+{
+    uint8_t data = 0;
+
+    if (m_command == MS5611_CMD_ADC) {
+        if (m_index == 0) {
+            if (m_result != 0)
+                sampleRead(m_done);
+        }
+        if (m_index < 3)
+            data = (m_result >> (16 - m_index * 8)) & 0xff;
+        if (++m_index == 3)
+            m_result = 0;                                   // each result is read once
+    } else if ((m_command & 0xf0) == MS5611_CMD_PROM) {
+        unsigned short word = m_prom[(m_command >> 1) & 0x07];
+
+        data = m_index == 0 ? word >> 8 : word & 0xff;
+        m_index++;
+    }
+    return data;
+}
+
+//----------------------------------------------------------
+//
+//  RTIMUSim
+
+RTIMUSimSensor *RTIMUSim::m_sensors[RTIMUSIM_MAX_SENSORS];
+int RTIMUSim::m_sensorCount = 0;
+
+static bool addSensor(RTIMUSimSensor *sensor)
+{
+    if (RTIMUSim::m_sensorCount >= RTIMUSIM_MAX_SENSORS)
+        return false;
+    RTIMUSim::m_sensors[RTIMUSim::m_sensorCount++] = sensor;
+    return I2CdevSim::attach(sensor);
+}
+
+//  The axis maps undo each driver's own axis handling
+
+bool RTIMUSim::attach(RTIMUSettings *settings, RTIMUSimMotion *motion)
+{
+    static const signed char stGyro[3] = {1, -2, -3};
+    static const signed char stAccel[3] = {-1, 2, 3};
+    bool ok = true;
+
+    unsigned char imuAddr = settings->m_I2CSlaveAddress;
+    unsigned char pressureAddr = settings->m_I2CPressureAddress;
+
+    (void)imuAddr;
+    (void)pressureAddr;
+    (void)stGyro;
+    (void)stAccel;
+
+#if (defined(MPU9150_68) || defined(MPU9150_69) || defined(MPU9250_68) || defined(MPU9250_69)) && !defined(RTIMU_SPI)
+    static const signed char akCompass[3] = {-2, 1, 3};
+    #if defined(MPU9250_68) || defined(MPU9250_69)
+        bool mpu9250 = true;
+    #else
+        bool mpu9250 = false;
+    #endif
+    RTIMUSimAK89xx *compass = new RTIMUSimAK89xx(motion, mpu9250);
+    RTIMUSimMPU9150 *mpu = new RTIMUSimMPU9150(imuAddr, motion, compass, mpu9250);
+
+    compass->setAxes(0, 0, akCompass);
+    mpu->setAxes(stGyro, stAccel, 0);
+    ok &= addSensor(compass);
+    ok &= addSensor(mpu);
+#endif
+
+#if (defined(LSM9DS0_6a) || defined(LSM9DS0_6b)) && !defined(RTIMU_SPI)
+    static const signed char lsm9ds0Compass[3] = {1, -2, 3};
+    RTIMUSimL3GD20 *gyro = new RTIMUSimL3GD20(imuAddr, motion, LSM9DS0_GYRO_ID);
+    RTIMUSimLSM303D *accelCompass = new RTIMUSimLSM303D(imuAddr == LSM9DS0_GYRO_ADDRESS0 ?
+            LSM9DS0_ACCELMAG_ADDRESS0 : LSM9DS0_ACCELMAG_ADDRESS1, motion);
+
+    gyro->setAxes(stGyro, 0, 0);
+    accelCompass->setAxes(0, stAccel, lsm9ds0Compass);
+    ok &= addSensor(gyro);
+    ok &= addSensor(accelCompass);
+#endif
+
+#if defined(GD20HM303D_6a) || defined(GD20HM303D_6b)
+    static const signed char lsm303dCompass[3] = {1, -2, -3};
+    RTIMUSimL3GD20 *gyro = new RTIMUSimL3GD20(imuAddr, motion, L3GD20H_ID);
+    RTIMUSimLSM303D *accelCompass = new RTIMUSimLSM303D(imuAddr == L3GD20H_ADDRESS0 ?
+            LSM303D_ADDRESS0 : LSM303D_ADDRESS1, motion);
+
+    gyro->setAxes(stGyro, 0, 0);
+    accelCompass->setAxes(0, stAccel, lsm303dCompass);
+    ok &= addSensor(gyro);
+    ok &= addSensor(accelCompass);
+#endif
+
+#if defined(GD20M303DLHC_6a) || defined(GD20M303DLHC_6b) || defined(GD20HM303DLHC_6a) || defined(GD20HM303DLHC_6b)
+    static const signed char dlhcCompass[3] = {1, -2, -3};
+    #if defined(GD20M303DLHC_6a) || defined(GD20M303DLHC_6b)
+        RTIMUSimL3GD20 *gyro = new RTIMUSimL3GD20(imuAddr, motion, L3GD20_ID);
+    #else
+        RTIMUSimL3GD20 *gyro = new RTIMUSimL3GD20(imuAddr, motion, L3GD20H_ID);
+    #endif
+    RTIMUSimLSM303DLHCAccel *accel = new RTIMUSimLSM303DLHCAccel(motion);
+    RTIMUSimLSM303DLHCMag *mag = new RTIMUSimLSM303DLHCMag(motion);
+
+    gyro->setAxes(stGyro, 0, 0);
+    accel->setAxes(0, stAccel, 0);
+    mag->setAxes(0, 0, dlhcCompass);
+    ok &= addSensor(gyro);
+    ok &= addSensor(accel);
+    ok &= addSensor(mag);
+#endif
+
+#if defined(BNO055_28) || defined(BNO055_29)
+    static const signed char bnoGyro[3] = {-2, -1, -3};
+    static const signed char bnoAccel[3] = {2, 1, 3};
+    RTIMUSimBNO055 *bno = new RTIMUSimBNO055(imuAddr, motion);
+
+    bno->setAxes(bnoGyro, bnoAccel, bnoGyro);
+    ok &= addSensor(bno);
+#endif
+
+#if defined(BMP180)
+    ok &= addSensor(new RTIMUSimBMP180(motion));
+#endif
+
+#if defined(LPS25H_5c) || defined(LPS25H_5d)
+    ok &= addSensor(new RTIMUSimLPS25H(pressureAddr, motion));
+#endif
+
+#if defined(MS5611_76) || defined(MS5611_77)
+    ok &= addSensor(new RTIMUSimMS5611(pressureAddr, motion));
+#endif
+
+    return ok;
+}
+
+#endif // I2CDEV_SIMULATOR
@@ -0,0 +1,368 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSIM_H
+#define	_RTIMUSIM_H
+
+#include "RTIMUSimMotion.h"
+#include "RTIMUSettings.h"
+#include "I2CdevSim.h"
+
+//  Register-level models of the supported sensors for the simulated I2C bus. Each
+//  model keeps its own sample clock from the configured output data rate, sets and
+//  clears its data-ready bits the way the part does and models conversion times, so
+//  a driver polling it sees the same timing as on the real bus. Outputs come from an
+//  RTIMUSimMotion source, scaled by the configured full scale range and mapped onto
+//  the chip axes so that the driver's own axis handling gets back the true values.
+//
+//  RTIMUSim::attach() creates and attaches the models for the IMU and pressure sensor
+//  selected in RTIMULibDefs.h. The counters in each model and in I2CdevSim then give
+//  transactions per sample and the latency from a sample being taken to it being read.
+
+#ifdef I2CDEV_SIMULATOR
+
+#define RTIMUSIM_MAX_SENSORS            4                   // models created by RTIMUSim::attach()
+#define RTIMUSIM_FIFO_SIZE              1024                // MPU9150/MPU9250 FIFO size in bytes
+#define RTIMUSIM_FIFO_ENTRIES           512                 // FIFO sample timestamps kept
+#define RTIMUSIM_LPS25H_HISTORY         32                  // LPS25H FIFO depth (mean mode)
+
+//  A sample clock running at a device's output data rate
+
+typedef struct
+{
+    unsigned long period;                                   // uS between samples (0 if stopped)
+    unsigned long next;                                     // time of the next sample
+    unsigned long last;                                     // time of the latest sample
+} RTIMUSIM_CLOCK;
+
+//  Common parts of the sensor models - sample clocks, axis mapping and the counters
+
+class RTIMUSimSensor : public I2CdevSimDevice
+{
+public:
+    RTIMUSimSensor(unsigned char devAddr, RTIMUSimMotion *motion, bool incrementBit);
+
+    //  Axis maps - entry i is the library axis (1 = x, 2 = y, 3 = z, negative to
+    //  invert) that chip axis i measures. 0 leaves the map as the identity.
+
+    void setAxes(const signed char *gyro, const signed char *accel, const signed char *compass);
+
+    void clearCounters();
+
+    unsigned long m_samples;                                // samples taken
+    unsigned long m_overruns;                               // samples replaced before they were read
+    unsigned long m_samplesRead;                            // samples read by the driver
+    unsigned long m_latencyTotal;                           // sum of sample to read times in uS
+    unsigned long m_latencyMax;                             // longest sample to read time in uS
+    unsigned long m_lastSampleTime;                         // sample time of the latest sample read
+
+    long m_clockError;                                      // sample clock error in ppm (parts are only good to a percent or so)
+
+    virtual void update(uint32_t now);
+    virtual void start(uint8_t regAddr);
+
+protected:
+    virtual void advance() {}                               // take the samples due by m_now
+    virtual uint8_t nextRegister(uint8_t regAddr);
+
+    void startClock(RTIMUSIM_CLOCK *clock, unsigned long period);
+    int ticks(RTIMUSIM_CLOCK *clock);
+    void getState(unsigned long time, RTIMUSIM_STATE *state);
+    void sampleRead(unsigned long sampleTime);
+
+    void toRaw(const RTVector3& vec, const signed char *axes, RTFLOAT lsb, short *raw);
+    void putRaw(unsigned char regAddr, const short *raw, bool bigEndian);
+
+    RTIMUSimMotion *m_motion;
+    unsigned long m_now;                                    // time of the current transaction
+    signed char m_gyroAxes[3];
+    signed char m_accelAxes[3];
+    signed char m_compassAxes[3];
+    bool m_incrementBit;                                    // ST style - bit 7 of the address enables auto increment
+    bool m_increment;
+};
+
+//  AK8975 (MPU9150) or AK8963 (MPU9250) magnetometer. It is reached directly when
+//  the MPU's bypass is on and through the MPU's I2C master otherwise.
+
+class RTIMUSimAK89xx : public RTIMUSimSensor
+{
+public:
+    RTIMUSimAK89xx(RTIMUSimMotion *motion, bool ak8963);
+
+    virtual bool present() { return m_onBus; }
+
+    bool m_onBus;                                           // false unless the host MPU's bypass is on
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    void measure(unsigned long time);
+
+    bool m_ak8963;
+    bool m_converting;                                      // single measurement in progress
+    unsigned long m_done;                                   // time it completes
+    RTIMUSIM_CLOCK m_clock;                                 // AK8963 continuous modes
+    bool m_unread;                                          // latest measurement not read yet
+};
+
+//  MPU9150 or MPU9250 gyro/accel with the FIFO, data ready status and the auxiliary
+//  I2C master (slaves 0, 1 and 4) driving the magnetometer.
+
+class RTIMUSimMPU9150 : public RTIMUSimSensor
+{
+public:
+    RTIMUSimMPU9150(unsigned char devAddr, RTIMUSimMotion *motion, RTIMUSimAK89xx *compass, bool mpu9250);
+
+    unsigned long m_fifoOverflows;                          // samples dropped from a full FIFO
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+    virtual uint8_t nextRegister(uint8_t regAddr);
+
+private:
+    void reset();
+    void restart();
+    void sample(unsigned long time);
+    void runSlaves(unsigned long time);
+    void slave4();
+    void fifoPush(const unsigned char *data, int length, unsigned long time);
+    void setBypass();
+
+    RTIMUSimAK89xx *m_compass;
+    bool m_mpu9250;
+    RTIMUSIM_CLOCK m_clock;
+    unsigned int m_slaveCount;                              // samples since the slaves last ran
+    bool m_unread;                                          // latest sample not read from the data registers
+
+    unsigned char m_fifo[RTIMUSIM_FIFO_SIZE];
+    unsigned int m_fifoOut;                                 // index of the next byte to read
+    unsigned int m_fifoCount;                               // bytes in the FIFO
+    unsigned int m_fifoEntry;                               // bytes per sample in the FIFO
+    unsigned long m_fifoTimes[RTIMUSIM_FIFO_ENTRIES];       // sample time of each entry
+    unsigned long m_fifoPushed;                             // entries written
+    unsigned long m_fifoPopped;                             // entries read or dropped
+    unsigned int m_fifoOffset;                              // bytes read from the current entry
+};
+
+//  L3GD20, L3GD20H or the gyro half of the LSM9DS0
+
+class RTIMUSimL3GD20 : public RTIMUSimSensor
+{
+public:
+    RTIMUSimL3GD20(unsigned char devAddr, RTIMUSimMotion *motion, unsigned char id);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    void reset();
+    void restart();
+
+    unsigned char m_id;                                     // WHO_AM_I - 0xd7 is the L3GD20H
+    RTIMUSIM_CLOCK m_clock;
+    bool m_unread;
+};
+
+//  LSM303D or the accel/mag half of the LSM9DS0 (the register maps are the same)
+
+class RTIMUSimLSM303D : public RTIMUSimSensor
+{
+public:
+    RTIMUSimLSM303D(unsigned char devAddr, RTIMUSimMotion *motion);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    void reset();
+    void restart();
+
+    RTIMUSIM_CLOCK m_accelClock;
+    RTIMUSIM_CLOCK m_compassClock;
+    bool m_accelUnread;
+    bool m_compassUnread;
+};
+
+//  LSM303DLHC accelerometer (0x19)
+
+class RTIMUSimLSM303DLHCAccel : public RTIMUSimSensor
+{
+public:
+    RTIMUSimLSM303DLHCAccel(RTIMUSimMotion *motion);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    RTIMUSIM_CLOCK m_clock;
+    bool m_unread;
+};
+
+//  LSM303DLHC magnetometer (0x1e) - big endian X, Z, Y outputs and no increment bit
+
+class RTIMUSimLSM303DLHCMag : public RTIMUSimSensor
+{
+public:
+    RTIMUSimLSM303DLHCMag(RTIMUSimMotion *motion);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+    virtual uint8_t nextRegister(uint8_t regAddr);
+
+private:
+    void restart();
+
+    RTIMUSIM_CLOCK m_clock;
+    bool m_converting;                                      // single conversion in progress
+    unsigned long m_done;
+    bool m_unread;
+};
+
+//  BNO055 in the fusion modes - raw sensors, Euler angles and quaternion at 100Hz.
+//  It NACKs while it restarts after a SYS_TRIGGER reset.
+
+class RTIMUSimBNO055 : public RTIMUSimSensor
+{
+public:
+    RTIMUSimBNO055(unsigned char devAddr, RTIMUSimMotion *motion);
+
+    virtual bool present();
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    void reset();
+
+    RTIMUSIM_CLOCK m_clock;
+    unsigned long m_resetDone;                              // time the chip answers again after a reset
+    bool m_resetting;
+    bool m_unread;
+};
+
+//  BMP180 - temperature and pressure conversions started through the control
+//  register with SCO set until they complete
+
+class RTIMUSimBMP180 : public RTIMUSimSensor
+{
+public:
+    RTIMUSimBMP180(RTIMUSimMotion *motion);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    long compensateTemperature(long ut, long *b5);
+    long compensatePressure(long up, long b5, int oss);
+
+    bool m_converting;
+    unsigned long m_started;
+    unsigned long m_done;
+    bool m_unread;
+    long m_ut;                                              // raw temperature from the last temperature conversion
+};
+
+//  LPS25H with its ODR clock, one shot conversions and the FIFO mean mode
+
+class RTIMUSimLPS25H : public RTIMUSimSensor
+{
+public:
+    RTIMUSimLPS25H(unsigned char devAddr, RTIMUSimMotion *motion);
+
+protected:
+    virtual void advance();
+    virtual uint8_t readRegister(uint8_t regAddr);
+    virtual void writeRegister(uint8_t regAddr, uint8_t data);
+
+private:
+    void reset();
+    void restart();
+    void sample(unsigned long time);
+
+    RTIMUSIM_CLOCK m_clock;
+    bool m_converting;                                      // one shot in progress
+    unsigned long m_done;
+    RTFLOAT m_history[RTIMUSIM_LPS25H_HISTORY];             // recent pressures for the mean mode
+    int m_historyIn;
+    int m_historyCount;
+    bool m_unread;
+};
+
+//  MS5611 - a command device. D1/D2 conversions take the time the OSR calls for and
+//  an ADC read before the end of one returns 0, as the part does.
+
+class RTIMUSimMS5611 : public RTIMUSimSensor
+{
+public:
+    RTIMUSimMS5611(unsigned char devAddr, RTIMUSimMotion *motion);
+
+    virtual void start(uint8_t regAddr);
+    virtual uint8_t read();
+    virtual void write(uint8_t data) {}
+
+private:
+    long compensate(unsigned long d1, unsigned long d2, long *temperature);
+
+    unsigned short m_prom[8];
+    unsigned char m_command;
+    int m_index;                                            // byte of the current read
+    bool m_converting;
+    bool m_pressure;                                        // converting D1 (else D2)
+    unsigned long m_started;
+    unsigned long m_done;
+    unsigned long m_result;                                 // ADC result (0 until a conversion completes)
+    unsigned long m_d2;                                     // latest D2 for the D1 inversion
+};
+
+//  Creates and attaches the models for the sensors selected in RTIMULibDefs.h
+
+class RTIMUSim
+{
+public:
+    static bool attach(RTIMUSettings *settings, RTIMUSimMotion *motion);
+
+    static RTIMUSimSensor *m_sensors[RTIMUSIM_MAX_SENSORS];
+    static int m_sensorCount;
+};
+
+#endif // I2CDEV_SIMULATOR
+
+#endif // _RTIMUSIM_H
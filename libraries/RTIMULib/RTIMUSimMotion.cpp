@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTIMUSimMotion.h"
+
+#ifdef I2CDEV_SIMULATOR
+
+//  Converts a vector in the earth frame to the body frame
+
+static RTVector3 toBody(const RTQuaternion& pose, const RTVector3& vec)
+{
+    RTQuaternion q(0, vec.x(), vec.y(), vec.z());
+
+    q = pose.conjugate() * q * pose;
+    return RTVector3(q.x(), q.y(), q.z());
+}
+
+RTIMUSimSyntheticMotion::RTIMUSimSyntheticMotion()
+{
+    RTVector3 level;
+
+    setPose(level);
+    m_field = RTVector3(20, 0, 45);                         // roughly mid-latitude
+    m_altitude = 0;
+    m_amplitude = 0;
+    m_period = 0;
+    m_temperature = 20;
+}
+
+void RTIMUSimSyntheticMotion::setPose(const RTVector3& pose)
+{
+    RTVector3 euler = pose;
+
+    m_pose.fromEuler(euler);
+}
+
+void RTIMUSimSyntheticMotion::setAltitude(RTFLOAT altitude, RTFLOAT amplitude, unsigned long period)
+{
+    m_altitude = altitude;
+    m_amplitude = amplitude;
+    m_period = period;
+}
+
+void RTIMUSimSyntheticMotion::getState(unsigned long time, RTIMUSIM_STATE *state)
+{
+    RTQuaternion pose = m_pose;
+    RTVector3 axis = m_rate;
+    RTFLOAT rate = axis.length();
+    RTFLOAT altitude = m_altitude;
+    RTFLOAT verticalAccel = 0;
+
+    //  a constant body rate turns the pose through rate * t about the (body) axis
+
+    if (rate > 0) {
+        RTQuaternion delta;
+
+        axis.normalize();
+        delta.fromAngleVector(rate * (RTFLOAT)((double)time / 1000000.0), axis);
+        pose = pose * delta;
+        pose.normalize();
+    }
+
+    //  the altitude swing is sinusoidal so the vertical accel is -w^2 times the swing
+
+    if (m_period != 0) {
+        double w = 2.0 * RTMATH_PI / ((double)m_period / 1000000.0);
+        double swing = m_amplitude * sin(2.0 * RTMATH_PI * (double)(time % m_period) / (double)m_period);
+
+        altitude += swing;
+        verticalAccel = -w * w * swing / 9.80665;
+    }
+
+    state->gyro = m_rate;
+    state->accel = toBody(pose, RTVector3(0, 0, 1 + verticalAccel));
+    state->compass = toBody(pose, m_field);
+    pose.toEuler(state->pose);
+
+    state->pressure = 1013.25 * pow(1.0 - altitude / 44330.0, 5.255);
+    state->temperature = m_temperature;
+}
+
+RTIMUSimRecordedMotion::RTIMUSimRecordedMotion(const RTIMUSIM_RECORD *records, int count, bool loop)
+{
+    m_records = records;
+    m_count = count;
+    m_loop = loop;
+}
+
+//  Linear interpolation between two vectors
+
+static RTVector3 interpolate(const RTVector3& a, const RTVector3& b, RTFLOAT f)
+{
+    return RTVector3(a.x() + (b.x() - a.x()) * f, a.y() + (b.y() - a.y()) * f, a.z() + (b.z() - a.z()) * f);
+}
+
+void RTIMUSimRecordedMotion::getState(unsigned long time, RTIMUSIM_STATE *state)
+{
+    const RTIMUSIM_RECORD *a;
+    const RTIMUSIM_RECORD *b;
+    unsigned long end = m_records[m_count - 1].timestamp;
+    int i;
+    RTFLOAT f;
+
+    if (m_loop && (end > 0))
+        time %= end;
+
+    if ((m_count == 1) || (time >= end)) {
+        *state = m_records[m_count - 1].state;
+        return;
+    }
+
+    for (i = 1; (i < m_count - 1) && (m_records[i].timestamp <= time); i++)
+        ;
+    a = m_records + i - 1;
+    b = m_records + i;
+    if (time <= a->timestamp) {
+        *state = a->state;
+        return;
+    }
+    f = (RTFLOAT)(time - a->timestamp) / (RTFLOAT)(b->timestamp - a->timestamp);
+
+    state->gyro = interpolate(a->state.gyro, b->state.gyro, f);
+    state->accel = interpolate(a->state.accel, b->state.accel, f);
+    state->compass = interpolate(a->state.compass, b->state.compass, f);
+    state->pose = interpolate(a->state.pose, b->state.pose, f);
+    state->pressure = a->state.pressure + (b->state.pressure - a->state.pressure) * f;
+    state->temperature = a->state.temperature + (b->state.temperature - a->state.temperature) * f;
+}
+
+#endif // I2CDEV_SIMULATOR
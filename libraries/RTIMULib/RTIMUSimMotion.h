@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTIMUSIMMOTION_H
+#define	_RTIMUSIMMOTION_H
+
+#include "RTMath.h"
+#include "I2Cdev.h"
+
+//  Motion sources for the simulated sensors in RTIMUSim.h. A source gives the true
+//  state at any time in the units and axes RTIMULib reports, so the output of a
+//  driver running against the simulated sensors can be compared with the truth.
+
+#ifdef I2CDEV_SIMULATOR
+
+typedef struct
+{
+    RTVector3 gyro;                                         // rad/s
+    RTVector3 accel;                                        // g
+    RTVector3 compass;                                      // uT
+    RTVector3 pose;                                         // roll, pitch and yaw in radians
+    RTFLOAT pressure;                                       // hPa
+    RTFLOAT temperature;                                    // degrees C
+} RTIMUSIM_STATE;
+
+typedef struct
+{
+    unsigned long timestamp;                                // uS from the start of the recording
+    RTIMUSIM_STATE state;
+} RTIMUSIM_RECORD;
+
+class RTIMUSimMotion
+{
+public:
+    virtual ~RTIMUSimMotion() {}
+
+    //  fills in the state at time (micros())
+
+    virtual void getState(unsigned long time, RTIMUSIM_STATE *state) = 0;
+};
+
+//  Rotation at a constant body rate from an initial pose, with gravity and the earth's
+//  field rotated into the body frame, and an optional sinusoidal altitude change for
+//  the pressure sensors (the accels include its vertical acceleration).
+
+class RTIMUSimSyntheticMotion : public RTIMUSimMotion
+{
+public:
+    RTIMUSimSyntheticMotion();
+
+    void setRate(const RTVector3& rate) { m_rate = rate; }  // body rate in rad/s
+    void setPose(const RTVector3& pose);                    // pose (roll, pitch, yaw) at time 0
+    void setField(const RTVector3& field) { m_field = field; } // earth's field in uT (north, east, down)
+    void setAltitude(RTFLOAT altitude, RTFLOAT amplitude, unsigned long period);
+    void setTemperature(RTFLOAT temperature) { m_temperature = temperature; }
+
+    virtual void getState(unsigned long time, RTIMUSIM_STATE *state);
+
+private:
+    RTVector3 m_rate;
+    RTQuaternion m_pose;                                    // pose at time 0
+    RTVector3 m_field;
+    RTFLOAT m_altitude;                                     // mean altitude in m
+    RTFLOAT m_amplitude;                                    // altitude swing in m
+    unsigned long m_period;                                 // altitude period in uS (0 for constant)
+    RTFLOAT m_temperature;
+};
+
+//  Plays back a table of recorded states, interpolating between entries. The table
+//  is held by the caller and its timestamps must increase.
+
+class RTIMUSimRecordedMotion : public RTIMUSimMotion
+{
+public:
+    RTIMUSimRecordedMotion(const RTIMUSIM_RECORD *records, int count, bool loop);
+
+    virtual void getState(unsigned long time, RTIMUSIM_STATE *state);
+
+private:
+    const RTIMUSIM_RECORD *m_records;
+    int m_count;
+    bool m_loop;                                            // start again at the end (else hold the last entry)
+};
+
+#endif // I2CDEV_SIMULATOR
+
+#endif // _RTIMUSIMMOTION_H
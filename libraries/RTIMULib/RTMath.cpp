@@ -22,9 +22,15 @@
 //  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "RTMath.h"
+
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+#include <stdio.h>                                          // host builds (e.g. RTArduLinkHost) print to stdout
+#endif
 
 #ifndef RTARDULINK_MODE
+#ifdef ARDUINO
 void RTMath::display(const char *label, RTVector3& vec)
 {
     Serial.print(label);
@@ -57,6 +63,29 @@ void RTMath::display(const char *label, RTQuaternion& quat)
     Serial.print(" y:"); Serial.print(quat.y());
     Serial.print(" z:"); Serial.print(quat.z());
 }
+#else
+void RTMath::display(const char *label, RTVector3& vec)
+{
+    printf("%s x:%.2f y:%.2f z:%.2f", label, vec.x(), vec.y(), vec.z());
+}
+
+void RTMath::displayDegrees(const char *label, RTVector3& vec)
+{
+    printf("%s x:%.2f y:%.2f z:%.2f", label, vec.x() * RTMATH_RAD_TO_DEGREE,
+            vec.y() * RTMATH_RAD_TO_DEGREE, vec.z() * RTMATH_RAD_TO_DEGREE);
+}
+
+void RTMath::displayRollPitchYaw(const char *label, RTVector3& vec)
+{
+    printf("%s roll:%.2f pitch:%.2f yaw:%.2f", label, vec.x() * RTMATH_RAD_TO_DEGREE,
+            vec.y() * RTMATH_RAD_TO_DEGREE, vec.z() * RTMATH_RAD_TO_DEGREE);
+}
+
+void RTMath::display(const char *label, RTQuaternion& quat)
+{
+    printf("%s scalar:%.2f x:%.2f y:%.2f z:%.2f", label, quat.scalar(), quat.x(), quat.y(), quat.z());
+}
+#endif // ARDUINO
 
 RTVector3 RTMath::poseFromAccelMag(const RTVector3& accel, const RTVector3& mag)
 {
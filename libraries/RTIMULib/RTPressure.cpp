@@ -52,8 +52,31 @@ RTPressure *RTPressure::createPressure(RTIMUSettings *settings)
 RTPressure::RTPressure(RTIMUSettings *settings)
 {
     m_settings = settings;
+    m_rate = 0;
+    m_rateCount = -1;
+    m_readingCount = 0;
 }
 
 RTPressure::~RTPressure()
 {
 }
+
+void RTPressure::pressureNewReading(unsigned long timestamp)
+{
+    m_readingCount++;
+
+    if (m_rateCount < 0) {
+        m_rateStart = timestamp;                            // the first reading just starts the period
+        m_rateCount = 0;
+        return;
+    }
+    m_rateCount++;
+
+    unsigned long elapsed = timestamp - m_rateStart;
+
+    if (elapsed >= RTPRESSURE_RATE_PERIOD) {
+        m_rate = (RTFLOAT)m_rateCount * (RTFLOAT)1000000 / (RTFLOAT)elapsed;
+        m_rateStart = timestamp;
+        m_rateCount = 0;
+    }
+}
@@ -29,6 +29,10 @@
 #include "RTPressureDefs.h"
 #include "I2Cdev.h"
 
+//  The achieved output rate is measured over this period (in uS)
+
+#define RTPRESSURE_RATE_PERIOD      1000000
+
 class RTPressure
 {
 public:
@@ -48,9 +52,34 @@ public:
     virtual bool pressureInit() = 0;                        // set up the pressure sensor
     virtual bool pressureRead(float &latestPressure, float &latestTemperature) = 0;   // get latest value
 
+    //  pressureGetRate() returns the rate that new pressure readings are being produced
+    //  (in readings per second), averaged over RTPRESSURE_RATE_PERIOD. It is 0 until
+    //  the first period has passed.
+
+    RTFLOAT pressureGetRate() { return m_rate; }
+
+    //  pressureGetReadingCount() counts the new readings - a change means pressureRead()
+    //  has returned a new one
+
+    unsigned long pressureGetReadingCount() { return m_readingCount; }
+
+    //  pressureGetAccessDue() returns the micros() time when pressureRead() will next need
+    //  the bus, to read a result or start a conversion. Sensors that can't tell return the
+    //  current time.
+
+    virtual unsigned long pressureGetAccessDue() { return micros(); }
+
 protected:
+    void pressureNewReading(unsigned long timestamp);       // sub classes call this for each new reading (timestamp in uS)
+
     RTIMUSettings *m_settings;                              // the settings object pointer
 
+private:
+    RTFLOAT m_rate;                                         // achieved output rate
+    unsigned long m_rateStart;                              // start of the current measurement period
+    int m_rateCount;                                        // readings since m_rateStart
+    unsigned long m_readingCount;                           // total new readings
+
 };
 
 #endif // _RTPRESSURE_H
@@ -40,6 +40,13 @@ bool RTPressureBMP180::pressureInit()
     unsigned char data[22];
 
     m_pressureAddr = m_settings->m_I2CPressureAddress;
+    I2Cdev::setDeviceClock(m_pressureAddr, I2CDEV_CLOCK_FAST);  // high speed mode needs a master code
+
+    m_oss = m_settings->m_BMP180Oss;
+    m_temperatureInterval = m_settings->m_BMP180TemperatureInterval;
+
+    if ((m_oss < BMP180_SCO_PRESSURECONV_ULP) || (m_oss > BMP180_SCO_PRESSURECONV_UHR) || (m_temperatureInterval < 1))
+        return false;
 
     // check ID of chip
 
@@ -57,7 +64,7 @@ bool RTPressureBMP180::pressureInit()
 
     m_AC1 = (int16_t)(((uint16_t)data[0]) << 8) + (uint16_t)data[1];
     m_AC2 = (int16_t)(((uint16_t)data[2]) << 8) + (uint16_t)data[3];
-    m_AC3 = (int16_t)(((uint16_t)data[4]) << 8) + (uint16_t)data[4];
+    m_AC3 = (int16_t)(((uint16_t)data[4]) << 8) + (uint16_t)data[5];
     m_AC4 = (((uint16_t)data[6]) << 8) + (uint16_t)data[7];
     m_AC5 = (((uint16_t)data[8]) << 8) + (uint16_t)data[9];
     m_AC6 = (((uint16_t)data[10]) << 8) + (uint16_t)data[11];
@@ -68,22 +75,82 @@ bool RTPressureBMP180::pressureInit()
     m_MD = (int16_t)(((uint16_t)data[20]) << 8) + (uint16_t)data[21];
 
     m_state = BMP180_STATE_IDLE;
-    m_oss = BMP180_SCO_PRESSURECONV_UHR;
+    m_temperatureValid = false;
+    m_pressureCount = 0;
+    setCoefficients();
+    return true;
+}
+
+//  setCoefficients() folds the calibration data and oversampling setting into the
+//  constants used by the compensation
+
+void RTPressureBMP180::setCoefficients()
+{
+    m_MC2048 = (int32_t)m_MC * 2048;
+    m_AC1x4 = (int32_t)m_AC1 * 4;
+    m_B7Scale = (uint32_t)50000 >> m_oss;
+    m_termsValid = false;
+}
+
+//  The temperature and the terms of the pressure compensation that only depend on it
+//  (B3 and B4) are worked out once for each raw temperature. After that, compensating
+//  a pressure needs a single division. The arithmetic is exactly the datasheet's.
+
+bool RTPressureBMP180::calculateTemperature()
+{
+    if (m_termsValid && (m_rawTemperature == m_termsRawTemperature))
+        return true;
+
+    int32_t X1 = ((m_rawTemperature - (int32_t)m_AC6) * (int32_t)m_AC5) / 32768;
+
+    if ((X1 + m_MD) == 0)
+        return false;
+
+    int32_t X2 = m_MC2048 / (X1 + (int32_t)m_MD);
+    int32_t B5 = X1 + X2;
+    m_temperature = (RTFLOAT)((B5 + 8) / 16) / (RTFLOAT)10;
+
+    int32_t B6 = B5 - 4000;
+    int32_t B6B6 = (B6 * B6) / 4096;
+    X1 = (m_B2 * B6B6) / 2048;
+    X2 = (m_AC2 * B6) / 2048;
+    int32_t X3 = X1 + X2;
+    m_B3 = (((m_AC1x4 + X3) << m_oss) + 2) / 4;
+    X1 = (m_AC3 * B6) / 8192;
+    X2 = (m_B1 * B6B6) / 65536;
+    X3 = ((X1 + X2) + 2) / 4;
+    m_B4 = (m_AC4 * (uint32_t)(X3 + 32768)) / 32768;
+
+    m_termsRawTemperature = m_rawTemperature;
+    m_termsValid = true;
     return true;
 }
 
+void RTPressureBMP180::calculatePressure(int32_t rawPressure)
+{
+    uint32_t B7 = (uint32_t)(rawPressure - m_B3) * m_B7Scale;
+
+    int32_t p;
+    if (B7 < 0x80000000)
+        p = (B7 * 2) / m_B4;
+    else
+        p = (B7 / m_B4) * 2;
+
+    int32_t X1 = (p / 256) * (p / 256);
+    X1 = (X1 * 3038) / 65536;
+    int32_t X2 = (-7357 * p) / 65536;
+    m_pressure = (RTFLOAT)(p + (X1 + X2 + 3791) / 16) / (RTFLOAT)100;      // the extra 100 factor is to get 1hPa units
+}
+
 bool RTPressureBMP180::pressureRead(float &latestPressure, float &latestTemperature)
 {
     latestPressure = 0;
     latestTemperature = 0;
 
     if (m_state == BMP180_STATE_IDLE) {
-        // start a temperature conversion
-        if (!I2Cdev::writeByte(m_pressureAddr, BMP180_REG_SCO, BMP180_SCO_TEMPCONV)) {
+        // start with a temperature conversion as the pressure compensation needs it
+        if (!startConversion(BMP180_STATE_TEMPERATURE))
             return false;
-        } else {
-            m_state = BMP180_STATE_TEMPERATURE;
-        }
     }
 
     pressureBackground();
@@ -95,118 +162,88 @@ bool RTPressureBMP180::pressureRead(float &latestPressure, float &latestTemperat
     return true;
 }
 
+unsigned long RTPressureBMP180::pressureGetAccessDue()
+{
+    if (m_state == BMP180_STATE_IDLE)
+        return micros();
+    return m_conversionStart + m_conversionTime;
+}
+
+bool RTPressureBMP180::startConversion(int state)
+{
+    static const unsigned long pressureTimes[] = {4500, 7500, 13500, 25500};
+    unsigned char cmd;
+
+    if (state == BMP180_STATE_PRESSURE) {
+        cmd = 0x34 + (m_oss << 6);
+        m_conversionTime = pressureTimes[m_oss];
+    } else {
+        cmd = BMP180_SCO_TEMPCONV;
+        m_conversionTime = 4500;
+    }
+
+    if (!I2Cdev::writeByte(m_pressureAddr, BMP180_REG_SCO, cmd)) {
+        m_state = BMP180_STATE_IDLE;
+        return false;
+    }
+    m_state = state;
+    m_conversionStart = micros();                           // the conversion starts at the end of the command
+    return true;
+}
+
+//  The conversions are run back to back - as soon as one has been read the next is started.
+//  They're timed with the datasheet's maximum conversion times rather than by polling SCO.
+//  The temperature is only converted every m_temperatureInterval pressure conversions
+//  and the pressures in between are compensated with the last one.
 
 void RTPressureBMP180::pressureBackground()
 {
-    uint8_t data[2];
+    uint8_t data[3];
+    unsigned long now = micros();
 
-    switch (m_state) {
-        case BMP180_STATE_IDLE:
-        break;
+    if ((m_state == BMP180_STATE_IDLE) || ((now - m_conversionStart) < m_conversionTime))
+        return;                                             // not time yet
 
-        case BMP180_STATE_TEMPERATURE:
-        if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_SCO, 1, data)) {
-            break;
-        }
-        if ((data[0] & 0x20) == 0x20)
-            break;                                      // conversion not finished
+    if (m_state == BMP180_STATE_TEMPERATURE) {
         if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_RESULT, 2, data)) {
-            m_state = BMP180_STATE_IDLE;
-            break;
+            m_state = BMP180_STATE_IDLE;                    // start again next time
+            return;
         }
         m_rawTemperature = (((uint16_t)data[0]) << 8) | (uint16_t)data[1];
-
-        data[0] = 0x34 + (m_oss << 6);
-        if (!I2Cdev::writeBytes(m_pressureAddr, BMP180_REG_SCO, 1, data)) {
+        m_temperatureValid = true;
+        m_pressureCount = 0;
+    } else {
+        if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_RESULT, 3, data)) {
             m_state = BMP180_STATE_IDLE;
-            break;
-        }
-        m_state = BMP180_STATE_PRESSURE;
-        break;
-
-        case BMP180_STATE_PRESSURE:
-        if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_SCO, 1, data)) {
-            break;
-        }
-        if ((data[0] & 0x20) == 0x20)
-            break;                                      // conversion not finished
-        if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_RESULT, 2, data)) {
-            m_state = BMP180_STATE_IDLE;
-            break;
+            return;
         }
         m_rawPressure = (((uint16_t)data[0]) << 8) | (uint16_t)data[1];
-
-        if (!I2Cdev::readBytes(m_pressureAddr, BMP180_REG_XLSB, 1, data)) {
-            m_state = BMP180_STATE_IDLE;
-            break;
-        }
+        m_pressureCount++;
 
         // call this function for testing only
         // should give T = 150 (15.0C) and pressure 6996 (699.6hPa)
 
         // setTestData();
 
-        int32_t pressure = ((((uint32_t)(m_rawPressure)) << 8) + (uint32_t)(data[0])) >> (8 - m_oss);
-
-        m_state = BMP180_STATE_IDLE;
-
-        // calculate compensated temperature
-
-        int32_t X1 = ((m_rawTemperature - (int32_t)m_AC6) * (int32_t)m_AC5) / 32768;
+        int32_t pressure = ((((uint32_t)(m_rawPressure)) << 8) + (uint32_t)(data[2])) >> (8 - m_oss);
 
-        if ((X1 + m_MD) == 0) {
-            break;
+        if (calculateTemperature()) {
+            calculatePressure(pressure);
+            m_validReadings = true;
+            pressureNewReading(now);
         }
 
-        int32_t X2 = ((int32_t)m_MC * 2048)  / (X1 + (int32_t)m_MD);
-        int32_t B5 = X1 + X2;
-        m_temperature = (RTFLOAT)((B5 + 8) / 16) / (RTFLOAT)10;
-
-        // calculate compensated pressure
-
-        int32_t B6 = B5 - 4000;
-        //          printf("B6 = %d\n", B6);
-        X1 = (m_B2 * ((B6 * B6) / 4096)) / 2048;
-        //          printf("X1 = %d\n", X1);
-        X2 = (m_AC2 * B6) / 2048;
-        //          printf("X2 = %d\n", X2);
-        int32_t X3 = X1 + X2;
-        //          printf("X3 = %d\n", X3);
-        int32_t B3 = (((m_AC1 * 4 + X3) << m_oss) + 2) / 4;
-        //          printf("B3 = %d\n", B3);
-        X1 = (m_AC3 * B6) / 8192;
-        //          printf("X1 = %d\n", X1);
-        X2 = (m_B1 * ((B6 * B6) / 4096)) / 65536;
-        //          printf("X2 = %d\n", X2);
-        X3 = ((X1 + X2) + 2) / 4;
-        //          printf("X3 = %d\n", X3);
-        uint32_t B4 = (m_AC4 * (uint32_t)(X3 + 32768)) / 32768;
-        //          printf("B4 = %d\n", B4);
-        uint32_t B7 = (uint32_t)(pressure - B3) * (50000 >> m_oss);
-        //          printf("B7 = %d\n", B7);
-
-        int32_t p;
-        if (B7 < 0x80000000)
-        p = (B7 * 2) / B4;
-            else
-        p = (B7 / B4) * 2;
-
-        //          printf("p = %d\n", p);
-        X1 = (p / 256) * (p / 256);
-        //          printf("X1 = %d\n", X1);
-        X1 = (X1 * 3038) / 65536;
-        //          printf("X1 = %d\n", X1);
-        X2 = (-7357 * p) / 65536;
-        //          printf("X2 = %d\n", X2);
-        m_pressure = (RTFLOAT)(p + (X1 + X2 + 3791) / 16) / (RTFLOAT)100;      // the extra 100 factor is to get 1hPa units
-
-        m_validReadings = true;
-
         // printf("UP = %d, P = %f, UT = %d, T = %f\n", m_rawPressure, m_pressure, m_rawTemperature, m_temperature);
-        break;
     }
+
+    if (!m_temperatureValid || (m_pressureCount >= m_temperatureInterval))
+        startConversion(BMP180_STATE_TEMPERATURE);
+    else
+        startConversion(BMP180_STATE_PRESSURE);
 }
 
+//  setTestData() loads the datasheet example - it has oss = 0
+
 void RTPressureBMP180::setTestData()
 {
     m_AC1 = 408;
@@ -223,5 +260,8 @@ void RTPressureBMP180::setTestData()
 
     m_rawTemperature = 27898;
     m_rawPressure = 23843;
+
+    m_oss = BMP180_SCO_PRESSURECONV_ULP;
+    setCoefficients();
 }
 #endif
\ No newline at end of file
@@ -52,9 +52,14 @@ public:
     virtual int pressureType() { return RTPRESSURE_TYPE_BMP180; }
     virtual bool pressureInit();
     virtual bool pressureRead(float &latestPressure, float &latestTemperature);
+    virtual unsigned long pressureGetAccessDue();
 
 private:
     void pressureBackground();
+    bool startConversion(int state);                        // start a pressure or temperature conversion
+    void setCoefficients();                                 // fold the calibration data into constants
+    bool calculateTemperature();                            // temperature and the terms that depend on it
+    void calculatePressure(int32_t rawPressure);            // compensated pressure from the raw value
     void setTestData();
 
     unsigned char m_pressureAddr;                           // I2C address
@@ -75,8 +80,23 @@ private:
     int16_t m_MC;
     int16_t m_MD;
 
+    // Constants derived from the calibration data and the temperature terms
+
+    int32_t m_MC2048;                                       // MC * 2048
+    int32_t m_AC1x4;                                        // AC1 * 4
+    uint32_t m_B7Scale;                                     // 50000 >> oss
+    int32_t m_B3;                                           // for the last raw temperature
+    uint32_t m_B4;                                          // same
+    int32_t m_termsRawTemperature;                          // raw temperature m_B3 and m_B4 are for
+    bool m_termsValid;                                      // true if m_B3 and m_B4 are valid
+
     int m_state;
     int m_oss;
+    int m_temperatureInterval;                              // pressure conversions per temperature conversion
+    int m_pressureCount;                                    // pressure conversions since the last temperature one
+    bool m_temperatureValid;                                // true if m_rawTemperature holds a conversion
+    unsigned long m_conversionStart;                        // micros() when the current conversion started
+    unsigned long m_conversionTime;                         // how long it takes (in uS)
 
     int32_t m_rawPressure;
     int32_t m_rawTemperature;
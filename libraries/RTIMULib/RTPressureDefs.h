@@ -84,6 +84,34 @@
 #define LPS25H_RPDS_L               0x39
 #define LPS25H_RPDS_H               0x3a
 
+//  Output data rate options
+
+#define LPS25H_SAMPLERATE_1         1                       // 1 sample per second
+#define LPS25H_SAMPLERATE_7         2                       // 7 samples per second
+#define LPS25H_SAMPLERATE_12_5      3                       // 12.5 samples per second
+#define LPS25H_SAMPLERATE_25        4                       // 25 samples per second
+
+//  Internal averaging options (more averaging lowers the noise but uses more power)
+
+#define LPS25H_PRESSURE_AVG_8       0                       // 8 internal pressure samples per output
+#define LPS25H_PRESSURE_AVG_32      1                       // 32
+#define LPS25H_PRESSURE_AVG_128     2                       // 128
+#define LPS25H_PRESSURE_AVG_512     3                       // 512 (not at 25 samples per second)
+
+#define LPS25H_TEMPERATURE_AVG_8    0                       // 8 internal temperature samples per output
+#define LPS25H_TEMPERATURE_AVG_16   1                       // 16
+#define LPS25H_TEMPERATURE_AVG_32   2                       // 32
+#define LPS25H_TEMPERATURE_AVG_64   3                       // 64
+
+//  FIFO mean mode options - the output is the running mean of the last n outputs
+
+#define LPS25H_FIFO_MEAN_OFF        0                       // FIFO not used
+#define LPS25H_FIFO_MEAN_2          2                       // mean of 2
+#define LPS25H_FIFO_MEAN_4          4                       // mean of 4
+#define LPS25H_FIFO_MEAN_8          8                       // mean of 8
+#define LPS25H_FIFO_MEAN_16         16                      // mean of 16
+#define LPS25H_FIFO_MEAN_32         32                      // mean of 32
+
 //----------------------------------------------------------
 //
 //  MS5611
@@ -96,9 +124,17 @@
 //	commands
 
 #define MS5611_CMD_RESET            0x1e
-#define MS5611_CMD_CONV_D1          0x48
-#define MS5611_CMD_CONV_D2          0x58
+#define MS5611_CMD_CONV_D1          0x40                    // plus the OSR code * 2
+#define MS5611_CMD_CONV_D2          0x50                    // plus the OSR code * 2
 #define MS5611_CMD_PROM             0xa0
 #define MS5611_CMD_ADC              0x00
 
+//  Oversampling ratio options (higher ratios have lower noise but take longer)
+
+#define MS5611_OSR_256              0                       // 0.6mS conversions
+#define MS5611_OSR_512              1                       // 1.17mS
+#define MS5611_OSR_1024             2                       // 2.28mS
+#define MS5611_OSR_2048             3                       // 4.54mS
+#define MS5611_OSR_4096             4                       // 9.04mS
+
 #endif // _RTPRESSUREDEFS_H
@@ -38,18 +38,67 @@ RTPressureLPS25H::~RTPressureLPS25H()
 
 bool RTPressureLPS25H::pressureInit()
 {
+    static const unsigned long intervals[] = {0, 1000000, 142857, 80000, 40000};
+    int rate = m_settings->m_LPS25HSampleRate;
+    int pressureAvg = m_settings->m_LPS25HPressureAvg;
+    int temperatureAvg = m_settings->m_LPS25HTemperatureAvg;
+    int fifoMean = m_settings->m_LPS25HFifoMean;
+
     m_pressureAddr = m_settings->m_I2CPressureAddress;
+    I2Cdev::setDeviceClock(m_pressureAddr, I2CDEV_CLOCK_FAST);  // up to 400kHz
 
-    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_1, 0xc4))
+    if ((rate < LPS25H_SAMPLERATE_1) || (rate > LPS25H_SAMPLERATE_25))
         return false;
 
-    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_RES_CONF, 0x05))
+    if ((pressureAvg < LPS25H_PRESSURE_AVG_8) || (pressureAvg > LPS25H_PRESSURE_AVG_512) ||
+            ((pressureAvg == LPS25H_PRESSURE_AVG_512) && (rate == LPS25H_SAMPLERATE_25)))
         return false;
 
-    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_FIFO_CTRL, 0xc0))
+    if ((temperatureAvg < LPS25H_TEMPERATURE_AVG_8) || (temperatureAvg > LPS25H_TEMPERATURE_AVG_64))
         return false;
 
-    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_2, 0x40))
+    switch (fifoMean) {
+    case LPS25H_FIFO_MEAN_OFF:
+    case LPS25H_FIFO_MEAN_2:
+    case LPS25H_FIFO_MEAN_4:
+    case LPS25H_FIFO_MEAN_8:
+    case LPS25H_FIFO_MEAN_16:
+    case LPS25H_FIFO_MEAN_32:
+        break;
+
+    default:
+        return false;
+    }
+
+    m_sampleInterval = intervals[rate];
+    m_pressureValid = false;
+    m_temperatureValid = false;
+
+    //  the averaging and FIFO are set up before the output data rate powers the chip up
+
+    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_1, 0))
+        return false;
+
+    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_RES_CONF, (temperatureAvg << 2) | pressureAvg))
+        return false;
+
+    if (fifoMean == LPS25H_FIFO_MEAN_OFF) {
+        if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_2, 0))
+            return false;
+
+        if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_FIFO_CTRL, 0))
+            return false;
+    } else {
+        if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_FIFO_CTRL, 0xc0 | (fifoMean - 1)))
+            return false;
+
+        if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_2, 0x40))
+            return false;
+    }
+
+    //  power on, output data rate and block data update
+
+    if (!I2Cdev::writeByte(m_pressureAddr, LPS25H_CTRL_REG_1, 0x84 | (rate << 4)))
         return false;
 
     return true;
@@ -58,33 +107,45 @@ bool RTPressureLPS25H::pressureInit()
 
 bool RTPressureLPS25H::pressureRead(float &latestPressure, float &latestTemperature)
 {
-    unsigned char rawData[3];
-    unsigned char status;
+    unsigned char data[6];
+    unsigned long now = micros();
 
     latestPressure = 0;
     latestTemperature = 0;
 
-    if (!I2Cdev::readBytes(m_pressureAddr, LPS25H_STATUS_REG, 1, &status))
-        return false;
-
-    if (status & 2) {
-        if (!I2Cdev::readBytes(m_pressureAddr, LPS25H_PRESS_OUT_XL + 0x80, 3, rawData))
-            return false;
+    //  there can't be a new output until a sample period after the last one was seen so
+    //  the bus is left alone until shortly before then (the chip's clock isn't exact and
+    //  waiting the whole period would let the sampling drift). After that, one burst
+    //  read gets the status, pressure and temperature.
 
-        m_pressure = (RTFLOAT)((((unsigned long)rawData[2]) << 16) | (((unsigned long)rawData[1]) << 8) | (unsigned long)rawData[0]) / (RTFLOAT)4096;
-        m_pressureValid = true;
-    }
-    if (status & 1) {
-        if (!I2Cdev::readBytes(m_pressureAddr, LPS25H_TEMP_OUT_L + 0x80, 2, rawData))
+    if (!m_pressureValid || ((now - m_lastSampleTime) >= m_sampleInterval - m_sampleInterval / 8)) {
+        if (I2Cdev::readBytes(m_pressureAddr, LPS25H_STATUS_REG + 0x80, 6, data) != 6)
             return false;
 
-        m_temperature = (int16_t)((((unsigned int)rawData[1]) << 8) | (unsigned int)rawData[0]) / (RTFLOAT)480 + (RTFLOAT)42.5;
-        m_temperatureValid = true;
+        if (data[0] & 2) {
+            m_pressure = (RTFLOAT)((((unsigned long)data[3]) << 16) | (((unsigned long)data[2]) << 8) | (unsigned long)data[1]) / (RTFLOAT)4096;
+            m_pressureValid = true;
+            m_lastSampleTime = now;
+            pressureNewReading(now);
+        }
+        if (data[0] & 1) {
+            m_temperature = (int16_t)((((unsigned int)data[5]) << 8) | (unsigned int)data[4]) / (RTFLOAT)480 + (RTFLOAT)42.5;
+            m_temperatureValid = true;
+        }
     }
 
-    latestPressure = m_pressure;
-    latestTemperature = m_temperature;
+    if (m_pressureValid)
+        latestPressure = m_pressure;
+    if (m_temperatureValid)
+        latestTemperature = m_temperature;
 
     return true;
 }
+
+unsigned long RTPressureLPS25H::pressureGetAccessDue()
+{
+    if (!m_pressureValid)
+        return micros();
+    return m_lastSampleTime + m_sampleInterval - m_sampleInterval / 8;
+}
 #endif
\ No newline at end of file
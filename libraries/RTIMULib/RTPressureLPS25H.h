@@ -38,6 +38,7 @@ public:
     virtual int pressureType() { return RTPRESSURE_TYPE_LPS25H; }
     virtual bool pressureInit();
     virtual bool pressureRead(float &latestPressure, float &latestTemperature);
+    virtual unsigned long pressureGetAccessDue();
 
 private:
     unsigned char m_pressureAddr;                           // I2C address
@@ -47,6 +48,9 @@ private:
     bool m_pressureValid;
     bool m_temperatureValid;
 
+    unsigned long m_sampleInterval;                         // output data rate period in uS
+    unsigned long m_lastSampleTime;                         // micros() when the last new pressure was seen
+
 };
 
 #endif // _RTPRESSURELPS25H_H_
@@ -23,6 +23,8 @@
 
 #include "RTPressureMS5611.h"
 
+#if defined(MS5611_76) || defined(MS5611_77)
+
 RTPressureMS5611::RTPressureMS5611(RTIMUSettings *settings) : RTPressure(settings)
 {
     m_validReadings = false;
@@ -34,10 +36,20 @@ RTPressureMS5611::~RTPressureMS5611()
 
 bool RTPressureMS5611::pressureInit()
 {
+    static const unsigned long conversionTimes[] = {600, 1170, 2280, 4540, 9040};
     unsigned char cmd = MS5611_CMD_PROM + 2;
     unsigned char data[2];
 
     m_pressureAddr = m_settings->m_I2CPressureAddress;
+    I2Cdev::setDeviceClock(m_pressureAddr, I2CDEV_CLOCK_FAST);  // up to 400kHz
+
+    m_osr = m_settings->m_MS5611Osr;
+    m_temperatureInterval = m_settings->m_MS5611TemperatureInterval;
+
+    if ((m_osr < MS5611_OSR_256) || (m_osr > MS5611_OSR_4096) || (m_temperatureInterval < 1))
+        return false;
+
+    m_conversionTime = conversionTimes[m_osr];
 
     // get calibration data
 
@@ -50,19 +62,87 @@ bool RTPressureMS5611::pressureInit()
     }
 
     m_state = MS5611_STATE_IDLE;
+    m_D2Valid = false;
+    m_pressureCount = 0;
+    setCoefficients();
     return true;
 }
 
+//  setCoefficients() folds the calibration data into the constants used by the compensation
+
+void RTPressureMS5611::setCoefficients()
+{
+    m_tRef = ((int32_t)m_calData[4]) << 8;
+    m_offsetBase = ((int64_t)m_calData[1]) << 16;
+    m_sensBase = ((int32_t)m_calData[0]) << 15;
+    m_termsValid = false;
+}
+
+//  The temperature and the pressure offset and sensitivity only depend on D2 so they're
+//  worked out once for each raw temperature. The arithmetic is exactly the datasheet's but
+//  int64 is only used where the values need it - the products are all 32 x 32 bits so
+//  the compiler can use its widening multiply.
+
+void RTPressureMS5611::calculateTemperature()
+{
+    if (m_termsValid && (m_D2 == m_termsD2))
+        return;
+
+    int32_t deltaT = (int32_t)m_D2 - m_tRef;
+
+    //  (deltaT * C6) >> 23 without int64 - deltaT is split at bit 16 and the low
+    //  product's bottom 16 bits can't change the result
+
+    int32_t high = (deltaT >> 16) * (int32_t)m_calData[5];
+    uint32_t low = ((uint32_t)deltaT & 0xffff) * (uint32_t)m_calData[5];
+    int32_t temperature = 2000 + ((high + (int32_t)(low >> 16)) >> 7);  // note - this needs to be divided by 100
+
+    int64_t offset = m_offsetBase + (((int64_t)(int32_t)m_calData[3] * deltaT) >> 7);
+    int64_t sens = (int64_t)m_sensBase + (((int64_t)(int32_t)m_calData[2] * deltaT) >> 8);
+
+    //  do second order temperature compensation
+
+    if (temperature < 2000) {
+        int32_t T2 = (int32_t)(((int64_t)deltaT * deltaT) >> 31);
+        int64_t offset2 = 5 * ((temperature - 2000) * (temperature - 2000)) / 2;
+        int64_t sens2 = offset2 / 2;
+        if (temperature < -1500) {
+            offset2 += 7 * (temperature + 1500) * (temperature + 1500);
+            sens2 += 11 * ((temperature + 1500) * (temperature + 1500)) / 2;
+        }
+        temperature -= T2;
+        offset -= offset2;
+        sens -= sens2;
+    }
+
+    m_temperature = (RTFLOAT)temperature / (RTFLOAT)100;
+    m_offset = offset;
+    m_sens = sens;
+    m_sens32 = (sens >= 0) && (sens <= (int64_t)0xffffffff);
+    m_termsD2 = m_D2;
+    m_termsValid = true;
+}
+
+void RTPressureMS5611::calculatePressure()
+{
+    int64_t product;
+
+    //  D1 is 24 bits so D1 * SENS is a 32 x 32 bit multiply unless SENS is out of the usual range
+
+    if (m_sens32)
+        product = (int64_t)((uint64_t)m_D1 * (uint32_t)m_sens);
+    else
+        product = (int64_t)m_D1 * m_sens;
+
+    m_pressure = (RTFLOAT)(((product >> 21) - m_offset) >> 15) / (RTFLOAT)100.0;
+}
+
 bool RTPressureMS5611::pressureRead(float &latestPressure, float &latestTemperature)
 {
     if (m_state == MS5611_STATE_IDLE) {
-        // start pressure conversion
-        if (!I2Cdev::writeBytes(m_pressureAddr, MS5611_CMD_CONV_D1, 0, 0)) {
+        // start with a temperature conversion as the pressure compensation needs it
+        if (!startConversion(MS5611_STATE_TEMPERATURE))
             return false;
-        } else {
-            m_state = MS5611_STATE_PRESSURE;
-            m_timer = millis();
-        }
     }
 
     pressureBackground();
@@ -74,79 +154,77 @@ bool RTPressureMS5611::pressureRead(float &latestPressure, float &latestTemperat
     return true;
 }
 
+unsigned long RTPressureMS5611::pressureGetAccessDue()
+{
+    if (m_state == MS5611_STATE_IDLE)
+        return micros();
+    return m_conversionStart + m_conversionTime;
+}
 
-void RTPressureMS5611::pressureBackground()
+bool RTPressureMS5611::startConversion(int state)
 {
-    uint8_t data[3];
+    unsigned char cmd = (state == MS5611_STATE_PRESSURE) ? MS5611_CMD_CONV_D1 : MS5611_CMD_CONV_D2;
 
-    switch (m_state) {
-        case MS5611_STATE_IDLE:
-        break;
+    if (!I2Cdev::writeBytes(m_pressureAddr, cmd + (m_osr << 1), 0, 0)) {
+        m_state = MS5611_STATE_IDLE;
+        return false;
+    }
+    m_state = state;
+    m_conversionStart = micros();                           // the conversion starts at the end of the command
+    return true;
+}
 
-        case MS5611_STATE_PRESSURE:
-        if ((millis() - m_timer) < 10)
-            break;                                          // not time yet
-        if (!I2Cdev::readBytes(m_pressureAddr, MS5611_CMD_ADC, 3, data)) {
-            break;
-        }
-        m_D1 = (((uint32_t)data[0]) << 16) + (((uint32_t)data[1]) << 8) + (uint32_t)data[2];
+//  The conversions are run back to back - as soon as one has been read the next is started.
+//  The temperature is only converted every m_temperatureInterval pressure conversions
+//  and the pressures in between are compensated with the last one.
 
-        // start temperature conversion
+void RTPressureMS5611::pressureBackground()
+{
+    uint8_t data[3];
+    unsigned long now = micros();
+    uint32_t result;
 
-        if (!I2Cdev::writeBytes(m_pressureAddr, MS5611_CMD_CONV_D2, 0, 0)) {
-            break;
-        } else {
-            m_state = MS5611_STATE_TEMPERATURE;
-            m_timer = millis();
-        }
-        break;
+    if ((m_state == MS5611_STATE_IDLE) || ((now - m_conversionStart) < m_conversionTime))
+        return;                                             // not time yet
 
-        case MS5611_STATE_TEMPERATURE:
-        if ((millis() - m_timer) < 10)
-            break;                                          // not time yet
-        if (!I2Cdev::readBytes(m_pressureAddr, MS5611_CMD_ADC, 3, data)) {
-            break;
-        }
-        m_D2 = (((uint32_t)data[0]) << 16) + (((uint32_t)data[1]) << 8) + (uint32_t)data[2];
+    if (!I2Cdev::readBytes(m_pressureAddr, MS5611_CMD_ADC, 3, data)) {
+        m_state = MS5611_STATE_IDLE;                        // start again next time
+        return;
+    }
+    result = (((uint32_t)data[0]) << 16) + (((uint32_t)data[1]) << 8) + (uint32_t)data[2];
 
-        //  call this function for testing only
-        //  should give T = 2007 (20.07C) and pressure 100009 (1000.09hPa)
+    //  the ADC reads 0 if the conversion didn't finish - that one is just lost
 
-        // setTestData();
+    if (result != 0) {
+        if (m_state == MS5611_STATE_TEMPERATURE) {
+            m_D2 = result;
+            m_D2Valid = true;
+            m_pressureCount = 0;
+        } else {
+            m_D1 = result;
+            m_pressureCount++;
 
-        //  now calculate the real values
+            //  call this function for testing only
+            //  should give T = 2007 (20.07C) and pressure 100009 (1000.09hPa)
 
-        int64_t deltaT = (int32_t)m_D2 - (((int32_t)m_calData[4]) << 8);
+            // setTestData();
 
-        int32_t temperature = 2000 + ((deltaT * (int64_t)m_calData[5]) >> 23); // note - this needs to be divided by 100
+            //  now calculate the real values
 
-        int64_t offset = ((int64_t)m_calData[1] << 16) + (((int64_t)m_calData[3] * deltaT) >> 7);
-        int64_t sens = ((int64_t)m_calData[0] << 15) + (((int64_t)m_calData[2] * deltaT) >> 8);
+            calculateTemperature();
+            calculatePressure();
 
-        //  do second order temperature compensation
+            // printf("Temp: %f, pressure: %f\n", m_temperature, m_pressure);
 
-        if (temperature < 2000) {
-            int64_t T2 = (deltaT * deltaT) >> 31;
-            int64_t offset2 = 5 * ((temperature - 2000) * (temperature - 2000)) / 2;
-            int64_t sens2 = offset2 / 2;
-            if (temperature < -1500) {
-                offset2 += 7 * (temperature + 1500) * (temperature + 1500);
-                sens2 += 11 * ((temperature + 1500) * (temperature + 1500)) / 2;
-            }
-            temperature -= T2;
-            offset -= offset2;
-            sens -= sens2;
+            m_validReadings = true;
+            pressureNewReading(now);
         }
-
-        m_pressure = (RTFLOAT)(((((int64_t)m_D1 * sens) >> 21) - offset) >> 15) / (RTFLOAT)100.0;
-        m_temperature = (RTFLOAT)temperature / (RTFLOAT)100;
-
-        // printf("Temp: %f, pressure: %f\n", m_temperature, m_pressure);
-
-        m_validReadings = true;
-        m_state = MS5611_STATE_IDLE;
-        break;
     }
+
+    if (!m_D2Valid || (m_pressureCount >= m_temperatureInterval))
+        startConversion(MS5611_STATE_TEMPERATURE);
+    else
+        startConversion(MS5611_STATE_PRESSURE);
 }
 
 void RTPressureMS5611::setTestData()
@@ -160,4 +238,7 @@ void RTPressureMS5611::setTestData()
 
     m_D1 = 9085466;
     m_D2 = 8569150;
+
+    setCoefficients();
 }
+#endif
\ No newline at end of file
@@ -44,9 +44,14 @@ public:
     virtual int pressureType() { return RTPRESSURE_TYPE_MS5611; }
     virtual bool pressureInit();
     virtual bool pressureRead(float &latestPressure, float &latestTemperature);
+    virtual unsigned long pressureGetAccessDue();
 
 private:
     void pressureBackground();
+    bool startConversion(int state);                        // start a D1 (MS5611_STATE_PRESSURE) or D2 conversion
+    void setCoefficients();                                 // fold the calibration data into constants
+    void calculateTemperature();                            // temperature, offset and sensitivity from D2
+    void calculatePressure();                               // compensated pressure from D1
     void setTestData();
 
     unsigned char m_pressureAddr;                           // I2C address
@@ -60,7 +65,23 @@ private:
     uint32_t m_D1;
     uint32_t m_D2;
 
-    long m_timer;                                           // used to time conversions
+    // Constants derived from the calibration data and the temperature terms
+
+    int32_t m_tRef;                                         // C5 << 8
+    int64_t m_offsetBase;                                   // C2 << 16
+    int32_t m_sensBase;                                     // C1 << 15
+    int64_t m_offset;                                       // OFF for the last D2
+    int64_t m_sens;                                         // SENS for the last D2
+    bool m_sens32;                                          // true if SENS fits in 32 bits unsigned
+    uint32_t m_termsD2;                                     // D2 m_offset and m_sens are for
+    bool m_termsValid;                                      // true if the terms are valid
+
+    int m_osr;                                              // oversampling ratio code
+    int m_temperatureInterval;                              // pressure conversions per temperature conversion
+    int m_pressureCount;                                    // pressure conversions since the last temperature one
+    bool m_D2Valid;                                         // true if m_D2 holds a temperature conversion
+    unsigned long m_conversionStart;                        // micros() when the current conversion started
+    unsigned long m_conversionTime;                         // conversion time for m_osr (in uS)
 
     bool m_validReadings;
 };
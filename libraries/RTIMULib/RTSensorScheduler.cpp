@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "RTSensorScheduler.h"
+
+RTSensorScheduler::RTSensorScheduler(RTIMUSettings *settings)
+{
+    m_imu = RTIMU::createIMU(settings);
+    m_pressure = RTPressure::createPressure(settings);
+    m_latestPressure = 0;
+    m_latestTemperature = 0;
+    clearStats();
+}
+
+RTSensorScheduler::~RTSensorScheduler()
+{
+    delete m_imu;
+    delete m_pressure;
+}
+
+int RTSensorScheduler::schedulerInit()
+{
+    int errcode;
+
+    if ((errcode = m_imu->IMUInit()) < 0)
+        return errcode;
+
+    if ((m_pressure != 0) && !m_pressure->pressureInit())
+        return RTSCHEDULER_PRESSURE_INIT_ERROR;
+
+    m_imuInterval = (unsigned long)1000000 / m_imu->IMUGetSampleRate();
+    m_imuExpected = m_imuDue = micros();
+    m_imuBacklog = false;
+    m_imuLocked = false;
+    m_pressureAccessTime = 0;
+    m_pressureHeld = false;
+    m_pressureReadings = m_pressure != 0 ? m_pressure->pressureGetReadingCount() : 0;
+    return errcode;
+}
+
+void RTSensorScheduler::clearStats()
+{
+    m_stats.imuSamples = 0;
+    m_stats.imuEmptyReads = 0;
+    m_stats.imuLateMax = 0;
+    m_stats.imuLateTotal = 0;
+    m_stats.imuAccessMax = 0;
+    m_stats.pressureReadings = 0;
+    m_stats.pressureCalls = 0;
+    m_stats.pressureDeferred = 0;
+    m_stats.pressureWaitMax = 0;
+    m_stats.pressureAccessMax = 0;
+    m_stats.busyMicros = 0;
+}
+
+int RTSensorScheduler::poll()
+{
+    unsigned long now = micros();
+    unsigned long allowance;
+
+    //  the IMU comes first - a sample found means the FIFO may hold more so it's
+    //  read again straight away
+
+    if ((long)(now - m_imuDue) >= 0)
+        return readIMU(now) ? RTSCHEDULER_IMU : 0;
+
+    //  a pressure access only goes ahead if it will be done before the IMU is due
+
+    if ((m_pressure == 0) || ((long)(now - m_pressure->pressureGetAccessDue()) < 0))
+        return 0;
+
+    allowance = m_pressureAccessTime != 0 ? m_pressureAccessTime : RTSCHEDULER_PRESSURE_ACCESS;
+    if (allowance > m_imuInterval / 2)
+        allowance = m_imuInterval / 2;
+
+    //  the wait is measured while it goes on so a starved sensor shows up in the stats
+
+    if ((long)(m_imuDue - now) < (long)allowance) {
+        m_stats.pressureDeferred++;
+        if (!m_pressureHeld) {
+            m_pressureHeld = true;
+            m_pressureHeldSince = now;
+        } else if ((now - m_pressureHeldSince) > m_stats.pressureWaitMax) {
+            m_stats.pressureWaitMax = now - m_pressureHeldSince;
+        }
+        return 0;
+    }
+    m_pressureHeld = false;
+    return readPressure(now) ? RTSCHEDULER_PRESSURE : 0;
+}
+
+bool RTSensorScheduler::readIMU(unsigned long now)
+{
+    bool sample = m_imu->IMURead();
+    unsigned long end = micros();
+    unsigned long late;
+
+    m_stats.busyMicros += end - now;
+    if ((end - now) > m_stats.imuAccessMax)
+        m_stats.imuAccessMax = end - now;
+
+    if (sample) {
+        if (m_imuLocked && !m_imuBacklog && ((long)(now - m_imuExpected) > 0)) {
+            late = now - m_imuExpected;
+            m_stats.imuLateTotal += late;
+            if (late > m_stats.imuLateMax)
+                m_stats.imuLateMax = late;
+        }
+        m_stats.imuSamples++;
+        m_imuExpected = now + m_imuInterval;
+        m_imuBacklog = true;
+        m_imuLocked = true;
+        m_imuDue = end;
+        return true;
+    }
+
+    //  nothing there - the next sample can't be ready much before an interval after the last
+    //  one was seen. The chip's clock isn't exact so it's polled from 7/8 of the interval
+    //  on, in steps short enough to keep the latency down.
+
+    m_stats.imuEmptyReads++;
+    m_imuBacklog = false;
+    if ((long)(end - (m_imuExpected - m_imuInterval / 8)) < 0)
+        m_imuDue = m_imuExpected - m_imuInterval / 8;
+    else
+        m_imuDue = end + m_imuInterval / 64;
+    return false;
+}
+
+bool RTSensorScheduler::readPressure(unsigned long now)
+{
+    float pressure, temperature;
+    unsigned long count;
+    bool ok = m_pressure->pressureRead(pressure, temperature);
+    unsigned long end = micros();
+
+    m_stats.pressureCalls++;
+    m_stats.busyMicros += end - now;
+    if ((end - now) > m_stats.pressureAccessMax)
+        m_stats.pressureAccessMax = end - now;
+
+    //  allow for the longest access seen, but let a one-off slow access be forgotten
+
+    if ((end - now) > m_pressureAccessTime)
+        m_pressureAccessTime = end - now;
+    else
+        m_pressureAccessTime -= (m_pressureAccessTime - (end - now)) / RTSCHEDULER_PRESSURE_DECAY;
+
+    count = m_pressure->pressureGetReadingCount();
+    if (!ok || (count == m_pressureReadings))
+        return false;
+
+    m_pressureReadings = count;
+    m_latestPressure = pressure;
+    m_latestTemperature = temperature;
+    m_stats.pressureReadings++;
+    return true;
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////
+//
+//  This file is part of RTIMULib-Arduino
+//
+//  Copyright (c) 2014-2015, richards-tech
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//  this software and associated documentation files (the "Software"), to deal in
+//  the Software without restriction, including without limitation the rights to use,
+//  copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+//  Software, and to permit persons to whom the Software is furnished to do so,
+//  subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in all
+//  copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//  INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//  PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//  HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//  OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef _RTSENSORSCHEDULER_H
+#define	_RTSENSORSCHEDULER_H
+
+#include "RTIMU.h"
+#include "RTPressure.h"
+
+//  RTSensorScheduler owns the IMU and pressure sensor and decides when each of them uses
+//  the bus. The IMU is read when its next sample is due and pressure accesses are only
+//  made when they will finish before that, so they can't hold up an IMU read. Call poll()
+//  as often as possible - it makes at most one driver call and returns what's new.
+
+//  Flags returned by poll()
+
+#define RTSCHEDULER_IMU                 1                   // a new IMU sample has been read
+#define RTSCHEDULER_PRESSURE            2                   // a new pressure reading has been read
+
+//  schedulerInit() returns this if the pressure sensor fails to init
+
+#define RTSCHEDULER_PRESSURE_INIT_ERROR -100
+
+//  The time a pressure access is assumed to take until one has been timed (uS)
+
+#define RTSCHEDULER_PRESSURE_ACCESS     500
+
+//  The time allowed for a pressure access follows the longest ones seen. It rises straight
+//  away to a longer access and falls 1/RTSCHEDULER_PRESSURE_DECAY of the way to a shorter
+//  one, so a single slow access is forgotten. It's never more than half the IMU interval
+//  so there's always a gap in which the pressure sensor can be read.
+
+#define RTSCHEDULER_PRESSURE_DECAY      16
+
+typedef struct
+{
+    unsigned long imuSamples;                               // IMU samples read
+    unsigned long imuEmptyReads;                            // IMURead() calls that found no sample
+    unsigned long imuLateMax;                               // longest a sample has waited past its expected time (uS)
+    unsigned long imuLateTotal;                             // total of the waits, for the average
+    unsigned long imuAccessMax;                             // longest IMURead() call (uS)
+    unsigned long pressureReadings;                         // new pressure readings
+    unsigned long pressureCalls;                            // pressureRead() calls
+    unsigned long pressureDeferred;                         // due pressure accesses held back for the IMU
+    unsigned long pressureWaitMax;                          // longest a due pressure access has been held back (uS)
+    unsigned long pressureAccessMax;                        // longest pressureRead() call (uS)
+    unsigned long busyMicros;                               // total time in the drivers (uS)
+} RTSCHEDULER_STATS;
+
+class RTSensorScheduler
+{
+public:
+    //  The IMU and pressure sensor are created from the settings - there may be no pressure sensor
+
+    RTSensorScheduler(RTIMUSettings *settings);
+    ~RTSensorScheduler();
+
+    //  schedulerInit() sets up the sensors. It returns the IMUInit() code if that fails.
+
+    int schedulerInit();
+
+    //  poll() returns a combination of the RTSCHEDULER_ flags, 0 if nothing is new
+
+    int poll();
+
+    inline RTIMU *getIMU() { return m_imu; }
+    inline RTPressure *getPressureSensor() { return m_pressure; }
+
+    inline float getPressure() { return m_latestPressure; } // the latest pressure in hPa (0 if none yet)
+    inline float getTemperature() { return m_latestTemperature; } // and the temperature with it
+
+    inline const RTSCHEDULER_STATS& getStats() { return m_stats; }
+    void clearStats();
+
+private:
+    bool readIMU(unsigned long now);                        // IMU access - true if there's a new sample
+    bool readPressure(unsigned long now);                   // pressure access - true if there's a new reading
+
+    RTIMU *m_imu;
+    RTPressure *m_pressure;
+
+    unsigned long m_imuInterval;                            // the IMU sample interval (uS)
+    unsigned long m_imuExpected;                            // when the next IMU sample should be ready
+    unsigned long m_imuDue;                                 // when the IMU should next be read
+    bool m_imuBacklog;                                      // true if the last IMU read found a sample
+    bool m_imuLocked;                                       // true once a sample has given the IMU's timing
+    unsigned long m_pressureAccessTime;                     // the decaying longest pressure access (uS, 0 if none yet)
+    bool m_pressureHeld;                                    // true while a due pressure access is being held back
+    unsigned long m_pressureHeldSince;                      // when it was first held back
+    unsigned long m_pressureReadings;                       // the sensor's reading count last time
+
+    float m_latestPressure;
+    float m_latestTemperature;
+
+    RTSCHEDULER_STATS m_stats;
+};
+
+#endif // _RTSENSORSCHEDULER_H